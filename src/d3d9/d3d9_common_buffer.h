@@ -4,6 +4,10 @@
 #include "d3d9_format.h"
 #include "../dxvk/dxvk_buffer.h"
 
+// NV-DXVK start: zero-copy vertex capture
+#include <unordered_map>
+// NV-DXVK end
+
 namespace dxvk {
 
   /**
@@ -134,6 +138,30 @@ namespace dxvk {
       return m_sliceHandle;
     }
 
+    // NV-DXVK start: zero-copy vertex capture
+    /**
+     * \brief Buffer object aliasing a physical slice
+     *
+     * Returns a clone of the mapping buffer that stays renamed to
+     * the given physical slice, so that an orphaned slice can be
+     * referenced after the buffer was discarded. Physical slices are
+     * owned by the buffer for its entire lifetime, so one clone per
+     * slice is created on first use and retained afterwards.
+     * \param [in] slice Physical slice of the mapping buffer
+     * \returns Buffer object referencing that slice
+     */
+    inline const Rc<DxvkBuffer>& GetSliceAlias(const DxvkBufferSliceHandle& slice) {
+      Rc<DxvkBuffer>& alias = m_sliceAliases[slice.mapPtr];
+
+      if (unlikely(alias == nullptr)) {
+        alias = GetMapBuffer()->clone();
+        alias->rename(slice);
+      }
+
+      return alias;
+    }
+    // NV-DXVK end
+
     inline DWORD GetMapFlags() const      { return m_mapFlags; }
     inline void SetMapFlags(DWORD Flags)  { m_mapFlags = Flags; }
 
@@ -218,6 +246,10 @@ namespace dxvk {
     D3D9Range                   m_gpuReadingRange;
 
     uint32_t                    m_lockCount = 0;
+
+    // NV-DXVK start: zero-copy vertex capture
+    std::unordered_map<const void*, Rc<DxvkBuffer>> m_sliceAliases;
+    // NV-DXVK end
   };
 
 }
\ No newline at end of file
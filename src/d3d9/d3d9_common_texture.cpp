@@ -79,6 +79,11 @@ namespace dxvk {
     if (m_size != 0)
       m_device->ChangeReportedMemory(m_size);
 
+    // NV-DXVK start: asynchronous texture hashing
+    if (m_image != nullptr)
+      m_device->GetTextureHasher().WaitForImage(m_image.ptr());
+    // NV-DXVK end
+
     // Release this texture from ImGUI 
     if (m_image != nullptr && m_image->getHash() != 0)
       ImGUI::ReleaseTexture(m_image->getHash());
@@ -539,7 +544,8 @@ namespace dxvk {
     if (m_type != D3DRTYPE_TEXTURE || (m_desc.Usage & D3DUSAGE_DEPTHSTENCIL))
       return;
 
-    if (m_image->getHash() != 0) {
+    // NV-DXVK start: asynchronous texture hashing
+    if (m_image->isHashPending() || m_image->getHash() != 0) {
       // Already setup.
       return;
     }
@@ -552,17 +558,25 @@ namespace dxvk {
     if (nullptr == buffer.ptr())
       return;
 
-    const bool useObsoleteHashMethod = NeedsUpload(subresource) &&
+    D3D9TextureHashParams params;
+    params.obsolete = NeedsUpload(subresource) &&
       RtxOptions::Get()->shouldUseObsoleteHashOnTextureUpload();
+    params.version = RtxOptions::textureHashVersion();
+    params.treeMinSize = RtxOptions::textureTreeHashMinSize();
+
+    if (likely(RtxOptions::asyncTextureHashing())) {
+      // Anything reading the hash before the worker is done waits for it
+      m_device->GetTextureHasher().HashTexture(
+        m_image, m_sampleView.Color, buffer,
+        buffer->mapPtr(0), buffer->info().size, params);
+      return;
+    }
 
     // Generate hash from CPU buffer
-    XXH64_hash_t imageHash;
+    XXH64_hash_t imageHash = D3D9TextureHasher::ComputeHash(
+      buffer->mapPtr(0), buffer->info().size, params);
+    // NV-DXVK end
 
-    if (unlikely(useObsoleteHashMethod)) {
-      imageHash = XXH64(buffer->mapPtr(0), buffer->info().size, 0);
-    } else {
-      imageHash = XXH3_64bits(buffer->mapPtr(0), buffer->info().size);
-    }
     // save hash to dxvkImage
     m_image->setHash(imageHash);
 
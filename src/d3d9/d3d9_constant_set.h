@@ -10,6 +10,11 @@
 #include "../util/util_vector.h"
 
 #include <cstdint>
+// NV-DXVK start: dirty-range constant uploads
+#include <array>
+#include <cstring>
+#include <unordered_map>
+// NV-DXVK end
 
 namespace dxvk {
 
@@ -44,11 +49,121 @@ namespace dxvk {
     Rc<DxvkBuffer>        boolBuffer;
   };
 
+  // NV-DXVK start: dirty-range constant uploads
+  /**
+   * \brief Float constant block tracker
+   *
+   * Constant buffers are renamed on every upload, and the buffer
+   * recycles its slices once the GPU is done with them. Nothing else
+   * writes to these slices, so a recycled slice still holds the data
+   * of the upload it was last used for. The tracker stamps each block
+   * of 16 registers with the upload generation it was last modified
+   * in, and only copies the blocks a slice has not seen yet.
+   */
+  class D3D9ConstantBlockTracker {
+
+  public:
+
+    constexpr static uint32_t RegistersPerBlock = 16;
+    constexpr static uint32_t MaxBlocks = caps::MaxFloatConstantsSoftware / RegistersPerBlock;
+
+    D3D9ConstantBlockTracker() {
+      m_blockGeneration.fill(m_generation);
+    }
+
+    /**
+     * \brief Marks a register range as modified
+     *
+     * \param [in] firstReg First register
+     * \param [in] count Number of registers
+     */
+    void markDirty(uint32_t firstReg, uint32_t count) {
+      if (unlikely(!count))
+        return;
+
+      uint32_t firstBlock = firstReg / RegistersPerBlock;
+      uint32_t lastBlock  = std::min((firstReg + count - 1) / RegistersPerBlock, MaxBlocks - 1);
+
+      for (uint32_t i = firstBlock; i <= lastBlock; i++)
+        m_blockGeneration[i] = m_generation;
+    }
+
+    /**
+     * \brief Forgets the contents of all known slices
+     *
+     * Must be called when the buffer is recreated, since
+     * slices of the new buffer may alias old mappings.
+     */
+    void reset() {
+      m_slices.clear();
+    }
+
+    /**
+     * \brief Copies modified registers into a slice
+     *
+     * \param [in] dst Mapped pointer of the newly allocated slice
+     * \param [in] src Source register array
+     * \param [in] regCount Number of registers the slice must hold
+     * \returns Number of bytes copied
+     */
+    uint32_t copy(void* dst, const Vector4* src, uint32_t regCount) {
+      SliceState& slice = m_slices[dst];
+
+      auto mustCopy = [&] (uint32_t block) {
+        return m_blockGeneration[block] > slice.generation
+            || (block + 1) * RegistersPerBlock > slice.regCount;
+      };
+
+      uint32_t blockCount = divCeil(regCount, RegistersPerBlock);
+      uint32_t copied = 0;
+
+      for (uint32_t i = 0; i < blockCount; ) {
+        if (!mustCopy(i)) {
+          i++;
+          continue;
+        }
+
+        uint32_t first = i;
+
+        while (i < blockCount && mustCopy(i))
+          i++;
+
+        uint32_t firstReg = first * RegistersPerBlock;
+        uint32_t size = (std::min(i * RegistersPerBlock, regCount) - firstReg) * sizeof(Vector4);
+
+        std::memcpy(reinterpret_cast<Vector4*>(dst) + firstReg, src + firstReg, size);
+        copied += size;
+      }
+
+      slice.generation = m_generation++;
+      slice.regCount   = regCount;
+      return copied;
+    }
+
+  private:
+
+    struct SliceState {
+      uint64_t generation = 0;
+      uint32_t regCount   = 0;
+    };
+
+    uint64_t m_generation = 1;
+
+    std::array<uint64_t, MaxBlocks> m_blockGeneration;
+
+    std::unordered_map<const void*, SliceState> m_slices;
+
+  };
+  // NV-DXVK end
+
   struct D3D9ConstantSets {
     D3D9SwvpConstantBuffers   swvpBuffers;
     Rc<DxvkBuffer>            buffer;
     DxsoShaderMetaInfo        meta  = {};
     bool                      dirty = true;
+    // NV-DXVK start: dirty-range constant uploads
+    D3D9ConstantBlockTracker  floatBlocks;
+    // NV-DXVK end
   };
 
 }
\ No newline at end of file
@@ -35,12 +35,18 @@
 #include "d3d9_spec_constants.h"
 #include "d3d9_names.h"
 #include "d3d9_format_helpers.h"
+// NV-DXVK start: CPU vertex processing
+#include "d3d9_swvp_cpu.h"
+// NV-DXVK end
 
 #include "../dxvk/dxvk_adapter.h"
 #include "../dxvk/dxvk_instance.h"
 
 #include "../util/util_bit.h"
 #include "../util/util_math.h"
+// NV-DXVK start: draw stage profiling
+#include "../util/log/draw_profiler.h"
+// NV-DXVK end
 
 #include "../dxvk/rtx_render/rtx_context.h"
 #include "../dxvk/rtx_render/rtx_options.h"
@@ -140,6 +146,24 @@ namespace dxvk {
 
     CreateConstantBuffers();
 
+    // NV-DXVK start: asynchronous shader compilation
+    const uint32_t shaderThreadCount = m_d3d9Options.numShaderCompilerThreads > 0
+      ? uint32_t(m_d3d9Options.numShaderCompilerThreads)
+      : std::max(1u, dxvk::thread::hardware_concurrency() / 4);
+    // NV-DXVK end
+
+    // NV-DXVK start: persistent shader cache
+    if (m_d3d9Options.enableShaderCache && env::getEnvVar("DXVK_STATE_CACHE") != "0") {
+      m_shaderModules->EnableDiskCache();
+      m_ffModules.EnableDiskCache(this, m_d3d9Options.ffShaderStateLog, shaderThreadCount);
+    }
+    // NV-DXVK end
+
+    // NV-DXVK start: asynchronous shader compilation
+    if (m_d3d9Options.asyncShaderCompile)
+      m_shaderModules->EnableAsyncCompile(shaderThreadCount);
+    // NV-DXVK end
+
     m_availableMemory = DetermineInitialTextureMemory();
 
     // NV-DXVK start: Consolidate RTX state
@@ -149,6 +173,14 @@ namespace dxvk {
 
 
   D3D9DeviceEx::~D3D9DeviceEx() {
+    // NV-DXVK start: asynchronous shader compilation
+    // Compile jobs reference the device
+    m_shaderModules->StopAsyncCompile();
+    // NV-DXVK end
+    // NV-DXVK start: fixed function shader cache
+    m_ffModules.StopPrecompile();
+    // NV-DXVK end
+
     Flush();
     SynchronizeCsThread();
 
@@ -1739,6 +1771,11 @@ namespace dxvk {
     if (unlikely(ShouldRecord()))
       return m_recorder->SetMaterial(pMaterial);
 
+    // NV-DXVK start: redundant state filtering
+    if (std::memcmp(&m_state.material, pMaterial, sizeof(D3DMATERIAL9)) == 0)
+      return D3D_OK;
+    // NV-DXVK end
+
     m_state.material = *pMaterial;
     m_flags.set(D3D9DeviceFlag::DirtyFFVertexData);
 
@@ -2180,7 +2217,9 @@ namespace dxvk {
           break;
 
         case D3DRS_SHADEMODE:
-          if (m_state.pixelShader != nullptr) {
+          // NV-DXVK start: asynchronous shader compilation
+          if (m_state.pixelShader != nullptr && !m_flags.test(D3D9DeviceFlag::PendingPixelShader)) {
+          // NV-DXVK end
             BindShader<DxsoProgramType::PixelShader>(
               GetCommonShader(m_state.pixelShader),
               GetPixelShaderPermutation());
@@ -2495,6 +2534,10 @@ namespace dxvk {
           UINT             PrimitiveCount) {
     ScopedCpuProfileZone();
 
+    // NV-DXVK start: draw stage profiling
+    DrawStageScope validationScope(DrawStage::D3D9Validation);
+    // NV-DXVK end
+
     D3D9DeviceLock lock = LockDevice();
 
     if (unlikely(m_state.vertexDecl == nullptr))
@@ -2503,11 +2546,20 @@ namespace dxvk {
     if (unlikely(!PrimitiveCount))
       return S_OK;
 
+    // NV-DXVK start: asynchronous shader compilation
+    if (unlikely(!ResolvePendingShaders(true)))
+      return D3D_OK;
+    // NV-DXVK end
+
     // NV-DXVK start: geometry processing
+    validationScope.end();
+
     const D3D9Rtx::DrawContext drawContext { PrimitiveType, (INT) StartVertex, 0, 0, 0, PrimitiveCount, FALSE };
     const auto [preserveOriginalDraw, pendingCommit] = m_rtx.PrepareDrawGeometryForRT(false, drawContext);
 
     if (preserveOriginalDraw) {
+      DrawStageScope rasterScope(DrawStage::RasterSetup);
+
       PrepareDraw(PrimitiveType);
 
       EmitCs([this,
@@ -2545,6 +2597,10 @@ namespace dxvk {
           UINT             PrimitiveCount) {
     ScopedCpuProfileZone();
 
+    // NV-DXVK start: draw stage profiling
+    DrawStageScope validationScope(DrawStage::D3D9Validation);
+    // NV-DXVK end
+
     D3D9DeviceLock lock = LockDevice();
 
     if (unlikely(m_state.vertexDecl == nullptr))
@@ -2553,11 +2609,20 @@ namespace dxvk {
     if (unlikely(!PrimitiveCount))
       return S_OK;
 
+    // NV-DXVK start: asynchronous shader compilation
+    if (unlikely(!ResolvePendingShaders(true)))
+      return D3D_OK;
+    // NV-DXVK end
+
     // NV-DXVK start: geometry processing
+    validationScope.end();
+
     const D3D9Rtx::DrawContext drawContext = { PrimitiveType, BaseVertexIndex, MinVertexIndex, NumVertices, StartIndex, PrimitiveCount, TRUE };
     const auto [preserveOriginalDraw, pendingCommit] = m_rtx.PrepareDrawGeometryForRT(true, drawContext);
 
     if (preserveOriginalDraw) {
+      DrawStageScope rasterScope(DrawStage::RasterSetup);
+
       PrepareDraw(PrimitiveType);
 
       EmitCs([this,
@@ -2595,6 +2660,10 @@ namespace dxvk {
           UINT             VertexStreamZeroStride) {
     ScopedCpuProfileZone();
 
+    // NV-DXVK start: draw stage profiling
+    DrawStageScope validationScope(DrawStage::D3D9Validation);
+    // NV-DXVK end
+
     D3D9DeviceLock lock = LockDevice();
 
     if (unlikely(m_state.vertexDecl == nullptr))
@@ -2603,6 +2672,15 @@ namespace dxvk {
     if (unlikely(!PrimitiveCount))
       return S_OK;
 
+    // NV-DXVK start: asynchronous shader compilation
+    if (unlikely(!ResolvePendingShaders(true))) {
+      m_state.vertexBuffers[0].vertexBuffer = nullptr;
+      m_state.vertexBuffers[0].offset = 0;
+      m_state.vertexBuffers[0].stride = 0;
+      return D3D_OK;
+    }
+    // NV-DXVK end
+
     auto drawInfo = GenerateDrawInfo(PrimitiveType, PrimitiveCount, 0);
 
     const uint32_t dataSize = GetUPDataSize(drawInfo.vertexCount, VertexStreamZeroStride);
@@ -2612,10 +2690,14 @@ namespace dxvk {
     FillUPVertexBuffer(upSlice.mapPtr, pVertexStreamZeroData, dataSize, bufferSize);
 
     // NV-DXVK start: geometry processing
+    validationScope.end();
+
     const D3D9Rtx::DrawContext drawContext = { PrimitiveType, 0, 0, 0, 0, PrimitiveCount, FALSE };
     const auto [preserveOriginalDraw, pendingCommit] = m_rtx.PrepareDrawUPGeometryForRT(false, upSlice, D3DFMT_UNKNOWN, 0, 0, dataSize, VertexStreamZeroStride, drawContext);
 
     if (preserveOriginalDraw) {
+      DrawStageScope rasterScope(DrawStage::RasterSetup);
+
       PrepareDraw(PrimitiveType);
 
       EmitCs([this,
@@ -2660,6 +2742,10 @@ namespace dxvk {
           UINT             VertexStreamZeroStride) {
     ScopedCpuProfileZone();
 
+    // NV-DXVK start: draw stage profiling
+    DrawStageScope validationScope(DrawStage::D3D9Validation);
+    // NV-DXVK end
+
     D3D9DeviceLock lock = LockDevice();
 
     if (unlikely(m_state.vertexDecl == nullptr))
@@ -2668,6 +2754,15 @@ namespace dxvk {
     if (unlikely(!PrimitiveCount))
       return S_OK;
 
+    // NV-DXVK start: asynchronous shader compilation
+    if (unlikely(!ResolvePendingShaders(true))) {
+      m_state.vertexBuffers[0].vertexBuffer = nullptr;
+      m_state.vertexBuffers[0].offset = 0;
+      m_state.vertexBuffers[0].stride = 0;
+      return D3D_OK;
+    }
+    // NV-DXVK end
+
     auto drawInfo = GenerateDrawInfo(PrimitiveType, PrimitiveCount, 0);
 
     const uint32_t vertexDataSize = GetUPDataSize(MinVertexIndex + NumVertices, VertexStreamZeroStride);
@@ -2684,10 +2779,14 @@ namespace dxvk {
     std::memcpy(data + vertexBufferSize, pIndexData, indicesSize);
 
     // NV-DXVK start: geometry processing
+    validationScope.end();
+
     const D3D9Rtx::DrawContext drawContext = { PrimitiveType, 0, MinVertexIndex, NumVertices, 0, PrimitiveCount, TRUE };
     const auto [preserveOriginalDraw, pendingCommit] = m_rtx.PrepareDrawUPGeometryForRT(true, upSlice, IndexDataFormat, indicesSize, vertexDataSize, vertexDataSize, VertexStreamZeroStride, drawContext);
 
     if (preserveOriginalDraw) {
+      DrawStageScope rasterScope(DrawStage::RasterSetup);
+
       PrepareDraw(PrimitiveType);
 
       EmitCs([this,
@@ -2750,6 +2849,17 @@ namespace dxvk {
     D3D9CommonBuffer* dst  = static_cast<D3D9VertexBuffer*>(pDestBuffer)->GetCommonBuffer();
     D3D9VertexDecl*   decl = static_cast<D3D9VertexDecl*>  (pVertexDecl);
 
+    // NV-DXVK start: CPU vertex processing
+    if (m_d3d9Options.cpuProcessVertices
+     && ProcessVerticesCpu(SrcStartIndex, DestIndex, VertexCount, dst, decl))
+      return D3D_OK;
+    // NV-DXVK end
+
+    // NV-DXVK start: asynchronous shader compilation
+    if (unlikely(!ResolvePendingShaders(false)))
+      return D3D_OK;
+    // NV-DXVK end
+
     PrepareDraw(D3DPT_FORCE_DWORD);
 
     if (decl == nullptr) {
@@ -2950,7 +3060,7 @@ namespace dxvk {
     DxsoModuleInfo moduleInfo;
     moduleInfo.options = m_dxsoOptions;
 
-    D3D9CommonShader module;
+    D3D9ShaderModule module;
 
     if (FAILED(this->CreateShaderModule(&module,
       VK_SHADER_STAGE_VERTEX_BIT,
@@ -2975,8 +3085,32 @@ namespace dxvk {
     if (shader == m_state.vertexShader.ptr())
       return D3D_OK;
 
-    auto* oldShader = GetCommonShader(m_state.vertexShader);
+    // NV-DXVK start: asynchronous shader compilation
+    // Shaders that are still compiling get applied when they
+    // are first drawn with, see ResolvePendingShaders.
+    const D3D9CommonShader* oldShader = m_flags.test(D3D9DeviceFlag::PendingVertexShader)
+      ? nullptr : GetCommonShader(m_state.vertexShader);
+
+    if (unlikely(shader != nullptr && !IsShaderUsable(shader))) {
+      m_state.vertexShader = shader;
+      m_flags.set(D3D9DeviceFlag::PendingVertexShader);
+      return D3D_OK;
+    }
+
+    m_flags.clr(D3D9DeviceFlag::PendingVertexShader);
+
+    // The old shader may only be kept alive by the state
+    ApplyVertexShader(shader, oldShader);
+    m_state.vertexShader = shader;
+    return D3D_OK;
+  }
+
+
+  void D3D9DeviceEx::ApplyVertexShader(
+          D3D9VertexShader* shader,
+    const D3D9CommonShader* oldShader) {
     auto* newShader = GetCommonShader(shader);
+    // NV-DXVK end
 
     bool oldCopies = oldShader && oldShader->GetMeta().needsConstantCopies;
     bool newCopies = newShader && newShader->GetMeta().needsConstantCopies;
@@ -2991,8 +3125,6 @@ namespace dxvk {
         || newShader->GetMeta().maxConstIndexB > oldShader->GetMeta().maxConstIndexB;
     }
 
-    m_state.vertexShader = shader;
-
     if (shader != nullptr) {
       BindShader<DxsoProgramTypes::VertexShader>(
         GetCommonShader(shader),
@@ -3004,8 +3136,6 @@ namespace dxvk {
       m_vsShaderMasks = D3D9ShaderMasks();
 
     m_flags.set(D3D9DeviceFlag::DirtyInputLayout);
-
-    return D3D_OK;
   }
 
 
@@ -3279,7 +3409,7 @@ namespace dxvk {
     DxsoModuleInfo moduleInfo;
     moduleInfo.options = m_dxsoOptions;
 
-    D3D9CommonShader module;
+    D3D9ShaderModule module;
 
     if (FAILED(this->CreateShaderModule(&module,
       VK_SHADER_STAGE_FRAGMENT_BIT,
@@ -3304,8 +3434,30 @@ namespace dxvk {
     if (shader == m_state.pixelShader.ptr())
       return D3D_OK;
 
-    auto* oldShader = GetCommonShader(m_state.pixelShader);
+    // NV-DXVK start: asynchronous shader compilation
+    const D3D9CommonShader* oldShader = m_flags.test(D3D9DeviceFlag::PendingPixelShader)
+      ? nullptr : GetCommonShader(m_state.pixelShader);
+
+    if (unlikely(shader != nullptr && !IsShaderUsable(shader))) {
+      m_state.pixelShader = shader;
+      m_flags.set(D3D9DeviceFlag::PendingPixelShader);
+      return D3D_OK;
+    }
+
+    m_flags.clr(D3D9DeviceFlag::PendingPixelShader);
+
+    // The old shader may only be kept alive by the state
+    ApplyPixelShader(shader, oldShader);
+    m_state.pixelShader = shader;
+    return D3D_OK;
+  }
+
+
+  void D3D9DeviceEx::ApplyPixelShader(
+          D3D9PixelShader* shader,
+    const D3D9CommonShader* oldShader) {
     auto* newShader = GetCommonShader(shader);
+    // NV-DXVK end
 
     bool oldCopies = oldShader && oldShader->GetMeta().needsConstantCopies;
     bool newCopies = newShader && newShader->GetMeta().needsConstantCopies;
@@ -3320,8 +3472,6 @@ namespace dxvk {
         || newShader->GetMeta().maxConstIndexB > oldShader->GetMeta().maxConstIndexB;
     }
 
-    m_state.pixelShader = shader;
-
     if (shader != nullptr) {
       m_flags.set(D3D9DeviceFlag::DirtyFFPixelShader);
 
@@ -3340,8 +3490,6 @@ namespace dxvk {
     }
 
     UpdateActiveHazardsRT(UINT32_MAX);
-
-    return D3D_OK;
   }
 
 
@@ -3919,17 +4067,24 @@ namespace dxvk {
     if (unlikely(ShouldRecord()))
       return m_recorder->SetStateTransform(idx, pMatrix);
 
-    m_state.transforms[idx] = ConvertMatrix(pMatrix);
+    // NV-DXVK start: signal that a transform has updated
+    m_rtx.SetTransformDirty(idx);
+    // NV-DXVK end
+
+    // NV-DXVK start: redundant state filtering
+    const Matrix4 matrix = ConvertMatrix(pMatrix);
+
+    if (m_state.transforms[idx] == matrix)
+      return D3D_OK;
+
+    m_state.transforms[idx] = matrix;
+    // NV-DXVK end
 
     m_flags.set(D3D9DeviceFlag::DirtyFFVertexData);
 
     if (idx == GetTransformIndex(D3DTS_VIEW) || idx >= GetTransformIndex(D3DTS_WORLD))
       m_flags.set(D3D9DeviceFlag::DirtyFFVertexBlend);
 
-    // NV-DXVK start: signal that a transform has updated
-    m_rtx.SetTransformDirty(idx);
-    // NV-DXVK end
-
     return D3D_OK;
   }
 
@@ -4388,6 +4543,12 @@ namespace dxvk {
 
     const Rc<DxvkBuffer> mappedBuffer = pResource->GetBuffer(Subresource);
 
+    // NV-DXVK start: asynchronous texture hashing
+    // The application may overwrite data that is still being hashed
+    if (!(Flags & D3DLOCK_READONLY))
+      m_textureHasher.WaitForBuffer(mappedBuffer.ptr());
+    // NV-DXVK end
+
     auto& formatMapping = pResource->GetFormatMapping();
 
     const DxvkFormatInfo* formatInfo = formatMapping.IsValid()
@@ -5217,7 +5378,9 @@ namespace dxvk {
     // Max copy source size is 8192 * 16 => always aligned to any plausible value
     // => we won't copy out of bounds
     if (likely(constSet.meta.maxConstIndexF != 0 || floatBuffer == nullptr)) {
-      DxvkBufferSliceHandle floatBufferSlice = CopySoftwareConstants(DxsoConstantBuffers::VSFloatConstantBuffer, floatBuffer, Src.fConsts, floatDataSize, m_dxsoOptions.vertexFloatConstantBufferAsSSBO);
+      // NV-DXVK start: dirty-range constant uploads
+      DxvkBufferSliceHandle floatBufferSlice = CopySoftwareConstants(DxsoConstantBuffers::VSFloatConstantBuffer, floatBuffer, Src.fConsts, floatDataSize, m_dxsoOptions.vertexFloatConstantBufferAsSSBO, &constSet.floatBlocks);
+      // NV-DXVK end
 
       if (constSet.meta.needsConstantCopies) {
         Vector4* data = reinterpret_cast<Vector4*>(floatBufferSlice.mapPtr);
@@ -5225,8 +5388,13 @@ namespace dxvk {
         auto& shaderConsts = GetCommonShader(m_state.vertexShader)->GetConstants();
 
         for (const auto& constant : shaderConsts) {
-          if (constant.uboIdx < constSet.meta.maxConstIndexF)
+          if (constant.uboIdx < constSet.meta.maxConstIndexF) {
             data[constant.uboIdx] = *reinterpret_cast<const Vector4*>(constant.float32);
+            // NV-DXVK start: dirty-range constant uploads
+            // The slice no longer matches the application's constants here
+            constSet.floatBlocks.markDirty(constant.uboIdx, 1);
+            // NV-DXVK end
+          }
         }
       }
     }
@@ -5245,7 +5413,9 @@ namespace dxvk {
   }
 
 
-  inline DxvkBufferSliceHandle D3D9DeviceEx::CopySoftwareConstants(DxsoConstantBuffers cBufferTarget, Rc<DxvkBuffer>& dstBuffer, const void* src, uint32_t size, bool useSSBO) {
+  // NV-DXVK start: dirty-range constant uploads
+  inline DxvkBufferSliceHandle D3D9DeviceEx::CopySoftwareConstants(DxsoConstantBuffers cBufferTarget, Rc<DxvkBuffer>& dstBuffer, const void* src, uint32_t size, bool useSSBO, D3D9ConstantBlockTracker* pTracker) {
+  // NV-DXVK end
     uint32_t alignment = useSSBO ? m_robustSSBOAlignment : m_robustUBOAlignment;
     alignment = std::max(alignment, 64u);
     size = std::max(size, alignment);
@@ -5255,6 +5425,11 @@ namespace dxvk {
     if (unlikely(dstBuffer == nullptr || dstBuffer->info().size < size)) {
       dstBuffer = CreateConstantBuffer(useSSBO, size, DxsoProgramType::VertexShader, cBufferTarget);
       slice = dstBuffer->getSliceHandle();
+
+      // NV-DXVK start: dirty-range constant uploads
+      if (pTracker)
+        pTracker->reset();
+      // NV-DXVK end
     } else {
       slice = dstBuffer->allocSlice();
       EmitCs([
@@ -5265,7 +5440,16 @@ namespace dxvk {
       });
     }
 
-    std::memcpy(slice.mapPtr, src, size);
+    // NV-DXVK start: dirty-range constant uploads
+    uint32_t copied = size;
+
+    if (pTracker)
+      copied = pTracker->copy(slice.mapPtr, reinterpret_cast<const Vector4*>(src), size / sizeof(Vector4));
+    else
+      std::memcpy(slice.mapPtr, src, size);
+
+    RecordConstantUpload(copied, size);
+    // NV-DXVK end
     return slice;
   }
 
@@ -5322,10 +5506,20 @@ namespace dxvk {
 
     auto* dst = reinterpret_cast<HardwareLayoutType*>(slice.mapPtr);
 
-    if (constSet.meta.maxConstIndexI != 0)
+    // NV-DXVK start: dirty-range constant uploads
+    uint32_t uploadedBytes = 0;
+
+    if (constSet.meta.maxConstIndexI != 0) {
       std::memcpy(dst->iConsts, Src.iConsts, intDataSize);
+      uploadedBytes += intDataSize;
+    }
     if (constSet.meta.maxConstIndexF != 0)
-      std::memcpy(dst->fConsts, Src.fConsts, floatDataSize);
+      uploadedBytes += constSet.floatBlocks.copy(dst->fConsts, Src.fConsts, floatDataSize / sizeof(Vector4));
+
+    RecordConstantUpload(uploadedBytes,
+      (constSet.meta.maxConstIndexI != 0 ? intDataSize   : 0) +
+      (constSet.meta.maxConstIndexF != 0 ? floatDataSize : 0));
+    // NV-DXVK end
 
     if (constSet.meta.needsConstantCopies) {
       Vector4* data = reinterpret_cast<Vector4*>(dst->fConsts);
@@ -5333,8 +5527,12 @@ namespace dxvk {
       auto& shaderConsts = GetCommonShader(Shader)->GetConstants();
 
       for (const auto& constant : shaderConsts) {
-        if (constant.uboIdx < constSet.meta.maxConstIndexF)
+        if (constant.uboIdx < constSet.meta.maxConstIndexF) {
           data[constant.uboIdx] = *reinterpret_cast<const Vector4*>(constant.float32);
+          // NV-DXVK start: dirty-range constant uploads
+          constSet.floatBlocks.markDirty(constant.uboIdx, 1);
+          // NV-DXVK end
+        }
       }
     }
   }
@@ -6258,6 +6456,230 @@ namespace dxvk {
   }
 
   
+  // NV-DXVK start: asynchronous shader compilation
+  bool D3D9DeviceEx::ResolvePendingShaders(bool allowSkip) {
+    const bool vsPending = m_flags.test(D3D9DeviceFlag::PendingVertexShader);
+    const bool psPending = m_flags.test(D3D9DeviceFlag::PendingPixelShader);
+
+    if (likely(!vsPending && !psPending))
+      return true;
+
+    if (allowSkip && m_d3d9Options.skipDrawsWithPendingShaders) {
+      if ((vsPending && !m_state.vertexShader->IsCompiled())
+       || (psPending && !m_state.pixelShader->IsCompiled())) {
+        m_pendingShaderSkippedDraws += 1;
+        return false;
+      }
+    }
+
+    auto t0 = dxvk::high_resolution_clock::now();
+
+    // Wait for the shaders to finish compiling. Shaders that
+    // failed to compile stay pending, we skip all draws that
+    // would use them.
+    bool usable = (!vsPending || HasShaderModule(m_state.vertexShader.ptr()))
+               && (!psPending || HasShaderModule(m_state.pixelShader.ptr()));
+
+    auto t1 = dxvk::high_resolution_clock::now();
+    m_pendingShaderWaitUs += std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+
+    if (unlikely(!usable)) {
+      m_pendingShaderSkippedDraws += 1;
+      return false;
+    }
+
+    // The previously applied shaders are unknown at this point,
+    // passing null makes sure that constants get re-uploaded.
+    if (vsPending) {
+      m_flags.clr(D3D9DeviceFlag::PendingVertexShader);
+      ApplyVertexShader(m_state.vertexShader.ptr(), nullptr);
+    }
+
+    if (psPending) {
+      m_flags.clr(D3D9DeviceFlag::PendingPixelShader);
+      ApplyPixelShader(m_state.pixelShader.ptr(), nullptr);
+    }
+
+    return true;
+  }
+  // NV-DXVK end
+
+  // NV-DXVK start: CPU vertex processing
+  bool D3D9DeviceEx::ProcessVerticesCpu(
+          UINT                         SrcStartIndex,
+          UINT                         DestIndex,
+          UINT                         VertexCount,
+          D3D9CommonBuffer*            pDst,
+    const D3D9VertexDecl*              pDecl) {
+    ScopedCpuProfileZone();
+
+    const D3D9VertexDecl* srcDecl = m_state.vertexDecl.ptr();
+
+    if (m_state.vertexShader != nullptr || srcDecl == nullptr || GetInstanceCount() != 1)
+      return false;
+
+    if (srcDecl->TestFlag(D3D9VertexDeclFlag::HasPositionT)
+     || m_state.renderStates[D3DRS_VERTEXBLEND] != D3DVBF_DISABLE)
+      return false;
+
+    const D3D9VertexElements& srcElements = srcDecl->GetElements();
+    const D3D9VertexElements& dstElements = pDecl->GetElements();
+
+    if (!D3D9SWVPCpuKernel::SupportsDeclarations(
+          srcElements.data(), uint32_t(srcElements.size()),
+          dstElements.data(), uint32_t(dstElements.size())))
+      return false;
+
+    // The kernel only passes texture coordinates through
+    for (const auto& element : dstElements) {
+      if (element.Usage != D3DDECLUSAGE_TEXCOORD)
+        continue;
+
+      const auto& stage = m_state.textureStages[element.UsageIndex];
+
+      if ((stage[DXVK_TSS_TEXCOORDINDEX] & TCIMask) != DXVK_TSS_TCI_PASSTHRU
+       || (stage[DXVK_TSS_TEXTURETRANSFORMFLAGS] & ~D3DTTFF_PROJECTED & 0b111) != D3DTTFF_DISABLE)
+        return false;
+    }
+
+    if (VertexCount == 0)
+      return true;
+
+    // Source data has to be current on the CPU, i.e. not
+    // written by a previous ProcessVertices call on the GPU.
+    std::array<D3D9SWVPCpuStream, caps::MaxStreams> streams = { };
+
+    for (const auto& element : srcElements) {
+      const D3D9VBO& vbo = m_state.vertexBuffers[element.Stream];
+
+      if (vbo.vertexBuffer == nullptr)
+        return false;
+
+      D3D9CommonBuffer* buffer = vbo.vertexBuffer->GetCommonBuffer();
+      const uint8_t* mapPtr = reinterpret_cast<const uint8_t*>(buffer->GetMappedSlice().mapPtr);
+
+      const uint64_t end = uint64_t(vbo.offset) + element.Offset
+                         + uint64_t(SrcStartIndex + VertexCount - 1) * vbo.stride
+                         + GetDecltypeSize(D3DDECLTYPE(element.Type));
+
+      if (mapPtr == nullptr || buffer->WasWrittenByGPU() || end > buffer->Desc()->Size)
+        return false;
+
+      streams[element.Stream].data   = mapPtr + vbo.offset;
+      streams[element.Stream].stride = vbo.stride;
+    }
+
+    // Write through the mapping buffer and upload the result like
+    // an unlock would, so that CPU reads never wait on the GPU.
+    if (pDst->GetMapMode() != D3D9_COMMON_BUFFER_MAP_MODE_BUFFER)
+      return false;
+
+    const uint32_t dstStride = pDecl->GetSize();
+    const uint64_t dstOffset = uint64_t(DestIndex) * dstStride;
+    const uint64_t dstSize   = uint64_t(VertexCount) * dstStride;
+
+    uint8_t* dstPtr = reinterpret_cast<uint8_t*>(pDst->GetMappedSlice().mapPtr);
+
+    if (dstPtr == nullptr || dstOffset + dstSize > pDst->Desc()->Size)
+      return false;
+
+    D3D9Range dstRange = D3D9Range(uint32_t(dstOffset), uint32_t(dstOffset + dstSize));
+
+    if (pDst->WasWrittenByGPU() || (!pDst->DoesStagingBufferUploads() && pDst->GPUReadingRange().Overlaps(dstRange))) {
+      if (!WaitForResource(pDst->GetBuffer<D3D9_COMMON_BUFFER_TYPE_MAPPING>(), 0))
+        return false;
+
+      pDst->SetWrittenByGPU(false);
+      pDst->GPUReadingRange().Clear();
+    }
+
+    // Same state the fixed function vertex shader would use,
+    // see UpdateFixedFunctionVS.
+    Matrix4 view = m_state.transforms[GetTransformIndex(D3DTS_VIEW)];
+
+    if (view[3][3] == 0.0f)
+      view[3][3] = 1.0f;
+
+    D3D9SWVPCpuState state;
+    state.WorldView    = view * m_state.transforms[GetTransformIndex(D3DTS_WORLD)];
+    state.NormalMatrix = inverse(state.WorldView);
+    state.Projection   = m_state.transforms[GetTransformIndex(D3DTS_PROJECTION)];
+
+    const bool hasColor0   = srcDecl->TestFlag(D3D9VertexDeclFlag::HasColor0);
+    const bool hasColor1   = srcDecl->TestFlag(D3D9VertexDeclFlag::HasColor1);
+    const bool lighting    = m_state.renderStates[D3DRS_LIGHTING] != 0;
+    const bool colorVertex = m_state.renderStates[D3DRS_COLORVERTEX] != 0;
+    const uint32_t mask    = (lighting && colorVertex)
+                           ? (hasColor0 ? D3DMCS_COLOR1 : D3DMCS_MATERIAL)
+                           | (hasColor1 ? D3DMCS_COLOR2 : D3DMCS_MATERIAL)
+                           : 0;
+
+    state.UseLighting      = lighting;
+    state.NormalizeNormals = m_state.renderStates[D3DRS_NORMALIZENORMALS];
+    state.LocalViewer      = m_state.renderStates[D3DRS_LOCALVIEWER] && lighting;
+
+    state.DiffuseSource    = m_state.renderStates[D3DRS_DIFFUSEMATERIALSOURCE]  & mask;
+    state.AmbientSource    = m_state.renderStates[D3DRS_AMBIENTMATERIALSOURCE]  & mask;
+    state.SpecularSource   = m_state.renderStates[D3DRS_SPECULARMATERIALSOURCE] & mask;
+    state.EmissiveSource   = m_state.renderStates[D3DRS_EMISSIVEMATERIALSOURCE] & mask;
+
+    auto convertColor = [] (const D3DCOLORVALUE& color) {
+      return Vector4(color.r, color.g, color.b, color.a);
+    };
+
+    DecodeD3DCOLOR(m_state.renderStates[D3DRS_AMBIENT], state.GlobalAmbient.data);
+    state.MaterialDiffuse  = convertColor(m_state.material.Diffuse);
+    state.MaterialAmbient  = convertColor(m_state.material.Ambient);
+    state.MaterialSpecular = convertColor(m_state.material.Specular);
+    state.MaterialEmissive = convertColor(m_state.material.Emissive);
+    state.MaterialPower    = m_state.material.Power;
+
+    if (lighting) {
+      for (uint32_t i = 0; i < caps::MaxEnabledLights && i < m_state.enabledLightIndices.size(); i++) {
+        const uint32_t idx = m_state.enabledLightIndices[i];
+
+        if (idx == UINT32_MAX)
+          continue;
+
+        const D3D9Light light(m_state.lights[idx].value(), view);
+        D3D9SWVPCpuLight& dst = state.Lights[state.LightCount++];
+
+        dst.Diffuse      = light.Diffuse;
+        dst.Specular     = light.Specular;
+        dst.Ambient      = light.Ambient;
+        dst.Position     = light.Position;
+        dst.Direction    = light.Direction;
+        dst.Type         = light.Type;
+        dst.Range        = light.Range;
+        dst.Falloff      = light.Falloff;
+        dst.Attenuation0 = light.Attenuation0;
+        dst.Attenuation1 = light.Attenuation1;
+        dst.Attenuation2 = light.Attenuation2;
+        dst.Theta        = light.Theta;
+        dst.Phi          = light.Phi;
+      }
+    }
+
+    for (uint32_t i = 0; i < caps::TextureStageCount; i++)
+      state.TexcoordIndices[i] = m_state.textureStages[i][DXVK_TSS_TEXCOORDINDEX] & 0b111;
+
+    D3D9SWVPCpuKernel kernel(state,
+      srcElements.data(), uint32_t(srcElements.size()),
+      dstElements.data(), uint32_t(dstElements.size()));
+
+    kernel.Process(streams.data(), SrcStartIndex, VertexCount,
+      dstPtr + dstOffset, dstStride);
+
+    pDst->DirtyRange().Conjoin(dstRange);
+
+    if (pDst->Desc()->Pool == D3DPOOL_DEFAULT)
+      FlushBuffer(pDst);
+
+    return true;
+  }
+  // NV-DXVK end
+
+
   void D3D9DeviceEx::PrepareDraw(D3DPRIMITIVETYPE PrimitiveType) {
     ScopedCpuProfileZone();
     if (unlikely(m_activeHazardsRT != 0)) {
@@ -6663,7 +7085,7 @@ namespace dxvk {
 
 
   HRESULT D3D9DeviceEx::CreateShaderModule(
-        D3D9CommonShader*     pShaderModule,
+        D3D9ShaderModule*     pShaderModule,
         VkShaderStageFlagBits ShaderStage,
   const DWORD*                pShaderBytecode,
   const DxsoModuleInfo*       pModuleInfo) {
@@ -6737,6 +7159,11 @@ namespace dxvk {
       }
     }
 
+    // NV-DXVK start: dirty-range constant uploads
+    if constexpr (ConstantType == D3D9ConstantType::Float)
+      m_consts[ProgramType].floatBlocks.markDirty(StartRegister, Count);
+    // NV-DXVK end
+
     UpdateStateConstants<ProgramType, ConstantType, T>(
       &m_state,
       StartRegister,
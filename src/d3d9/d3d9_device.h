@@ -29,6 +29,9 @@
 #include <type_traits>
 #include <unordered_map>
 #include "d3d9_rtx.h"
+// NV-DXVK start: asynchronous texture hashing
+#include "d3d9_texture_hasher.h"
+// NV-DXVK end
 
 namespace dxvk {
 
@@ -75,6 +78,11 @@ namespace dxvk {
     DirtyPointScale,
 
     InScene,
+
+    // NV-DXVK start: asynchronous shader compilation
+    PendingVertexShader,
+    PendingPixelShader,
+    // NV-DXVK end
   };
 
   using D3D9DeviceFlags = Flags<D3D9DeviceFlag>;
@@ -816,7 +824,14 @@ namespace dxvk {
 
     inline void UploadSoftwareConstantSet(const D3D9ShaderConstantsVSSoftware& Src, const D3D9ConstantLayout& Layout);
 
-    inline DxvkBufferSliceHandle CopySoftwareConstants(DxsoConstantBuffers cBufferTarget, Rc<DxvkBuffer>& dstBuffer, const void* src, uint32_t copySize, bool useSSBO);
+    // NV-DXVK start: dirty-range constant uploads
+    inline DxvkBufferSliceHandle CopySoftwareConstants(DxsoConstantBuffers cBufferTarget, Rc<DxvkBuffer>& dstBuffer, const void* src, uint32_t copySize, bool useSSBO, D3D9ConstantBlockTracker* pTracker = nullptr);
+
+    void RecordConstantUpload(uint32_t uploadedBytes, uint32_t fullBytes) {
+      m_constantUploadBytes     += uploadedBytes;
+      m_constantUploadFullBytes += fullBytes;
+    }
+    // NV-DXVK end
 
     template <DxsoProgramType ShaderStage, typename HardwareLayoutType, typename SoftwareLayoutType, typename ShaderType>
     inline void UploadConstantSet(const SoftwareLayoutType& Src, const D3D9ConstantLayout& Layout, const ShaderType& Shader);
@@ -859,6 +874,64 @@ namespace dxvk {
 
     void PrepareDraw(D3DPRIMITIVETYPE PrimitiveType);
 
+    // NV-DXVK start: asynchronous shader compilation
+    /**
+     * \brief Applies shaders that were bound while compiling
+     *
+     * Waits for pending shaders to finish compiling, unless
+     * the draw may be skipped and skipping is enabled.
+     * \param [in] allowSkip Whether the draw may be skipped
+     * \returns \c false if the draw must be skipped
+     */
+    bool ResolvePendingShaders(bool allowSkip);
+
+    /**
+     * \brief Checks whether a shader can be applied without waiting
+     * \returns \c true if the shader has finished compiling successfully
+     */
+    template <typename T>
+    static bool IsShaderUsable(const T* pShader) {
+      return pShader->IsCompiled()
+          && HasShaderModule(pShader);
+    }
+
+    /**
+     * \brief Checks whether compilation produced a shader
+     *
+     * Waits for the shader to finish compiling.
+     * \returns \c true if the shader can be applied
+     */
+    template <typename T>
+    static bool HasShaderModule(const T* pShader) {
+      return pShader->GetCommonShader()->GetShader(D3D9ShaderPermutations::None) != nullptr;
+    }
+
+    void ApplyVertexShader(
+            D3D9VertexShader*                 pShader,
+      const D3D9CommonShader*                 pOldShader);
+
+    void ApplyPixelShader(
+            D3D9PixelShader*                  pShader,
+      const D3D9CommonShader*                 pOldShader);
+    // NV-DXVK end
+
+    // NV-DXVK start: CPU vertex processing
+    /**
+     * \brief Runs ProcessVertices on the CPU
+     *
+     * Handles fixed function state supported by the CPU
+     * kernel, with CPU accessible source vertex buffers
+     * and a destination buffer backed by a mapping buffer.
+     * \returns \c false if the GPU path has to be used
+     */
+    bool ProcessVerticesCpu(
+            UINT                         SrcStartIndex,
+            UINT                         DestIndex,
+            UINT                         VertexCount,
+            D3D9CommonBuffer*            pDst,
+      const D3D9VertexDecl*              pDecl);
+    // NV-DXVK end
+
     template <DxsoProgramType ShaderStage>
     void BindShader(
       const D3D9CommonShader*                 pShaderModule,
@@ -925,6 +998,87 @@ namespace dxvk {
       return m_samplerCount.load();
     }
 
+    // NV-DXVK start: asynchronous shader compilation
+    D3D9ShaderCompileStats GetShaderCompileStats() const {
+      return m_shaderModules->GetCompileStats();
+    }
+
+    uint64_t GetPendingShaderSkippedDraws() const {
+      return m_pendingShaderSkippedDraws.load();
+    }
+
+    uint64_t GetPendingShaderWaitUs() const {
+      return m_pendingShaderWaitUs.load();
+    }
+    // NV-DXVK end
+
+    // NV-DXVK start: dirty-range constant uploads
+    /**
+     * \brief Total shader constant bytes written to constant buffers
+     */
+    uint64_t GetConstantUploadBytes() const {
+      return m_constantUploadBytes.load();
+    }
+
+    /**
+     * \brief Total bytes that full constant range copies would have written
+     */
+    uint64_t GetConstantUploadFullBytes() const {
+      return m_constantUploadFullBytes.load();
+    }
+    // NV-DXVK end
+
+    // NV-DXVK start: asynchronous texture hashing
+    D3D9TextureHasher& GetTextureHasher() {
+      return m_textureHasher;
+    }
+    // NV-DXVK end
+
+    // NV-DXVK start: redundant state filtering
+    /**
+     * \brief Checks whether a state block is being recorded
+     *
+     * State set while recording goes to the recorder
+     * rather than the device, so it must not be filtered
+     * against the current device state.
+     */
+    bool IsRecordingStateBlock() const {
+      return m_recorder != nullptr;
+    }
+
+    /**
+     * \brief Counts state block entries skipped on apply
+     * \param [in] count Number of redundant entries
+     */
+    void RecordFilteredStates(uint32_t count) {
+      m_filteredStateCount.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Total redundant state block entries skipped
+     */
+    uint64_t GetFilteredStateCount() const {
+      return m_filteredStateCount.load();
+    }
+
+    /**
+     * \brief Total commands emitted to the CS thread
+     */
+    uint64_t GetCsCommandCount() const {
+      return m_csCommandCount.load();
+    }
+
+    /**
+     * \brief Starts counting commands emitted to the CS thread
+     *
+     * Counting is off by default to keep it off the
+     * hot path, the statefilter HUD item enables it.
+     */
+    void EnableCsCommandCount() {
+      m_countCsCommands = true;
+    }
+    // NV-DXVK end
+
   private:
 
     DxvkCsChunkRef AllocCsChunk() {
@@ -934,6 +1088,11 @@ namespace dxvk {
 
     template<typename Cmd>
     void EmitCs(Cmd&& command) {
+      // NV-DXVK start: redundant state filtering
+      if (unlikely(m_countCsCommands))
+        m_csCommandCount.fetch_add(1, std::memory_order_relaxed);
+      // NV-DXVK end
+
       if (unlikely(!m_csChunk->push(command))) {
         EmitCsChunk(std::move(m_csChunk));
 
@@ -973,11 +1132,13 @@ namespace dxvk {
 
     bool ShouldRecord();
 
+    // NV-DXVK start: asynchronous shader compilation
     HRESULT               CreateShaderModule(
-            D3D9CommonShader*     pShaderModule,
+            D3D9ShaderModule*     pShaderModule,
             VkShaderStageFlagBits ShaderStage,
       const DWORD*                pShaderBytecode,
       const DxsoModuleInfo*       pModuleInfo);
+    // NV-DXVK end
 
     inline uint32_t GetUPDataSize(uint32_t vertexCount, uint32_t stride) {
       return vertexCount * stride;
@@ -1260,6 +1421,26 @@ namespace dxvk {
     std::atomic<int64_t>            m_availableMemory = { 0 };
     std::atomic<int32_t>            m_samplerCount    = { 0 };
 
+    // NV-DXVK start: asynchronous shader compilation
+    std::atomic<uint64_t>           m_pendingShaderSkippedDraws = { 0 };
+    std::atomic<uint64_t>           m_pendingShaderWaitUs       = { 0 };
+    // NV-DXVK end
+
+    // NV-DXVK start: dirty-range constant uploads
+    std::atomic<uint64_t>           m_constantUploadBytes     = { 0 };
+    std::atomic<uint64_t>           m_constantUploadFullBytes = { 0 };
+    // NV-DXVK end
+
+    // NV-DXVK start: asynchronous texture hashing
+    D3D9TextureHasher               m_textureHasher;
+    // NV-DXVK end
+
+    // NV-DXVK start: redundant state filtering
+    bool                            m_countCsCommands    = false;
+    std::atomic<uint64_t>           m_csCommandCount     = { 0 };
+    std::atomic<uint64_t>           m_filteredStateCount = { 0 };
+    // NV-DXVK end
+
     Direct3DState9                  m_state;
 
     D3D9Rtx                         m_rtx;
@@ -11,6 +11,12 @@
 
 #include <cfloat>
 
+// NV-DXVK start: fixed function shader cache
+#include <iomanip>
+#include <sstream>
+#include <unordered_set>
+// NV-DXVK end
+
 namespace dxvk {
 
   D3D9FixedFunctionOptions::D3D9FixedFunctionOptions(const D3D9Options* options) {
@@ -2383,6 +2389,25 @@ namespace dxvk {
     pDevice->GetDXVKDevice()->registerShader(m_shader);
   }
 
+  // NV-DXVK start: fixed function shader cache
+  D3D9FFShader::D3D9FFShader(
+          D3D9DeviceEx*           pDevice,
+          VkShaderStageFlagBits   Stage,
+    const Sha1Hash&               KeyHash,
+    const D3D9ShaderCacheModule&  Module,
+    const DxsoIsgn&               Isgn) {
+    DxvkShaderKey shaderKey = { Stage, KeyHash };
+
+    m_shader = new DxvkShader(Stage,
+      Module.slots.size(), Module.slots.data(), Module.iface,
+      Module.code.decompress(), DxvkShaderOptions(), DxvkShaderConstData());
+    m_isgn   = Isgn;
+
+    m_shader->setShaderKey(shaderKey);
+    pDevice->GetDXVKDevice()->registerShader(m_shader);
+  }
+  // NV-DXVK end
+
   template <typename T>
   void D3D9FFShader::Dump(const T& Key, const std::string& Name) {
     const std::string dumpPath = env::getEnvVar("DXVK_SHADER_DUMP_PATH");
@@ -2397,40 +2422,364 @@ namespace dxvk {
   }
 
 
+  // NV-DXVK start: fixed function shader cache
+  static VkShaderStageFlagBits GetFFShaderStage(const D3D9FFShaderKeyVS&) {
+    return VK_SHADER_STAGE_VERTEX_BIT;
+  }
+
+
+  static VkShaderStageFlagBits GetFFShaderStage(const D3D9FFShaderKeyFS&) {
+    return VK_SHADER_STAGE_FRAGMENT_BIT;
+  }
+
+
+  template <typename Key>
+  static Sha1Hash ComputeFFCacheKey(D3D9DeviceEx* pDevice, const Key& ShaderKey) {
+    D3D9FixedFunctionOptions options(pDevice->GetOptions());
+
+    const uint32_t keyData[] = {
+      uint32_t(GetFFShaderStage(ShaderKey)),
+      uint32_t(options.invariantPosition),
+    };
+
+    const Sha1Data chunks[] = {
+      { &ShaderKey, sizeof(ShaderKey) },
+      { keyData,    sizeof(keyData)   },
+    };
+
+    return Sha1Hash::compute(std::size(chunks), chunks);
+  }
+
+
+  D3D9FFShaderModuleSet::~D3D9FFShaderModuleSet() {
+    StopPrecompile();
+  }
+  // NV-DXVK end
+
+
   D3D9FFShader D3D9FFShaderModuleSet::GetShaderModule(
           D3D9DeviceEx*         pDevice,
     const D3D9FFShaderKeyVS&    ShaderKey) {
-    // Use the shader's unique key for the lookup
-    auto entry = m_vsModules.find(ShaderKey);
-    if (entry != m_vsModules.end())
-      return entry->second;
-    
-    D3D9FFShader shader(
-      pDevice, ShaderKey);
-
-    m_vsModules.insert({ShaderKey, shader});
-
-    return shader;
+    // NV-DXVK start: fixed function shader cache
+    return LookupOrCompile(pDevice, ShaderKey, m_vsModules, true);
+    // NV-DXVK end
   }
 
 
   D3D9FFShader D3D9FFShaderModuleSet::GetShaderModule(
           D3D9DeviceEx*         pDevice,
     const D3D9FFShaderKeyFS&    ShaderKey) {
-    // Use the shader's unique key for the lookup
-    auto entry = m_fsModules.find(ShaderKey);
-    if (entry != m_fsModules.end())
-      return entry->second;
-    
+    // NV-DXVK start: fixed function shader cache
+    return LookupOrCompile(pDevice, ShaderKey, m_fsModules, true);
+    // NV-DXVK end
+  }
+
+
+  // NV-DXVK start: fixed function shader cache
+  void D3D9FFShaderModuleSet::EnableDiskCache(
+          D3D9DeviceEx*         pDevice,
+    const std::string&          stateLogPath,
+          uint32_t              threadCount) {
+    if (m_diskCache)
+      return;
+
+    m_diskCache = std::make_unique<D3D9ShaderDiskCache>(".dxvk-d3d9-ff");
+
+    for (const auto& record : m_diskCache->keys()) {
+      PrecompileJob job;
+      job.fromCache = true;
+      job.record    = record;
+      m_precompileJobs.push_back(job);
+    }
+
+    if (!stateLogPath.empty())
+      ReadStateLog(pDevice, stateLogPath);
+
+    if (m_precompileJobs.empty())
+      return;
+
+    threadCount = std::min(threadCount, uint32_t(m_precompileJobs.size()));
+
+    Logger::info(str::format("D3D9: Precompiling ", m_precompileJobs.size(),
+      " fixed function shaders on ", threadCount, " threads"));
+
+    for (uint32_t i = 0; i < threadCount; i++)
+      m_precompileWorkers.emplace_back([this, pDevice] () { PrecompileWorker(pDevice); });
+  }
+
+
+  void D3D9FFShaderModuleSet::StopPrecompile() {
+    m_stopPrecompile.store(true);
+
+    for (auto& worker : m_precompileWorkers)
+      worker.join();
+
+    m_precompileWorkers.clear();
+  }
+
+
+  void D3D9FFShaderModuleSet::PrecompileWorker(D3D9DeviceEx* pDevice) {
+    env::setThreadName("dxvk-d3d9-ff");
+
+    while (!m_stopPrecompile.load()) {
+      uint32_t index = m_nextPrecompileJob++;
+
+      if (index >= m_precompileJobs.size())
+        return;
+
+      const PrecompileJob& job = m_precompileJobs[index];
+
+      try {
+        if (!job.fromCache) {
+          if (job.stage == VK_SHADER_STAGE_VERTEX_BIT)
+            LookupOrCompile(pDevice, job.vsKey, m_vsModules, false);
+          else
+            LookupOrCompile(pDevice, job.fsKey, m_fsModules, false);
+          continue;
+        }
+
+        D3D9ShaderCacheReader reader;
+
+        if (!m_diskCache->readRecord(job.record, reader))
+          continue;
+
+        uint32_t              stage = 0;
+        D3D9FFShaderKeyVS     vsKey;
+        D3D9FFShaderKeyFS     fsKey;
+        DxsoIsgn              isgn;
+        D3D9ShaderCacheModule module;
+
+        bool valid = reader.read(stage)
+          && (stage == VK_SHADER_STAGE_VERTEX_BIT || stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+          && (stage == VK_SHADER_STAGE_VERTEX_BIT ? reader.read(vsKey) : reader.read(fsKey))
+          && reader.read(isgn)
+          && D3D9ShaderDiskCache::readModule(reader, module)
+          && reader.eof();
+
+        if (!valid) {
+          Logger::warn(str::format("D3D9: Failed to decode fixed function shader cache entry ", job.record.toString()));
+          continue;
+        }
+
+        // Records compiled under different options, e.g. d3d9.invariantPosition,
+        // are stored under a different key and must not be used now
+        Sha1Hash record = stage == VK_SHADER_STAGE_VERTEX_BIT
+          ? ComputeFFCacheKey(pDevice, vsKey)
+          : ComputeFFCacheKey(pDevice, fsKey);
+
+        if (record != job.record)
+          continue;
+
+        Sha1Hash keyHash = stage == VK_SHADER_STAGE_VERTEX_BIT
+          ? Sha1Hash::compute(&vsKey, sizeof(vsKey))
+          : Sha1Hash::compute(&fsKey, sizeof(fsKey));
+
+        D3D9FFShader shader(pDevice, VkShaderStageFlagBits(stage), keyHash, module, isgn);
+
+        std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+        if (stage == VK_SHADER_STAGE_VERTEX_BIT)
+          m_vsModules.insert({ vsKey, shader });
+        else
+          m_fsModules.insert({ fsKey, shader });
+      } catch (const DxvkError& e) {
+        Logger::err(str::format("D3D9: Failed to precompile fixed function shader: ", e.message()));
+      }
+    }
+  }
+
+
+  template <typename Key, typename Map>
+  D3D9FFShader D3D9FFShaderModuleSet::LookupOrCompile(
+          D3D9DeviceEx*         pDevice,
+    const Key&                  ShaderKey,
+          Map&                  Modules,
+          bool                  LogNewKey) {
+    { // Use the shader's unique key for the lookup
+      std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+      auto entry = Modules.find(ShaderKey);
+      if (entry != Modules.end())
+        return entry->second;
+    }
+
+    // Compile without holding the lock so that
+    // precompilation does not stall the CS thread
     D3D9FFShader shader(
       pDevice, ShaderKey);
 
-    m_fsModules.insert({ShaderKey, shader});
+    { std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+      auto entry = Modules.insert({ ShaderKey, shader });
+      if (!entry.second)
+        return entry.first->second;
+    }
+
+    StoreShader(pDevice, ShaderKey, shader);
+
+    if (LogNewKey)
+      LogKey(ShaderKey);
 
     return shader;
   }
 
 
+  template <typename Key>
+  void D3D9FFShaderModuleSet::StoreShader(
+          D3D9DeviceEx*         pDevice,
+    const Key&                  ShaderKey,
+    const D3D9FFShader&         Shader) {
+    if (!m_diskCache)
+      return;
+
+    Sha1Hash record = ComputeFFCacheKey(pDevice, ShaderKey);
+
+    if (m_diskCache->contains(record))
+      return;
+
+    const Rc<DxvkShader>& dxvkShader = Shader.GetShader();
+
+    D3D9ShaderCacheModule module;
+    module.valid = true;
+    module.slots = dxvkShader->resourceSlots();
+    module.iface = dxvkShader->interfaceSlots();
+    module.code  = dxvkShader->compressedCode();
+
+    D3D9ShaderCacheWriter writer;
+    writer.write(uint32_t(GetFFShaderStage(ShaderKey)));
+    writer.write(ShaderKey);
+    writer.write(Shader.GetIsgn());
+    D3D9ShaderDiskCache::writeModule(writer, module);
+
+    m_diskCache->writeRecord(record, writer);
+  }
+
+
+  /**
+   * \brief State log line format
+   *
+   * One key per line, the stage followed by
+   * the raw key dwords in hexadecimal.
+   */
+  static std::string FormatFFKey(const char* stage, const uint32_t* dwords, size_t count) {
+    std::stringstream stream;
+    stream << stage << std::hex << std::setfill('0');
+
+    for (size_t i = 0; i < count; i++)
+      stream << ' ' << std::setw(8) << dwords[i];
+
+    return stream.str();
+  }
+
+
+  template <typename Key>
+  void D3D9FFShaderModuleSet::LogKey(const Key& ShaderKey) {
+    std::lock_guard<dxvk::mutex> lock(m_stateLogLock);
+
+    if (!m_stateLog)
+      return;
+
+    uint32_t dwords[sizeof(Key) / sizeof(uint32_t)];
+    std::memcpy(dwords, &ShaderKey, sizeof(dwords));
+
+    m_stateLog << FormatFFKey(GetFFShaderStage(ShaderKey) == VK_SHADER_STAGE_VERTEX_BIT ? "VS" : "FS",
+      dwords, std::size(dwords)) << std::endl;
+  }
+
+
+  void D3D9FFShaderModuleSet::ReadStateLog(
+          D3D9DeviceEx*         pDevice,
+    const std::string&          path) {
+    struct RecordHash {
+      size_t operator () (const Sha1Hash& key) const {
+        return key.dword(0);
+      }
+    };
+
+    std::unordered_set<Sha1Hash, RecordHash> seen;
+
+    auto addJob = [&] (const auto& key) {
+      Sha1Hash record = ComputeFFCacheKey(pDevice, key);
+
+      // Cached permutations are already queued
+      if (m_diskCache->contains(record) || !seen.insert(record).second)
+        return;
+
+      PrecompileJob job;
+      job.stage = GetFFShaderStage(key);
+
+      if constexpr (std::is_same_v<std::decay_t<decltype(key)>, D3D9FFShaderKeyVS>)
+        job.vsKey = key;
+      else
+        job.fsKey = key;
+
+      m_precompileJobs.push_back(job);
+    };
+
+    std::ifstream log(str::tows(path.c_str()).c_str());
+    std::string line;
+
+    uint32_t keyCount = 0;
+
+    while (std::getline(log, line)) {
+      std::stringstream stream(line);
+      std::string stage;
+      stream >> stage;
+
+      uint32_t dwords[sizeof(D3D9FFShaderKeyFS) / sizeof(uint32_t)] = { };
+      uint32_t count = 0;
+
+      while (count < std::size(dwords) && (stream >> std::hex >> dwords[count]))
+        count++;
+
+      if (stage == "VS" && count * sizeof(uint32_t) == sizeof(D3D9FFShaderKeyVS)) {
+        D3D9FFShaderKeyVS key;
+        std::memcpy(&key, dwords, sizeof(key));
+
+        // Light count and fog commonly change between
+        // draws that otherwise share the same state.
+        for (uint32_t fog = 0; fog < 2; fog++) {
+          D3D9FFShaderKeyVS variant = key;
+          variant.Data.Contents.HasFog = fog;
+
+          if (!key.Data.Contents.UseLighting) {
+            addJob(variant);
+            continue;
+          }
+
+          for (uint32_t lights = 0; lights <= caps::MaxEnabledLights; lights++) {
+            variant.Data.Contents.LightCount = lights;
+            addJob(variant);
+          }
+        }
+      } else if (stage == "FS" && count * sizeof(uint32_t) == sizeof(D3D9FFShaderKeyFS)) {
+        D3D9FFShaderKeyFS key;
+        std::memcpy(&key, dwords, sizeof(key));
+
+        // The specular enable is a global render state
+        // that is packed into the first stage
+        for (uint32_t specular = 0; specular < 2; specular++) {
+          D3D9FFShaderKeyFS variant = key;
+          variant.Stages[0].Contents.GlobalSpecularEnable = specular;
+          addJob(variant);
+        }
+      } else {
+        continue;
+      }
+
+      keyCount++;
+    }
+
+    Logger::info(str::format("D3D9: Expanded ", keyCount, " logged fixed function states into ", seen.size(), " new permutations"));
+
+    m_stateLog = std::ofstream(str::tows(path.c_str()).c_str(), std::ios_base::app);
+
+    if (!m_stateLog)
+      Logger::warn(str::format("D3D9: Failed to open fixed function state log ", path));
+  }
+  // NV-DXVK end
+
+
   size_t D3D9FFShaderKeyHash::operator () (const D3D9FFShaderKeyVS& key) const {
     DxvkHashState state;
 
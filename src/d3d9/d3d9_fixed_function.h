@@ -11,6 +11,13 @@
 #include <unordered_map>
 #include <bitset>
 
+// NV-DXVK start: fixed function shader cache
+#include "d3d9_shader_cache.h"
+
+#include <atomic>
+#include <memory>
+// NV-DXVK end
+
 namespace dxvk {
 
   class D3D9DeviceEx;
@@ -202,6 +209,15 @@ namespace dxvk {
             D3D9DeviceEx*         pDevice,
       const D3D9FFShaderKeyFS&    Key);
 
+    // NV-DXVK start: fixed function shader cache
+    D3D9FFShader(
+            D3D9DeviceEx*           pDevice,
+            VkShaderStageFlagBits   Stage,
+      const Sha1Hash&               KeyHash,
+      const D3D9ShaderCacheModule&  Module,
+      const DxsoIsgn&               Isgn);
+    // NV-DXVK end
+
     template <typename T>
     void Dump(const T& Key, const std::string& Name);
 
@@ -209,6 +225,12 @@ namespace dxvk {
       return m_shader;
     }
 
+    // NV-DXVK start: fixed function shader cache
+    const DxsoIsgn& GetIsgn() const {
+      return m_isgn;
+    }
+    // NV-DXVK end
+
   private:
 
     Rc<DxvkShader> m_shader;
@@ -222,6 +244,10 @@ namespace dxvk {
 
   public:
 
+    // NV-DXVK start: fixed function shader cache
+    ~D3D9FFShaderModuleSet();
+    // NV-DXVK end
+
     D3D9FFShader GetShaderModule(
             D3D9DeviceEx*         pDevice,
       const D3D9FFShaderKeyVS&    ShaderKey);
@@ -230,8 +256,82 @@ namespace dxvk {
             D3D9DeviceEx*         pDevice,
       const D3D9FFShaderKeyFS&    ShaderKey);
 
+    // NV-DXVK start: fixed function shader cache
+    /**
+     * \brief Enables the fixed function shader cache
+     *
+     * Every permutation compiled from now on is stored in a
+     * per-title cache file. Permutations already in the file
+     * are loaded on background threads, so that they are
+     * ready before the application first needs them.
+     *
+     * If a state log is given, all keys it contains are
+     * expanded into likely neighbouring permutations and
+     * compiled as well. Newly seen keys are appended to it.
+     * \param [in] pDevice The device
+     * \param [in] stateLogPath State log file, may be empty
+     * \param [in] threadCount Number of worker threads
+     */
+    void EnableDiskCache(
+            D3D9DeviceEx*         pDevice,
+      const std::string&          stateLogPath,
+            uint32_t              threadCount);
+
+    /**
+     * \brief Stops precompilation
+     *
+     * Pending permutations are dropped. Must be called
+     * before the device that owns the set is destroyed.
+     */
+    void StopPrecompile();
+    // NV-DXVK end
+
   private:
 
+    // NV-DXVK start: fixed function shader cache
+    struct PrecompileJob {
+      bool                  fromCache = false;
+      Sha1Hash              record;
+      VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+      D3D9FFShaderKeyVS     vsKey;
+      D3D9FFShaderKeyFS     fsKey;
+    };
+
+    dxvk::mutex                 m_mutex;
+
+    std::unique_ptr<D3D9ShaderDiskCache> m_diskCache;
+
+    dxvk::mutex                 m_stateLogLock;
+    std::ofstream               m_stateLog;
+
+    std::vector<PrecompileJob>  m_precompileJobs;
+    std::atomic<uint32_t>       m_nextPrecompileJob = { 0u };
+    std::atomic<bool>           m_stopPrecompile    = { false };
+    std::vector<dxvk::thread>   m_precompileWorkers;
+
+    void PrecompileWorker(D3D9DeviceEx* pDevice);
+
+    template <typename Key, typename Map>
+    D3D9FFShader LookupOrCompile(
+            D3D9DeviceEx*         pDevice,
+      const Key&                  ShaderKey,
+            Map&                  Modules,
+            bool                  LogNewKey);
+
+    template <typename Key>
+    void StoreShader(
+            D3D9DeviceEx*         pDevice,
+      const Key&                  ShaderKey,
+      const D3D9FFShader&         Shader);
+
+    template <typename Key>
+    void LogKey(const Key& ShaderKey);
+
+    void ReadStateLog(
+            D3D9DeviceEx*         pDevice,
+      const std::string&          path);
+    // NV-DXVK end
+
     std::unordered_map<
       D3D9FFShaderKeyVS,
       D3D9FFShader,
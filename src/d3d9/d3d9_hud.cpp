@@ -33,4 +33,244 @@ namespace dxvk::hud {
     return position;
   }
 
-}
\ No newline at end of file
+
+
+  // NV-DXVK start: asynchronous shader compilation
+  HudShaderCompileStats::HudShaderCompileStats(D3D9DeviceEx* device)
+    : m_device (device) {
+
+  }
+
+
+  void HudShaderCompileStats::update(dxvk::high_resolution_clock::time_point time) {
+    D3D9ShaderCompileStats stats = m_device->GetShaderCompileStats();
+
+    uint64_t avgLatencyUs = stats.compiled
+      ? stats.totalLatencyUs / stats.compiled
+      : 0;
+
+    m_compileCount = str::format(stats.compiled, " (", stats.pending, " pending)");
+    m_latency = str::format(
+      stats.lastLatencyUs / 1000, ".", (stats.lastLatencyUs / 100) % 10, " / ",
+      avgLatencyUs        / 1000, ".", (avgLatencyUs        / 100) % 10, " / ",
+      stats.maxLatencyUs  / 1000, ".", (stats.maxLatencyUs  / 100) % 10, " ms");
+    m_drawStalls = str::format(
+      m_device->GetPendingShaderSkippedDraws(), " skipped, ",
+      m_device->GetPendingShaderWaitUs() / 1000, " ms waited");
+  }
+
+
+  HudPos HudShaderCompileStats::render(
+          HudRenderer&      renderer,
+          HudPos            position) {
+    const std::pair<const char*, const std::string*> lines[] = {
+      { "Shaders:",         &m_compileCount },
+      { "Last/avg/max:",    &m_latency      },
+      { "Pending draws:",   &m_drawStalls   },
+    };
+
+    for (const auto& line : lines) {
+      position.y += 16.0f;
+
+      renderer.drawText(16.0f,
+        { position.x, position.y },
+        { 0.0f, 1.0f, 0.75f, 1.0f },
+        line.first);
+
+      renderer.drawText(16.0f,
+        { position.x + 160.0f, position.y },
+        { 1.0f, 1.0f, 1.0f, 1.0f },
+        *line.second);
+    }
+
+    position.y += 8.0f;
+    return position;
+  }
+  // NV-DXVK end
+
+
+  // NV-DXVK start: dirty-range constant uploads
+  HudConstantUploadStats::HudConstantUploadStats(D3D9DeviceEx* device)
+    : m_device      (device)
+    , m_prevUploaded(device->GetConstantUploadBytes())
+    , m_prevFull    (device->GetConstantUploadFullBytes())
+    , m_uploadRate  ("0 kB / 0 kB") {
+
+  }
+
+
+  void HudConstantUploadStats::update(dxvk::high_resolution_clock::time_point time) {
+    m_frames += 1;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(time - m_lastUpdate);
+
+    if (elapsed.count() >= UpdateInterval) {
+      uint64_t uploaded = m_device->GetConstantUploadBytes();
+      uint64_t full     = m_device->GetConstantUploadFullBytes();
+
+      m_uploadRate = str::format(
+        (uploaded - m_prevUploaded) / (m_frames * 1024), " kB / ",
+        (full     - m_prevFull)     / (m_frames * 1024), " kB");
+
+      m_prevUploaded = uploaded;
+      m_prevFull     = full;
+      m_frames       = 0;
+      m_lastUpdate   = time;
+    }
+  }
+
+
+  HudPos HudConstantUploadStats::render(
+          HudRenderer&      renderer,
+          HudPos            position) {
+    position.y += 16.0f;
+
+    renderer.drawText(16.0f,
+      { position.x, position.y },
+      { 0.0f, 1.0f, 0.75f, 1.0f },
+      "Constants/frame:");
+
+    renderer.drawText(16.0f,
+      { position.x + 200.0f, position.y },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      m_uploadRate);
+
+    position.y += 8.0f;
+    return position;
+  }
+  // NV-DXVK end
+
+
+  // NV-DXVK start: redundant state filtering
+  HudStateFilterStats::HudStateFilterStats(D3D9DeviceEx* device)
+    : m_device      (device)
+    , m_prevCommands(device->GetCsCommandCount())
+    , m_prevFiltered(device->GetFilteredStateCount())
+    , m_commandRate ("0")
+    , m_filterRate  ("0") {
+    m_device->EnableCsCommandCount();
+  }
+
+
+  void HudStateFilterStats::update(dxvk::high_resolution_clock::time_point time) {
+    m_frames += 1;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(time - m_lastUpdate);
+
+    if (elapsed.count() >= UpdateInterval) {
+      uint64_t commands = m_device->GetCsCommandCount();
+      uint64_t filtered = m_device->GetFilteredStateCount();
+
+      m_commandRate = str::format((commands - m_prevCommands) / m_frames);
+      m_filterRate  = str::format((filtered - m_prevFiltered) / m_frames);
+
+      m_prevCommands = commands;
+      m_prevFiltered = filtered;
+      m_frames       = 0;
+      m_lastUpdate   = time;
+    }
+  }
+
+
+  HudPos HudStateFilterStats::render(
+          HudRenderer&      renderer,
+          HudPos            position) {
+    position.y += 16.0f;
+
+    renderer.drawText(16.0f,
+      { position.x, position.y },
+      { 0.0f, 1.0f, 0.75f, 1.0f },
+      "CS commands/frame:");
+
+    renderer.drawText(16.0f,
+      { position.x + 200.0f, position.y },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      m_commandRate);
+
+    position.y += 20.0f;
+
+    renderer.drawText(16.0f,
+      { position.x, position.y },
+      { 0.0f, 1.0f, 0.75f, 1.0f },
+      "Filtered states/frame:");
+
+    renderer.drawText(16.0f,
+      { position.x + 200.0f, position.y },
+      { 1.0f, 1.0f, 1.0f, 1.0f },
+      m_filterRate);
+
+    position.y += 8.0f;
+    return position;
+  }
+  // NV-DXVK end
+
+
+  // NV-DXVK start: draw stage profiling
+  HudDrawStageStats::HudDrawStageStats()
+    : m_wasEnabled(DrawProfiler::enabled()) {
+    DrawProfiler::setEnabled(true);
+    m_prev = DrawProfiler::accumulated();
+  }
+
+
+  HudDrawStageStats::~HudDrawStageStats() {
+    DrawProfiler::setEnabled(m_wasEnabled);
+  }
+
+
+  void HudDrawStageStats::update(dxvk::high_resolution_clock::time_point time) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(time - m_lastUpdate);
+
+    if (elapsed.count() < UpdateInterval)
+      return;
+
+    DrawStageReport current = DrawProfiler::accumulated();
+    uint64_t frames = std::max<uint64_t>(current.frames - m_prev.frames, 1);
+
+    for (uint32_t s = 0; s < uint32_t(DrawStage::Count); s++) {
+      const DrawStageHistogram& cur  = current.stages[s];
+      const DrawStageHistogram& prev = m_prev.stages[s];
+
+      DrawStageHistogram delta;
+      delta.count   = cur.count   - prev.count;
+      delta.totalNs = cur.totalNs - prev.totalNs;
+
+      for (uint32_t i = 0; i < DrawStageHistogram::BucketCount; i++)
+        delta.buckets[i] = cur.buckets[i] - prev.buckets[i];
+
+      m_lines[s] = str::format(
+        delta.count / frames, "/frame, ",
+        uint64_t(delta.averageNs() / 1000.0), " us avg, ",
+        delta.percentileNs(0.99) / 1000, " us p99");
+    }
+
+    m_prev = current;
+    m_lastUpdate = time;
+  }
+
+
+  HudPos HudDrawStageStats::render(
+          HudRenderer&      renderer,
+          HudPos            position) {
+    for (uint32_t s = 0; s < uint32_t(DrawStage::Count); s++) {
+      position.y += 16.0f;
+
+      renderer.drawText(16.0f,
+        { position.x, position.y },
+        { 0.0f, 1.0f, 0.75f, 1.0f },
+        str::format(DrawProfiler::stageName(DrawStage(s)), ":"));
+
+      renderer.drawText(16.0f,
+        { position.x + 200.0f, position.y },
+        { 1.0f, 1.0f, 1.0f, 1.0f },
+        m_lines[s]);
+
+      position.y += 4.0f;
+    }
+
+    position.y += 4.0f;
+    return position;
+  }
+  // NV-DXVK end
+
+}
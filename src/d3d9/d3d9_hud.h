@@ -2,6 +2,9 @@
 
 #include "d3d9_device.h"
 #include "../dxvk/hud/dxvk_hud_item.h"
+// NV-DXVK start: draw stage profiling
+#include "../util/log/draw_profiler.h"
+// NV-DXVK end
 
 namespace dxvk::hud {
 
@@ -28,4 +31,142 @@ namespace dxvk::hud {
 
   };
 
-}
\ No newline at end of file
+
+  // NV-DXVK start: asynchronous shader compilation
+  /**
+   * \brief HUD item to display shader compile latency
+   */
+  class HudShaderCompileStats : public HudItem {
+
+  public:
+
+    HudShaderCompileStats(D3D9DeviceEx* device);
+
+    void update(dxvk::high_resolution_clock::time_point time);
+
+    HudPos render(
+            HudRenderer&      renderer,
+            HudPos            position);
+
+  private:
+
+    D3D9DeviceEx* m_device;
+
+    std::string m_compileCount;
+    std::string m_latency;
+    std::string m_drawStalls;
+
+  };
+  // NV-DXVK end
+
+
+  // NV-DXVK start: dirty-range constant uploads
+  /**
+   * \brief HUD item to display constant upload bandwidth
+   *
+   * Shows the average number of constant bytes written per
+   * frame next to what full range copies would have written.
+   */
+  class HudConstantUploadStats : public HudItem {
+    constexpr static int64_t UpdateInterval = 500'000;
+  public:
+
+    HudConstantUploadStats(D3D9DeviceEx* device);
+
+    void update(dxvk::high_resolution_clock::time_point time);
+
+    HudPos render(
+            HudRenderer&      renderer,
+            HudPos            position);
+
+  private:
+
+    D3D9DeviceEx* m_device;
+
+    uint64_t m_prevUploaded = 0;
+    uint64_t m_prevFull     = 0;
+    uint64_t m_frames       = 0;
+
+    std::string m_uploadRate;
+
+    dxvk::high_resolution_clock::time_point m_lastUpdate
+      = dxvk::high_resolution_clock::now();
+
+  };
+  // NV-DXVK end
+
+
+  // NV-DXVK start: redundant state filtering
+  /**
+   * \brief HUD item to display state filtering stats
+   *
+   * Shows the average number of commands sent to the CS
+   * thread per frame, and how many redundant state block
+   * entries were dropped before reaching the device.
+   */
+  class HudStateFilterStats : public HudItem {
+    constexpr static int64_t UpdateInterval = 500'000;
+  public:
+
+    HudStateFilterStats(D3D9DeviceEx* device);
+
+    void update(dxvk::high_resolution_clock::time_point time);
+
+    HudPos render(
+            HudRenderer&      renderer,
+            HudPos            position);
+
+  private:
+
+    D3D9DeviceEx* m_device;
+
+    uint64_t m_prevCommands = 0;
+    uint64_t m_prevFiltered = 0;
+    uint64_t m_frames       = 0;
+
+    std::string m_commandRate;
+    std::string m_filterRate;
+
+    dxvk::high_resolution_clock::time_point m_lastUpdate
+      = dxvk::high_resolution_clock::now();
+
+  };
+  // NV-DXVK end
+
+
+  // NV-DXVK start: draw stage profiling
+  /**
+   * \brief HUD item to display per-draw CPU cost by stage
+   *
+   * Enables the draw profiler while the item exists and shows
+   * samples per frame, average and 99th percentile duration
+   * for each stage over the last update interval.
+   */
+  class HudDrawStageStats : public HudItem {
+    constexpr static int64_t UpdateInterval = 500'000;
+  public:
+
+    HudDrawStageStats();
+
+    ~HudDrawStageStats();
+
+    void update(dxvk::high_resolution_clock::time_point time);
+
+    HudPos render(
+            HudRenderer&      renderer,
+            HudPos            position);
+
+  private:
+
+    bool            m_wasEnabled;
+    DrawStageReport m_prev;
+
+    std::array<std::string, uint32_t(DrawStage::Count)> m_lines;
+
+    dxvk::high_resolution_clock::time_point m_lastUpdate
+      = dxvk::high_resolution_clock::now();
+
+  };
+  // NV-DXVK end
+
+}
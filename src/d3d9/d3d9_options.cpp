@@ -98,6 +98,20 @@ namespace dxvk {
     // NV-DXVK start: adapter override conf
     this->adapterOverride = config.getOption<int32_t>("d3d9.adapterOverride", -1);
     // NV-DXVK end
+    // NV-DXVK start: persistent shader cache
+    this->enableShaderCache             = config.getOption<bool>        ("d3d9.enableShaderCache",             true);
+    // NV-DXVK end
+    // NV-DXVK start: fixed function shader cache
+    this->ffShaderStateLog              = config.getOption<std::string> ("d3d9.ffShaderStateLog",              "");
+    // NV-DXVK end
+    // NV-DXVK start: asynchronous shader compilation
+    this->asyncShaderCompile            = config.getOption<bool>        ("d3d9.asyncShaderCompile",            false);
+    this->numShaderCompilerThreads      = config.getOption<int32_t>     ("d3d9.numShaderCompilerThreads",      0);
+    this->skipDrawsWithPendingShaders   = config.getOption<bool>        ("d3d9.skipDrawsWithPendingShaders",   false);
+    // NV-DXVK end
+    // NV-DXVK start: CPU vertex processing
+    this->cpuProcessVertices            = config.getOption<bool>        ("d3d9.cpuProcessVertices",            false);
+    // NV-DXVK end
 
     // If we are not Nvidia, enable general hazards.
     this->generalHazards = adapter != nullptr
@@ -190,6 +190,33 @@ namespace dxvk {
     /// Override the adapter/GPU used for D3D9 (-1 = use application defined)
     int adapterOverride;
     // NV-DXVK end
+
+    // NV-DXVK start: persistent shader cache
+    /// Store translated shaders on disk and reuse them on subsequent runs
+    bool enableShaderCache;
+    // NV-DXVK end
+
+    // NV-DXVK start: fixed function shader cache
+    /// Fixed function state log used to precompile likely permutations
+    std::string ffShaderStateLog;
+    // NV-DXVK end
+
+    // NV-DXVK start: asynchronous shader compilation
+    /// Translate shaders on worker threads instead of the app thread
+    bool asyncShaderCompile;
+
+    /// Number of shader compiler threads, 0 picks a default
+    int32_t numShaderCompilerThreads;
+
+    /// Skip draws using shaders that are still compiling
+    /// instead of waiting for compilation to finish
+    bool skipDrawsWithPendingShaders;
+    // NV-DXVK end
+
+    // NV-DXVK start: CPU vertex processing
+    /// Run ProcessVertices for fixed function state on the CPU
+    bool cpuProcessVertices;
+    // NV-DXVK end
   };
 
 }
\ No newline at end of file
@@ -11,6 +11,7 @@
 
 #include "../util/util_fastops.h"
 #include "../util/util_math.h"
+#include "../util/log/draw_profiler.h"
 #include "d3d9_rtx_utils.h"
 #include "d3d9_texture.h"
 
@@ -26,7 +27,8 @@ namespace dxvk {
   D3D9Rtx::D3D9Rtx(D3D9DeviceEx* d3d9Device)
     : m_rtStagingData(d3d9Device->GetDXVKDevice(), (VkMemoryPropertyFlagBits) (VK_MEMORY_PROPERTY_HOST_CACHED_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
     , m_parent(d3d9Device)
-    , m_gpeWorkers(popcnt_uint8(D3D9Rtx::kAllThreads), "geometry-processing") {
+    , m_gpeWorkers(popcnt_uint8(D3D9Rtx::kAllThreads), "geometry-processing")
+    , m_drawCallChannel(maxDrawCallsInFlight()) {
 
     // Add space for 256 objects skinned with 256 bones each.
     m_stagedBones.resize(256 * 256);
@@ -205,92 +207,134 @@ namespace dxvk {
   void D3D9Rtx::processVertices(const VertexContext vertexContext[caps::MaxStreams], int vertexIndexOffset, RasterGeometry& geoData) {
     DxvkBufferSlice streamCopies[caps::MaxStreams] {};
 
-    // Process vertex buffers from CPU
-    for (const auto& element : d3d9State().vertexDecl->GetElements()) {
-      // Get vertex context
-      const VertexContext& ctx = vertexContext[element.Stream];
-
-      if (ctx.mappedSlice.handle == VK_NULL_HANDLE)
-        continue;
-
-      ScopedCpuProfileZoneN("Process Vertices");
-      const int32_t vertexOffset = ctx.offset + ctx.stride * vertexIndexOffset;
-      const uint32_t numVertexBytes = ctx.stride * geoData.vertexCount;
-
-      // Validating index data here, vertexCount and vertexIndexOffset accounts for the min/max indices
-      if (RtxOptions::Get()->getValidateCPUIndexData()) {
-        if (ctx.mappedSlice.length < vertexOffset + numVertexBytes) {
-          throw DxvkError("Invalid draw call");
-        }
-      }
+    // Small streams are copied into one staging allocation per draw
+    struct StagedStream {
+      const uint8_t* src;
+      uint32_t offset;
+      uint32_t size;
+    };
+    StagedStream stagedStreams[caps::MaxStreams];
+    uint32_t stagedStreamMask = 0;
+    uint32_t stagingSize = 0;
 
-      // TODO: Simplify this by refactoring RasterGeometry to contain an array of RasterBuffer's
-      RasterBuffer* targetBuffer = nullptr;
+    // TODO: Simplify this by refactoring RasterGeometry to contain an array of RasterBuffer's
+    auto getTargetBuffer = [&](const D3DVERTEXELEMENT9& element) -> RasterBuffer* {
       switch (element.Usage) {
       case D3DDECLUSAGE_POSITIONT:
       case D3DDECLUSAGE_POSITION:
         if (element.UsageIndex == 0)
-          targetBuffer = &geoData.positionBuffer;
+          return &geoData.positionBuffer;
         break;
       case D3DDECLUSAGE_BLENDWEIGHT:
         if (element.UsageIndex == 0)
-          targetBuffer = &geoData.blendWeightBuffer;
+          return &geoData.blendWeightBuffer;
         break;
       case D3DDECLUSAGE_BLENDINDICES:
         if (element.UsageIndex == 0)
-          targetBuffer = &geoData.blendIndicesBuffer;
+          return &geoData.blendIndicesBuffer;
         break;
       case D3DDECLUSAGE_NORMAL:
         if (element.UsageIndex == 0)
-          targetBuffer = &geoData.normalBuffer;
+          return &geoData.normalBuffer;
         break;
       case D3DDECLUSAGE_TEXCOORD:
         if (m_texcoordIndex <= MAXD3DDECLUSAGEINDEX && element.UsageIndex == m_texcoordIndex)
-          targetBuffer = &geoData.texcoordBuffer;
+          return &geoData.texcoordBuffer;
         break;
       case D3DDECLUSAGE_COLOR:
         if (element.UsageIndex == 0)
-          targetBuffer = &geoData.color0Buffer;
+          return &geoData.color0Buffer;
         break;
       }
+      return nullptr;
+    };
 
-      if (targetBuffer != nullptr) {
-        assert(!targetBuffer->defined());
+    // Process vertex buffers from CPU
+    for (const auto& element : d3d9State().vertexDecl->GetElements()) {
+      // Get vertex context
+      const VertexContext& ctx = vertexContext[element.Stream];
 
-        // Only do once for each stream
-        if (!streamCopies[element.Stream].defined()) {
-          // Deep clonning a buffer object is not cheap (320 bytes to copy and other work). Set a min-size threshold.
-          const uint32_t kMinSizeToClone = 512;
+      if (ctx.mappedSlice.handle == VK_NULL_HANDLE)
+        continue;
 
-          // Check if buffer is actualy a d3d9 orphan
-          const bool isOrphan = !(ctx.buffer.getSliceHandle() == ctx.mappedSlice);
-          const bool canUseBuffer = ctx.canUseBuffer && m_forceGeometryCopy == false;
+      ScopedCpuProfileZoneN("Process Vertices");
+      const int32_t vertexOffset = ctx.offset + ctx.stride * vertexIndexOffset;
+      const uint32_t numVertexBytes = ctx.stride * geoData.vertexCount;
 
-          if (canUseBuffer && !isOrphan) {
-            // Use the buffer directly if it is not an orphan
-            if (ctx.pVBO != nullptr && ctx.pVBO->NeedsUpload())
-              m_parent->FlushBuffer(ctx.pVBO);
+      // Validating index data here, vertexCount and vertexIndexOffset accounts for the min/max indices
+      if (RtxOptions::Get()->getValidateCPUIndexData()) {
+        if (ctx.mappedSlice.length < vertexOffset + numVertexBytes) {
+          throw DxvkError("Invalid draw call");
+        }
+      }
 
-            streamCopies[element.Stream] = ctx.buffer.subSlice(vertexOffset, numVertexBytes);
-          } else if (canUseBuffer && numVertexBytes > kMinSizeToClone) {
-            // Create a clone for the orphaned physical slice
-            auto clone = ctx.buffer.buffer()->clone();
-            clone->rename(ctx.mappedSlice);
-            streamCopies[element.Stream] = DxvkBufferSlice(clone, ctx.buffer.offset() + vertexOffset, numVertexBytes);
-          } else {
-            streamCopies[element.Stream] = m_rtStagingData.alloc(CACHE_LINE_SIZE, numVertexBytes);
+      if (getTargetBuffer(element) == nullptr)
+        continue;
 
-            // Acquire prevents the staging allocator from re-using this memory
-            streamCopies[element.Stream].buffer()->acquire(DxvkAccess::Read);
+      // Only do once for each stream
+      if (streamCopies[element.Stream].defined() || (stagedStreamMask & (1u << element.Stream)))
+        continue;
 
-            memcpy(streamCopies[element.Stream].mapPtr(0), (uint8_t*) ctx.mappedSlice.mapPtr + vertexOffset, numVertexBytes);
-          }
+      // Aliases are retained per physical slice, but the first use of each slice still
+      // has to clone the buffer object (320 bytes to copy and other work). Set a min-size threshold.
+      const uint32_t kMinSizeToAlias = 512;
+
+      // Check if buffer is actualy a d3d9 orphan
+      const bool isOrphan = !(ctx.buffer.getSliceHandle() == ctx.mappedSlice);
+      const bool canUseBuffer = ctx.canUseBuffer && m_forceGeometryCopy == false;
+
+      if (canUseBuffer && !isOrphan) {
+        // Use the buffer directly if it is not an orphan
+        if (ctx.pVBO != nullptr && ctx.pVBO->NeedsUpload())
+          m_parent->FlushBuffer(ctx.pVBO);
+
+        streamCopies[element.Stream] = ctx.buffer.subSlice(vertexOffset, numVertexBytes);
+      } else if (canUseBuffer && numVertexBytes > kMinSizeToAlias) {
+        // Reference the orphaned physical slice through a buffer object bound to it
+        Rc<DxvkBuffer> alias;
+
+        if (ctx.pVBO != nullptr) {
+          alias = ctx.pVBO->GetSliceAlias(ctx.mappedSlice);
+        } else {
+          alias = ctx.buffer.buffer()->clone();
+          alias->rename(ctx.mappedSlice);
         }
 
-        *targetBuffer = RasterBuffer(streamCopies[element.Stream], element.Offset, ctx.stride, DecodeDecltype(D3DDECLTYPE(element.Type)));
-        assert(targetBuffer->offset() % 4 == 0);
+        streamCopies[element.Stream] = DxvkBufferSlice(alias, ctx.buffer.offset() + vertexOffset, numVertexBytes);
+      } else {
+        stagingSize = align(stagingSize, CACHE_LINE_SIZE);
+
+        stagedStreams[element.Stream] = { (const uint8_t*) ctx.mappedSlice.mapPtr + vertexOffset, stagingSize, numVertexBytes };
+        stagedStreamMask |= 1u << element.Stream;
+        stagingSize += numVertexBytes;
       }
     }
+
+    if (stagedStreamMask != 0) {
+      DxvkBufferSlice staging = m_rtStagingData.alloc(CACHE_LINE_SIZE, stagingSize);
+
+      // Acquire prevents the staging allocator from re-using this memory
+      staging.buffer()->acquire(DxvkAccess::Read);
+
+      for (uint32_t stream : bit::BitMask(stagedStreamMask)) {
+        const StagedStream& staged = stagedStreams[stream];
+
+        streamCopies[stream] = staging.subSlice(staged.offset, staged.size);
+        memcpy(streamCopies[stream].mapPtr(0), staged.src, staged.size);
+      }
+    }
+
+    for (const auto& element : d3d9State().vertexDecl->GetElements()) {
+      RasterBuffer* targetBuffer = getTargetBuffer(element);
+
+      if (targetBuffer == nullptr || !streamCopies[element.Stream].defined())
+        continue;
+
+      assert(!targetBuffer->defined());
+
+      *targetBuffer = RasterBuffer(streamCopies[element.Stream], element.Offset, vertexContext[element.Stream].stride, DecodeDecltype(D3DDECLTYPE(element.Type)));
+      assert(targetBuffer->offset() % 4 == 0);
+    }
   }
 
   bool D3D9Rtx::processRenderState() {
@@ -631,6 +675,7 @@ namespace dxvk {
 
   void D3D9Rtx::CommitGeometryToRT(const DrawContext& drawContext) {
     ScopedCpuProfileZone();
+    DrawStageScope stageScope(DrawStage::CsDispatch);
     auto drawInfo = m_parent->GenerateDrawInfo(drawContext.PrimitiveType, drawContext.PrimitiveCount, m_parent->GetInstanceCount());
 
     DrawParameters params;
@@ -644,13 +689,18 @@ namespace dxvk {
       params.vertexCount = drawInfo.vertexCount;
     }
 
-    m_drawCallStateQueue.push(std::move(m_activeDrawCallState));
+    const uint32_t drawCallSlot = m_drawCallChannel.push(std::move(m_activeDrawCallState), [this] {
+      m_parent->FlushCsChunk();
+    });
 
-    m_parent->EmitCs([params, this](DxvkContext* ctx) {
+    DxvkStatCounters& counters = m_parent->GetDXVKDevice()->statCounters();
+    counters.setCtr(DxvkStatCounter::RtxDrawCallQueueDepth, m_drawCallChannel.depth());
+    counters.setCtr(DxvkStatCounter::RtxDrawCallQueueStallUs, m_drawCallChannel.stallTimeUs());
+
+    m_parent->EmitCs([params, drawCallSlot, this](DxvkContext* ctx) {
       assert(dynamic_cast<RtxContext*>(ctx));
-      DrawCallState drawCallState;
-      m_drawCallStateQueue.pop(drawCallState);
-      static_cast<RtxContext*>(ctx)->commitGeometryToRT(params, drawCallState);
+      static_cast<RtxContext*>(ctx)->commitGeometryToRT(params, m_drawCallChannel.at(drawCallSlot));
+      m_drawCallChannel.release(drawCallSlot);
     });
   }
 
@@ -728,6 +778,7 @@ namespace dxvk {
 
     return m_gpeWorkers.Schedule([boneMatrices, blendIndices, numBonesPerVertex, vertexCount]()->SkinningData {
       ScopedCpuProfileZone();
+      DrawStageScope stageScope(DrawStage::Skinning);
       uint32_t numBones = numBonesPerVertex;
 
       int minBoneIndex = 0;
@@ -930,6 +981,8 @@ namespace dxvk {
     if (!RtxOptions::Get()->enableRaytracing())
       return { true, false };
 
+    DrawStageScope stageScope(DrawStage::PrepareGeometry);
+
     m_parent->PrepareTextures();
 
     IndexContext indices;
@@ -977,6 +1030,8 @@ namespace dxvk {
     if (!RtxOptions::Get()->enableRaytracing())                
       return { true, false };
 
+    DrawStageScope stageScope(DrawStage::PrepareGeometry);
+
     m_parent->PrepareTextures();
 
     // 'buffer' - contains vertex + index data (packed in that order)
@@ -3,6 +3,7 @@
 #include "d3d9_state.h"
 #include "../dxvk/dxvk_buffer.h"
 #include "../util/util_threadpool.h"
+#include "d3d9_rtx_draw_channel.h"
 #include <vector>
 
 namespace dxvk {
@@ -25,6 +26,7 @@ namespace dxvk {
     RTX_OPTION("rtx", bool, orthographicIsUI, true, "When enabled, draw calls that are orthographic will be considered as UI.");
     RTX_OPTION("rtx", bool, useVertexCapture, true, "When enabled, injects code into the original vertex shader to capture final shaded vertex positions.  Is useful for games using simple vertex shaders, that still also set the fixed function transform matrices.");
     RTX_OPTION("rtx", bool, useVertexCapturedNormals, true, "When enabled, vertex normals are read from the input assembler and used in raytracing.  This doesn't always work as normals can be in any coordinate space, but can help sometimes.");
+    RTX_OPTION("rtx", uint32_t, maxDrawCallsInFlight, 64 * 1024, "The maximum number of draw calls that can be queued for RT processing before the application thread waits for the CS thread to catch up.  Draw call states are allocated in blocks of 1024 as needed up to this limit.");
     RTX_OPTION("rtx", bool, useWorldMatricesForShaders, true, "When enabled, Remix will utilize the world matrices being passed from the game via D3D9 fixed function API, even when running with shaders.  Sometimes games pass these matrices and they are useful, however for some games they are very unreliable, and should be filtered out.  If you're seeing precision related issues with shader vertex capture, try disabling this setting.");
 
     // Copy of the parameters issued to D3D9 on DrawXXX
@@ -176,7 +178,7 @@ namespace dxvk {
 
     inline static const uint32_t kMaxConcurrentDraws = 4 * 1024;
     WorkerThreadPool<kMaxConcurrentDraws> m_gpeWorkers;
-    AtomicQueue<DrawCallState, kMaxConcurrentDraws> m_drawCallStateQueue;
+    D3D9DrawCallChannel m_drawCallChannel;
 
     DrawCallState m_activeDrawCallState;
 
@@ -0,0 +1,98 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include "d3d9_rtx_draw_channel.h"
+
+#include "../util/util_likely.h"
+#include "../util/util_time.h"
+
+namespace dxvk {
+
+  D3D9DrawCallChannel::D3D9DrawCallChannel(uint32_t maxInFlight)
+  : m_maxSlabs(std::max(1u, (maxInFlight + SlabSize - 1) / SlabSize)) {
+    // Reserved up front so that slab pointers never move
+    // while the consumer may be reading from them.
+    m_slabs.resize(m_maxSlabs);
+    m_freeSlots.reserve(m_maxSlabs * SlabSize);
+
+    allocSlab();
+  }
+
+
+  uint32_t D3D9DrawCallChannel::push(
+          DrawCallState&&         state,
+    const std::function<void()>&  flush) {
+    std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+    if (unlikely(m_freeSlots.empty()) && !allocSlab()) {
+      // Out of slabs, make sure the consumer has
+      // work to do before waiting for a free slot
+      lock.unlock();
+      flush();
+      lock.lock();
+
+      auto t0 = dxvk::high_resolution_clock::now();
+
+      m_cond.wait(lock, [this] {
+        return !m_freeSlots.empty();
+      });
+
+      auto t1 = dxvk::high_resolution_clock::now();
+      m_stallTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+    }
+
+    uint32_t index = m_freeSlots.back();
+    m_freeSlots.pop_back();
+    lock.unlock();
+
+    at(index) = std::move(state);
+    m_depth += 1;
+    return index;
+  }
+
+
+  void D3D9DrawCallChannel::release(uint32_t index) {
+    // Drop buffer references and outstanding futures now
+    // rather than whenever the slot gets reused
+    at(index) = DrawCallState();
+    m_depth -= 1;
+
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+    m_freeSlots.push_back(index);
+    m_cond.notify_one();
+  }
+
+
+  bool D3D9DrawCallChannel::allocSlab() {
+    if (m_slabCount == m_maxSlabs)
+      return false;
+
+    uint32_t slab = m_slabCount++;
+    m_slabs[slab] = std::make_unique<Slab>();
+
+    // Push in reverse order so that low indices get used first
+    for (uint32_t i = SlabSize; i > 0; i--)
+      m_freeSlots.push_back(slab * SlabSize + i - 1);
+
+    return true;
+  }
+
+}
@@ -0,0 +1,130 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../dxvk/rtx_render/rtx_types.h"
+#include "../util/thread.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Draw call state handoff to the CS thread
+   *
+   * Owns a pool of \c DrawCallState objects, allocated in slabs
+   * that never move once created. The main thread moves a state
+   * into a free slot and only passes the slot index to the CS
+   * thread, which releases the slot once the draw is committed.
+   * Since each CS command knows its own slot, draws can no
+   * longer get out of sync with each other.
+   *
+   * The pool grows one slab at a time up to the given limit.
+   * Beyond that the producer blocks until the CS thread releases
+   * a slot, after flushing so that the CS thread can make progress.
+   */
+  class D3D9DrawCallChannel {
+    static constexpr uint32_t SlabSize = 1024;
+
+    using Slab = std::array<DrawCallState, SlabSize>;
+
+  public:
+
+    /**
+     * \brief Creates the channel
+     *
+     * \param [in] maxInFlight Maximum number of draw
+     *    call states in flight before the producer blocks.
+     *    Rounded up to a multiple of the slab size.
+     */
+    explicit D3D9DrawCallChannel(uint32_t maxInFlight);
+
+    /**
+     * \brief Moves a draw call state into a free slot
+     *
+     * Must only be called from the producer thread. If the
+     * channel is full, \c flush is invoked once before waiting
+     * for the consumer to release a slot.
+     * \param [in] state Draw call state
+     * \param [in] flush Submits pending consumer work
+     * \returns Slot index to pass to the consumer
+     */
+    uint32_t push(
+            DrawCallState&&         state,
+      const std::function<void()>&  flush);
+
+    /**
+     * \brief Retrieves the draw call state in a slot
+     *
+     * \param [in] index Slot index returned by \ref push
+     * \returns Draw call state
+     */
+    DrawCallState& at(uint32_t index) {
+      return (*m_slabs[index / SlabSize])[index % SlabSize];
+    }
+
+    /**
+     * \brief Returns a slot to the pool
+     *
+     * Called by the consumer once it is done with the state.
+     * Futures still held by the state are dropped here.
+     * \param [in] index Slot index
+     */
+    void release(uint32_t index);
+
+    /**
+     * \brief Number of draw call states in flight
+     */
+    uint32_t depth() const {
+      return m_depth.load();
+    }
+
+    /**
+     * \brief Total time the producer spent waiting for free slots
+     */
+    uint64_t stallTimeUs() const {
+      return m_stallTimeUs.load();
+    }
+
+  private:
+
+    const uint32_t              m_maxSlabs;
+
+    std::vector<std::unique_ptr<Slab>> m_slabs;
+    uint32_t                    m_slabCount = 0;
+
+    dxvk::mutex                 m_mutex;
+    dxvk::condition_variable    m_cond;
+    std::vector<uint32_t>       m_freeSlots;
+
+    std::atomic<uint32_t>       m_depth       = { 0u };
+    std::atomic<uint64_t>       m_stallTimeUs = { 0ull };
+
+    bool allocSlab();
+
+  };
+
+}
@@ -6,6 +6,7 @@
 #include "../dxvk/dxvk_buffer.h"
 #include "../dxvk/rtx_render/rtx_hashing.h"
 #include "../util/util_fastops.h"
+#include "../util/log/draw_profiler.h"
 
 namespace dxvk {
   // Geometry indices should never be signed.  Using this to handle the non-indexed case for templates.
@@ -186,6 +187,7 @@ namespace dxvk {
                                  maxIndexValue, vertexShaderHash, geometryDescriptorHash,
                                  vertexLayoutHash]() -> GeometryHashes {
       ScopedCpuProfileZone();
+      DrawStageScope stageScope(DrawStage::GeometryHashing);
 
       GeometryHashes hashes;
 
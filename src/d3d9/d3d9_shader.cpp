@@ -10,6 +10,7 @@ namespace dxvk {
 
   D3D9CommonShader::D3D9CommonShader() {}
 
+  // NV-DXVK start: persistent shader cache
   D3D9CommonShader::D3D9CommonShader(
             D3D9DeviceEx*         pDevice,
             VkShaderStageFlagBits ShaderStage,
@@ -17,7 +18,9 @@ namespace dxvk {
       const DxsoModuleInfo*       pDxsoModuleInfo,
       const void*                 pShaderBytecode,
       const DxsoAnalysisInfo&     AnalysisInfo,
-            DxsoModule*           pModule) {
+            DxsoModule*           pModule,
+            D3D9ShaderDiskCache*  pDiskCache) {
+  // NV-DXVK end
     const uint32_t bytecodeLength = AnalysisInfo.bytecodeByteLength;
     m_bytecode.resize(bytecodeLength);
     std::memcpy(m_bytecode.data(), pShaderBytecode, bytecodeLength);
@@ -58,12 +61,76 @@ namespace dxvk {
     const D3D9ConstantLayout& constantLayout = ShaderStage == VK_SHADER_STAGE_VERTEX_BIT
       ? pDevice->GetVertexConstantLayout()
       : pDevice->GetPixelConstantLayout();
-    m_shaders      = pModule->compile(*pDxsoModuleInfo, name, AnalysisInfo, constantLayout);
-    m_isgn         = pModule->isgn();
-    // NV-DXVK start: expose shader outputs for vertex capture
-    m_osgn = pModule->osgn();
+    // NV-DXVK start: persistent shader cache
+    D3D9ShaderCacheEntry cacheEntry;
+    Sha1Hash cacheKey;
+
+    bool cacheHit = false;
+
+    if (pDiskCache) {
+      cacheKey = D3D9ShaderDiskCache::computeKey(ShaderStage,
+        pShaderBytecode, bytecodeLength, *pDxsoModuleInfo, constantLayout);
+      cacheHit = pDiskCache->lookup(cacheKey, cacheEntry);
+    }
+
+    if (cacheHit) {
+      Logger::debug(str::format("Loaded shader ", name, " from shader cache"));
+
+      for (uint32_t i = 0; i < m_shaders.size(); i++) {
+        const D3D9ShaderCacheModule& module = cacheEntry.modules[i];
+
+        if (module.valid) {
+          m_shaders[i] = new DxvkShader(ShaderStage,
+            module.slots.size(), module.slots.data(), module.iface,
+            module.code.decompress(), DxvkShaderOptions(), DxvkShaderConstData());
+        }
+      }
+
+      m_isgn            = cacheEntry.isgn;
+      m_osgn            = cacheEntry.osgn;
+      m_usedSamplers    = cacheEntry.usedSamplers;
+      m_usedRTs         = cacheEntry.usedRTs;
+      m_info            = cacheEntry.info;
+      m_meta            = cacheEntry.meta;
+      m_constants       = std::move(cacheEntry.constants);
+      m_maxDefinedConst = cacheEntry.maxDefinedConst;
+    } else {
+      m_shaders      = pModule->compile(*pDxsoModuleInfo, name, AnalysisInfo, constantLayout);
+      m_isgn         = pModule->isgn();
+      m_osgn         = pModule->osgn();
+      m_usedSamplers = pModule->usedSamplers();
+      m_usedRTs      = pModule->usedRTs();
+
+      m_info      = pModule->info();
+      m_meta      = pModule->meta();
+      m_constants = pModule->constants();
+      m_maxDefinedConst = pModule->maxDefinedConstant();
+
+      if (pDiskCache) {
+        for (uint32_t i = 0; i < m_shaders.size(); i++) {
+          D3D9ShaderCacheModule& module = cacheEntry.modules[i];
+
+          if (m_shaders[i] != nullptr) {
+            module.valid = true;
+            module.slots = m_shaders[i]->resourceSlots();
+            module.iface = m_shaders[i]->interfaceSlots();
+            module.code  = m_shaders[i]->compressedCode();
+          }
+        }
+
+        cacheEntry.isgn            = m_isgn;
+        cacheEntry.osgn            = m_osgn;
+        cacheEntry.usedSamplers    = m_usedSamplers;
+        cacheEntry.usedRTs         = m_usedRTs;
+        cacheEntry.info            = m_info;
+        cacheEntry.meta            = m_meta;
+        cacheEntry.constants       = m_constants;
+        cacheEntry.maxDefinedConst = m_maxDefinedConst;
+
+        pDiskCache->store(cacheKey, cacheEntry);
+      }
+    }
     // NV-DXVK end
-    m_usedSamplers = pModule->usedSamplers();
 
     // Shift up these sampler bits so we can just
     // do an or per-draw in the device.
@@ -71,13 +138,6 @@ namespace dxvk {
     if (ShaderStage == VK_SHADER_STAGE_VERTEX_BIT)
       m_usedSamplers <<= caps::MaxTexturesPS + 1;
 
-    m_usedRTs      = pModule->usedRTs();
-
-    m_info      = pModule->info();
-    m_meta      = pModule->meta();
-    m_constants = pModule->constants();
-    m_maxDefinedConst = pModule->maxDefinedConstant();
-
     m_shaders[0]->setShaderKey(Key);
 
     if (m_shaders[1] != nullptr) {
@@ -102,11 +162,14 @@ namespace dxvk {
 
   void D3D9ShaderModuleSet::GetShaderModule(
             D3D9DeviceEx*         pDevice,
-            D3D9CommonShader*     pShaderModule,
+            D3D9ShaderModule*     pShaderModule,
             VkShaderStageFlagBits ShaderStage,
       const DxsoModuleInfo*       pDxbcModuleInfo,
       const void*                 pShaderBytecode) {
     ScopedCpuProfileZone();
+    // NV-DXVK start: asynchronous shader compilation
+    const auto createTime = high_resolution_clock::now();
+    // NV-DXVK end
     DxsoReader reader(
       reinterpret_cast<const char*>(pShaderBytecode));
 
@@ -134,12 +197,57 @@ namespace dxvk {
       }
     }
     
+    // NV-DXVK start: asynchronous shader compilation
+    if (m_asyncCompile.load()) {
+      // Register the module before queueing the job so that
+      // requests for the same bytecode share one compile job.
+      // The bytecode must be copied since the app may free it.
+      CompileJob job;
+      job.device     = pDevice;
+      job.stage      = ShaderStage;
+      job.key        = lookupKey;
+      job.moduleInfo = *pDxbcModuleInfo;
+      job.queueTime  = createTime;
+
+      auto bytecode = reinterpret_cast<const uint8_t*>(pShaderBytecode);
+      job.bytecode.assign(bytecode, bytecode + info.bytecodeByteLength);
+
+      *pShaderModule = D3D9ShaderModule(job.promise.get_future().share());
+
+      { std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+        auto status = m_modules.insert({ lookupKey, *pShaderModule });
+        if (!status.second) {
+          *pShaderModule = status.first->second;
+          return;
+        }
+      }
+
+      { std::lock_guard<dxvk::mutex> lock(m_statsLock);
+        m_stats.pending += 1;
+      }
+
+      { std::unique_lock<dxvk::mutex> lock(m_compileLock);
+        m_compileQueue.push(std::move(job));
+      }
+
+      m_compileCond.notify_one();
+      return;
+    }
+
     // This shader has not been compiled yet, so we have to create a
     // new module. This takes a while, so we won't lock the structure.
-    *pShaderModule = D3D9CommonShader(
+    std::promise<D3D9CommonShader> promise;
+    promise.set_value(D3D9CommonShader(
       pDevice, ShaderStage, lookupKey,
       pDxbcModuleInfo, pShaderBytecode,
-      info, &module);
+      info, &module,
+      m_diskCache.get()));
+
+    *pShaderModule = D3D9ShaderModule(promise.get_future().share());
+
+    RecordCompileTime(createTime, false);
+    // NV-DXVK end
     
     // Insert the new module into the lookup table. If another thread
     // has compiled the same shader in the meantime, we should return
@@ -154,4 +262,125 @@ namespace dxvk {
     }
   }
 
+
+  // NV-DXVK start: persistent shader cache
+  void D3D9ShaderModuleSet::EnableDiskCache() {
+    std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+    if (!m_diskCache)
+      m_diskCache = std::make_unique<D3D9ShaderDiskCache>(".dxvk-d3d9-shaders");
+  }
+  // NV-DXVK end
+
+
+
+  // NV-DXVK start: asynchronous shader compilation
+  D3D9ShaderModuleSet::~D3D9ShaderModuleSet() {
+    StopAsyncCompile();
+  }
+
+
+  void D3D9ShaderModuleSet::EnableAsyncCompile(uint32_t threadCount) {
+    std::unique_lock<dxvk::mutex> lock(m_compileLock);
+
+    if (!m_compileWorkers.empty())
+      return;
+
+    Logger::info(str::format("D3D9: Using ", threadCount, " shader compiler threads"));
+
+    for (uint32_t i = 0; i < threadCount; i++)
+      m_compileWorkers.emplace_back([this] () { CompileWorker(); });
+
+    m_asyncCompile.store(true);
+  }
+
+
+  void D3D9ShaderModuleSet::StopAsyncCompile() {
+    { std::unique_lock<dxvk::mutex> lock(m_compileLock);
+
+      if (m_compileWorkers.empty())
+        return;
+
+      m_asyncCompile.store(false);
+      m_stopWorkers = true;
+    }
+
+    m_compileCond.notify_all();
+
+    // Workers drain the queue before exiting, so
+    // every handed out module gets a result
+    for (auto& worker : m_compileWorkers)
+      worker.join();
+
+    m_compileWorkers.clear();
+  }
+
+
+  D3D9ShaderCompileStats D3D9ShaderModuleSet::GetCompileStats() const {
+    std::lock_guard<dxvk::mutex> lock(m_statsLock);
+    return m_stats;
+  }
+
+
+  void D3D9ShaderModuleSet::CompileWorker() {
+    env::setThreadName("dxvk-d3d9-shader");
+
+    while (true) {
+      CompileJob job;
+
+      { std::unique_lock<dxvk::mutex> lock(m_compileLock);
+
+        m_compileCond.wait(lock, [this] () {
+          return m_stopWorkers || !m_compileQueue.empty();
+        });
+
+        if (m_compileQueue.empty())
+          break;
+
+        job = std::move(m_compileQueue.front());
+        m_compileQueue.pop();
+      }
+
+      try {
+        DxsoReader reader(
+          reinterpret_cast<const char*>(job.bytecode.data()));
+
+        DxsoModule module(reader);
+        DxsoAnalysisInfo info = module.analyze();
+
+        job.promise.set_value(D3D9CommonShader(
+          job.device, job.stage, job.key,
+          &job.moduleInfo, job.bytecode.data(),
+          info, &module, m_diskCache.get()));
+      } catch (const DxvkError& e) {
+        // Nothing can report the error to the app at this point.
+        // Hand out a shader without modules, draws using it are
+        // skipped by the device.
+        Logger::err(str::format("D3D9: Failed to compile shader ", job.key.toString(), ": ", e.message()));
+        job.promise.set_value(D3D9CommonShader());
+      }
+
+      RecordCompileTime(job.queueTime, true);
+    }
+  }
+
+
+  void D3D9ShaderModuleSet::RecordCompileTime(
+          high_resolution_clock::time_point queueTime,
+          bool                  async) {
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+      high_resolution_clock::now() - queueTime);
+
+    std::lock_guard<dxvk::mutex> lock(m_statsLock);
+
+    if (async)
+      m_stats.pending -= 1;
+
+    m_stats.compiled       += 1;
+    m_stats.lastLatencyUs   = uint64_t(latency.count());
+    m_stats.maxLatencyUs    = std::max(m_stats.maxLatencyUs, m_stats.lastLatencyUs);
+    m_stats.totalLatencyUs += m_stats.lastLatencyUs;
+  }
+  // NV-DXVK end
+
 }
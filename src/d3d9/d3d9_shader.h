@@ -3,9 +3,20 @@
 #include "d3d9_resource.h"
 #include "../dxso/dxso_module.h"
 #include "d3d9_shader_permutations.h"
+// NV-DXVK start: persistent shader cache
+#include "d3d9_shader_cache.h"
+// NV-DXVK end
 #include "d3d9_util.h"
 
+// NV-DXVK start: asynchronous shader compilation
+#include "../util/util_time.h"
+// NV-DXVK end
+
 #include <array>
+// NV-DXVK start: asynchronous shader compilation
+#include <future>
+#include <queue>
+// NV-DXVK end
 
 namespace dxvk {
 
@@ -23,6 +34,7 @@ namespace dxvk {
 
     D3D9CommonShader();
 
+    // NV-DXVK start: persistent shader cache
     D3D9CommonShader(
             D3D9DeviceEx*         pDevice,
             VkShaderStageFlagBits ShaderStage,
@@ -30,7 +42,9 @@ namespace dxvk {
       const DxsoModuleInfo*       pDxbcModuleInfo,
       const void*                 pShaderBytecode,
       const DxsoAnalysisInfo&     AnalysisInfo,
-            DxsoModule*           pModule);
+            DxsoModule*           pModule,
+            D3D9ShaderDiskCache*  pDiskCache);
+    // NV-DXVK end
 
 
     Rc<DxvkShader> GetShader(D3D9ShaderPermutation Permutation) const {
@@ -84,6 +98,48 @@ namespace dxvk {
 
   };
 
+  // NV-DXVK start: asynchronous shader compilation
+  /**
+   * \brief Shader module reference
+   *
+   * Refers to a common shader which may still be compiling
+   * on a worker thread. Copies refer to the same shader.
+   * If compilation failed, the shader has no modules.
+   */
+  class D3D9ShaderModule {
+
+  public:
+
+    D3D9ShaderModule() { }
+
+    explicit D3D9ShaderModule(std::shared_future<D3D9CommonShader> Future)
+      : m_future(std::move(Future)) { }
+
+    /**
+     * \brief Checks whether compilation has finished
+     * \returns \c true if \ref Get will not block
+     */
+    bool IsReady() const {
+      return m_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    /**
+     * \brief Retrieves the common shader
+     *
+     * Waits for compilation to finish if necessary.
+     * \returns Reference to the common shader
+     */
+    const D3D9CommonShader& Get() const {
+      return m_future.get();
+    }
+
+  private:
+
+    std::shared_future<D3D9CommonShader> m_future;
+
+  };
+  // NV-DXVK end
+
   /**
    * \brief Common shader interface
    * 
@@ -96,11 +152,13 @@ namespace dxvk {
 
   public:
 
+    // NV-DXVK start: asynchronous shader compilation
     D3D9Shader(
             D3D9DeviceEx*      pDevice,
-      const D3D9CommonShader&  CommonShader)
+      const D3D9ShaderModule&  Module)
       : D3D9DeviceChild<Base>( pDevice )
-      , m_shader             ( CommonShader ) { }
+      , m_module             ( Module ) { }
+    // NV-DXVK end
 
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) {
       if (ppvObject == nullptr)
@@ -123,7 +181,7 @@ namespace dxvk {
       if (pSizeOfData == nullptr)
         return D3DERR_INVALIDCALL;
 
-      const auto& bytecode = m_shader.GetBytecode();
+      const auto& bytecode = GetCommonShader()->GetBytecode();
 
       if (pOut == nullptr) {
         *pSizeOfData = bytecode.size();
@@ -136,13 +194,35 @@ namespace dxvk {
       return D3D_OK;
     }
 
+    // NV-DXVK start: asynchronous shader compilation
     const D3D9CommonShader* GetCommonShader() const {
-      return &m_shader;
+      const D3D9CommonShader* shader = m_shader.load(std::memory_order_acquire);
+
+      if (unlikely(shader == nullptr)) {
+        shader = &m_module.Get();
+        m_shader.store(shader, std::memory_order_release);
+      }
+
+      return shader;
+    }
+
+    /**
+     * \brief Checks whether the shader can be used
+     *
+     * \returns \c true if compilation has finished
+     *    and accessing the common shader won't block.
+     */
+    bool IsCompiled() const {
+      return m_shader.load(std::memory_order_acquire) != nullptr
+          || m_module.IsReady();
     }
 
   private:
 
-    D3D9CommonShader m_shader;
+    D3D9ShaderModule m_module;
+
+    mutable std::atomic<const D3D9CommonShader*> m_shader = { nullptr };
+    // NV-DXVK end
 
   };
 
@@ -154,8 +234,8 @@ namespace dxvk {
 
     D3D9VertexShader(
             D3D9DeviceEx*      pDevice,
-      const D3D9CommonShader&  CommonShader)
-      : D3D9Shader<IDirect3DVertexShader9>( pDevice, CommonShader ) { }
+      const D3D9ShaderModule&  Module)
+      : D3D9Shader<IDirect3DVertexShader9>( pDevice, Module ) { }
 
   };
 
@@ -165,11 +245,29 @@ namespace dxvk {
 
     D3D9PixelShader(
             D3D9DeviceEx*      pDevice,
-      const D3D9CommonShader&  CommonShader)
-      : D3D9Shader<IDirect3DPixelShader9>( pDevice, CommonShader ) { }
+      const D3D9ShaderModule&  Module)
+      : D3D9Shader<IDirect3DPixelShader9>( pDevice, Module ) { }
 
   };
 
+  // NV-DXVK start: asynchronous shader compilation
+  /**
+   * \brief Shader compile statistics
+   *
+   * Latencies are measured from the point where the
+   * application created the shader until the compiled
+   * shader became available, in microseconds.
+   */
+  struct D3D9ShaderCompileStats {
+    uint32_t pending        = 0;
+    uint64_t compiled       = 0;
+    uint64_t lastLatencyUs  = 0;
+    uint64_t maxLatencyUs   = 0;
+    uint64_t totalLatencyUs = 0;
+  };
+  // NV-DXVK end
+
+
   /**
    * \brief Shader module set
    * 
@@ -181,22 +279,94 @@ namespace dxvk {
   class D3D9ShaderModuleSet : public RcObject {
     
   public:
+
+    // NV-DXVK start: asynchronous shader compilation
+    ~D3D9ShaderModuleSet();
+    // NV-DXVK end
     
     void GetShaderModule(
             D3D9DeviceEx*         pDevice,
-            D3D9CommonShader*     pShaderModule,
+            D3D9ShaderModule*     pShaderModule,
             VkShaderStageFlagBits ShaderStage,
       const DxsoModuleInfo*       pDxbcModuleInfo,
       const void*                 pShaderBytecode);
+
+    // NV-DXVK start: persistent shader cache
+    /**
+     * \brief Enables the persistent shader cache
+     *
+     * Must be called before any shader is created.
+     */
+    void EnableDiskCache();
+    // NV-DXVK end
+
+    // NV-DXVK start: asynchronous shader compilation
+    /**
+     * \brief Enables asynchronous compilation
+     *
+     * Shaders created afterwards are compiled on worker
+     * threads, and accessing them blocks until done.
+     * \param [in] threadCount Number of worker threads
+     */
+    void EnableAsyncCompile(uint32_t threadCount);
+
+    /**
+     * \brief Finishes all queued compile jobs
+     *
+     * Stops the worker threads. Must be called before
+     * the device that created the shaders goes away.
+     */
+    void StopAsyncCompile();
+
+    /**
+     * \brief Queries compile statistics
+     * \returns Compile statistics
+     */
+    D3D9ShaderCompileStats GetCompileStats() const;
+    // NV-DXVK end
     
   private:
+
+    // NV-DXVK start: asynchronous shader compilation
+    struct CompileJob {
+      D3D9DeviceEx*                     device;
+      VkShaderStageFlagBits             stage;
+      DxvkShaderKey                     key;
+      DxsoModuleInfo                    moduleInfo;
+      std::vector<uint8_t>              bytecode;
+      std::promise<D3D9CommonShader>    promise;
+      high_resolution_clock::time_point queueTime;
+    };
+    // NV-DXVK end
     
     dxvk::mutex m_mutex;
+
+    // NV-DXVK start: persistent shader cache
+    std::unique_ptr<D3D9ShaderDiskCache> m_diskCache;
+    // NV-DXVK end
     
+    // NV-DXVK start: asynchronous shader compilation
     std::unordered_map<
       DxvkShaderKey,
-      D3D9CommonShader,
+      D3D9ShaderModule,
       DxvkHash, DxvkEq> m_modules;
+
+    dxvk::mutex                   m_compileLock;
+    dxvk::condition_variable      m_compileCond;
+    std::queue<CompileJob>        m_compileQueue;
+    std::vector<dxvk::thread>     m_compileWorkers;
+    bool                          m_stopWorkers = false;
+    std::atomic<bool>             m_asyncCompile = { false };
+
+    mutable dxvk::mutex           m_statsLock;
+    D3D9ShaderCompileStats        m_stats;
+
+    void CompileWorker();
+
+    void RecordCompileTime(
+            high_resolution_clock::time_point queueTime,
+            bool                  async);
+    // NV-DXVK end
     
   };
 
@@ -0,0 +1,409 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <type_traits>
+
+#include <version.h>
+
+#include "d3d9_shader_cache.h"
+
+#include "../util/util_env.h"
+#include "../util/xxHash/xxhash.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Shader cache file header
+   *
+   * The build hash covers the DXVK version string as well
+   * as the layout of all structures stored in the file, so
+   * that compiler changes invalidate previous entries.
+   */
+  struct D3D9ShaderCacheHeader {
+    char     magic[4] = { 'D', '9', 'S', 'C' };
+    uint32_t version  = 1;
+    Sha1Hash buildHash;
+  };
+
+
+  /**
+   * \brief Shader cache record header
+   *
+   * Precedes the serialized entry. The checksum is
+   * only verified when the entry is looked up.
+   */
+  struct D3D9ShaderCacheRecordHeader {
+    Sha1Hash key;
+    uint32_t size;
+    uint64_t checksum;
+  };
+
+
+  static Sha1Hash getBuildHash() {
+    const uint32_t structSizes[] = {
+      uint32_t(sizeof(D3D9ShaderCacheRecordHeader)),
+      uint32_t(sizeof(DxsoIsgn)),
+      uint32_t(sizeof(DxsoShaderMetaInfo)),
+      uint32_t(sizeof(DxsoDefinedConstant)),
+      uint32_t(sizeof(DxvkResourceSlot)),
+      uint32_t(sizeof(DxvkInterfaceSlots)),
+    };
+
+    const Sha1Data chunks[] = {
+      { DXVK_VERSION,  std::strlen(DXVK_VERSION) },
+      { structSizes,   sizeof(structSizes)       },
+    };
+
+    return Sha1Hash::compute(std::size(chunks), chunks);
+  }
+
+
+  D3D9ShaderDiskCache::D3D9ShaderDiskCache(const char* fileExtension)
+  : m_fileExtension(fileExtension) {
+    if (!readCacheFile())
+      createCacheFile();
+
+    m_writer = std::ofstream(getCacheFileName().c_str(),
+      std::ios_base::binary |
+      std::ios_base::app);
+
+    if (!m_writer)
+      Logger::warn("D3D9: Failed to open shader cache file for writing");
+  }
+
+
+  D3D9ShaderDiskCache::~D3D9ShaderDiskCache() {
+
+  }
+
+
+  Sha1Hash D3D9ShaderDiskCache::computeKey(
+          VkShaderStageFlagBits stage,
+    const void*                 pBytecode,
+          size_t                bytecodeLength,
+    const DxsoModuleInfo&       moduleInfo,
+    const D3D9ConstantLayout&   layout) {
+    const DxsoOptions& options = moduleInfo.options;
+
+    // Vertex capture code is injected into every vertex shader,
+    // the stage covers it and the build hash covers its revision.
+    const uint32_t keyData[] = {
+      uint32_t(stage),
+      uint32_t(options.useDemoteToHelperInvocation),
+      uint32_t(options.useSubgroupOpsForEarlyDiscard),
+      uint32_t(options.strictConstantCopies),
+      uint32_t(options.d3d9FloatEmulation),
+      uint32_t(options.strictPow),
+      uint32_t(options.shaderModel),
+      uint32_t(options.invariantPosition),
+      uint32_t(options.forceSamplerTypeSpecConstants),
+      uint32_t(options.vertexFloatConstantBufferAsSSBO),
+      uint32_t(options.longMad),
+      uint32_t(options.alphaTestWiggleRoom),
+      uint32_t(options.robustness2Supported),
+      layout.floatCount,
+      layout.intCount,
+      layout.boolCount,
+      layout.bitmaskCount,
+    };
+
+    const Sha1Data chunks[] = {
+      { pBytecode, bytecodeLength  },
+      { keyData,   sizeof(keyData) },
+    };
+
+    return Sha1Hash::compute(std::size(chunks), chunks);
+  }
+
+
+  bool D3D9ShaderDiskCache::lookup(
+    const Sha1Hash&             key,
+          D3D9ShaderCacheEntry& entry) const {
+    D3D9ShaderCacheReader reader;
+
+    if (!readRecord(key, reader))
+      return false;
+
+    uint32_t programType  = 0;
+    uint32_t minorVersion = 0;
+    uint32_t majorVersion = 0;
+    uint32_t moduleMask   = 0;
+
+    bool valid = reader.read(programType)
+              && reader.read(minorVersion)
+              && reader.read(majorVersion)
+              && reader.read(entry.isgn)
+              && reader.read(entry.osgn)
+              && reader.read(entry.usedSamplers)
+              && reader.read(entry.usedRTs)
+              && reader.read(entry.meta)
+              && reader.read(entry.constants)
+              && reader.read(entry.maxDefinedConst)
+              && reader.read(moduleMask);
+
+    entry.info = DxsoProgramInfo(DxsoProgramType(programType), minorVersion, majorVersion);
+
+    for (uint32_t i = 0; i < entry.modules.size() && valid; i++) {
+      D3D9ShaderCacheModule& module = entry.modules[i];
+      module.valid = (moduleMask >> i) & 1;
+
+      if (module.valid)
+        valid = readModule(reader, module);
+    }
+
+    valid = valid && reader.eof()
+      && entry.modules[D3D9ShaderPermutations::None].valid;
+
+    if (!valid)
+      Logger::warn(str::format("D3D9: Failed to decode shader cache entry ", key.toString()));
+
+    return valid;
+  }
+
+
+  void D3D9ShaderDiskCache::store(
+    const Sha1Hash&             key,
+    const D3D9ShaderCacheEntry& entry) {
+    D3D9ShaderCacheWriter writer;
+    writer.write(uint32_t(entry.info.type()));
+    writer.write(entry.info.minorVersion());
+    writer.write(entry.info.majorVersion());
+    writer.write(entry.isgn);
+    writer.write(entry.osgn);
+    writer.write(entry.usedSamplers);
+    writer.write(entry.usedRTs);
+    writer.write(entry.meta);
+    writer.write(entry.constants);
+    writer.write(entry.maxDefinedConst);
+
+    uint32_t moduleMask = 0;
+
+    for (uint32_t i = 0; i < entry.modules.size(); i++)
+      moduleMask |= uint32_t(entry.modules[i].valid) << i;
+
+    writer.write(moduleMask);
+
+    for (const auto& module : entry.modules) {
+      if (module.valid)
+        writeModule(writer, module);
+    }
+
+    writeRecord(key, writer);
+  }
+
+
+  std::vector<Sha1Hash> D3D9ShaderDiskCache::keys() const {
+    std::vector<Sha1Hash> result;
+    result.reserve(m_records.size());
+
+    for (const auto& record : m_records)
+      result.push_back(record.first);
+
+    return result;
+  }
+
+
+  bool D3D9ShaderDiskCache::readRecord(
+    const Sha1Hash&             key,
+          D3D9ShaderCacheReader& reader) const {
+    auto record = m_records.find(key);
+
+    if (record == m_records.end())
+      return false;
+
+    const uint8_t* data = m_mapping.data() + record->second.offset;
+    const uint32_t size = record->second.size;
+
+    if (XXH3_64bits(data, size) != record->second.checksum) {
+      Logger::warn(str::format("D3D9: Shader cache entry ", key.toString(), " is corrupted"));
+      return false;
+    }
+
+    reader = D3D9ShaderCacheReader(data, size);
+    return true;
+  }
+
+
+  void D3D9ShaderDiskCache::writeRecord(
+    const Sha1Hash&             key,
+    const D3D9ShaderCacheWriter& writer) {
+    const std::vector<uint8_t>& data = writer.data();
+
+    D3D9ShaderCacheRecordHeader header;
+    header.key      = key;
+    header.size     = uint32_t(data.size());
+    header.checksum = XXH3_64bits(data.data(), data.size());
+
+    std::lock_guard<dxvk::mutex> lock(m_writerLock);
+
+    if (!m_writer)
+      return;
+
+    // Flush every record so that a crash can only
+    // ever leave a partial record at the very end
+    m_writer.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_writer.write(reinterpret_cast<const char*>(data.data()), data.size());
+    m_writer.flush();
+  }
+
+
+  void D3D9ShaderDiskCache::writeModule(
+          D3D9ShaderCacheWriter& writer,
+    const D3D9ShaderCacheModule& module) {
+    writer.write(module.slots);
+    writer.write(module.iface);
+    writer.write(module.code.dwords());
+    writer.write(module.code.getMask());
+    writer.write(module.code.getCode());
+  }
+
+
+  bool D3D9ShaderDiskCache::readModule(
+          D3D9ShaderCacheReader& reader,
+          D3D9ShaderCacheModule& module) {
+    uint32_t dwords = 0;
+    std::vector<uint64_t> mask;
+    std::vector<uint64_t> code;
+
+    bool valid = reader.read(module.slots)
+              && reader.read(module.iface)
+              && reader.read(dwords)
+              && reader.read(mask)
+              && reader.read(code);
+
+    if (valid)
+      module.code = SpirvCompressedBuffer(dwords, std::move(mask), std::move(code));
+
+    return valid;
+  }
+
+
+  bool D3D9ShaderDiskCache::readCacheFile() {
+    std::wstring fileName = getCacheFileName();
+
+    if (!m_mapping.open(fileName))
+      return false;
+
+    D3D9ShaderCacheHeader expected;
+    expected.buildHash = getBuildHash();
+
+    D3D9ShaderCacheHeader header;
+
+    if (m_mapping.size() < sizeof(header)) {
+      m_mapping.close();
+      return false;
+    }
+
+    std::memcpy(&header, m_mapping.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic))
+     || header.version   != expected.version
+     || header.buildHash != expected.buildHash) {
+      Logger::warn("D3D9: Shader cache was created by a different build, discarding");
+      m_mapping.close();
+      return false;
+    }
+
+    // Only index the records here, they get
+    // decoded and verified when looked up.
+    const size_t fileSize = m_mapping.size();
+    size_t offset = sizeof(header);
+
+    while (fileSize - offset >= sizeof(D3D9ShaderCacheRecordHeader)) {
+      D3D9ShaderCacheRecordHeader record;
+      std::memcpy(&record, m_mapping.data() + offset, sizeof(record));
+      offset += sizeof(record);
+
+      if (record.size > fileSize - offset) {
+        offset -= sizeof(record);
+        break;
+      }
+
+      // Later records for the same key replace earlier ones
+      m_records[record.key] = { offset, record.size, record.checksum };
+      offset += record.size;
+    }
+
+    if (offset != fileSize) {
+      // Drop the partial record at the end of the file, otherwise
+      // anything we append would be unreachable on the next run.
+      Logger::warn("D3D9: Shader cache file is truncated, removing last record");
+
+      std::vector<char> data(m_mapping.data(), m_mapping.data() + offset);
+
+      m_mapping.close();
+      m_records.clear();
+
+      std::ofstream file(fileName.c_str(),
+        std::ios_base::binary |
+        std::ios_base::trunc);
+
+      file.write(data.data(), data.size());
+      file.close();
+
+      if (!file)
+        return false;
+
+      return readCacheFile();
+    }
+
+    Logger::info(str::format("D3D9: Found ", m_records.size(), " shader cache entries"));
+    return true;
+  }
+
+
+  void D3D9ShaderDiskCache::createCacheFile() {
+    Logger::info("D3D9: Creating new shader cache file");
+
+    std::ofstream file(getCacheFileName().c_str(),
+      std::ios_base::binary |
+      std::ios_base::trunc);
+
+    if (!file && env::createDirectory(getCacheDir())) {
+      file = std::ofstream(getCacheFileName().c_str(),
+        std::ios_base::binary |
+        std::ios_base::trunc);
+    }
+
+    D3D9ShaderCacheHeader header;
+    header.buildHash = getBuildHash();
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+
+
+  std::wstring D3D9ShaderDiskCache::getCacheFileName() const {
+    std::string path = getCacheDir();
+
+    if (!path.empty() && *path.rbegin() != '/')
+      path += '/';
+
+    std::string exeName = env::getExeBaseName();
+    path += exeName + m_fileExtension;
+    return str::tows(path.c_str());
+  }
+
+
+  std::string D3D9ShaderDiskCache::getCacheDir() {
+    return env::getEnvVar("DXVK_STATE_CACHE_PATH");
+  }
+
+}
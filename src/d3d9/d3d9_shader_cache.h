@@ -0,0 +1,330 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <unordered_map>
+
+#include "../dxso/dxso_common.h"
+#include "../dxso/dxso_isgn.h"
+#include "../dxso/dxso_modinfo.h"
+
+#include "../dxvk/dxvk_shader.h"
+
+#include "../util/thread.h"
+#include "../util/util_mapped_file.h"
+
+#include "d3d9_constant_layout.h"
+#include "d3d9_shader_permutations.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Cached shader permutation
+   *
+   * Holds the arguments needed to recreate
+   * a \c DxvkShader without running the
+   * DXSO compiler.
+   */
+  struct D3D9ShaderCacheModule {
+    bool                          valid = false;
+    std::vector<DxvkResourceSlot> slots;
+    DxvkInterfaceSlots            iface;
+    SpirvCompressedBuffer         code;
+  };
+
+
+  /**
+   * \brief Cached DXSO compiler output
+   *
+   * Everything a \c D3D9CommonShader takes from the
+   * compiler. The sampler mask is stored unshifted.
+   */
+  struct D3D9ShaderCacheEntry {
+    DxsoProgramInfo       info;
+    DxsoIsgn              isgn;
+    DxsoIsgn              osgn;
+    uint32_t              usedSamplers    = 0;
+    uint32_t              usedRTs         = 0;
+    DxsoShaderMetaInfo    meta;
+    DxsoDefinedConstants  constants;
+    uint32_t              maxDefinedConst = 0;
+
+    std::array<D3D9ShaderCacheModule, D3D9ShaderPermutations::Count> modules;
+  };
+
+
+  /**
+   * \brief Shader cache record serializer
+   */
+  class D3D9ShaderCacheWriter {
+
+  public:
+
+    template<typename T>
+    void write(const T& value) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      auto data = reinterpret_cast<const uint8_t*>(&value);
+      m_data.insert(m_data.end(), data, data + sizeof(T));
+    }
+
+    template<typename T>
+    void write(const std::vector<T>& values) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      write(uint32_t(values.size()));
+
+      auto data = reinterpret_cast<const uint8_t*>(values.data());
+      m_data.insert(m_data.end(), data, data + values.size() * sizeof(T));
+    }
+
+    const std::vector<uint8_t>& data() const {
+      return m_data;
+    }
+
+  private:
+
+    std::vector<uint8_t> m_data;
+
+  };
+
+
+  /**
+   * \brief Shader cache record deserializer
+   *
+   * Reads fail instead of running past the end of the record.
+   */
+  class D3D9ShaderCacheReader {
+
+  public:
+
+    D3D9ShaderCacheReader() = default;
+
+    D3D9ShaderCacheReader(const uint8_t* data, size_t size)
+    : m_data(data), m_size(size) { }
+
+    template<typename T>
+    bool read(T& value) {
+      static_assert(std::is_trivially_copyable_v<T>);
+
+      if (m_size - m_offset < sizeof(T))
+        return false;
+
+      std::memcpy(&value, m_data + m_offset, sizeof(T));
+      m_offset += sizeof(T);
+      return true;
+    }
+
+    template<typename T>
+    bool read(std::vector<T>& values) {
+      static_assert(std::is_trivially_copyable_v<T>);
+      uint32_t count = 0;
+
+      if (!read(count) || count > (m_size - m_offset) / sizeof(T))
+        return false;
+
+      values.resize(count);
+      std::memcpy(values.data(), m_data + m_offset, count * sizeof(T));
+      m_offset += count * sizeof(T);
+      return true;
+    }
+
+    bool eof() const {
+      return m_offset == m_size;
+    }
+
+  private:
+
+    const uint8_t* m_data   = nullptr;
+    size_t         m_size   = 0;
+    size_t         m_offset = 0;
+
+  };
+
+
+  /**
+   * \brief Persistent DXSO to SPIR-V translation cache
+   *
+   * Stores compiled D3D9 shaders in a file next to the
+   * state cache so that the DXSO compiler does not have
+   * to run again on subsequent launches. The file is
+   * memory mapped and only its record headers are read
+   * on startup, entries are decoded on lookup.
+   *
+   * Lookups are lock-free, new entries are appended to
+   * the file immediately. The file is discarded when it
+   * was written by a different build.
+   */
+  class D3D9ShaderDiskCache {
+
+  public:
+
+    /**
+     * \brief Opens or creates the cache file
+     *
+     * \param [in] fileExtension Suffix appended to
+     *    the executable name to form the file name
+     */
+    explicit D3D9ShaderDiskCache(const char* fileExtension);
+
+    ~D3D9ShaderDiskCache();
+
+    D3D9ShaderDiskCache             (const D3D9ShaderDiskCache&) = delete;
+    D3D9ShaderDiskCache& operator = (const D3D9ShaderDiskCache&) = delete;
+
+    /**
+     * \brief Computes the cache key of a shader
+     *
+     * Covers the bytecode and everything else that the
+     * compiler output depends on: the shader stage, the
+     * compiler options and the constant layout.
+     * \param [in] stage Shader stage
+     * \param [in] pBytecode Shader bytecode
+     * \param [in] bytecodeLength Bytecode size, in bytes
+     * \param [in] moduleInfo Compiler options
+     * \param [in] layout Constant buffer layout
+     * \returns Cache key
+     */
+    static Sha1Hash computeKey(
+            VkShaderStageFlagBits stage,
+      const void*                 pBytecode,
+            size_t                bytecodeLength,
+      const DxsoModuleInfo&       moduleInfo,
+      const D3D9ConstantLayout&   layout);
+
+    /**
+     * \brief Looks up a shader
+     *
+     * \param [in] key Cache key
+     * \param [out] entry Decoded entry
+     * \returns \c true if a valid entry was found
+     */
+    bool lookup(
+      const Sha1Hash&             key,
+            D3D9ShaderCacheEntry& entry) const;
+
+    /**
+     * \brief Adds a shader to the cache file
+     *
+     * \param [in] key Cache key
+     * \param [in] entry Compiler output
+     */
+    void store(
+      const Sha1Hash&             key,
+      const D3D9ShaderCacheEntry& entry);
+
+    /**
+     * \brief Lists the keys of all records in the file
+     * \returns Record keys
+     */
+    std::vector<Sha1Hash> keys() const;
+
+    /**
+     * \brief Checks whether a record exists
+     *
+     * \param [in] key Cache key
+     * \returns \c true if the file contains the key
+     */
+    bool contains(const Sha1Hash& key) const {
+      return m_records.find(key) != m_records.end();
+    }
+
+    /**
+     * \brief Retrieves the payload of a record
+     *
+     * Verifies the record checksum. The returned
+     * data lives as long as the cache object.
+     * \param [in] key Cache key
+     * \param [out] reader Reader for the payload
+     * \returns \c true if a valid record was found
+     */
+    bool readRecord(
+      const Sha1Hash&             key,
+            D3D9ShaderCacheReader& reader) const;
+
+    /**
+     * \brief Appends a record to the cache file
+     *
+     * \param [in] key Cache key
+     * \param [in] data Serialized payload
+     */
+    void writeRecord(
+      const Sha1Hash&             key,
+      const D3D9ShaderCacheWriter& data);
+
+    /**
+     * \brief Serializes a cached shader module
+     *
+     * \param [in] writer Record writer
+     * \param [in] module Shader module
+     */
+    static void writeModule(
+            D3D9ShaderCacheWriter& writer,
+      const D3D9ShaderCacheModule& module);
+
+    /**
+     * \brief Deserializes a cached shader module
+     *
+     * \param [in] reader Record reader
+     * \param [out] module Shader module
+     * \returns \c true on success
+     */
+    static bool readModule(
+            D3D9ShaderCacheReader& reader,
+            D3D9ShaderCacheModule& module);
+
+  private:
+
+    struct KeyHash {
+      size_t operator () (const Sha1Hash& key) const {
+        return key.dword(0);
+      }
+    };
+
+    struct Record {
+      size_t   offset;
+      uint32_t size;
+      uint64_t checksum;
+    };
+
+    std::string   m_fileExtension;
+
+    MappedFile    m_mapping;
+
+    std::unordered_map<Sha1Hash, Record, KeyHash> m_records;
+
+    dxvk::mutex   m_writerLock;
+    std::ofstream m_writer;
+
+    bool readCacheFile();
+
+    void createCacheFile();
+
+    std::wstring getCacheFileName() const;
+
+    static std::string getCacheDir();
+
+  };
+
+}
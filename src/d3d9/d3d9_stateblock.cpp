@@ -9,8 +9,105 @@
 
 #include "d3d9_util.h"
 
+// NV-DXVK start: redundant state filtering
+#include <emmintrin.h>
+// NV-DXVK end
+
 namespace dxvk {
 
+  // NV-DXVK start: redundant state filtering
+  namespace {
+
+    /**
+     * \brief Compares two dword arrays
+     *
+     * \param [in] a First array
+     * \param [in] b Second array
+     * \param [in] count Number of dwords, at most 32
+     * \returns Mask with bit \c i set if \c a[i] and \c b[i] differ
+     */
+    uint32_t DiffDwords(const void* a, const void* b, uint32_t count) {
+      auto pa = reinterpret_cast<const uint32_t*>(a);
+      auto pb = reinterpret_cast<const uint32_t*>(b);
+
+      uint32_t mask = 0;
+      uint32_t i = 0;
+
+      for (; i + 4 <= count; i += 4) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + i));
+
+        uint32_t equal = uint32_t(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(va, vb))));
+        mask |= (~equal & 0xfu) << i;
+      }
+
+      for (; i < count; i++) {
+        if (pa[i] != pb[i])
+          mask |= 1u << i;
+      }
+
+      return mask;
+    }
+
+    /**
+     * \brief Checks whether two four-component registers are identical
+     */
+    bool EqualVec4(const void* a, const void* b) {
+      __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+      __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+
+      return _mm_movemask_epi8(_mm_cmpeq_epi32(va, vb)) == 0xffff;
+    }
+
+    /**
+     * \brief Clears registers whose value matches the device
+     * \returns Number of registers cleared
+     */
+    template <size_t Bits, typename T>
+    uint32_t FilterRegisters(bit::bitset<Bits>& mask, const T* src, const T* live) {
+      uint32_t filtered = 0;
+
+      for (uint32_t i = 0; i < mask.dwordCount(); i++) {
+        uint32_t keep = mask.dword(i);
+
+        for (uint32_t bit : bit::BitMask(mask.dword(i))) {
+          uint32_t idx = i * 32 + bit;
+
+          if (EqualVec4(&src[idx], &live[idx])) {
+            keep &= ~(1u << bit);
+            filtered += 1;
+          }
+        }
+
+        mask.dword(i) = keep;
+      }
+
+      return filtered;
+    }
+
+    /**
+     * \brief Clears bits of a mask whose dwords match the device
+     * \returns Number of bits cleared
+     */
+    uint32_t FilterDwords(uint32_t& mask, const void* src, const void* live, uint32_t count) {
+      uint32_t before = bit::popcnt(mask);
+      mask &= DiffDwords(src, live, count);
+      return before - bit::popcnt(mask);
+    }
+
+    /**
+     * \brief Clears bits of a mask whose boolean value matches the device
+     * \returns Number of bits cleared
+     */
+    uint32_t FilterBits(uint32_t& mask, uint32_t src, uint32_t live) {
+      uint32_t before = bit::popcnt(mask);
+      mask &= src ^ live;
+      return before - bit::popcnt(mask);
+    }
+
+  }
+  // NV-DXVK end
+
   D3D9StateBlock::D3D9StateBlock(D3D9DeviceEx* pDevice, D3D9StateBlockType Type)
     : D3D9StateBlockBase(pDevice)
     // NV-DXVK start: unbound light indices
@@ -52,6 +149,10 @@ namespace dxvk {
 
 
   HRESULT STDMETHODCALLTYPE D3D9StateBlock::Apply() {
+    // NV-DXVK start: redundant state filtering
+    D3D9DeviceLock lock = m_parent->LockDevice();
+    // NV-DXVK end
+
     m_applying = true;
 
     if (m_captures.flags.test(D3D9CapturedStateFlag::VertexDecl) && m_state.vertexDecl != nullptr)
@@ -64,6 +165,94 @@ namespace dxvk {
   }
 
 
+  // NV-DXVK start: redundant state filtering
+  D3D9StateCaptures& D3D9StateBlock::ComputeApplyDelta() {
+    m_applyDelta = m_captures;
+
+    // While recording, the device state is not what the
+    // recorder will see when its own block gets applied
+    if (m_parent->IsRecordingStateBlock())
+      return m_applyDelta;
+
+    auto& delta = m_applyDelta;
+    const D3D9CapturableState* live = m_deviceState;
+
+    uint32_t filtered = 0;
+
+    if (delta.flags.test(D3D9CapturedStateFlag::RenderStates)) {
+      for (uint32_t i = 0; i < delta.renderStates.dwordCount(); i++) {
+        filtered += FilterDwords(delta.renderStates.dword(i),
+          &m_state.renderStates[i * 32], &live->renderStates[i * 32],
+          std::min(32u, RenderStateCount - i * 32));
+      }
+    }
+
+    if (delta.flags.test(D3D9CapturedStateFlag::SamplerStates)) {
+      for (uint32_t samplerIdx : bit::BitMask(delta.samplers.dword(0))) {
+        filtered += FilterDwords(delta.samplerStates[samplerIdx].dword(0),
+          m_state.samplerStates[samplerIdx].data(), live->samplerStates[samplerIdx].data(),
+          SamplerStateCount);
+      }
+    }
+
+    if (delta.flags.test(D3D9CapturedStateFlag::TextureStages)) {
+      for (uint32_t stageIdx : bit::BitMask(delta.textureStages.dword(0))) {
+        filtered += FilterDwords(delta.textureStageStates[stageIdx].dword(0),
+          m_state.textureStages[stageIdx].data(), live->textureStages[stageIdx].data(),
+          TextureStageStateCount);
+      }
+    }
+
+    if (delta.flags.test(D3D9CapturedStateFlag::Textures)) {
+      for (uint32_t idx : bit::BitMask(delta.textures.dword(0))) {
+        if (m_state.textures[idx] == live->textures[idx]) {
+          delta.textures.set(idx, false);
+          filtered += 1;
+        }
+      }
+    }
+
+    if (delta.flags.test(D3D9CapturedStateFlag::StreamFreq)) {
+      filtered += FilterDwords(delta.streamFreq.dword(0),
+        m_state.streamFreq.data(), live->streamFreq.data(), caps::MaxStreams);
+    }
+
+    if (delta.flags.test(D3D9CapturedStateFlag::ClipPlanes))
+      filtered += FilterRegisters(delta.clipPlanes, m_state.clipPlanes.data(), live->clipPlanes.data());
+
+    if (delta.flags.test(D3D9CapturedStateFlag::Material)
+     && std::memcmp(&m_state.material, &live->material, sizeof(D3DMATERIAL9)) == 0) {
+      delta.flags.clr(D3D9CapturedStateFlag::Material);
+      filtered += 1;
+    }
+
+    if (delta.flags.test(D3D9CapturedStateFlag::VsConstants)) {
+      filtered += FilterRegisters(delta.vsConsts.fConsts, m_state.vsConsts.fConsts, live->vsConsts.fConsts);
+      filtered += FilterRegisters(delta.vsConsts.iConsts, m_state.vsConsts.iConsts, live->vsConsts.iConsts);
+
+      for (uint32_t i = 0; i < delta.vsConsts.bConsts.dwordCount(); i++)
+        filtered += FilterBits(delta.vsConsts.bConsts.dword(i), m_state.vsConsts.bConsts[i], live->vsConsts.bConsts[i]);
+    }
+
+    if (delta.flags.test(D3D9CapturedStateFlag::PsConstants)) {
+      filtered += FilterRegisters(delta.psConsts.fConsts, m_state.psConsts.fConsts, live->psConsts.fConsts);
+      filtered += FilterRegisters(delta.psConsts.iConsts, m_state.psConsts.iConsts, live->psConsts.iConsts);
+
+      for (uint32_t i = 0; i < delta.psConsts.bConsts.dwordCount(); i++)
+        filtered += FilterBits(delta.psConsts.bConsts.dword(i), m_state.psConsts.bConsts[i], live->psConsts.bConsts[i]);
+    }
+
+    // Transforms are compared by the device itself since it has to
+    // track bone indices regardless, and viewport, scissor, streams
+    // and shaders are always applied as they carry side effects.
+    if (filtered)
+      m_parent->RecordFilteredStates(filtered);
+
+    return delta;
+  }
+  // NV-DXVK end
+
+
   HRESULT D3D9StateBlock::SetVertexDeclaration(D3D9VertexDecl* pDecl) {
     m_state.vertexDecl = pDecl;
 
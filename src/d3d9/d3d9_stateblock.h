@@ -172,19 +172,20 @@ namespace dxvk {
       Capture
     };
 
+    // NV-DXVK start: redundant state filtering
     template <typename Dst, typename Src>
-    void ApplyOrCapture(Dst* dst, const Src* src) {
-      if (m_captures.flags.test(D3D9CapturedStateFlag::StreamFreq)) {
-        for (uint32_t idx : bit::BitMask(m_captures.streamFreq.dword(0)))
+    void ApplyOrCapture(Dst* dst, const Src* src, D3D9StateCaptures& captures) {
+      if (captures.flags.test(D3D9CapturedStateFlag::StreamFreq)) {
+        for (uint32_t idx : bit::BitMask(captures.streamFreq.dword(0)))
           dst->SetStreamSourceFreq(idx, src->streamFreq[idx]);
       }
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::Indices))
+      if (captures.flags.test(D3D9CapturedStateFlag::Indices))
         dst->SetIndices(src->indices.ptr());
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::RenderStates)) {
-        for (uint32_t i = 0; i < m_captures.renderStates.dwordCount(); i++) {
-          for (uint32_t rs : bit::BitMask(m_captures.renderStates.dword(i))) {
+      if (captures.flags.test(D3D9CapturedStateFlag::RenderStates)) {
+        for (uint32_t i = 0; i < captures.renderStates.dwordCount(); i++) {
+          for (uint32_t rs : bit::BitMask(captures.renderStates.dword(i))) {
             uint32_t idx = i * 32 + rs;
 
             dst->SetRenderState(D3DRENDERSTATETYPE(idx), src->renderStates[idx]);
@@ -192,15 +193,15 @@ namespace dxvk {
         }
       }
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::SamplerStates)) {
-        for (uint32_t samplerIdx : bit::BitMask(m_captures.samplers.dword(0))) {
-          for (uint32_t stateIdx : bit::BitMask(m_captures.samplerStates[samplerIdx].dword(0)))
+      if (captures.flags.test(D3D9CapturedStateFlag::SamplerStates)) {
+        for (uint32_t samplerIdx : bit::BitMask(captures.samplers.dword(0))) {
+          for (uint32_t stateIdx : bit::BitMask(captures.samplerStates[samplerIdx].dword(0)))
             dst->SetStateSamplerState(samplerIdx, D3DSAMPLERSTATETYPE(stateIdx), src->samplerStates[samplerIdx][stateIdx]);
         }
       }
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::VertexBuffers)) {
-        for (uint32_t idx : bit::BitMask(m_captures.vertexBuffers.dword(0))) {
+      if (captures.flags.test(D3D9CapturedStateFlag::VertexBuffers)) {
+        for (uint32_t idx : bit::BitMask(captures.vertexBuffers.dword(0))) {
           const auto& vbo = src->vertexBuffers[idx];
           dst->SetStreamSource(
             idx,
@@ -210,23 +211,23 @@ namespace dxvk {
         }
       }
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::Material))
+      if (captures.flags.test(D3D9CapturedStateFlag::Material))
         dst->SetMaterial(&src->material);
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::Textures)) {
-        for (uint32_t idx : bit::BitMask(m_captures.textures.dword(0)))
+      if (captures.flags.test(D3D9CapturedStateFlag::Textures)) {
+        for (uint32_t idx : bit::BitMask(captures.textures.dword(0)))
           dst->SetStateTexture(idx, src->textures[idx]);
       }
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::VertexShader))
+      if (captures.flags.test(D3D9CapturedStateFlag::VertexShader))
         dst->SetVertexShader(src->vertexShader.ptr());
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::PixelShader))
+      if (captures.flags.test(D3D9CapturedStateFlag::PixelShader))
         dst->SetPixelShader(src->pixelShader.ptr());
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::Transforms)) {
-        for (uint32_t i = 0; i < m_captures.transforms.dwordCount(); i++) {
-          for (uint32_t trans : bit::BitMask(m_captures.transforms.dword(i))) {
+      if (captures.flags.test(D3D9CapturedStateFlag::Transforms)) {
+        for (uint32_t i = 0; i < captures.transforms.dwordCount(); i++) {
+          for (uint32_t trans : bit::BitMask(captures.transforms.dword(i))) {
             uint32_t idx = i * 32 + trans;
 
             dst->SetStateTransform(idx, reinterpret_cast<const D3DMATRIX*>(&src->transforms[idx]));
@@ -234,77 +235,65 @@ namespace dxvk {
         }
       }
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::TextureStages)) {
-        for (uint32_t stageIdx : bit::BitMask(m_captures.textureStages.dword(0))) {
-          for (uint32_t stateIdx : bit::BitMask(m_captures.textureStageStates[stageIdx].dword(0)))
+      if (captures.flags.test(D3D9CapturedStateFlag::TextureStages)) {
+        for (uint32_t stageIdx : bit::BitMask(captures.textureStages.dword(0))) {
+          for (uint32_t stateIdx : bit::BitMask(captures.textureStageStates[stageIdx].dword(0)))
             dst->SetStateTextureStageState(stageIdx, D3D9TextureStageStateTypes(stateIdx), src->textureStages[stageIdx][stateIdx]);
         }
       }
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::Viewport))
+      if (captures.flags.test(D3D9CapturedStateFlag::Viewport))
         dst->SetViewport(&src->viewport);
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::ScissorRect))
+      if (captures.flags.test(D3D9CapturedStateFlag::ScissorRect))
         dst->SetScissorRect(&src->scissorRect);
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::ClipPlanes)) {
-        for (uint32_t idx : bit::BitMask(m_captures.clipPlanes.dword(0)))
+      if (captures.flags.test(D3D9CapturedStateFlag::ClipPlanes)) {
+        for (uint32_t idx : bit::BitMask(captures.clipPlanes.dword(0)))
           dst->SetClipPlane(idx, src->clipPlanes[idx].coeff);
       }
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::VsConstants)) {
-        for (uint32_t i = 0; i < m_captures.vsConsts.fConsts.dwordCount(); i++) {
-          for (uint32_t consts : bit::BitMask(m_captures.vsConsts.fConsts.dword(i))) {
-            uint32_t idx = i * 32 + consts;
+      // Consecutive constant registers are set with a single call
+      if (captures.flags.test(D3D9CapturedStateFlag::VsConstants)) {
+        ForEachRange(captures.vsConsts.fConsts, [&] (uint32_t idx, uint32_t count) {
+          dst->SetVertexShaderConstantF(idx, (float*)&src->vsConsts.fConsts[idx], count);
+        });
 
-            dst->SetVertexShaderConstantF(idx, (float*)&src->vsConsts.fConsts[idx], 1);
-          }
-        }
-
-        for (uint32_t i = 0; i < m_captures.vsConsts.iConsts.dwordCount(); i++) {
-          for (uint32_t consts : bit::BitMask(m_captures.vsConsts.iConsts.dword(i))) {
-            uint32_t idx = i * 32 + consts;
-
-            dst->SetVertexShaderConstantI(idx, (int*)&src->vsConsts.iConsts[idx], 1);
-          }
-        }
+        ForEachRange(captures.vsConsts.iConsts, [&] (uint32_t idx, uint32_t count) {
+          dst->SetVertexShaderConstantI(idx, (int*)&src->vsConsts.iConsts[idx], count);
+        });
 
-        if (m_captures.vsConsts.bConsts.any()) {
-          for (uint32_t i = 0; i < m_captures.vsConsts.bConsts.dwordCount(); i++)
-            dst->SetVertexBoolBitfield(i, m_captures.vsConsts.bConsts.dword(i), src->vsConsts.bConsts[i]);
+        if (captures.vsConsts.bConsts.any()) {
+          for (uint32_t i = 0; i < captures.vsConsts.bConsts.dwordCount(); i++)
+            dst->SetVertexBoolBitfield(i, captures.vsConsts.bConsts.dword(i), src->vsConsts.bConsts[i]);
         }
       }
 
-      if (m_captures.flags.test(D3D9CapturedStateFlag::PsConstants)) {
-        for (uint32_t i = 0; i < m_captures.psConsts.fConsts.dwordCount(); i++) {
-          for (uint32_t consts : bit::BitMask(m_captures.psConsts.fConsts.dword(i))) {
-            uint32_t idx = i * 32 + consts;
-
-            dst->SetPixelShaderConstantF(idx, (float*)&src->psConsts.fConsts[idx], 1);
-          }
-        }
-
-        for (uint32_t i = 0; i < m_captures.psConsts.iConsts.dwordCount(); i++) {
-          for (uint32_t consts : bit::BitMask(m_captures.psConsts.iConsts.dword(i))) {
-            uint32_t idx = i * 32 + consts;
+      if (captures.flags.test(D3D9CapturedStateFlag::PsConstants)) {
+        ForEachRange(captures.psConsts.fConsts, [&] (uint32_t idx, uint32_t count) {
+          dst->SetPixelShaderConstantF(idx, (float*)&src->psConsts.fConsts[idx], count);
+        });
 
-            dst->SetPixelShaderConstantI(idx, (int*)&src->psConsts.iConsts[idx], 1);
-          }
-        }
+        ForEachRange(captures.psConsts.iConsts, [&] (uint32_t idx, uint32_t count) {
+          dst->SetPixelShaderConstantI(idx, (int*)&src->psConsts.iConsts[idx], count);
+        });
 
-        if (m_captures.psConsts.bConsts.any()) {
-          for (uint32_t i = 0; i < m_captures.psConsts.bConsts.dwordCount(); i++)
-            dst->SetPixelBoolBitfield(i, m_captures.psConsts.bConsts.dword(i), src->psConsts.bConsts[i]);
+        if (captures.psConsts.bConsts.any()) {
+          for (uint32_t i = 0; i < captures.psConsts.bConsts.dwordCount(); i++)
+            dst->SetPixelBoolBitfield(i, captures.psConsts.bConsts.dword(i), src->psConsts.bConsts[i]);
         }
       }
     }
+    // NV-DXVK end
 
     template <D3D9StateFunction Func>
     void ApplyOrCapture() {
+      // NV-DXVK start: redundant state filtering
       if      constexpr (Func == D3D9StateFunction::Apply)
-        ApplyOrCapture(m_parent, &m_state);
+        ApplyOrCapture(m_parent, &m_state, ComputeApplyDelta());
       else if constexpr (Func == D3D9StateFunction::Capture)
-        ApplyOrCapture(this, m_deviceState);
+        ApplyOrCapture(this, m_deviceState, m_captures);
+      // NV-DXVK end
     }
 
     template <
@@ -368,8 +357,52 @@ namespace dxvk {
 
     void CaptureType(D3D9StateBlockType State);
 
+    // NV-DXVK start: redundant state filtering
+    /**
+     * \brief Computes the captured state that differs from the device
+     *
+     * Compares the captured state against the live device state
+     * and drops everything that would not change it, so that
+     * applying a block only touches state that actually differs.
+     * \returns Captures to apply
+     */
+    D3D9StateCaptures& ComputeApplyDelta();
+
+    /**
+     * \brief Calls a function for each range of consecutive set bits
+     */
+    template <size_t Bits, typename Fn>
+    static void ForEachRange(bit::bitset<Bits>& mask, Fn&& fn) {
+      uint32_t first = 0;
+      uint32_t count = 0;
+
+      for (uint32_t i = 0; i < mask.dwordCount(); i++) {
+        for (uint32_t bit : bit::BitMask(mask.dword(i))) {
+          uint32_t idx = i * 32 + bit;
+
+          if (count && idx == first + count) {
+            count++;
+            continue;
+          }
+
+          if (count)
+            fn(first, count);
+
+          first = idx;
+          count = 1;
+        }
+      }
+
+      if (count)
+        fn(first, count);
+    }
+    // NV-DXVK end
+
     D3D9CapturableState  m_state;
     D3D9StateCaptures    m_captures;
+    // NV-DXVK start: redundant state filtering
+    D3D9StateCaptures    m_applyDelta;
+    // NV-DXVK end
 
     D3D9CapturableState* m_deviceState;
 
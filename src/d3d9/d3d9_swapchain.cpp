@@ -407,6 +407,14 @@ namespace dxvk {
 
     D3D9DeviceLock lock = m_parent->LockDevice();
 
+    // NV-DXVK start: asynchronous texture hashing
+    m_parent->m_textureHasher.AnnounceCompleted();
+    // NV-DXVK end
+
+    // NV-DXVK start: draw stage profiling
+    DrawProfiler::endFrame();
+    // NV-DXVK end
+
     uint32_t presentInterval = m_presentParams.PresentationInterval;
 
     // This is not true directly in d3d9 to to timing differences that don't matter for us.
@@ -1456,6 +1464,18 @@ namespace dxvk {
     if (m_hud != nullptr) {
       m_hud->addItem<hud::HudClientApiItem>("api", 1, GetApiName());
       m_hud->addItem<hud::HudSamplerCount>("samplers", -1, m_parent);
+      // NV-DXVK start: asynchronous shader compilation
+      m_hud->addItem<hud::HudShaderCompileStats>("shadercompile", -1, m_parent);
+      // NV-DXVK end
+      // NV-DXVK start: dirty-range constant uploads
+      m_hud->addItem<hud::HudConstantUploadStats>("constuploads", -1, m_parent);
+      // NV-DXVK end
+      // NV-DXVK start: redundant state filtering
+      m_hud->addItem<hud::HudStateFilterStats>("statefilter", -1, m_parent);
+      // NV-DXVK end
+      // NV-DXVK start: draw stage profiling
+      m_hud->addItem<hud::HudDrawStageStats>("drawstages", -1);
+      // NV-DXVK end
     }
   }
 
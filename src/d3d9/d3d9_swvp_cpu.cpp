@@ -0,0 +1,421 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include "d3d9_swvp_cpu.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include <ppl.h>
+#include <xmmintrin.h>
+
+namespace dxvk {
+
+  namespace {
+
+    struct SimdMatrix {
+      __m128 rows[4];
+    };
+
+    // The fixed function VS declares its matrices as row major and
+    // transforms positions as row vectors, so every output is a sum
+    // of the matrix rows scaled by the input components.
+    SimdMatrix LoadRowVectorMatrix(const Matrix4& m) {
+      SimdMatrix result;
+      for (uint32_t i = 0; i < 4; i++)
+        result.rows[i] = _mm_loadu_ps(m[i].data);
+      return result;
+    }
+
+    // Normals are multiplied from the right by the upper 3x3 part
+    // of the normal matrix, which is the transposed case of the above.
+    SimdMatrix LoadNormalMatrix(const Matrix4& m) {
+      const Matrix4 t = transpose(m);
+
+      SimdMatrix result;
+      for (uint32_t i = 0; i < 3; i++) {
+        Vector4 row = t[i];
+        row.w = 0.0f;
+        result.rows[i] = _mm_loadu_ps(row.data);
+      }
+      result.rows[3] = _mm_setzero_ps();
+      return result;
+    }
+
+    inline Vector4 Transform(const SimdMatrix& m, const Vector4& v) {
+      __m128 r = _mm_mul_ps(m.rows[0], _mm_set1_ps(v.x));
+      r = _mm_add_ps(r, _mm_mul_ps(m.rows[1], _mm_set1_ps(v.y)));
+      r = _mm_add_ps(r, _mm_mul_ps(m.rows[2], _mm_set1_ps(v.z)));
+      r = _mm_add_ps(r, _mm_mul_ps(m.rows[3], _mm_set1_ps(v.w)));
+
+      Vector4 result;
+      _mm_storeu_ps(result.data, r);
+      return result;
+    }
+
+    inline float Dot3(const Vector4& a, const Vector4& b) {
+      return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    inline Vector4 Normalize3(const Vector4& v) {
+      const float invLength = 1.0f / std::sqrt(Dot3(v, v));
+      return Vector4(v.x * invLength, v.y * invLength, v.z * invLength, 0.0f);
+    }
+
+    inline float Saturate(float v) {
+      return std::clamp(v, 0.0f, 1.0f);
+    }
+
+    inline Vector4 Saturate(const Vector4& v) {
+      return Vector4(Saturate(v.x), Saturate(v.y), Saturate(v.z), Saturate(v.w));
+    }
+
+    inline uint32_t FloatCount(D3DDECLTYPE type) {
+      switch (type) {
+        case D3DDECLTYPE_FLOAT1: return 1;
+        case D3DDECLTYPE_FLOAT2: return 2;
+        case D3DDECLTYPE_FLOAT3: return 3;
+        case D3DDECLTYPE_FLOAT4: return 4;
+        default:                 return 0;
+      }
+    }
+
+    // Same expansion as the vertex input stage: missing
+    // components are filled with (0, 0, 0, 1).
+    inline Vector4 FetchElement(const uint8_t* pData, D3DDECLTYPE type) {
+      Vector4 result(0.0f, 0.0f, 0.0f, 1.0f);
+
+      if (type == D3DDECLTYPE_D3DCOLOR) {
+        uint8_t bgra[4];
+        std::memcpy(bgra, pData, sizeof(bgra));
+
+        result = Vector4(
+          float(bgra[2]) / 255.0f,
+          float(bgra[1]) / 255.0f,
+          float(bgra[0]) / 255.0f,
+          float(bgra[3]) / 255.0f);
+      }
+      else
+        std::memcpy(result.data, pData, FloatCount(type) * sizeof(float));
+
+      return result;
+    }
+
+    // Same conversion as the SWVP geometry shader,
+    // which truncates when converting colors.
+    inline void StoreElement(uint8_t* pData, D3DDECLTYPE type, const Vector4& value) {
+      if (type == D3DDECLTYPE_D3DCOLOR) {
+        const uint8_t bgra[4] = {
+          uint8_t(Saturate(value.z) * 255.0f),
+          uint8_t(Saturate(value.y) * 255.0f),
+          uint8_t(Saturate(value.x) * 255.0f),
+          uint8_t(Saturate(value.w) * 255.0f) };
+
+        std::memcpy(pData, bgra, sizeof(bgra));
+      }
+      else
+        std::memcpy(pData, value.data, FloatCount(type) * sizeof(float));
+    }
+
+  }
+
+
+  D3D9SWVPCpuKernel::D3D9SWVPCpuKernel(
+    const D3D9SWVPCpuState&   state,
+    const D3DVERTEXELEMENT9*  pInputElements,
+          uint32_t            inputCount,
+    const D3DVERTEXELEMENT9*  pOutputElements,
+          uint32_t            outputCount)
+  : m_state(state) {
+    for (uint32_t i = 0; i < inputCount; i++) {
+      uint32_t attribute;
+
+      if (!MapUsage(pInputElements[i], &attribute))
+        continue;
+
+      m_inputs.push_back({ attribute,
+        pInputElements[i].Stream,
+        pInputElements[i].Offset,
+        D3DDECLTYPE(pInputElements[i].Type) });
+    }
+
+    for (uint32_t i = 0; i < outputCount; i++) {
+      uint32_t attribute;
+
+      if (!MapUsage(pOutputElements[i], &attribute))
+        continue;
+
+      m_outputs.push_back({ attribute,
+        0u, pOutputElements[i].Offset,
+        D3DDECLTYPE(pOutputElements[i].Type) });
+    }
+  }
+
+
+  bool D3D9SWVPCpuKernel::SupportsDeclarations(
+    const D3DVERTEXELEMENT9*  pInputElements,
+          uint32_t            inputCount,
+    const D3DVERTEXELEMENT9*  pOutputElements,
+          uint32_t            outputCount) {
+    auto isSupportedType = [] (BYTE type) {
+      return type == D3DDECLTYPE_D3DCOLOR
+          || FloatCount(D3DDECLTYPE(type)) != 0;
+    };
+
+    bool hasPosition = false;
+
+    for (uint32_t i = 0; i < inputCount; i++) {
+      uint32_t attribute;
+
+      if (!MapUsage(pInputElements[i], &attribute))
+        continue;
+
+      if (!isSupportedType(pInputElements[i].Type))
+        return false;
+
+      hasPosition |= attribute == uint32_t(Attribute::Position);
+    }
+
+    if (!hasPosition)
+      return false;
+
+    for (uint32_t i = 0; i < outputCount; i++) {
+      uint32_t attribute;
+
+      if (!MapUsage(pOutputElements[i], &attribute)
+       || !isSupportedType(pOutputElements[i].Type))
+        return false;
+    }
+
+    return true;
+  }
+
+
+  void D3D9SWVPCpuKernel::Process(
+    const D3D9SWVPCpuStream*  pStreams,
+          uint32_t            firstVertex,
+          uint32_t            vertexCount,
+          uint8_t*            pDst,
+          uint32_t            dstStride) const {
+    const uint32_t batchCount = (vertexCount + BatchSize - 1) / BatchSize;
+
+    // Not worth waking up worker threads for a handful of batches
+    if (batchCount <= 2) {
+      ProcessBatch(pStreams, firstVertex, vertexCount, pDst, dstStride);
+      return;
+    }
+
+    concurrency::parallel_for<uint32_t>(0, batchCount, [&] (uint32_t batch) {
+      const uint32_t first = batch * BatchSize;
+      const uint32_t count = std::min(BatchSize, vertexCount - first);
+
+      ProcessBatch(pStreams, firstVertex + first, count,
+        pDst + size_t(first) * dstStride, dstStride);
+    });
+  }
+
+
+  void D3D9SWVPCpuKernel::ProcessBatch(
+    const D3D9SWVPCpuStream*  pStreams,
+          uint32_t            firstVertex,
+          uint32_t            vertexCount,
+          uint8_t*            pDst,
+          uint32_t            dstStride) const {
+    const SimdMatrix worldView  = LoadRowVectorMatrix(m_state.WorldView);
+    const SimdMatrix projection = LoadRowVectorMatrix(m_state.Projection);
+    const SimdMatrix normalMtx  = LoadNormalMatrix(m_state.NormalMatrix);
+
+    Vertex in;
+    Vertex out;
+
+    Vector4* attributes[uint32_t(Attribute::Count)] = {
+      &in.position, &in.normal, &in.color[0], &in.color[1] };
+
+    for (uint32_t i = 0; i < caps::TextureStageCount; i++)
+      attributes[uint32_t(Attribute::Texcoord0) + i] = &in.texcoord[i];
+
+    for (uint32_t v = 0; v < vertexCount; v++) {
+      // Defaults for attributes missing from the declaration,
+      // matching the fixed function vertex shader.
+      in.position = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+      in.normal   = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+      in.color[0] = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
+      in.color[1] = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+      in.texcoord.fill(Vector4(0.0f, 0.0f, 0.0f, 0.0f));
+
+      for (const auto& element : m_inputs) {
+        const D3D9SWVPCpuStream& stream = pStreams[element.stream];
+        const uint8_t* pData = stream.data
+          + size_t(firstVertex + v) * stream.stride
+          + element.offset;
+
+        *attributes[element.attribute] = FetchElement(pData, element.type);
+      }
+
+      // Position and normal into view space, then project
+      out.position = Transform(worldView, in.position);
+      out.normal   = Transform(normalMtx, in.normal);
+
+      if (m_state.NormalizeNormals && Dot3(out.normal, out.normal) != 0.0f)
+        out.normal = Normalize3(out.normal);
+
+      ShadeVertex(in, out);
+
+      out.position = Transform(projection, out.position);
+      out.normal.w = 1.0f;
+
+      uint8_t* pVertex = pDst + size_t(v) * dstStride;
+
+      for (const auto& element : m_outputs) {
+        const Vector4* value = nullptr;
+
+        switch (Attribute(element.attribute)) {
+          case Attribute::Position: value = &out.position; break;
+          case Attribute::Normal:   value = &out.normal;   break;
+          case Attribute::Color0:   value = &out.color[0]; break;
+          case Attribute::Color1:   value = &out.color[1]; break;
+          default: value = &in.texcoord[m_state.TexcoordIndices[element.attribute - uint32_t(Attribute::Texcoord0)] & 0x7];
+        }
+
+        StoreElement(pVertex + element.offset, element.type, *value);
+      }
+    }
+  }
+
+
+  void D3D9SWVPCpuKernel::ShadeVertex(
+    const Vertex&   in,
+          Vertex&   out) const {
+    if (!m_state.UseLighting) {
+      out.color[0] = in.color[0];
+      out.color[1] = in.color[1];
+      return;
+    }
+
+    const Vector4& vtx    = out.position;
+    const Vector4& normal = out.normal;
+
+    Vector4 diffuseValue (0.0f, 0.0f, 0.0f, 0.0f);
+    Vector4 specularValue(0.0f, 0.0f, 0.0f, 0.0f);
+    Vector4 ambientValue (0.0f, 0.0f, 0.0f, 0.0f);
+
+    for (uint32_t i = 0; i < m_state.LightCount; i++) {
+      const D3D9SWVPCpuLight& light = m_state.Lights[i];
+
+      const bool isSpot        = light.Type == D3DLIGHT_SPOT;
+      const bool isDirectional = light.Type == D3DLIGHT_DIRECTIONAL;
+
+      Vector4 delta = light.Position - vtx;
+      delta.w = 0.0f;
+
+      const float d = std::sqrt(Dot3(delta, delta));
+
+      Vector4 hitDir = isDirectional
+        ? Vector4(-light.Direction.x, -light.Direction.y, -light.Direction.z, 0.0f)
+        : delta;
+      hitDir = Normalize3(hitDir);
+
+      float atten = 1.0f / std::fma(d, std::fma(d, light.Attenuation2, light.Attenuation1), light.Attenuation0);
+      atten = std::fmin(atten, FLT_MAX);
+      atten = d > light.Range ? 0.0f : atten;
+      atten = isDirectional ? 1.0f : atten;
+
+      if (isSpot) {
+        const float rho = -Dot3(hitDir, light.Direction);
+
+        float spotAtten = std::pow((rho - light.Phi) / (light.Theta - light.Phi), light.Falloff);
+        spotAtten = rho >  light.Phi   ? spotAtten : 0.0f;
+        spotAtten = rho <= light.Theta ? spotAtten : 1.0f;
+
+        atten *= Saturate(spotAtten);
+      }
+
+      const float hitDot      = Saturate(Dot3(normal, hitDir));
+      const float diffuseness = hitDot * atten;
+
+      Vector4 mid = m_state.LocalViewer
+        ? hitDir - Normalize3(vtx)
+        : hitDir - Vector4(0.0f, 0.0f, 1.0f, 0.0f);
+      mid = Normalize3(mid);
+
+      const float midDot       = Saturate(Dot3(normal, mid));
+      const float specularness = midDot > 0.0f
+        ? std::pow(midDot, m_state.MaterialPower) * atten
+        : 0.0f;
+
+      ambientValue  = ambientValue  + light.Ambient  * atten;
+      diffuseValue  = diffuseValue  + light.Diffuse  * diffuseness;
+      specularValue = specularValue + light.Specular * specularness;
+    }
+
+    auto pickSource = [&] (uint32_t source, const Vector4& material) -> const Vector4& {
+      if (source == D3DMCS_MATERIAL)
+        return material;
+      else if (source == D3DMCS_COLOR1)
+        return in.color[0];
+      else
+        return in.color[1];
+    };
+
+    const Vector4& matDiffuse  = pickSource(m_state.DiffuseSource,  m_state.MaterialDiffuse);
+    const Vector4& matAmbient  = pickSource(m_state.AmbientSource,  m_state.MaterialAmbient);
+    const Vector4& matEmissive = pickSource(m_state.EmissiveSource, m_state.MaterialEmissive);
+    const Vector4& matSpecular = pickSource(m_state.SpecularSource, m_state.MaterialSpecular);
+
+    Vector4 color0 = matAmbient * m_state.GlobalAmbient + matEmissive;
+    color0 = matAmbient * ambientValue + color0;
+    color0 = matDiffuse * diffuseValue + color0;
+    color0.w = matDiffuse.w;
+
+    out.color[0] = Saturate(color0);
+    out.color[1] = Saturate(matSpecular * specularValue);
+  }
+
+
+  bool D3D9SWVPCpuKernel::MapUsage(
+    const D3DVERTEXELEMENT9&  element,
+          uint32_t*           pAttribute) {
+    switch (element.Usage) {
+      case D3DDECLUSAGE_POSITION:
+      case D3DDECLUSAGE_POSITIONT:
+        *pAttribute = uint32_t(Attribute::Position);
+        return element.UsageIndex == 0;
+
+      case D3DDECLUSAGE_NORMAL:
+        *pAttribute = uint32_t(Attribute::Normal);
+        return element.UsageIndex == 0;
+
+      case D3DDECLUSAGE_COLOR:
+        *pAttribute = uint32_t(Attribute::Color0) + element.UsageIndex;
+        return element.UsageIndex < 2;
+
+      case D3DDECLUSAGE_TEXCOORD:
+        *pAttribute = uint32_t(Attribute::Texcoord0) + element.UsageIndex;
+        return element.UsageIndex < caps::TextureStageCount;
+
+      default:
+        return false;
+    }
+  }
+
+}
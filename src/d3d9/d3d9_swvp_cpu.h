@@ -0,0 +1,202 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include "d3d9_include.h"
+#include "d3d9_caps.h"
+
+#include "../util/util_matrix.h"
+
+#include <array>
+#include <vector>
+
+namespace dxvk {
+
+  /**
+   * \brief Light consumed by the CPU vertex kernel
+   *
+   * Same view space data the fixed function
+   * vertex shader reads from its constant buffer.
+   */
+  struct D3D9SWVPCpuLight {
+    Vector4 Diffuse;
+    Vector4 Specular;
+    Vector4 Ambient;
+
+    Vector4 Position;
+    Vector4 Direction;
+
+    D3DLIGHTTYPE Type = D3DLIGHT_DIRECTIONAL;
+    float Range        = 0.0f;
+    float Falloff      = 0.0f;
+    float Attenuation0 = 0.0f;
+    float Attenuation1 = 0.0f;
+    float Attenuation2 = 0.0f;
+    float Theta        = 0.0f;
+    float Phi          = 0.0f;
+  };
+
+  /**
+   * \brief Fixed function state for CPU vertex processing
+   *
+   * Covers the subset of the fixed function vertex pipeline
+   * the kernel implements: no vertex blending, no pre-transformed
+   * positions and no texture coordinate generation or transforms.
+   */
+  struct D3D9SWVPCpuState {
+    Matrix4 WorldView;
+    Matrix4 NormalMatrix;
+    Matrix4 Projection;
+
+    bool UseLighting      = false;
+    bool NormalizeNormals = false;
+    bool LocalViewer      = false;
+
+    uint32_t DiffuseSource  = D3DMCS_MATERIAL;
+    uint32_t AmbientSource  = D3DMCS_MATERIAL;
+    uint32_t SpecularSource = D3DMCS_MATERIAL;
+    uint32_t EmissiveSource = D3DMCS_MATERIAL;
+
+    Vector4 GlobalAmbient;
+    Vector4 MaterialDiffuse;
+    Vector4 MaterialAmbient;
+    Vector4 MaterialSpecular;
+    Vector4 MaterialEmissive;
+    float   MaterialPower = 0.0f;
+
+    uint32_t LightCount = 0;
+    std::array<D3D9SWVPCpuLight, caps::MaxEnabledLights> Lights;
+
+    /// Input texture coordinate set written to each output set
+    std::array<uint32_t, caps::TextureStageCount> TexcoordIndices = { 0, 1, 2, 3, 4, 5, 6, 7 };
+  };
+
+  /**
+   * \brief Source vertex stream
+   */
+  struct D3D9SWVPCpuStream {
+    const uint8_t* data   = nullptr;
+    uint32_t       stride = 0;
+  };
+
+  /**
+   * \brief CPU fixed function vertex kernel
+   *
+   * Implements \c ProcessVertices for fixed function state on
+   * the CPU, producing the same output as the geometry shader
+   * based emulation. Positions and normals are transformed with
+   * SSE, and large vertex ranges are split into batches that
+   * are processed in parallel.
+   */
+  class D3D9SWVPCpuKernel {
+    constexpr static uint32_t BatchSize = 1024;
+  public:
+
+    D3D9SWVPCpuKernel(
+      const D3D9SWVPCpuState&   state,
+      const D3DVERTEXELEMENT9*  pInputElements,
+            uint32_t            inputCount,
+      const D3DVERTEXELEMENT9*  pOutputElements,
+            uint32_t            outputCount);
+
+    /**
+     * \brief Checks whether the declarations are supported
+     *
+     * Only float and \c D3DCOLOR elements can be read and
+     * written, and only position, normal, color and texture
+     * coordinate outputs are produced. Everything else has
+     * to go through the GPU path.
+     */
+    static bool SupportsDeclarations(
+      const D3DVERTEXELEMENT9*  pInputElements,
+            uint32_t            inputCount,
+      const D3DVERTEXELEMENT9*  pOutputElements,
+            uint32_t            outputCount);
+
+    /**
+     * \brief Processes a range of vertices
+     *
+     * \param [in] pStreams Source streams, indexed by stream number,
+     *   must hold \c caps::MaxStreams entries
+     * \param [in] firstVertex Index of the first source vertex
+     * \param [in] vertexCount Number of vertices to process
+     * \param [out] pDst Destination of the first output vertex
+     * \param [in] dstStride Size of an output vertex
+     */
+    void Process(
+      const D3D9SWVPCpuStream*  pStreams,
+            uint32_t            firstVertex,
+            uint32_t            vertexCount,
+            uint8_t*            pDst,
+            uint32_t            dstStride) const;
+
+    /**
+     * \brief Processes a range of vertices on the calling thread
+     */
+    void ProcessBatch(
+      const D3D9SWVPCpuStream*  pStreams,
+            uint32_t            firstVertex,
+            uint32_t            vertexCount,
+            uint8_t*            pDst,
+            uint32_t            dstStride) const;
+
+  private:
+
+    enum class Attribute : uint32_t {
+      Position,
+      Normal,
+      Color0,
+      Color1,
+      Texcoord0,
+      Count = Texcoord0 + caps::TextureStageCount
+    };
+
+    struct Element {
+      uint32_t    attribute;
+      uint32_t    stream;
+      uint32_t    offset;
+      D3DDECLTYPE type;
+    };
+
+    struct Vertex {
+      Vector4 position;
+      Vector4 normal;
+      Vector4 color[2];
+      std::array<Vector4, caps::TextureStageCount> texcoord;
+    };
+
+    D3D9SWVPCpuState      m_state;
+
+    std::vector<Element>  m_inputs;
+    std::vector<Element>  m_outputs;
+
+    void ShadeVertex(
+      const Vertex&   in,
+            Vertex&   out) const;
+
+    static bool MapUsage(
+      const D3DVERTEXELEMENT9&  element,
+            uint32_t*           pAttribute);
+
+  };
+
+}
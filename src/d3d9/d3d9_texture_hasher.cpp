@@ -0,0 +1,135 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include "d3d9_texture_hasher.h"
+
+#include "../dxvk/imgui/dxvk_imgui.h"
+
+#include <algorithm>
+#include <ppl.h>
+
+namespace dxvk {
+
+  /// Chunk size of the version 1 tree hash, must never change
+  constexpr size_t TreeHashChunkSize = 1 << 20;
+
+  D3D9TextureHasher::D3D9TextureHasher()
+    : m_workers(uint8_t(std::clamp(dxvk::thread::hardware_concurrency() / 4, 1u, 4u)), "texture-hashing") {
+  }
+
+
+  D3D9TextureHasher::~D3D9TextureHasher() {
+    // Tasks still queued when the pool shuts down are
+    // cancelled, which would leave their images pending
+    WaitFor([] (const PendingHash&) { return true; });
+  }
+
+
+  void D3D9TextureHasher::HashTexture(
+    const Rc<DxvkImage>&        image,
+    const Rc<DxvkImageView>&    view,
+    const Rc<DxvkBuffer>&       buffer,
+    const void*                 data,
+          size_t                size,
+    const D3D9TextureHashParams& params) {
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+    image->setHashPending();
+
+    auto future = m_workers.Schedule([image, data, size, params] {
+      image->setHash(ComputeHash(data, size, params));
+    });
+
+    if (unlikely(!future.valid())) {
+      image->setHash(ComputeHash(data, size, params));
+      ImGUI::AddTexture(image->getHash(), view);
+      return;
+    }
+
+    m_pending.push_back({ image, view, buffer });
+  }
+
+
+  void D3D9TextureHasher::WaitForBuffer(const DxvkBuffer* buffer) {
+    WaitFor([buffer] (const PendingHash& entry) {
+      return entry.buffer.ptr() == buffer;
+    });
+  }
+
+
+  void D3D9TextureHasher::WaitForImage(const DxvkImage* image) {
+    WaitFor([image] (const PendingHash& entry) {
+      return entry.image.ptr() == image;
+    });
+  }
+
+
+  void D3D9TextureHasher::AnnounceCompleted() {
+    WaitFor([] (const PendingHash& entry) {
+      return !entry.image->isHashPending();
+    });
+  }
+
+
+  template <typename Pred>
+  void D3D9TextureHasher::WaitFor(Pred&& pred) {
+    std::lock_guard<dxvk::mutex> lock(m_mutex);
+
+    if (likely(m_pending.empty()))
+      return;
+
+    auto end = std::remove_if(m_pending.begin(), m_pending.end(), [&] (const PendingHash& entry) {
+      if (!pred(entry))
+        return false;
+
+      // Waits for the worker if the hash is not done yet
+      ImGUI::AddTexture(entry.image->getHash(), entry.view);
+      return true;
+    });
+
+    m_pending.erase(end, m_pending.end());
+  }
+
+
+  XXH64_hash_t D3D9TextureHasher::ComputeHash(
+    const void*                 data,
+          size_t                size,
+    const D3D9TextureHashParams& params) {
+    if (unlikely(params.obsolete))
+      return XXH64(data, size, 0);
+
+    if (params.version == 0 || size < std::max(params.treeMinSize, TreeHashChunkSize + 1))
+      return XXH3_64bits(data, size);
+
+    const size_t chunkCount = (size + TreeHashChunkSize - 1) / TreeHashChunkSize;
+    std::vector<XXH64_hash_t> chunkHashes(chunkCount);
+
+    concurrency::parallel_for<size_t>(0, chunkCount, [&] (size_t chunk) {
+      const size_t offset = chunk * TreeHashChunkSize;
+      chunkHashes[chunk] = XXH3_64bits(
+        reinterpret_cast<const uint8_t*>(data) + offset,
+        std::min(TreeHashChunkSize, size - offset));
+    });
+
+    return XXH3_64bits(chunkHashes.data(), chunkHashes.size() * sizeof(XXH64_hash_t));
+  }
+
+}
@@ -0,0 +1,146 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include "d3d9_include.h"
+
+#include "../dxvk/dxvk_buffer.h"
+#include "../dxvk/dxvk_image.h"
+
+#include "../util/util_threadpool.h"
+
+#include <vector>
+
+namespace dxvk {
+
+  /**
+   * \brief Texture content hashing parameters
+   */
+  struct D3D9TextureHashParams {
+    /// Use the XXH64 hash kept for older projects
+    bool     obsolete        = false;
+    /// Hash rule version, see \c rtx.textureHashVersion
+    uint32_t version         = 0;
+    /// Minimum size in bytes hashed as a tree in version 1
+    size_t   treeMinSize     = 0;
+  };
+
+  /**
+   * \brief Computes texture content hashes off the application thread
+   *
+   * Hashing the CPU copy of a texture the first time it gets uploaded
+   * stalls the application thread for large textures. Hashes are
+   * instead computed on a small worker pool. The destination image is
+   * marked as pending until the hash arrives, so any reader of the hash
+   * resolves it lazily, waiting only if the worker is not done yet.
+   *
+   * The hashed memory stays owned by the source buffer. Before the
+   * application is allowed to write to a buffer again, \c WaitForBuffer
+   * must be called so the hash always reflects the uploaded contents.
+   *
+   * All methods are called from threads holding the device lock.
+   */
+  class D3D9TextureHasher {
+    constexpr static uint32_t MaxQueuedHashesPerThread = 64;
+  public:
+
+    D3D9TextureHasher();
+
+    ~D3D9TextureHasher();
+
+    /**
+     * \brief Hashes texture contents
+     *
+     * Hashes asynchronously when possible, and falls back to
+     * hashing in place if the worker queue is full.
+     * \param [in] image Image that receives the hash
+     * \param [in] view View registered with the UI once hashed
+     * \param [in] buffer Buffer owning the data
+     * \param [in] data Data to hash
+     * \param [in] size Data size in bytes
+     * \param [in] params Hashing parameters
+     */
+    void HashTexture(
+      const Rc<DxvkImage>&        image,
+      const Rc<DxvkImageView>&    view,
+      const Rc<DxvkBuffer>&       buffer,
+      const void*                 data,
+            size_t                size,
+      const D3D9TextureHashParams& params);
+
+    /**
+     * \brief Waits for hashes reading from a buffer
+     * \param [in] buffer Buffer about to be written
+     */
+    void WaitForBuffer(const DxvkBuffer* buffer);
+
+    /**
+     * \brief Waits for the hash of an image
+     * \param [in] image Image about to be destroyed
+     */
+    void WaitForImage(const DxvkImage* image);
+
+    /**
+     * \brief Registers completed hashes with the UI
+     *
+     * Called once per frame on the application thread, since
+     * the UI texture registry is not thread safe.
+     */
+    void AnnounceCompleted();
+
+    /**
+     * \brief Computes a texture content hash
+     *
+     * Version 0 hashes the whole buffer with XXH3, or XXH64 for
+     * obsolete projects. Version 1 splits buffers of at least
+     * \c treeMinSize bytes into fixed size chunks, hashes them
+     * in parallel and hashes the list of chunk hashes. Smaller
+     * buffers hash the same in both versions.
+     * \param [in] data Data to hash
+     * \param [in] size Data size in bytes
+     * \param [in] params Hashing parameters
+     * \returns Content hash
+     */
+    static XXH64_hash_t ComputeHash(
+      const void*                 data,
+            size_t                size,
+      const D3D9TextureHashParams& params);
+
+  private:
+
+    struct PendingHash {
+      Rc<DxvkImage>     image;
+      Rc<DxvkImageView> view;
+      Rc<DxvkBuffer>    buffer;
+    };
+
+    dxvk::mutex                   m_mutex;
+    std::vector<PendingHash>      m_pending;
+
+    WorkerThreadPool<MaxQueuedHashesPerThread, true, false> m_workers;
+
+    template <typename Pred>
+    void WaitFor(Pred&& pred);
+
+  };
+
+}
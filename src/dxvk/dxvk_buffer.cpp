@@ -26,6 +26,10 @@
 #include <numeric>
 
 namespace dxvk {
+
+  // NV-DXVK start: Bindless descriptor caching
+  std::atomic<uint64_t> DxvkBuffer::s_cookie = { 0ull };
+  // NV-DXVK end
   
   DxvkBuffer::DxvkBuffer(
           DxvkDevice*           device,
@@ -320,8 +324,9 @@ namespace dxvk {
   const DxvkBufferCreateInfo& createInfo,
         DxvkMemoryAllocator& memAlloc,
         VkMemoryPropertyFlags memFlags,
-        VkAccelerationStructureTypeKHR accelType)
-    : DxvkBuffer(device, createInfo, memAlloc, memFlags, DxvkMemoryStats::Category::RTXAccelerationStructure) {
+        VkAccelerationStructureTypeKHR accelType,
+        DxvkMemoryStats::Category category)
+    : DxvkBuffer(device, createInfo, memAlloc, memFlags, category) {
 
     VkAccelerationStructureCreateInfoKHR accelCreateInfo {};
     accelCreateInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
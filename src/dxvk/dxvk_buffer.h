@@ -324,6 +324,20 @@ namespace dxvk {
 
     VkDeviceAddress getDeviceAddress();
 
+    // NV-DXVK start: Bindless descriptor caching
+    /**
+     * \brief Unique object identifier
+     *
+     * Can be used to identify an object even when
+     * the lifetime of the object is unknown, and
+     * without referencing the actual object.
+     * \returns Unique identifier
+     */
+    uint64_t cookie() const {
+      return m_cookie;
+    }
+    // NV-DXVK end
+
     // NV-DXVK start: buffer clones for orphaned slices
     /**
      * \brief Creates a clone of the buffer
@@ -363,6 +377,12 @@ namespace dxvk {
     VkDeviceSize m_physSliceMaxCount = 1;
 
     DxvkMemoryStats::Category m_category;
+
+    // NV-DXVK start: Bindless descriptor caching
+    uint64_t m_cookie = ++s_cookie;
+
+    static std::atomic<uint64_t> s_cookie;
+    // NV-DXVK end
     
     void pushSlice(const DxvkBufferHandle& handle, uint32_t index) {
       DxvkBufferSliceHandle slice;
@@ -733,7 +753,8 @@ namespace dxvk {
       const DxvkBufferCreateInfo& createInfo,
             DxvkMemoryAllocator& memAlloc,
             VkMemoryPropertyFlags memFlags,
-            VkAccelerationStructureTypeKHR accelType);
+            VkAccelerationStructureTypeKHR accelType,
+            DxvkMemoryStats::Category category = DxvkMemoryStats::Category::RTXAccelerationStructure);
 
     ~DxvkAccelStructure();
 
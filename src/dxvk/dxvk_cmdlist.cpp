@@ -81,6 +81,12 @@ namespace dxvk {
 
   // NV-DXVK start: DLFG integration
   void DxvkCommandList::addWaitSemaphore(VkSemaphore waitSemaphore, uint64_t waitSemaphoreValue) {
+    // Repeated waits on the same timeline semaphore collapse into a wait for the highest value
+    if (m_additionalWaitSemaphore == waitSemaphore) {
+      m_additionalWaitSemaphoreValue = std::max(m_additionalWaitSemaphoreValue, waitSemaphoreValue);
+      return;
+    }
+
     assert(!m_additionalWaitSemaphore);
     m_additionalWaitSemaphore = waitSemaphore;
     m_additionalWaitSemaphoreValue = waitSemaphoreValue;
@@ -92,6 +92,9 @@ namespace dxvk {
     // NV-DXVK start: DLFG integration
     /**
      * \brief Adds an extra wait semaphore to this command list
+     *
+     * Waiting on the same timeline semaphore more than
+     * once only waits for the highest value.
      */
     void addWaitSemaphore(VkSemaphore waitSemaphore, uint64_t waitSemaphoreValue = -1);
     /**
@@ -27,8 +27,16 @@
 #include "dxvk_context.h"
 #include "../d3d9/d3d9_state.h"
 #include "../d3d9/d3d9_spec_constants.h"
+#include "../util/util_time.h"
 
 namespace dxvk {
+  // NV-DXVK start: Adaptive submission batching
+  static uint64_t getSubmitTimeUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+      dxvk::high_resolution_clock::now().time_since_epoch()).count();
+  }
+  // NV-DXVK end
+
   DxvkContext::DxvkContext(const Rc<DxvkDevice>& device)
     : m_device(device),
     m_common(&device->m_objects),
@@ -49,6 +57,11 @@ namespace dxvk {
     // Init framebuffer info with default render pass in case
     // the app does not explicitly bind any render targets
     m_state.om.framebufferInfo = makeFramebufferInfo(m_state.om.renderTargets);
+
+    // NV-DXVK start: Adaptive submission batching
+    m_submitPolicy = m_device->createSubmitPolicy();
+    m_lastSubmitUs = getSubmitTimeUs();
+    // NV-DXVK end
   }
 
 
@@ -126,7 +139,53 @@ namespace dxvk {
     // NV-DXVK start: early submit heuristics for memcpy work
     m_bytesCopiedInCurrentCmdlist = 0;
     // NV-DXVK end
+
+    // NV-DXVK start: Staging ring allocator
+    const DxvkStagingDataStats& stagingStats = m_staging.getStats();
+    m_device->statCounters().setCtr(DxvkStatCounter::StagingLastFrameKb, stagingStats.bytesLastFrame >> 10);
+    m_device->statCounters().setCtr(DxvkStatCounter::StagingRingBuffers, stagingStats.bufferCount);
+    m_device->statCounters().setCtr(DxvkStatCounter::StagingRingGrowths, stagingStats.growCount);
+    // NV-DXVK end
+
+    // NV-DXVK start: Adaptive submission batching
+    m_lastSubmitUs = getSubmitTimeUs();
+    m_tracedCopiedBytes = 0;
+    m_tracedCommandCount = 0;
+    // NV-DXVK end
+  }
+
+
+  // NV-DXVK start: Adaptive submission batching
+  bool DxvkContext::flushCommandListHint() {
+    ScopedCpuProfileZone();
+
+    DxvkSubmitPolicyInput input;
+    input.timeUs = getSubmitTimeUs();
+    input.lastSubmitUs = m_lastSubmitUs;
+    input.copiedBytes = m_bytesCopiedInCurrentCmdlist;
+    input.commandCount = m_cmd->statCounters().getCtr(DxvkStatCounter::CmdDrawCalls)
+                       + m_cmd->statCounters().getCtr(DxvkStatCounter::CmdDispatchCalls)
+                       + m_cmd->statCounters().getCtr(DxvkStatCounter::CmdTraceRaysCalls);
+    input.pendingSubmissions = m_device->pendingSubmissions();
+    input.gpuIdleUs = m_device->gpuIdleTicks();
+
+    // The policy sees the totals of the command list, while the trace records
+    // the work added since the previous request so that it can be replayed
+    // against policies which submit at different points
+    m_device->recordSubmitTrace({ input.timeUs,
+      input.copiedBytes - std::min(m_tracedCopiedBytes, input.copiedBytes),
+      input.commandCount - std::min(m_tracedCommandCount, input.commandCount) });
+
+    m_tracedCopiedBytes = input.copiedBytes;
+    m_tracedCommandCount = input.commandCount;
+
+    if (!m_submitPolicy->shouldSubmit(input))
+      return false;
+
+    flushCommandList();
+    return true;
   }
+  // NV-DXVK end
 
 
   void DxvkContext::beginQuery(const Rc<DxvkGpuQuery>& query) {
@@ -2931,11 +2990,11 @@ namespace dxvk {
   // NV-DXVK start: early submit heuristics for memcpy work
   void DxvkContext::recordGPUMemCopy(uint32_t bytes)
   {
+    m_bytesCopiedInCurrentCmdlist += bytes;
+
     // XXX TODO - this early submit logic is disabled because it results in missing geometry.
     return;
 
-    m_bytesCopiedInCurrentCmdlist += bytes;
-
     const uint32_t threshold = m_device->config().memcpyKickoffThreshold;
     if (threshold > 0 && bytes >= threshold) {
       flushCommandList();
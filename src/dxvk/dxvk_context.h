@@ -26,6 +26,7 @@
 #include "dxvk_cmdlist.h"
 #include "dxvk_context_state.h"
 #include "dxvk_data.h"
+#include "dxvk_submit_policy.h"
 #include <optional>
 
 namespace dxvk {
@@ -88,6 +89,20 @@ namespace dxvk {
      * buffer and allocates a new one.
      */
     virtual void flushCommandList();
+
+    // NV-DXVK start: Adaptive submission batching
+    /**
+     * \brief Requests a command buffer flush
+     *
+     * Lets the submission policy decide whether the current
+     * command buffer is submitted now or merged with work
+     * recorded later. Only use this where nothing depends
+     * on the recorded work being submitted before the next
+     * call to \ref flushCommandList.
+     * \returns \c true if the command buffer was submitted
+     */
+    bool flushCommandListHint();
+    // NV-DXVK end
     
     /**
      * \brief Begins generating query data
@@ -1273,7 +1288,7 @@ namespace dxvk {
 
     // track the amount of memory copies being submitted to the current command list
     // we apply a heuristic to determine whether to submit early based on this value
-    uint32_t m_bytesCopiedInCurrentCmdlist = 0;
+    uint64_t m_bytesCopiedInCurrentCmdlist = 0;
 
     // records a memory copy being written to the current command list
     // may flush if heuristic decides it's time
@@ -1281,6 +1296,15 @@ namespace dxvk {
 
     // NV-DXVK end
 
+    // NV-DXVK start: Adaptive submission batching
+    std::unique_ptr<DxvkSubmitPolicy> m_submitPolicy;
+    uint64_t m_lastSubmitUs = 0;
+    // Work of the current command list at the last flush request, the
+    // submission trace records the work added since the previous request
+    uint64_t m_tracedCopiedBytes = 0;
+    uint64_t m_tracedCommandCount = 0;
+    // NV-DXVK end
+
     std::array<Rc<DxvkFramebuffer>,    512> m_framebufferCache = { };
 
     void blitImageFb(
@@ -45,6 +45,17 @@ namespace dxvk {
     m_submissionQueue   (this) {
     auto queueFamilies = m_adapter->findQueueFamilies();
 
+    // NV-DXVK start: Adaptive submission batching
+    if (!m_options.submitTraceFile.empty()) {
+      m_submitTraceFile = std::ofstream(str::tows(m_options.submitTraceFile.c_str()).c_str());
+
+      if (m_submitTraceFile)
+        m_submitTraceFile << "# time_us copied_bytes command_count (since the previous request)" << std::endl;
+      else
+        Logger::warn(str::format("DxvkDevice: Failed to open submission trace ", m_options.submitTraceFile));
+    }
+    // NV-DXVK end
+
     // NV-DXVK start: DLFG + RTXIO
     std::map<uint32_t /* queue family index */, uint32_t /* queue object count */> queueIndices;
 
@@ -116,6 +127,28 @@ namespace dxvk {
                                                            m_vkd->vkGetCalibratedTimestampsEXT);
       TracyVkContextName(m_queues.present.tracyCtx, "Present Queue", strlen("Present Queue"));
     }
+
+    // NV-DXVK start: async acceleration structure builds
+    if (m_queues.asyncCompute.queueHandle) {
+      poolInfo.queueFamilyIndex = m_queues.asyncCompute.queueFamily;
+
+      if (m_vkd->vkCreateCommandPool(m_vkd->device(), &poolInfo, nullptr, &m_queues.asyncCompute.tracyPool) != VK_SUCCESS)
+        throw DxvkError("DxvkCommandList: Failed to create async compute command pool");
+
+      cmdInfoTracy.commandPool = m_queues.asyncCompute.tracyPool;
+
+      if (m_vkd->vkAllocateCommandBuffers(m_vkd->device(), &cmdInfoTracy, &m_queues.asyncCompute.tracyCmdList) != VK_SUCCESS)
+        throw DxvkError("DxvkCommandList: Failed to allocate command buffer");
+
+      m_queues.asyncCompute.tracyCtx = TracyVkContextCalibrated(m_adapter->handle(),
+                                                                m_vkd->device(),
+                                                                m_queues.asyncCompute.queueHandle,
+                                                                m_queues.asyncCompute.tracyCmdList,
+                                                                m_vkd->vkGetPhysicalDeviceCalibrateableTimeDomainsEXT,
+                                                                m_vkd->vkGetCalibratedTimestampsEXT);
+      TracyVkContextName(m_queues.asyncCompute.tracyCtx, "Async Compute Queue", strlen("Async Compute Queue"));
+    }
+    // NV-DXVK end
 #endif
   }
 
@@ -138,6 +171,13 @@ namespace dxvk {
       TracyVkDestroy(m_queues.present.tracyCtx);
       m_vkd->vkDestroyCommandPool(m_vkd->device(), m_queues.present.tracyPool, nullptr);
     }
+
+    // NV-DXVK start: async acceleration structure builds
+    if (m_queues.asyncCompute.queueHandle) {
+      TracyVkDestroy(m_queues.asyncCompute.tracyCtx);
+      m_vkd->vkDestroyCommandPool(m_vkd->device(), m_queues.asyncCompute.tracyPool, nullptr);
+    }
+    // NV-DXVK end
 #endif
     // Stop workers explicitly in order to prevent
     // access to structures that are being destroyed.
@@ -245,8 +285,9 @@ namespace dxvk {
   Rc<DxvkAccelStructure> DxvkDevice::createAccelStructure(
       const DxvkBufferCreateInfo& createInfo,
             VkMemoryPropertyFlags memoryType,
-            VkAccelerationStructureTypeKHR accelType) {
-    return new DxvkAccelStructure(this, createInfo, m_objects.memoryManager(), memoryType, accelType);
+            VkAccelerationStructureTypeKHR accelType,
+            DxvkMemoryStats::Category category) {
+    return new DxvkAccelStructure(this, createInfo, m_objects.memoryManager(), memoryType, accelType, category);
   }
   // NV-DXVK end
   
@@ -307,6 +348,9 @@ namespace dxvk {
     result.setCtr(DxvkStatCounter::PipeCountGraphics, pipe.numGraphicsPipelines);
     result.setCtr(DxvkStatCounter::PipeCountCompute,  pipe.numComputePipelines);
     result.setCtr(DxvkStatCounter::PipeCompilerBusy,  m_objects.pipelineManager().isCompilingShaders());
+    // NV-DXVK start: prioritized pipeline compilation
+    result.setCtr(DxvkStatCounter::PipeCompilerPending, m_objects.pipelineManager().getCompilerProgress().totalPending());
+    // NV-DXVK end
     result.setCtr(DxvkStatCounter::GpuIdleTicks,      m_submissionQueue.gpuIdleTicks());
 
     std::lock_guard<sync::Spinlock> lock(m_statLock);
@@ -340,6 +384,13 @@ namespace dxvk {
   void DxvkDevice::registerShader(const Rc<DxvkShader>& shader) {
     m_objects.pipelineManager().registerShader(shader);
   }
+
+
+  // NV-DXVK start: prioritized pipeline compilation
+  void DxvkDevice::unregisterShader(const Rc<DxvkShader>& shader) {
+    m_objects.pipelineManager().unregisterShader(shader);
+  }
+  // NV-DXVK end
   
   
   void DxvkDevice::presentImage(
@@ -376,6 +427,9 @@ namespace dxvk {
       std::lock_guard<sync::Spinlock> statLock(m_statLock);
       m_statCounters.addCtr(DxvkStatCounter::QueuePresentCount, 1); // Increase getCurrentFrameId()
     }
+
+    // Reset the per-frame pipeline prewarm budget
+    m_objects.pipelineManager().endFrame();
     // NV-DXVK end
   }
 
@@ -394,6 +448,9 @@ namespace dxvk {
     submitInfo.cmdList  = commandList;
     submitInfo.waitSync = waitSync;
     submitInfo.wakeSync = wakeSync;
+    // NV-DXVK start: Frame-based resource reclamation
+    submitInfo.frameId  = getCurrentFrameId();
+    // NV-DXVK end
     m_submissionQueue.submit(submitInfo);
 
     std::lock_guard<sync::Spinlock> statLock(m_statLock);
@@ -402,6 +459,28 @@ namespace dxvk {
   }
   
   
+  // NV-DXVK start: Adaptive submission batching
+  std::unique_ptr<DxvkSubmitPolicy> DxvkDevice::createSubmitPolicy() const {
+    DxvkSubmitPolicyParams params;
+    params.maxBatchDelayUs = m_options.submitMaxBatchDelayUs;
+    params.maxBatchCost = uint64_t(m_options.submitMaxBatchSizeMiB) << 20;
+
+    return DxvkSubmitPolicy::create(
+      DxvkSubmitPolicy::parseType(m_options.submitPolicy), params);
+  }
+
+
+  void DxvkDevice::recordSubmitTrace(
+    const DxvkSubmitTraceEvent&     event) {
+    if (!m_submitTraceFile.is_open())
+      return;
+
+    std::lock_guard<dxvk::mutex> lock(m_submitTraceMutex);
+    m_submitTraceFile << event.timeUs << " " << event.copiedBytes << " " << event.commandCount << "\n";
+  }
+  // NV-DXVK end
+
+
   VkResult DxvkDevice::waitForSubmission(DxvkSubmitStatus* status) {
     VkResult result = status->result.load();
 
@@ -339,12 +339,14 @@ namespace dxvk {
      * \param [in] createInfo Buffer create info
      * \param [in] memoryType Memory type flags
      * \param [in] accelType  BLAS/TLAS
+     * \param [in] category   Memory category the structure is accounted for in
      * \returns The buffer object
      */
     Rc<DxvkAccelStructure> createAccelStructure(
       const DxvkBufferCreateInfo& createInfo,
             VkMemoryPropertyFlags memoryType,
-            VkAccelerationStructureTypeKHR accelType);
+            VkAccelerationStructureTypeKHR accelType,
+            DxvkMemoryStats::Category category = DxvkMemoryStats::Category::RTXAccelerationStructure);
     // NV-DXVK end
 
     /**
@@ -455,6 +457,19 @@ namespace dxvk {
      * \returns Current frame ID
      */
     uint32_t getCurrentFrameId() const;
+
+    // NV-DXVK start: Frame-based resource reclamation
+    /**
+     * \brief Retrieves frame ID of the last finished submission
+     *
+     * All command lists submitted during frames prior
+     * to the returned frame ID have finished executing.
+     * \returns Frame ID of the last finished submission
+     */
+    uint32_t getFinishedFrameId() const {
+      return m_submissionQueue.finishedFrameId();
+    }
+    // NV-DXVK end
     
     /**
      * \brief Initializes dummy resources
@@ -471,6 +486,17 @@ namespace dxvk {
      */
     void registerShader(
       const Rc<DxvkShader>&         shader);
+
+    // NV-DXVK start: prioritized pipeline compilation
+    /**
+     * \brief Unregisters a shader
+     *
+     * Cancels pending pipeline compiles using the shader.
+     * \param [in] shader Shader that is no longer used
+     */
+    void unregisterShader(
+      const Rc<DxvkShader>&         shader);
+    // NV-DXVK end
     
     /**
      * \brief Presents a swap chain image
@@ -549,6 +575,36 @@ namespace dxvk {
       return m_submissionQueue.pendingSubmissions();
     }
 
+    // NV-DXVK start: Adaptive submission batching
+    /**
+     * \brief Retrieves estimated GPU idle time
+     * \returns Accumulated GPU idle time, in us
+     */
+    uint64_t gpuIdleTicks() const {
+      return m_submissionQueue.gpuIdleTicks();
+    }
+
+    /**
+     * \brief Creates a submission policy
+     *
+     * Creates a new instance of the submission policy
+     * selected in the options. Each context owns one.
+     * \returns Submission policy
+     */
+    std::unique_ptr<DxvkSubmitPolicy> createSubmitPolicy() const;
+
+    /**
+     * \brief Records a soft flush request
+     *
+     * Appends the request to the submission trace
+     * file if one is configured, and does nothing
+     * otherwise. Safe to call from any thread.
+     * \param [in] event Flush request
+     */
+    void recordSubmitTrace(
+      const DxvkSubmitTraceEvent&     event);
+    // NV-DXVK end
+
     /**
      * \brief Waits for a given submission
      * 
@@ -609,6 +665,11 @@ namespace dxvk {
     
     DxvkSubmissionQueue m_submissionQueue;
 
+    // NV-DXVK start: Adaptive submission batching
+    dxvk::mutex                 m_submitTraceMutex;
+    std::ofstream               m_submitTraceFile;
+    // NV-DXVK end
+
     DxvkDevicePerfHints getPerfHints();
     
     void recycleCommandList(
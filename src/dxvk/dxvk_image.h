@@ -342,13 +342,36 @@ namespace dxvk {
       return m_image.memory.length();
     }
 
+    // NV-DXVK start: asynchronous texture hashing
     void setHash(XXH64_hash_t hash) {
       m_hash = hash;
+      m_hashPending.store(false, std::memory_order_release);
+    }
+
+    /**
+     * \brief Marks the content hash as being computed
+     *
+     * Until \c setHash is called, \c getHash waits
+     * for the hash to arrive rather than returning 0.
+     */
+    void setHashPending() {
+      m_hashPending.store(true, std::memory_order_release);
+    }
+
+    /**
+     * \brief Checks whether the content hash is still being computed
+     */
+    bool isHashPending() const {
+      return m_hashPending.load(std::memory_order_acquire);
     }
 
     XXH64_hash_t getHash() const {
+      while (unlikely(isHashPending()))
+        std::this_thread::yield();
+
       return m_hash;
     }
+    // NV-DXVK end
 
     VkDeviceMemory getMemory() const {
       return m_image.memory.memory();
@@ -376,6 +399,9 @@ namespace dxvk {
     VkMemoryPropertyFlags m_memFlags;
     DxvkPhysicalImage     m_image;
     XXH64_hash_t          m_hash = 0;
+    // NV-DXVK start: asynchronous texture hashing
+    std::atomic<bool>     m_hashPending = { false };
+    // NV-DXVK end
     small_vector<VkFormat, 4> m_viewFormats;
     
   };
@@ -32,6 +32,7 @@ DxvkMemoryStats& DxvkMemoryStats::operator=(const DxvkMemoryStats& other)
   applicationTextures = other.applicationTextures.load();
   rtxBuffers = other.rtxBuffers.load();
   rtxAccelerationStructures = other.rtxAccelerationStructures.load();
+  rtxCompactedAccelerationStructures = other.rtxCompactedAccelerationStructures.load();
   rtxOpacityMicromaps = other.rtxOpacityMicromaps.load();
   rtxMaterialTextures = other.rtxMaterialTextures.load();
   rtxRenderTargets = other.rtxRenderTargets.load();
@@ -54,6 +55,9 @@ void DxvkMemoryStats::trackMemoryAssigned(Category category, VkDeviceSize size)
   case Category::RTXAccelerationStructure:
     rtxAccelerationStructures += size;
     break;
+  case Category::RTXCompactedAccelerationStructure:
+    rtxCompactedAccelerationStructures += size;
+    break;
   case Category::RTXOpacityMicromap:
     rtxOpacityMicromaps += size;
     break;
@@ -87,6 +91,9 @@ void DxvkMemoryStats::trackMemoryReleased(Category category, VkDeviceSize size)
   case Category::RTXAccelerationStructure:
     rtxAccelerationStructures -= size;
     break;
+  case Category::RTXCompactedAccelerationStructure:
+    rtxCompactedAccelerationStructures -= size;
+    break;
   case Category::RTXOpacityMicromap:
     rtxOpacityMicromaps -= size;
     break;
@@ -136,6 +143,8 @@ VkDeviceSize DxvkMemoryStats::usedByCategory(Category category) const
     return rtxBuffers;
   case Category::RTXAccelerationStructure:
     return rtxAccelerationStructures;
+  case Category::RTXCompactedAccelerationStructure:
+    return rtxCompactedAccelerationStructures;
   case Category::RTXOpacityMicromap:
     return rtxOpacityMicromaps;
   case Category::RTXMaterialTexture:
@@ -153,6 +162,7 @@ static const std::map<DxvkMemoryStats::Category, const char *> categoryStringMap
   { DxvkMemoryStats::Category::AppTexture, "AppTexture" },
   { DxvkMemoryStats::Category::RTXBuffer, "RTXBuffer" },
   { DxvkMemoryStats::Category::RTXAccelerationStructure, "RTXAccelerationStructure" },
+  { DxvkMemoryStats::Category::RTXCompactedAccelerationStructure, "RTXCompactedAccelerationStructure" },
   { DxvkMemoryStats::Category::RTXOpacityMicromap, "RTXOpacityMicromap" },
   { DxvkMemoryStats::Category::RTXMaterialTexture, "RTXMaterialTexture" },
   { DxvkMemoryStats::Category::RTXRenderTarget, "RTXRenderTarget" },
@@ -43,6 +43,7 @@ namespace dxvk {
 
       RTXBuffer,
       RTXAccelerationStructure,
+      RTXCompactedAccelerationStructure,
       RTXOpacityMicromap,
       RTXMaterialTexture,
       RTXRenderTarget,
@@ -83,6 +84,7 @@ namespace dxvk {
     std::atomic<VkDeviceSize> applicationTextures = 0;
     std::atomic<VkDeviceSize> rtxBuffers = 0;
     std::atomic<VkDeviceSize> rtxAccelerationStructures = 0;
+    std::atomic<VkDeviceSize> rtxCompactedAccelerationStructures = 0;
     std::atomic<VkDeviceSize> rtxOpacityMicromaps = 0;
     std::atomic<VkDeviceSize> rtxMaterialTextures = 0;
     std::atomic<VkDeviceSize> rtxRenderTargets = 0;
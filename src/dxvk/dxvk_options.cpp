@@ -29,6 +29,9 @@ namespace dxvk {
     enableOpenVR          = config.getOption<bool>    ("dxvk.enableOpenVR",           true);
     enableOpenXR          = config.getOption<bool>    ("dxvk.enableOpenXR",           true);
     numCompilerThreads    = config.getOption<int32_t> ("dxvk.numCompilerThreads",     0);
+    // NV-DXVK start: prioritized pipeline compilation
+    compilerPrewarmBudgetMs = config.getOption<float> ("dxvk.compilerPrewarmBudgetMs", 0.0f);
+    // NV-DXVK end
     useRawSsbo            = config.getOption<Tristate>("dxvk.useRawSsbo",             Tristate::Auto);
     shrinkNvidiaHvvHeap   = config.getOption<Tristate>("dxvk.shrinkNvidiaHvvHeap",    Tristate::Auto);
     hud                   = config.getOption<std::string>("dxvk.hud", "");
@@ -42,6 +45,13 @@ namespace dxvk {
     memcpyKickoffThreshold = config.getOption<uint32_t>("dxvk.memcpyKickoffThreshold", 16 * 1024 * 1024);
     // NV-DXVK end
 
+    // NV-DXVK start: Adaptive submission batching
+    submitPolicy          = config.getOption<std::string>("dxvk.submitPolicy", "immediate");
+    submitMaxBatchDelayUs = config.getOption<uint32_t>("dxvk.submitMaxBatchDelayUs", 2000);
+    submitMaxBatchSizeMiB = config.getOption<uint32_t>("dxvk.submitMaxBatchSizeMiB", 16);
+    submitTraceFile       = config.getOption<std::string>("dxvk.submitTraceFile", "");
+    // NV-DXVK end
+
     // NV-DXVK start: tell the user they cant run Remix
     float nvidiaMinDriverFloat = config.getOption<float>("dxvk.nvidiaMinDriver", 536.67f);
     float nvidiaGfnMinDriverFloat = config.getOption<float>("dxvk.nvidiaGfnMinDriver", 527.01f);
@@ -42,6 +42,12 @@ namespace dxvk {
     /// when using the state cache
     int32_t numCompilerThreads;
 
+    // NV-DXVK start: prioritized pipeline compilation
+    /// CPU time compiler threads may spend on state
+    /// cache prewarm per frame, in ms. 0 is unlimited
+    float compilerPrewarmBudgetMs;
+    // NV-DXVK end
+
     /// Shader-related options
     Tristate useRawSsbo;
 
@@ -63,6 +69,13 @@ namespace dxvk {
     uint32_t memcpyKickoffThreshold;
     // NV-DXVK end
 
+    // NV-DXVK start: Adaptive submission batching
+    std::string submitPolicy;
+    uint32_t submitMaxBatchDelayUs;
+    uint32_t submitMaxBatchSizeMiB;
+    std::string submitTraceFile;
+    // NV-DXVK end
+
     // NV-DXVK start: tell the user they cant run Remix
     uint32_t nvidiaMinDriver;
     uint32_t nvidiaLinuxMinDriver;
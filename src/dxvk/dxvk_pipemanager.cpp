@@ -138,6 +138,35 @@ namespace dxvk {
   }
 
 
+  // NV-DXVK start: prioritized pipeline compilation
+  bool DxvkPipelineManager::isCompilingShaders(
+          DxvkPipelinePriority  maxPriority) const {
+    return m_stateCache != nullptr
+        && m_stateCache->isCompilingShaders(maxPriority);
+  }
+
+
+  DxvkStateCacheProgress DxvkPipelineManager::getCompilerProgress() const {
+    return m_stateCache != nullptr
+      ? m_stateCache->getProgress()
+      : DxvkStateCacheProgress();
+  }
+
+
+  void DxvkPipelineManager::unregisterShader(
+    const Rc<DxvkShader>&         shader) {
+    if (m_stateCache != nullptr)
+      m_stateCache->unregisterShader(shader);
+  }
+
+
+  void DxvkPipelineManager::endFrame() const {
+    if (m_stateCache != nullptr)
+      m_stateCache->endFrame();
+  }
+  // NV-DXVK end
+
+
   void DxvkPipelineManager::stopWorkerThreads() const {
     if (m_stateCache != nullptr)
       m_stateCache->stopWorkerThreads();
@@ -21,6 +21,7 @@
 */
 #pragma once
 
+#include <array>
 #include <mutex>
 #include <unordered_map>
 
@@ -41,7 +42,45 @@ namespace dxvk {
     uint32_t numGraphicsPipelines;
     uint32_t numComputePipelines;
   };
-  
+
+  // NV-DXVK start: prioritized pipeline compilation
+  /**
+   * \brief Pipeline compilation priority
+   *
+   * Lower values are compiled first. Pipelines that
+   * the current frame asked for go ahead of the RTX
+   * pipelines, which in turn go ahead of whatever the
+   * state cache wants to prewarm.
+   */
+  enum class DxvkPipelinePriority : uint32_t {
+    Immediate   = 0,
+    Raytracing  = 1,
+    Prewarm     = 2,
+
+    Count
+  };
+
+
+  /**
+   * \brief Pipeline compiler progress
+   */
+  struct DxvkStateCacheProgress {
+    /// Pipelines queued or being compiled, per priority
+    std::array<uint32_t, uint32_t(DxvkPipelinePriority::Count)> pending = { };
+    /// Pipelines compiled since startup
+    uint32_t compiled  = 0;
+    /// Pipelines dropped before they got compiled
+    uint32_t cancelled = 0;
+
+    uint32_t totalPending() const {
+      uint32_t result = 0;
+      for (uint32_t n : pending)
+        result += n;
+      return result;
+    }
+  };
+  // NV-DXVK end
+
   
   /**
    * \brief Pipeline manager
@@ -136,6 +175,40 @@ namespace dxvk {
      */
     bool isCompilingShaders() const;
 
+    // NV-DXVK start: prioritized pipeline compilation
+    /**
+     * \brief Checks for pending work up to a given priority
+     *
+     * \param [in] maxPriority Lowest priority to consider
+     * \returns \c true if pipelines of \c maxPriority or
+     *    higher are still being compiled
+     */
+    bool isCompilingShaders(
+            DxvkPipelinePriority  maxPriority) const;
+
+    /**
+     * \brief Queries async compiler progress
+     * \returns Pending and completed pipeline counts
+     */
+    DxvkStateCacheProgress getCompilerProgress() const;
+
+    /**
+     * \brief Cancels pending pipelines for a shader
+     *
+     * Should be called when a shader is no longer
+     * going to be used, e.g. after it got replaced.
+     * Also cancels raytracing pipelines using it.
+     * \param [in] shader Shader to drop
+     */
+    void unregisterShader(
+      const Rc<DxvkShader>&         shader);
+
+    /**
+     * \brief Notifies the async compiler of a new frame
+     */
+    void endFrame() const;
+    // NV-DXVK end
+
     /**
      * \brief Stops async compiler threads
      */
@@ -287,6 +287,11 @@ namespace dxvk {
       entry.submit.cmdList->notifySignals();
       entry.submit.cmdList->reset();
 
+      // NV-DXVK start: Frame-based resource reclamation
+      if (entry.submit.frameId > m_finishedFrameId.load())
+        m_finishedFrameId.store(entry.submit.frameId);
+      // NV-DXVK end
+
       m_device->recycleCommandList(entry.submit.cmdList);
 
       lock = std::unique_lock<dxvk::mutex>(m_mutex);
@@ -36,6 +36,9 @@ namespace dxvk {
     Rc<DxvkCommandList> cmdList;
     VkSemaphore         waitSync;
     VkSemaphore         wakeSync;
+    // NV-DXVK start: Frame-based resource reclamation
+    uint32_t            frameId;
+    // NV-DXVK end
   };
   
   
@@ -131,6 +134,21 @@ namespace dxvk {
       return m_gpuIdle.load();
     }
 
+    // NV-DXVK start: Frame-based resource reclamation
+    /**
+     * \brief Retrieves the frame ID of the last finished submission
+     *
+     * Returns the frame ID that was current when the most recently
+     * finished command list was submitted. Since command lists finish
+     * in submission order, all command lists submitted during earlier
+     * frames have finished executing on the GPU as well.
+     * \returns Frame ID of the last finished command list
+     */
+    uint32_t finishedFrameId() const {
+      return m_finishedFrameId.load();
+    }
+    // NV-DXVK end
+
     /**
      * \brief Retrieves last submission error
      * 
@@ -235,6 +253,9 @@ namespace dxvk {
     std::atomic<bool>       m_stopped = { false };
     std::atomic<uint32_t>   m_pending = { 0u };
     std::atomic<uint64_t>   m_gpuIdle = { 0ull };
+    // NV-DXVK start: Frame-based resource reclamation
+    std::atomic<uint32_t>   m_finishedFrameId = { 0u };
+    // NV-DXVK end
 
     dxvk::mutex                 m_mutex;
     dxvk::mutex                 m_mutexQueue;
@@ -81,6 +81,20 @@ namespace dxvk {
       return m_hash;
     }
     // NV-DXVK end
+
+    // NV-DXVK start: Bindless descriptor caching
+    /**
+     * \brief Unique object identifier
+     *
+     * Can be used to identify an object even when
+     * the lifetime of the object is unknown, and
+     * without referencing the actual object.
+     * \returns Unique identifier
+     */
+    uint64_t cookie() const {
+      return m_cookie;
+    }
+    // NV-DXVK end
     
   private:
     
@@ -91,6 +105,12 @@ namespace dxvk {
     XXH64_hash_t m_hash;
     // NV-DXVK end
 
+    // NV-DXVK start: Bindless descriptor caching
+    uint64_t m_cookie = ++s_cookie;
+
+    static std::atomic<uint64_t> s_cookie;
+    // NV-DXVK end
+
     static VkBorderColor getBorderColor(
       const Rc<DxvkDevice>&         device,
       const DxvkSamplerCreateInfo&  info);
@@ -209,6 +209,24 @@ namespace dxvk {
       return m_interface;
     }
 
+    // NV-DXVK start: persistent D3D9 shader cache
+    /**
+     * \brief Resource slots
+     * \returns Resource slots used by the shader
+     */
+    const std::vector<DxvkResourceSlot>& resourceSlots() const {
+      return m_slots;
+    }
+
+    /**
+     * \brief Compressed SPIR-V code
+     * \returns Code as passed to the constructor
+     */
+    const SpirvCompressedBuffer& compressedCode() const {
+      return m_code;
+    }
+    // NV-DXVK end
+
     /**
      * \brief Shader options
      * \returns Shader options
@@ -1,6 +1,8 @@
 #include "dxvk_device.h"
 #include "dxvk_staging.h"
 
+#include "rtx_render/rtx_utils.h"
+
 namespace dxvk {
   
   // NV-DXVK start: Add alignment override functionality.
@@ -18,7 +20,9 @@ namespace dxvk {
     , m_access(access)
     , m_bufferRequiredAlignmentOverride(bufferRequiredAlignmentOverride)
   {
-
+    // NV-DXVK start: Staging ring allocator
+    m_tracked = (m_usage & VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR) == 0;
+    // NV-DXVK end
   }
   // NV-DXVK end
 
@@ -30,45 +34,117 @@ namespace dxvk {
   DxvkBufferSlice DxvkStagingDataAlloc::alloc(VkDeviceSize align, VkDeviceSize size) {
     ScopedCpuProfileZone();
 
+    // NV-DXVK start: Staging ring allocator
+    const uint32_t frameId = m_device->getCurrentFrameId();
+
+    if (frameId != m_frameId)
+      beginFrame(frameId);
+
+    m_stats.bytesThisFrame += size;
+    // NV-DXVK end
+
     if (size > MaxBufferSize)
       return DxvkBufferSlice(createBuffer(size));
     
-    if (m_buffer == nullptr)
-      m_buffer = createBuffer(MaxBufferSize);
-    
-    // Acceleration structure API accepts a VA, which DXVK doesnt recognize as "in use"
-    if (!m_buffer->isInUse() && (m_usage & VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR) == 0)
+    // NV-DXVK start: Staging ring allocator
+    if (m_ring.empty()) {
+      m_ring.push_back(RingBuffer { createBuffer(MaxBufferSize), frameId });
+      m_current = 0;
       m_offset = 0;
-    
-    m_offset = dxvk::align(m_offset, align);
+      m_stats.bufferCount = 1;
+    }
 
-    if (m_offset + size > MaxBufferSize) {
-      m_offset = 0;
+    m_offset = dxvk::align(m_offset, align);
 
-      if (m_buffers.size() < MaxBufferCount)
-        m_buffers.push(std::move(m_buffer));
+    if (m_offset + size > MaxBufferSize)
+      advance();
 
-      if (!m_buffers.front()->isInUse() && (m_usage & VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR) == 0) {
-        m_buffer = std::move(m_buffers.front());
-        m_buffers.pop();
-      } else {
-        m_buffer = createBuffer(MaxBufferSize);
-      }
-    }
+    RingBuffer& ring = m_ring[m_current];
+    ring.lastUseFrame = frameId;
 
-    DxvkBufferSlice slice(m_buffer, m_offset, size);
+    DxvkBufferSlice slice(ring.buffer, m_offset, size);
     m_offset = dxvk::align(m_offset + size, align);
     return slice;
+    // NV-DXVK end
   }
 
 
   void DxvkStagingDataAlloc::trim() {
-    m_buffer = nullptr;
+    // NV-DXVK start: Staging ring allocator
+    m_ring.clear();
+    m_current = 0;
+    m_offset = 0;
+    m_stats.bufferCount = 0;
+    // NV-DXVK end
+  }
+
+  // NV-DXVK start: Staging ring allocator
+  void DxvkStagingDataAlloc::beginFrame(uint32_t frameId) {
+    m_frameId = frameId;
+
+    m_stats.bytesLastFrame = m_stats.bytesThisFrame;
+    m_stats.bytesThisFrame = 0;
+
+    if (m_ring.empty())
+      return;
+
+    // Start over at the beginning of the current buffer
+    // if all previous allocations from it have retired
+    if (isIdle(m_ring[m_current]))
+      m_offset = 0;
+
+    // Release at most one buffer per frame which was added to the
+    // ring in order to absorb an allocation spike, once it has not
+    // been used for a while.
+    if (m_ring.size() > MaxBufferCount + 1) {
+      for (uint32_t i = 0; i < m_ring.size(); i++) {
+        const RingBuffer& ring = m_ring[i];
+
+        if (i == m_current || ring.lastUseFrame + kMaxFramesInFlight > frameId || !isIdle(ring))
+          continue;
+
+        m_ring.erase(m_ring.begin() + i);
+
+        if (m_current > i)
+          m_current -= 1;
+
+        m_stats.bufferCount = m_ring.size();
+        break;
+      }
+    }
+  }
+
+
+  void DxvkStagingDataAlloc::advance() {
+    // The next buffer in the ring is the least recently used one,
+    // so if that one is still in flight, none of the others are
+    // going to be available either. Grow the ring in that case.
+    const uint32_t next = (m_current + 1) % m_ring.size();
+
+    if (isIdle(m_ring[next])) {
+      m_current = next;
+    } else {
+      m_ring.insert(m_ring.begin() + m_current + 1, RingBuffer { createBuffer(MaxBufferSize), m_frameId });
+      m_current += 1;
+
+      m_stats.growCount += 1;
+      m_stats.bufferCount = m_ring.size();
+    }
+
     m_offset = 0;
+  }
+
 
-    while (!m_buffers.empty())
-      m_buffers.pop();
+  bool DxvkStagingDataAlloc::isIdle(const RingBuffer& ring) const {
+    // Acceleration structure API accepts a VA, which DXVK doesnt recognize as "in use".
+    // Rely on frame completion for those buffers instead, and allow for one frame of
+    // latency between allocating a slice and submitting the commands which use it.
+    if (!m_tracked)
+      return ring.lastUseFrame + 2 <= m_device->getFinishedFrameId();
+
+    return !ring.buffer->isInUse();
   }
+  // NV-DXVK end
 
   Rc<DxvkBuffer> DxvkStagingDataAlloc::createBuffer(VkDeviceSize size) {
     DxvkBufferCreateInfo info;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <queue>
+#include <vector>
 
 #include "dxvk_buffer.h"
 
@@ -8,12 +9,30 @@ namespace dxvk {
   
   class DxvkDevice;
 
+  // NV-DXVK start: Staging ring allocator
+  /**
+   * \brief Staging data allocator statistics
+   */
+  struct DxvkStagingDataStats {
+    VkDeviceSize bytesThisFrame = 0;  ///< Bytes allocated in the current frame
+    VkDeviceSize bytesLastFrame = 0;  ///< Bytes allocated in the previous frame
+    uint64_t     growCount      = 0;  ///< Number of times the ring grew because its next buffer was still in flight
+    uint32_t     bufferCount    = 0;  ///< Number of buffers currently in the ring
+  };
+  // NV-DXVK end
+
   /**
    * \brief Staging data allocator
    *
    * Allocates buffer slices for resource uploads,
    * while trying to keep the number of allocations
    * but also the amount of allocated memory low.
+   *
+   * Buffers are used as a ring. Allocations are
+   * sub-allocated linearly from the current buffer,
+   * and once it is full, the allocator moves on to
+   * the next buffer in the ring if the GPU is done
+   * with it, or inserts a new buffer otherwise.
    */
   class DxvkStagingDataAlloc {
     constexpr static VkDeviceSize MaxBufferSize  = 1 << 25; // 32 MiB
@@ -55,21 +74,50 @@ namespace dxvk {
      */
     void trim();
 
+    // NV-DXVK start: Staging ring allocator
+    /**
+     * \brief Queries allocator statistics
+     * \returns Allocation statistics
+     */
+    const DxvkStagingDataStats& getStats() const {
+      return m_stats;
+    }
+    // NV-DXVK end
+
   private:
 
+    // NV-DXVK start: Staging ring allocator
+    struct RingBuffer {
+      Rc<DxvkBuffer>  buffer;
+      uint32_t        lastUseFrame = 0;
+    };
+    // NV-DXVK end
+
     const VkMemoryPropertyFlagBits m_memoryFlags;
     const VkBufferUsageFlags m_usage;
     const VkPipelineStageFlags m_stages;
     const VkAccessFlags m_access;
 
     Rc<DxvkDevice>  m_device;
-    Rc<DxvkBuffer>  m_buffer;
     VkDeviceSize    m_offset = 0;
     // NV-DXVK start: Add alignment override functionality.
     VkDeviceSize    m_bufferRequiredAlignmentOverride = 1;
     // NV-DXVK end
 
-    std::queue<Rc<DxvkBuffer>> m_buffers;
+    // NV-DXVK start: Staging ring allocator
+    std::vector<RingBuffer> m_ring;
+    uint32_t                m_current = 0;
+    uint32_t                m_frameId = 0;
+    bool                    m_tracked = true;
+
+    DxvkStagingDataStats    m_stats;
+
+    void beginFrame(uint32_t frameId);
+
+    void advance();
+
+    bool isIdle(const RingBuffer& ring) const;
+    // NV-DXVK end
 
     Rc<DxvkBuffer> createBuffer(VkDeviceSize size);
   };
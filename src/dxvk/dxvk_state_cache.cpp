@@ -29,145 +29,27 @@ namespace dxvk {
   static const DxvkShaderKey  g_nullShaderKey = DxvkShaderKey();
 
 
-  /**
-   * \brief Packed entry header
-   */
-  struct DxvkStateCacheEntryHeader {
-    uint32_t stageMask : 8;
-    uint32_t entrySize : 24;
-  };
-
-  
-  /**
-   * \brief State cache entry data
-   *
-   * Stores data for a single cache entry and
-   * provides convenience methods to access it.
-   */
-  class DxvkStateCacheEntryData {
-    constexpr static size_t MaxSize = 1024;
-  public:
-
-    size_t size() const {
-      return m_size;
-    }
-
-    const char* data() const {
-      return m_data;
-    }
-
-    Sha1Hash computeHash() const {
-      return Sha1Hash::compute(m_data, m_size);
-    }
-
-    template<typename T>
-    bool read(T& data, uint32_t version) {
-      return read(data);
-    }
-
-    bool read(DxvkBindingMask& data, uint32_t version) {
-      if (version < 9) {
-        DxvkBindingMaskV8 v8;
-
-        if (!read(v8))
-          return false;
-
-        data = v8.convert();
-        return true;
-      }
-
-      return read(data);
-    }
-
-    bool read(DxvkIlBinding& data, uint32_t version) {
-      if (version < 10) {
-        DxvkIlBindingV9 v9;
-
-        if (!read(v9))
-          return false;
-
-        data = v9.convert();
-        return true;
-      }
-
-      return read(data);
-    }
-
-    template<typename T>
-    bool write(const T& data) {
-      if (m_size + sizeof(T) > MaxSize)
-        return false;
-      
-      std::memcpy(&m_data[m_size], &data, sizeof(T));
-      m_size += sizeof(T);
-      return true;
-    }
-
-    bool readFromStream(std::istream& stream, size_t size) {
-      if (size > MaxSize)
-        return false;
-
-      if (!stream.read(m_data, size))
-        return false;
-
-      m_size = size;
-      m_read = 0;
-      return true;
-    }
-
-  private:
-
-    size_t m_size = 0;
-    size_t m_read = 0;
-    char   m_data[MaxSize];
+  // NV-DXVK start: packed state cache format
+  template<typename Fn>
+  void DxvkStateCache::forEachEntry(
+    const DxvkStateCacheKey&        key,
+    const Fn&                       fn) const {
+    auto group = m_packGroupMap.find(key);
 
-    template<typename T>
-    bool read(T& data) {
-      if (m_read + sizeof(T) > m_size)
-        return false;
+    if (group != m_packGroupMap.end()) {
+      std::vector<DxvkStateCacheEntry> entries;
+      m_pack.readGroup(group->second, entries);
 
-      std::memcpy(&data, &m_data[m_read], sizeof(T));
-      m_read += sizeof(T);
-      return true;
+      for (const auto& entry : entries)
+        fn(entry);
     }
 
-  };
-
+    auto entries = m_entryMap.equal_range(key);
 
-  template<typename T>
-  bool readCacheEntryTyped(std::istream& stream, T& entry) {
-    auto data = reinterpret_cast<char*>(&entry);
-    auto size = sizeof(entry);
-
-    if (!stream.read(data, size))
-      return false;
-    
-    Sha1Hash expectedHash = std::exchange(entry.hash, g_nullHash);
-    Sha1Hash computedHash = Sha1Hash::compute(entry);
-    return expectedHash == computedHash;
-  }
-
-
-  bool DxvkStateCacheKey::eq(const DxvkStateCacheKey& key) const {
-    return this->vs.eq(key.vs)
-        && this->tcs.eq(key.tcs)
-        && this->tes.eq(key.tes)
-        && this->gs.eq(key.gs)
-        && this->fs.eq(key.fs)
-        && this->cs.eq(key.cs);
-  }
-
-
-  size_t DxvkStateCacheKey::hash() const {
-    DxvkHashState hash;
-    hash.add(this->vs.hash());
-    hash.add(this->tcs.hash());
-    hash.add(this->tes.hash());
-    hash.add(this->gs.hash());
-    hash.add(this->fs.hash());
-    hash.add(this->cs.hash());
-    return hash;
+    for (auto e = entries.first; e != entries.second; e++)
+      fn(m_entries[e->second]);
   }
+  // NV-DXVK end
 
 
   DxvkStateCache::DxvkStateCache(
@@ -200,10 +82,22 @@ namespace dxvk {
 
       file.write(data, size);
 
-      // Write all valid entries to the cache file in
-      // case we're recovering a corrupted cache file
-      for (auto& e : m_entries)
-        writeCacheEntry(file, e);
+      // NV-DXVK start: packed state cache format
+      // Write all valid entries to the cache file in case we're
+      // recovering a corrupted or converting an outdated file
+      DxvkStateCachePackWriter writer;
+
+      for (const auto& e : m_entries)
+        writer.addEntry(e);
+
+      if (writer.write(file)) {
+        const auto& stats = writer.stats();
+
+        Logger::info(str::format(
+          "DXVK: Packed ", stats.entryCount, " state cache entries (",
+          stats.stateBytes, " bytes) into ", stats.packBytes, " bytes"));
+      }
+      // NV-DXVK end
     }
 
     // Use half the available CPU cores for pipeline compilation
@@ -217,6 +111,14 @@ namespace dxvk {
       numWorkers = device->config().numCompilerThreads;
     
     Logger::info(str::format("DXVK: Using ", numWorkers, " compiler threads"));
+
+    // NV-DXVK start: prioritized pipeline compilation
+    m_prewarmBudgetUs = uint64_t(std::max(0.0f, device->config().compilerPrewarmBudgetMs) * 1000.0f);
+    m_budgetWindowStart = dxvk::high_resolution_clock::now();
+
+    if (m_prewarmBudgetUs)
+      Logger::info(str::format("DXVK: Limiting state cache prewarm to ", m_prewarmBudgetUs, " us of compile time per frame"));
+    // NV-DXVK end
     
     // Start the worker threads and the file writer
     m_workerBusy.store(numWorkers);
@@ -241,16 +143,22 @@ namespace dxvk {
     const DxvkRenderPassFormat&           format) {
     if (shaders.vs.eq(g_nullShaderKey))
       return;
+
+    // NV-DXVK start: prioritized pipeline compilation
+    // A draw just needed these shaders, so any other cached
+    // state vectors for them are likely needed this frame too.
+    prioritizePipelines(shaders);
+    // NV-DXVK end
     
     // Do not add an entry that is already in the cache
-    auto entries = m_entryMap.equal_range(shaders);
+    bool found = false;
 
-    for (auto e = entries.first; e != entries.second; e++) {
-      const DxvkStateCacheEntry& entry = m_entries[e->second];
+    forEachEntry(shaders, [&] (const DxvkStateCacheEntry& entry) {
+      found |= entry.format.eq(format) && entry.gpState == state;
+    });
 
-      if (entry.format.eq(format) && entry.gpState == state)
-        return;
-    }
+    if (found)
+      return;
 
     // Queue a job to write this pipeline to the cache
     std::unique_lock<dxvk::mutex> lock(m_writerLock);
@@ -268,13 +176,19 @@ namespace dxvk {
     if (shaders.cs.eq(g_nullShaderKey))
       return;
 
+    // NV-DXVK start: prioritized pipeline compilation
+    prioritizePipelines(shaders);
+    // NV-DXVK end
+
     // Do not add an entry that is already in the cache
-    auto entries = m_entryMap.equal_range(shaders);
+    bool found = false;
 
-    for (auto e = entries.first; e != entries.second; e++) {
-      if (m_entries[e->second].cpState == state)
-        return;
-    }
+    forEachEntry(shaders, [&] (const DxvkStateCacheEntry& entry) {
+      found |= entry.cpState == state;
+    });
+
+    if (found)
+      return;
 
     // Queue a job to write this pipeline to the cache
     std::unique_lock<dxvk::mutex> lock(m_writerLock);
@@ -320,12 +234,11 @@ namespace dxvk {
       
       if (!workerLock)
         workerLock = std::unique_lock<dxvk::mutex>(m_workerLock);
-      
-      // NV-DXVK start: do not compile same shader multiple times
-      if (m_workerItemsInFlight.count(item.hash()) == 0) {
-        m_workerQueue.push(item);
-        m_workerItemsInFlight.insert(item.hash());
-      }
+
+      // NV-DXVK start: prioritized pipeline compilation
+      item.key = p->second;
+      item.priority = DxvkPipelinePriority::Prewarm;
+      enqueueWorkerItem(std::move(item));
       // NV-DXVK end
     }
 
@@ -341,16 +254,182 @@ namespace dxvk {
 
     WorkerItem item;
     item.rt = shaders;
+    item.priority = DxvkPipelinePriority::Raytracing;
+
+    std::unique_lock<dxvk::mutex> workerLock(m_workerLock);
+    enqueueWorkerItem(std::move(item));
+    m_workerCond.notify_all();
+  }
+  // NV-DXVK end
+
+  // NV-DXVK start: prioritized pipeline compilation
+  void DxvkStateCache::unregisterShader(const Rc<DxvkShader>& shader) {
+    DxvkShaderKey key = getShaderKey(shader);
+
+    if (key.eq(g_nullShaderKey))
+      return;
+
+    // Only drop the lookup entry if it refers to this very shader,
+    // a replacement with identical code may already be registered
+    { std::unique_lock<dxvk::mutex> entryLock(m_entryLock);
+      auto entry = m_shaderMap.find(key);
+
+      if (entry != m_shaderMap.end() && entry->second == shader)
+        m_shaderMap.erase(entry);
+    }
 
     std::unique_lock<dxvk::mutex> workerLock(m_workerLock);
+    cancelWorkerItems([&shader] (const WorkerItem& item) {
+      return item.usesShader(shader);
+    });
+  }
+
+
+  void DxvkStateCache::prioritizePipelines(const DxvkStateCacheKey& shaders) {
+    std::unique_lock<dxvk::mutex> workerLock(m_workerLock);
+
+    auto entry = m_queuedItems.find(shaders);
+
+    if (entry == m_queuedItems.end())
+      return;
+
+    auto item = entry->second;
+    uint32_t p = uint32_t(item->priority);
 
+    if (item->priority == DxvkPipelinePriority::Immediate)
+      return;
+
+    m_progress.pending[p] -= 1;
+    m_progress.pending[uint32_t(DxvkPipelinePriority::Immediate)] += 1;
+
+    // Splicing keeps the indexed iterator valid
+    auto& immediate = m_workerQueues[uint32_t(DxvkPipelinePriority::Immediate)];
+    immediate.splice(immediate.end(), m_workerQueues[p], item);
+    item->priority = DxvkPipelinePriority::Immediate;
+
+    m_workerCond.notify_one();
+  }
+
+
+  void DxvkStateCache::endFrame() {
+    if (!m_prewarmBudgetUs)
+      return;
+
+    std::unique_lock<dxvk::mutex> workerLock(m_workerLock);
+    m_prewarmTimeUs = 0;
+    m_budgetWindowStart = dxvk::high_resolution_clock::now();
+    m_workerCond.notify_all();
+  }
+
+
+  bool DxvkStateCache::isCompilingShaders(DxvkPipelinePriority maxPriority) {
+    std::unique_lock<dxvk::mutex> workerLock(m_workerLock);
+
+    for (uint32_t p = 0; p <= uint32_t(maxPriority) && p < uint32_t(DxvkPipelinePriority::Count); p++) {
+      if (m_progress.pending[p])
+        return true;
+    }
+
+    return false;
+  }
+
+
+  DxvkStateCacheProgress DxvkStateCache::getProgress() {
+    std::unique_lock<dxvk::mutex> workerLock(m_workerLock);
+    return m_progress;
+  }
+
+
+  void DxvkStateCache::enqueueWorkerItem(WorkerItem&& item) {
     // Do not compile same shader multiple times
-    if (m_workerItemsInFlight.count(item.hash()) == 0) {
-      m_workerQueue.push(item);
-      m_workerItemsInFlight.insert(item.hash());
+    size_t hash = item.hash();
 
-      m_workerCond.notify_all();
+    if (m_workerItemsInFlight.count(hash) != 0)
+      return;
+
+    m_workerItemsInFlight.insert(hash);
+    m_progress.pending[uint32_t(item.priority)] += 1;
+
+    auto& queue = m_workerQueues[uint32_t(item.priority)];
+    queue.push_back(std::move(item));
+
+    if (queue.back().rt.groups.empty())
+      m_queuedItems.emplace(queue.back().key, std::prev(queue.end()));
+  }
+
+
+  void DxvkStateCache::unindexWorkerItem(WorkerItemList::iterator item) {
+    if (!item->rt.groups.empty())
+      return;
+
+    auto entry = m_queuedItems.find(item->key);
+
+    if (entry != m_queuedItems.end() && entry->second == item)
+      m_queuedItems.erase(entry);
+  }
+
+
+  bool DxvkStateCache::dequeueWorkerItem(WorkerItem& item) {
+    // Roll the budget window over if no frame has been presented in
+    // a while, so that loading screens do not stall prewarm entirely.
+    constexpr auto MaxBudgetWindow = std::chrono::milliseconds(100);
+
+    if (m_prewarmBudgetUs) {
+      auto now = dxvk::high_resolution_clock::now();
+
+      if (now - m_budgetWindowStart >= MaxBudgetWindow) {
+        m_prewarmTimeUs = 0;
+        m_budgetWindowStart = now;
+      }
+    }
+
+    for (uint32_t p = 0; p < uint32_t(DxvkPipelinePriority::Count); p++) {
+      auto& queue = m_workerQueues[p];
+
+      if (queue.empty())
+        continue;
+
+      if (p == uint32_t(DxvkPipelinePriority::Prewarm) && isPrewarmThrottled())
+        continue;
+
+      unindexWorkerItem(queue.begin());
+      item = std::move(queue.front());
+      queue.pop_front();
+      return true;
     }
+
+    return false;
+  }
+
+
+  bool DxvkStateCache::isPrewarmThrottled() const {
+    return m_prewarmBudgetUs != 0
+        && m_prewarmTimeUs >= m_prewarmBudgetUs;
+  }
+
+
+  template<typename Pred>
+  uint32_t DxvkStateCache::cancelWorkerItems(const Pred& pred) {
+    uint32_t numCancelled = 0;
+
+    for (uint32_t p = 0; p < uint32_t(DxvkPipelinePriority::Count); p++) {
+      auto& queue = m_workerQueues[p];
+
+      for (auto i = queue.begin(); i != queue.end(); ) {
+        if (pred(*i)) {
+          m_workerItemsInFlight.erase(i->hash());
+          m_progress.pending[p] -= 1;
+          numCancelled += 1;
+          unindexWorkerItem(i);
+          i = queue.erase(i);
+        } else {
+          i++;
+        }
+      }
+    }
+
+    m_progress.cancelled += numCancelled;
+    return numCancelled;
   }
   // NV-DXVK end
 
@@ -424,29 +503,25 @@ namespace dxvk {
     // NV-DXVK end
     if (item.cp.cs == nullptr) {
       auto pipeline = m_pipeManager->createGraphicsPipeline(item.gp);
-      auto entries = m_entryMap.equal_range(key);
-
-      for (auto e = entries.first; e != entries.second; e++) {
-        const auto& entry = m_entries[e->second];
 
+      forEachEntry(key, [&] (const DxvkStateCacheEntry& entry) {
         auto rp = m_passManager->getRenderPass(entry.format);
         pipeline->compilePipeline(entry.gpState, rp);
-      }
+      });
     } else {
       auto pipeline = m_pipeManager->createComputePipeline(item.cp);
-      auto entries = m_entryMap.equal_range(key);
 
-      for (auto e = entries.first; e != entries.second; e++) {
-        const auto& entry = m_entries[e->second];
+      forEachEntry(key, [&] (const DxvkStateCacheEntry& entry) {
         pipeline->compilePipeline(entry.cpState);
-      }
+      });
     }
   }
 
 
   bool DxvkStateCache::readCacheFile() {
     // Open state file and just fail if it doesn't exist
-    std::ifstream ifile(getCacheFileName().c_str(), std::ios_base::binary);
+    std::wstring fileName = getCacheFileName();
+    std::ifstream ifile(fileName.c_str(), std::ios_base::binary);
 
     if (!ifile) {
       Logger::warn("DXVK: No state cache file found");
@@ -458,30 +533,12 @@ namespace dxvk {
     DxvkStateCacheHeader newHeader;
     DxvkStateCacheHeader curHeader;
 
-    if (!readCacheHeader(ifile, curHeader)) {
+    if (!DxvkStateCacheIo::readCacheHeader(ifile, curHeader)) {
       Logger::warn("DXVK: Failed to read state cache header");
       return false;
     }
 
-    // Struct size hasn't changed between v2 and v4
-    size_t expectedSize = newHeader.entrySize;
-
-    if (curHeader.version <= 4)
-      expectedSize = sizeof(DxvkStateCacheEntryV4);
-    else if (curHeader.version <= 5)
-      expectedSize = sizeof(DxvkStateCacheEntryV5);
-    else if (curHeader.version <= 6)
-      expectedSize = sizeof(DxvkStateCacheEntryV6);
-    else if (curHeader.version <= 7)
-      expectedSize = sizeof(DxvkStateCacheEntry);
-
-    if (curHeader.entrySize != expectedSize) {
-      Logger::warn("DXVK: State cache entry size changed");
-      return false;
-    }
-
-    // Discard caches of unsupported versions
-    if (curHeader.version < 2 || curHeader.version > newHeader.version) {
+    if (!DxvkStateCacheIo::isHeaderSupported(curHeader)) {
       Logger::warn("DXVK: State cache version not supported");
       return false;
     }
@@ -490,6 +547,31 @@ namespace dxvk {
     if (curHeader.version != newHeader.version)
       Logger::warn(str::format("DXVK: Updating state cache version to v", newHeader.version));
 
+    // NV-DXVK start: packed state cache format
+    // Since v11, the header is followed by a packed section. We only
+    // index it here, entries get decoded when they are compiled.
+    if (curHeader.version >= 11) {
+      if (!m_pack.open(fileName, sizeof(DxvkStateCacheHeader))) {
+        Logger::warn("DXVK: Failed to read packed state cache");
+        return false;
+      }
+
+      for (uint32_t i = 0; i < m_pack.getGroupCount(); i++) {
+        DxvkStateCacheKey key = m_pack.getGroupKey(i);
+        m_packGroupMap.insert({ key, i });
+
+        mapShaderToPipeline(key.vs,  key);
+        mapShaderToPipeline(key.tcs, key);
+        mapShaderToPipeline(key.tes, key);
+        mapShaderToPipeline(key.gs,  key);
+        mapShaderToPipeline(key.fs,  key);
+        mapShaderToPipeline(key.cs,  key);
+      }
+
+      ifile.seekg(m_pack.getEndOffset());
+    }
+    // NV-DXVK end
+
     // Read actual cache entries from the file.
     // If we encounter invalid entries, we should
     // regenerate the entire state cache file.
@@ -498,485 +580,82 @@ namespace dxvk {
     while (ifile) {
       DxvkStateCacheEntry entry;
 
-      if (readCacheEntry(curHeader.version, ifile, entry)) {
-        size_t entryId = m_entries.size();
-        m_entries.push_back(entry);
-
-        mapPipelineToEntry(entry.shaders, entryId);
-
-        mapShaderToPipeline(entry.shaders.vs,  entry.shaders);
-        mapShaderToPipeline(entry.shaders.tcs, entry.shaders);
-        mapShaderToPipeline(entry.shaders.tes, entry.shaders);
-        mapShaderToPipeline(entry.shaders.gs,  entry.shaders);
-        mapShaderToPipeline(entry.shaders.fs,  entry.shaders);
-        mapShaderToPipeline(entry.shaders.cs,  entry.shaders);
-      } else if (ifile) {
+      if (DxvkStateCacheIo::readCacheEntry(curHeader.version, ifile, entry))
+        addCacheEntry(entry);
+      else if (ifile)
         numInvalidEntries += 1;
-      }
     }
 
     Logger::info(str::format(
-      "DXVK: Read ", m_entries.size(),
-      " valid state cache entries"));
+      "DXVK: Read ", m_pack.getEntryCount(), " packed and ",
+      m_entries.size(), " appended state cache entries"));
 
     if (numInvalidEntries) {
       Logger::warn(str::format(
         "DXVK: Skipped ", numInvalidEntries,
         " invalid state cache entries"));
-      return false;
-    }
-    
-    // Rewrite entire state cache if it is outdated
-    return curHeader.version == newHeader.version;
-  }
-
-
-  bool DxvkStateCache::readCacheHeader(
-          std::istream&             stream,
-          DxvkStateCacheHeader&     header) const {
-    DxvkStateCacheHeader expected;
-
-    auto data = reinterpret_cast<char*>(&header);
-    auto size = sizeof(header);
-
-    if (!stream.read(data, size))
-      return false;
-    
-    for (uint32_t i = 0; i < 4; i++) {
-      if (expected.magic[i] != header.magic[i])
-        return false;
-    }
-    
-    return true;
-  }
-
-
-  bool DxvkStateCache::readCacheEntryV7(
-          uint32_t                  version,
-          std::istream&             stream, 
-          DxvkStateCacheEntry&      entry) const {
-    if (version <= 6) {
-      DxvkStateCacheEntryV6 v6;
-
-      if (version <= 4) {
-        DxvkStateCacheEntryV4 v4;
-
-        if (!readCacheEntryTyped(stream, v4))
-          return false;
-
-        if (version == 2)
-          convertEntryV2(v4);
-
-        if (!convertEntryV4(v4, v6))
-          return false;
-      } else if (version <= 5) {
-        DxvkStateCacheEntryV5 v5;
-
-        if (!readCacheEntryTyped(stream, v5))
-          return false;
-
-        if (!convertEntryV5(v5, v6))
-          return false;
-      } else {
-        if (!readCacheEntryTyped(stream, v6))
-          return false;
-      }
-
-      return convertEntryV6(v6, entry);
-    } else {
-      return readCacheEntryTyped(stream, entry);
-    }
-  }
-
-
-  bool DxvkStateCache::readCacheEntry(
-          uint32_t                  version,
-          std::istream&             stream, 
-          DxvkStateCacheEntry&      entry) const {
-    if (version < 8)
-      return readCacheEntryV7(version, stream, entry);
-
-    // Read entry metadata and actual data
-    DxvkStateCacheEntryHeader header;
-    DxvkStateCacheEntryData data;
-    Sha1Hash hash;
-  
-    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header))
-     || !stream.read(reinterpret_cast<char*>(&hash), sizeof(hash))
-     || !data.readFromStream(stream, header.entrySize))
-      return false;
-
-    // Validate hash, skip entry if invalid
-    if (hash != data.computeHash())
-      return false;
-
-    // Read shader hashes
-    VkShaderStageFlags stageMask = VkShaderStageFlags(header.stageMask);
-    auto keys = &entry.shaders.vs;
-
-    for (uint32_t i = 0; i < 6; i++) {
-      if (stageMask & VkShaderStageFlagBits(1 << i))
-        data.read(keys[i], version);
-      else
-        keys[i] = g_nullShaderKey;
-    }
-
-    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
-      if (!data.read(entry.cpState.bsBindingMask, version))
-        return false;
-    } else {
-      // Read packed render pass format
-      uint8_t sampleCount = 0;
-      uint8_t imageFormat = 0;
-      uint8_t imageLayout = 0;
-
-      if (!data.read(sampleCount, version)
-       || !data.read(imageFormat, version)
-       || !data.read(imageLayout, version))
-        return false;
-
-      entry.format.sampleCount = VkSampleCountFlagBits(sampleCount);
-      entry.format.depth.format = VkFormat(imageFormat);
-      entry.format.depth.layout = unpackImageLayout(imageLayout);
-
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
-        if (!data.read(imageFormat, version)
-         || !data.read(imageLayout, version))
-          return false;
-
-        entry.format.color[i].format = VkFormat(imageFormat);
-        entry.format.color[i].layout = unpackImageLayout(imageLayout);
-      }
-
-      if (!validateRenderPassFormat(entry.format))
-        return false;
-
-      // Read common pipeline state
-      if (!data.read(entry.gpState.bsBindingMask, version)
-       || !data.read(entry.gpState.ia, version)
-       || !data.read(entry.gpState.il, version)
-       || !data.read(entry.gpState.rs, version)
-       || !data.read(entry.gpState.ms, version)
-       || !data.read(entry.gpState.ds, version)
-       || !data.read(entry.gpState.om, version)
-       || !data.read(entry.gpState.dsFront, version)
-       || !data.read(entry.gpState.dsBack, version))
-        return false;
-
-      if (entry.gpState.il.attributeCount() > MaxNumVertexAttributes
-       || entry.gpState.il.bindingCount() > MaxNumVertexBindings)
-        return false;
-
-      // Read render target swizzles
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
-        if (!data.read(entry.gpState.omSwizzle[i], version))
-          return false;
-      }
-
-      // Read render target blend info
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
-        if (!data.read(entry.gpState.omBlend[i], version))
-          return false;
-      }
-
-      // Read defined vertex attributes
-      for (uint32_t i = 0; i < entry.gpState.il.attributeCount(); i++) {
-        if (!data.read(entry.gpState.ilAttributes[i], version))
-          return false;
-      }
-
-      // Read defined vertex bindings
-      for (uint32_t i = 0; i < entry.gpState.il.bindingCount(); i++) {
-        if (!data.read(entry.gpState.ilBindings[i], version))
-          return false;
-      }
-    }
-
-    // Read non-zero spec constants
-    auto& sc = (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
-      ? entry.cpState.sc
-      : entry.gpState.sc;
-
-    uint32_t specConstantMask = 0;
-
-    if (!data.read(specConstantMask, version))
-      return false;
-
-    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
-      if (specConstantMask & (1 << i)) {
-        if (!data.read(sc.specConstants[i], version))
-          return false;
-      }
     }
 
-    return true;
-  }
-
+    // NV-DXVK start: packed state cache format
+    // Fold appended entries back into the pack once there are
+    // enough of them to noticeably slow down reading the file
+    constexpr size_t MinRepackEntries = 256;
 
-  void DxvkStateCache::writeCacheEntry(
-          std::ostream&             stream, 
-          DxvkStateCacheEntry&      entry) const {
-    DxvkStateCacheEntryData data;
-    VkShaderStageFlags stageMask = 0;
+    bool rewrite = numInvalidEntries
+      || curHeader.version != newHeader.version
+      || m_entries.size() >= std::max<size_t>(MinRepackEntries, m_pack.getEntryCount() / 8);
 
-    // Write shader hashes
-    auto keys = &entry.shaders.vs;
-
-    for (uint32_t i = 0; i < 6; i++) {
-      if (!keys[i].eq(g_nullShaderKey)) {
-        stageMask |= VkShaderStageFlagBits(1 << i);
-        data.write(keys[i]);
-      }
-    }
-
-    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
-      // Nothing else here to write out
-      data.write(entry.cpState.bsBindingMask);
-    } else {
-      // Pack render pass format
-      data.write(uint8_t(entry.format.sampleCount));
-      data.write(uint8_t(entry.format.depth.format));
-      data.write(packImageLayout(entry.format.depth.layout));
-
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
-        data.write(uint8_t(entry.format.color[i].format));
-        data.write(packImageLayout(entry.format.color[i].layout));
-      }
-
-      // Write out common pipeline state
-      data.write(entry.gpState.bsBindingMask);
-      data.write(entry.gpState.ia);
-      data.write(entry.gpState.il);
-      data.write(entry.gpState.rs);
-      data.write(entry.gpState.ms);
-      data.write(entry.gpState.ds);
-      data.write(entry.gpState.om);
-      data.write(entry.gpState.dsFront);
-      data.write(entry.gpState.dsBack);
-
-      // Write out render target swizzles and blend info
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++)
-        data.write(entry.gpState.omSwizzle[i]);
-
-      for (uint32_t i = 0; i < MaxNumRenderTargets; i++)
-        data.write(entry.gpState.omBlend[i]);
-
-      // Write out input layout for defined attributes
-      for (uint32_t i = 0; i < entry.gpState.il.attributeCount(); i++)
-        data.write(entry.gpState.ilAttributes[i]);
-
-      for (uint32_t i = 0; i < entry.gpState.il.bindingCount(); i++)
-        data.write(entry.gpState.ilBindings[i]);
-    }
-
-    // Write out all non-zero spec constants
-    auto& sc = (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
-      ? entry.cpState.sc
-      : entry.gpState.sc;
-
-    uint32_t specConstantMask = 0;
-
-    for (uint32_t i = 0; i < MaxNumSpecConstants; i++)
-      specConstantMask |= sc.specConstants[i] ? (1 << i) : 0;
-
-    data.write(specConstantMask);
-
-    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
-      if (specConstantMask & (1 << i))
-        data.write(sc.specConstants[i]);
-    }
-
-    // General layout: header -> hash -> data
-    DxvkStateCacheEntryHeader header;
-    header.stageMask = uint8_t(stageMask);
-    header.entrySize = data.size();
-
-    Sha1Hash hash = data.computeHash();
-
-    stream.write(reinterpret_cast<char*>(&header), sizeof(header));
-    stream.write(reinterpret_cast<char*>(&hash), sizeof(hash));
-    stream.write(data.data(), data.size());
-    stream.flush();
-  }
+    if (rewrite && m_pack.isOpen())
+      unpackCacheFile();
 
-
-  bool DxvkStateCache::convertEntryV2(
-          DxvkStateCacheEntryV4&    entry) const {
-    // Semantics changed:
-    // v2: rsDepthClampEnable
-    // v3: rsDepthClipEnable
-    entry.gpState.rsDepthClipEnable = !entry.gpState.rsDepthClipEnable;
-
-    // Frontend changed: Depth bias
-    // will typically be disabled
-    entry.gpState.rsDepthBiasEnable = VK_FALSE;
-    return true;
+    return !rewrite;
+    // NV-DXVK end
   }
 
 
-  bool DxvkStateCache::convertEntryV4(
-    const DxvkStateCacheEntryV4&    in,
-          DxvkStateCacheEntryV6&    out) const {
-    out.shaders = in.shaders;
-    out.format  = in.format;
-    out.hash    = in.hash;
-
-    out.cpState.bsBindingMask           = in.cpState.bsBindingMask;
-    out.gpState.bsBindingMask           = in.gpState.bsBindingMask;
-    
-    out.gpState.iaPrimitiveTopology     = in.gpState.iaPrimitiveTopology;
-    out.gpState.iaPrimitiveRestart      = in.gpState.iaPrimitiveRestart;
-    out.gpState.iaPatchVertexCount      = in.gpState.iaPatchVertexCount;
-    
-    out.gpState.ilAttributeCount        = in.gpState.ilAttributeCount;
-    out.gpState.ilBindingCount          = in.gpState.ilBindingCount;
-
-    for (uint32_t i = 0; i < in.gpState.ilAttributeCount; i++)
-      out.gpState.ilAttributes[i]       = in.gpState.ilAttributes[i];
-
-    for (uint32_t i = 0; i < in.gpState.ilBindingCount; i++) {
-      out.gpState.ilBindings[i]         = in.gpState.ilBindings[i];
-      out.gpState.ilDivisors[i]         = in.gpState.ilDivisors[i];
-    }
-    
-    out.gpState.rsDepthClipEnable       = in.gpState.rsDepthClipEnable;
-    out.gpState.rsDepthBiasEnable       = in.gpState.rsDepthBiasEnable;
-    out.gpState.rsPolygonMode           = in.gpState.rsPolygonMode;
-    out.gpState.rsCullMode              = in.gpState.rsCullMode;
-    out.gpState.rsFrontFace             = in.gpState.rsFrontFace;
-    out.gpState.rsViewportCount         = in.gpState.rsViewportCount;
-    out.gpState.rsSampleCount           = in.gpState.rsSampleCount;
-    
-    out.gpState.msSampleCount           = in.gpState.msSampleCount;
-    out.gpState.msSampleMask            = in.gpState.msSampleMask;
-    out.gpState.msEnableAlphaToCoverage = in.gpState.msEnableAlphaToCoverage;
-    
-    out.gpState.dsEnableDepthTest       = in.gpState.dsEnableDepthTest;
-    out.gpState.dsEnableDepthWrite      = in.gpState.dsEnableDepthWrite;
-    out.gpState.dsEnableStencilTest     = in.gpState.dsEnableStencilTest;
-    out.gpState.dsDepthCompareOp        = in.gpState.dsDepthCompareOp;
-    out.gpState.dsStencilOpFront        = in.gpState.dsStencilOpFront;
-    out.gpState.dsStencilOpBack         = in.gpState.dsStencilOpBack;
-    
-    out.gpState.omEnableLogicOp         = in.gpState.omEnableLogicOp;
-    out.gpState.omLogicOp               = in.gpState.omLogicOp;
+  // NV-DXVK start: packed state cache format
+  void DxvkStateCache::addCacheEntry(
+    const DxvkStateCacheEntry&      entry) {
+    size_t entryId = m_entries.size();
+    m_entries.push_back(entry);
 
-    for (uint32_t i = 0; i < 8; i++) {
-      out.gpState.omBlendAttachments[i] = in.gpState.omBlendAttachments[i];
-      out.gpState.omComponentMapping[i] = in.gpState.omComponentMapping[i];
-    }
+    mapPipelineToEntry(entry.shaders, entryId);
 
-    return true;
+    mapShaderToPipeline(entry.shaders.vs,  entry.shaders);
+    mapShaderToPipeline(entry.shaders.tcs, entry.shaders);
+    mapShaderToPipeline(entry.shaders.tes, entry.shaders);
+    mapShaderToPipeline(entry.shaders.gs,  entry.shaders);
+    mapShaderToPipeline(entry.shaders.fs,  entry.shaders);
+    mapShaderToPipeline(entry.shaders.cs,  entry.shaders);
   }
 
 
-  bool DxvkStateCache::convertEntryV5(
-    const DxvkStateCacheEntryV5&    in,
-          DxvkStateCacheEntryV6&    out) const {
-    out.shaders = in.shaders;
-    out.gpState = in.gpState;
-    out.format  = in.format;
-    out.hash    = in.hash;
-
-    out.cpState.bsBindingMask = in.cpState.bsBindingMask;
-    return true;
-  }
-
+  void DxvkStateCache::unpackCacheFile() {
+    // Decode all packed entries so that the file can be rewritten.
+    // Shaders are already mapped to their pipelines at this point.
+    std::vector<DxvkStateCacheEntry> entries;
 
-  bool DxvkStateCache::convertEntryV6(
-    const DxvkStateCacheEntryV6&    in,
-          DxvkStateCacheEntry&      out) const {
-    out.shaders = in.shaders;
-    out.format  = in.format;
-    out.hash    = in.hash;
+    for (uint32_t i = 0; i < m_pack.getGroupCount(); i++) {
+      entries.clear();
 
-    if (in.shaders.cs.eq(g_nullShaderKey)) {
-      // Binding mask
-      out.gpState.bsBindingMask = in.gpState.bsBindingMask.convert();
+      uint32_t numInvalid = m_pack.readGroup(i, entries);
 
-      // Graphics state
-      out.gpState.ia = DxvkIaInfo(
-        in.gpState.iaPrimitiveTopology,
-        in.gpState.iaPrimitiveRestart,
-        in.gpState.iaPatchVertexCount);
-      
-      out.gpState.il = DxvkIlInfo(
-        in.gpState.ilAttributeCount,
-        in.gpState.ilBindingCount);
-      
-      for (uint32_t i = 0; i < in.gpState.ilAttributeCount; i++) {
-        out.gpState.ilAttributes[i] = DxvkIlAttribute(
-          in.gpState.ilAttributes[i].location,
-          in.gpState.ilAttributes[i].binding,
-          in.gpState.ilAttributes[i].format,
-          in.gpState.ilAttributes[i].offset);
+      if (numInvalid) {
+        Logger::warn(str::format(
+          "DXVK: Skipped ", numInvalid,
+          " invalid packed state cache entries"));
       }
-      
-      for (uint32_t i = 0; i < in.gpState.ilBindingCount; i++) {
-        out.gpState.ilBindings[i] = DxvkIlBinding(
-          in.gpState.ilBindings[i].binding,
-          in.gpState.ilBindings[i].stride,
-          in.gpState.ilBindings[i].inputRate,
-          in.gpState.ilDivisors[i]);
-      }
-      
-      out.gpState.rs = DxvkRsInfo(
-        in.gpState.rsDepthClipEnable,
-        in.gpState.rsDepthBiasEnable,
-        in.gpState.rsPolygonMode,
-        in.gpState.rsCullMode,
-        in.gpState.rsFrontFace,
-        in.gpState.rsViewportCount,
-        in.gpState.rsSampleCount,
-        VK_CONSERVATIVE_RASTERIZATION_MODE_DISABLED_EXT);
-
-      out.gpState.ms = DxvkMsInfo(
-        in.gpState.msSampleCount,
-        in.gpState.msSampleMask,
-        in.gpState.msEnableAlphaToCoverage);
-      
-      out.gpState.ds = DxvkDsInfo(
-        in.gpState.dsEnableDepthTest,
-        in.gpState.dsEnableDepthWrite,
-        in.gpState.dsEnableDepthBoundsTest,
-        in.gpState.dsEnableStencilTest,
-        in.gpState.dsDepthCompareOp);
-      
-      out.gpState.dsFront = DxvkDsStencilOp(in.gpState.dsStencilOpFront);
-      out.gpState.dsBack  = DxvkDsStencilOp(in.gpState.dsStencilOpBack);
 
-      out.gpState.om = DxvkOmInfo(
-        in.gpState.omEnableLogicOp,
-        in.gpState.omLogicOp);
-      
-      for (uint32_t i = 0; i < 8 && i < MaxNumRenderTargets; i++) {
-        out.gpState.omBlend[i] = DxvkOmAttachmentBlend(
-          in.gpState.omBlendAttachments[i].blendEnable,
-          in.gpState.omBlendAttachments[i].srcColorBlendFactor,
-          in.gpState.omBlendAttachments[i].dstColorBlendFactor,
-          in.gpState.omBlendAttachments[i].colorBlendOp,
-          in.gpState.omBlendAttachments[i].srcAlphaBlendFactor,
-          in.gpState.omBlendAttachments[i].dstAlphaBlendFactor,
-          in.gpState.omBlendAttachments[i].alphaBlendOp,
-          in.gpState.omBlendAttachments[i].colorWriteMask);
-        
-        out.gpState.omSwizzle[i] = DxvkOmAttachmentSwizzle(
-          in.gpState.omComponentMapping[i]);
+      for (const auto& entry : entries) {
+        mapPipelineToEntry(entry.shaders, m_entries.size());
+        m_entries.push_back(entry);
       }
-
-      // Specialization constants
-      for (uint32_t i = 0; i < 8 && i < MaxNumSpecConstants; i++)
-        out.cpState.sc.specConstants[i] = in.cpState.scSpecConstants[i];
-    } else {
-      // Binding mask
-      out.cpState.bsBindingMask = in.cpState.bsBindingMask.convert();
-
-      for (uint32_t i = 0; i < 8 && i < MaxNumSpecConstants; i++)
-        out.gpState.sc.specConstants[i] = in.gpState.scSpecConstants[i];
     }
 
-    return true;
+    m_packGroupMap.clear();
+    m_pack.close();
   }
+  // NV-DXVK end
 
 
   void DxvkStateCache::workerFunc() {
@@ -985,32 +664,47 @@ namespace dxvk {
     while (!m_stopThreads.load()) {
       WorkerItem item;
 
+      // NV-DXVK start: prioritized pipeline compilation
       { std::unique_lock<dxvk::mutex> lock(m_workerLock);
 
-        if (m_workerQueue.empty()) {
+        if (!dequeueWorkerItem(item)) {
           m_workerBusy -= 1;
-          m_workerCond.wait(lock, [this] () {
-            return m_workerQueue.size()
-                || m_stopThreads.load();
-          });
 
-          if (!m_workerQueue.empty())
-            m_workerBusy += 1;
-        }
+          bool haveItem = false;
 
-        if (m_workerQueue.empty())
-          break;
-        
-        item = m_workerQueue.front();
-        m_workerQueue.pop();
+          while (!m_stopThreads.load() && !(haveItem = dequeueWorkerItem(item))) {
+            // Throttled prewarm work becomes available again once the
+            // budget window rolls over, even if nobody notifies us
+            if (isPrewarmThrottled() && !m_workerQueues[uint32_t(DxvkPipelinePriority::Prewarm)].empty())
+              m_workerCond.wait_for(lock, std::chrono::milliseconds(10));
+            else
+              m_workerCond.wait(lock);
+          }
+
+          if (!haveItem)
+            break;
+
+          m_workerBusy += 1;
+        }
       }
 
+      auto t0 = dxvk::high_resolution_clock::now();
+
       compilePipelines(item);
 
-      // NV-DXVK start: do not compile same shader multiple times
+      auto t1 = dxvk::high_resolution_clock::now();
+      auto us = std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0);
+
       { std::unique_lock<dxvk::mutex> lock(m_workerLock);
+        // Do not compile same shader multiple times
         assert(m_workerItemsInFlight.count(item.hash()) == 1);
         m_workerItemsInFlight.erase(item.hash());
+
+        m_progress.pending[uint32_t(item.priority)] -= 1;
+        m_progress.compiled += 1;
+
+        if (item.priority == DxvkPipelinePriority::Prewarm)
+          m_prewarmTimeUs += uint64_t(us.count());
       }
       // NV-DXVK end
     }
@@ -1045,7 +739,7 @@ namespace dxvk {
           std::ios_base::app);
       }
 
-      writeCacheEntry(file, entry);
+      DxvkStateCacheIo::writeCacheEntry(file, entry);
     }
   }
 
@@ -1066,47 +760,4 @@ namespace dxvk {
     return env::getEnvVar("DXVK_STATE_CACHE_PATH");
   }
 
-
-  uint8_t DxvkStateCache::packImageLayout(
-          VkImageLayout             layout) {
-    switch (layout) {
-      case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL: return 0x80;
-      case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL: return 0x81;
-      default: return uint8_t(layout);
-    }
-  }
-
-
-  VkImageLayout DxvkStateCache::unpackImageLayout(
-          uint8_t                   layout) {
-    switch (layout) {
-      case 0x80: return VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL;
-      case 0x81: return VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL;
-      default: return VkImageLayout(layout);
-    }
-  }
-
-
-  bool DxvkStateCache::validateRenderPassFormat(
-    const DxvkRenderPassFormat&     format) {
-    bool valid = true;
-
-    if (format.depth.format) {
-      valid &= format.depth.layout == VK_IMAGE_LAYOUT_GENERAL
-            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
-            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL
-            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL;
-    }
-
-    for (uint32_t i = 0; i < MaxNumRenderTargets && valid; i++) {
-      if (format.color[i].format) {
-        valid &= format.color[i].layout == VK_IMAGE_LAYOUT_GENERAL
-              || format.color[i].layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-      }
-    }
-
-    return valid;
-  }
-
 }
@@ -23,13 +23,16 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <list>
 #include <fstream>
 #include <mutex>
 #include <queue>
 #include <unordered_map>
 #include <vector>
 
+#include "dxvk_state_cache_io.h"
 #include "dxvk_state_cache_types.h"
+#include "../util/util_time.h"
 // NV-DXVK start: compile rt shaders on shader compilation threads
 #include "dxvk_raytracing.h"
 // NV-DXVK end
@@ -107,6 +110,38 @@ namespace dxvk {
     void registerRaytracingShaders(
       const DxvkRaytracingPipelineShaders& shaders);
     // NV-DXVK end
+
+    // NV-DXVK start: prioritized pipeline compilation
+    /**
+     * \brief Cancels pending work for a shader
+     *
+     * Removes the shader from the compiler's lookup
+     * table and drops all queued pipelines using it,
+     * including raytracing pipelines. Pipelines that
+     * are already being compiled are not affected.
+     * \param [in] shader Shader that is no longer used
+     */
+    void unregisterShader(
+      const Rc<DxvkShader>&                 shader);
+
+    /**
+     * \brief Moves pipelines for a shader set to the front
+     *
+     * Any queued state vectors for the given shaders
+     * will be compiled before other pending work.
+     * \param [in] shaders Shader keys
+     */
+    void prioritizePipelines(
+      const DxvkStateCacheKey&              shaders);
+
+    /**
+     * \brief Notifies the compiler of a new frame
+     *
+     * Resets the per-frame CPU time budget for prewarm
+     * compilation. Called once per present.
+     */
+    void endFrame();
+    // NV-DXVK end
     
     /**
      * \brief Explicitly stops worker threads
@@ -121,6 +156,24 @@ namespace dxvk {
       return m_workerBusy.load() > 0;
     }
 
+    // NV-DXVK start: prioritized pipeline compilation
+    /**
+     * \brief Checks for pending work up to a given priority
+     *
+     * \param [in] maxPriority Lowest priority to consider
+     * \returns \c true if any pipeline of \c maxPriority or
+     *    higher is still queued or being compiled
+     */
+    bool isCompilingShaders(
+            DxvkPipelinePriority            maxPriority);
+
+    /**
+     * \brief Queries compiler progress
+     * \returns Pending and completed pipeline counts
+     */
+    DxvkStateCacheProgress getProgress();
+    // NV-DXVK end
+
   private:
 
     using WriterItem = DxvkStateCacheEntry;
@@ -133,6 +186,26 @@ namespace dxvk {
       DxvkRaytracingPipelineShaders rt;
       // NV-DXVK end
 
+      // NV-DXVK start: prioritized pipeline compilation
+      DxvkStateCacheKey           key;
+      DxvkPipelinePriority        priority = DxvkPipelinePriority::Prewarm;
+
+      bool usesShader(const Rc<DxvkShader>& shader) const {
+        if (!rt.groups.empty()) {
+          for (const auto& group : rt.groups) {
+            if (group.generalShader == shader || group.closestHitShader == shader
+             || group.anyHitShader == shader  || group.intersectionShader == shader)
+              return true;
+          }
+
+          return false;
+        }
+
+        return gp.vs == shader || gp.tcs == shader || gp.tes == shader
+            || gp.gs == shader || gp.fs == shader  || cp.cs == shader;
+      }
+      // NV-DXVK end
+
       // NV-DXVK start: do not compile same shader multiple times
       size_t hash() const {
         // raytracing shader group hash is NOT guaranteed to be zero
@@ -157,6 +230,14 @@ namespace dxvk {
       DxvkStateCacheKey, size_t,
       DxvkHash, DxvkEq> m_entryMap;
 
+    // NV-DXVK start: packed state cache format
+    DxvkStateCachePackReader          m_pack;
+
+    std::unordered_map<
+      DxvkStateCacheKey, uint32_t,
+      DxvkHash, DxvkEq> m_packGroupMap;
+    // NV-DXVK end
+
     std::unordered_multimap<
       DxvkShaderKey, DxvkStateCacheKey,
       DxvkHash, DxvkEq> m_pipelineMap;
@@ -167,7 +248,24 @@ namespace dxvk {
 
     dxvk::mutex                       m_workerLock;
     dxvk::condition_variable          m_workerCond;
-    std::queue<WorkerItem>            m_workerQueue;
+    // NV-DXVK start: prioritized pipeline compilation
+    using WorkerItemList = std::list<WorkerItem>;
+
+    std::array<WorkerItemList,
+      uint32_t(DxvkPipelinePriority::Count)> m_workerQueues;
+
+    // Queued graphics and compute items by shader key, so
+    // that draws can promote them without scanning queues
+    std::unordered_map<
+      DxvkStateCacheKey, WorkerItemList::iterator,
+      DxvkHash, DxvkEq> m_queuedItems;
+    DxvkStateCacheProgress            m_progress;
+
+    // CPU time workers may spend on prewarm items per frame, 0 means unlimited
+    uint64_t                          m_prewarmBudgetUs = 0;
+    uint64_t                          m_prewarmTimeUs = 0;
+    dxvk::high_resolution_clock::time_point m_budgetWindowStart;
+    // NV-DXVK end
     // NV-DXVK start: do not compile same shader multiple times
     std::unordered_set<size_t>        m_workerItemsInFlight;  // stores hashes for work items in the queue
     // NV-DXVK end
@@ -197,41 +295,37 @@ namespace dxvk {
     void compilePipelines(
       const WorkerItem&               item);
 
+    // NV-DXVK start: prioritized pipeline compilation
+    void enqueueWorkerItem(
+            WorkerItem&&              item);
+
+    bool dequeueWorkerItem(
+            WorkerItem&               item);
+
+    void unindexWorkerItem(
+            WorkerItemList::iterator  item);
+
+    bool isPrewarmThrottled() const;
+
+    template<typename Pred>
+    uint32_t cancelWorkerItems(
+      const Pred&                     pred);
+    // NV-DXVK end
+
     bool readCacheFile();
 
-    bool readCacheHeader(
-            std::istream&             stream,
-            DxvkStateCacheHeader&     header) const;
+    // NV-DXVK start: packed state cache format
+    void addCacheEntry(
+      const DxvkStateCacheEntry&      entry);
+
+    void unpackCacheFile();
+
+    template<typename Fn>
+    void forEachEntry(
+      const DxvkStateCacheKey&        key,
+      const Fn&                       fn) const;
+    // NV-DXVK end
 
-    bool readCacheEntryV7(
-            uint32_t                  version,
-            std::istream&             stream, 
-            DxvkStateCacheEntry&      entry) const;
-    
-    bool readCacheEntry(
-            uint32_t                  version,
-            std::istream&             stream, 
-            DxvkStateCacheEntry&      entry) const;
-    
-    void writeCacheEntry(
-            std::ostream&             stream, 
-            DxvkStateCacheEntry&      entry) const;
-    
-    bool convertEntryV2(
-            DxvkStateCacheEntryV4&    entry) const;
-    
-    bool convertEntryV4(
-      const DxvkStateCacheEntryV4&    in,
-            DxvkStateCacheEntryV6&    out) const;
-    
-    bool convertEntryV5(
-      const DxvkStateCacheEntryV5&    in,
-            DxvkStateCacheEntryV6&    out) const;
-    
-    bool convertEntryV6(
-      const DxvkStateCacheEntryV6&    in,
-            DxvkStateCacheEntry&      out) const;
-    
     void workerFunc();
 
     void writerFunc();
@@ -240,15 +334,6 @@ namespace dxvk {
     
     std::string getCacheDir() const;
 
-    static uint8_t packImageLayout(
-            VkImageLayout             layout);
-
-    static VkImageLayout unpackImageLayout(
-            uint8_t                   layout);
-
-    static bool validateRenderPassFormat(
-      const DxvkRenderPassFormat&     format);
-
   };
 
 }
@@ -0,0 +1,1127 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <cstring>
+
+#include "dxvk_state_cache_io.h"
+
+#include "../util/xxHash/xxhash.h"
+
+namespace dxvk {
+
+  static const Sha1Hash       g_nullHash      = Sha1Hash::compute(nullptr, 0);
+  static const DxvkShaderKey  g_nullShaderKey = DxvkShaderKey();
+
+
+  /**
+   * \brief Packed entry header
+   */
+  struct DxvkStateCacheEntryHeader {
+    uint32_t stageMask : 8;
+    uint32_t entrySize : 24;
+  };
+
+  
+  /**
+   * \brief State cache entry data
+   *
+   * Stores data for a single cache entry and
+   * provides convenience methods to access it.
+   */
+  class DxvkStateCacheEntryData {
+    constexpr static size_t MaxSize = 1024;
+  public:
+
+    size_t size() const {
+      return m_size;
+    }
+
+    const char* data() const {
+      return m_data;
+    }
+
+    Sha1Hash computeHash() const {
+      return Sha1Hash::compute(m_data, m_size);
+    }
+
+    template<typename T>
+    bool read(T& data, uint32_t version) {
+      return read(data);
+    }
+
+    bool read(DxvkBindingMask& data, uint32_t version) {
+      if (version < 9) {
+        DxvkBindingMaskV8 v8;
+
+        if (!read(v8))
+          return false;
+
+        data = v8.convert();
+        return true;
+      }
+
+      return read(data);
+    }
+
+    bool read(DxvkIlBinding& data, uint32_t version) {
+      if (version < 10) {
+        DxvkIlBindingV9 v9;
+
+        if (!read(v9))
+          return false;
+
+        data = v9.convert();
+        return true;
+      }
+
+      return read(data);
+    }
+
+    template<typename T>
+    bool write(const T& data) {
+      if (m_size + sizeof(T) > MaxSize)
+        return false;
+      
+      std::memcpy(&m_data[m_size], &data, sizeof(T));
+      m_size += sizeof(T);
+      return true;
+    }
+
+    bool readFromMemory(const void* data, size_t size) {
+      if (size > MaxSize)
+        return false;
+
+      std::memcpy(m_data, data, size);
+      m_size = size;
+      m_read = 0;
+      return true;
+    }
+
+    bool readFromStream(std::istream& stream, size_t size) {
+      if (size > MaxSize)
+        return false;
+
+      if (!stream.read(m_data, size))
+        return false;
+
+      m_size = size;
+      m_read = 0;
+      return true;
+    }
+
+  private:
+
+    size_t m_size = 0;
+    size_t m_read = 0;
+    char   m_data[MaxSize];
+
+    template<typename T>
+    bool read(T& data) {
+      if (m_read + sizeof(T) > m_size)
+        return false;
+
+      std::memcpy(&data, &m_data[m_read], sizeof(T));
+      m_read += sizeof(T);
+      return true;
+    }
+
+  };
+
+
+  template<typename T>
+  bool readCacheEntryTyped(std::istream& stream, T& entry) {
+    auto data = reinterpret_cast<char*>(&entry);
+    auto size = sizeof(entry);
+
+    if (!stream.read(data, size))
+      return false;
+    
+    Sha1Hash expectedHash = std::exchange(entry.hash, g_nullHash);
+    Sha1Hash computedHash = Sha1Hash::compute(entry);
+    return expectedHash == computedHash;
+  }
+
+
+  static uint8_t packImageLayout(
+          VkImageLayout             layout) {
+    switch (layout) {
+      case VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL: return 0x80;
+      case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL: return 0x81;
+      default: return uint8_t(layout);
+    }
+  }
+
+
+  static VkImageLayout unpackImageLayout(
+          uint8_t                   layout) {
+    switch (layout) {
+      case 0x80: return VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL;
+      case 0x81: return VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL;
+      default: return VkImageLayout(layout);
+    }
+  }
+
+
+  static bool validateRenderPassFormat(
+    const DxvkRenderPassFormat&     format) {
+    bool valid = true;
+
+    if (format.depth.format) {
+      valid &= format.depth.layout == VK_IMAGE_LAYOUT_GENERAL
+            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL
+            || format.depth.layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_STENCIL_READ_ONLY_OPTIMAL;
+    }
+
+    for (uint32_t i = 0; i < MaxNumRenderTargets && valid; i++) {
+      if (format.color[i].format) {
+        valid &= format.color[i].layout == VK_IMAGE_LAYOUT_GENERAL
+              || format.color[i].layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+      }
+    }
+
+    return valid;
+  }
+
+
+  static bool readEntryState(
+          DxvkStateCacheEntryData&  data,
+          uint32_t                  version,
+          VkShaderStageFlags        stageMask,
+          DxvkStateCacheEntry&      entry) {
+    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
+      if (!data.read(entry.cpState.bsBindingMask, version))
+        return false;
+    } else {
+      // Read packed render pass format
+      uint8_t sampleCount = 0;
+      uint8_t imageFormat = 0;
+      uint8_t imageLayout = 0;
+
+      if (!data.read(sampleCount, version)
+       || !data.read(imageFormat, version)
+       || !data.read(imageLayout, version))
+        return false;
+
+      entry.format.sampleCount = VkSampleCountFlagBits(sampleCount);
+      entry.format.depth.format = VkFormat(imageFormat);
+      entry.format.depth.layout = unpackImageLayout(imageLayout);
+
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        if (!data.read(imageFormat, version)
+         || !data.read(imageLayout, version))
+          return false;
+
+        entry.format.color[i].format = VkFormat(imageFormat);
+        entry.format.color[i].layout = unpackImageLayout(imageLayout);
+      }
+
+      if (!validateRenderPassFormat(entry.format))
+        return false;
+
+      // Read common pipeline state
+      if (!data.read(entry.gpState.bsBindingMask, version)
+       || !data.read(entry.gpState.ia, version)
+       || !data.read(entry.gpState.il, version)
+       || !data.read(entry.gpState.rs, version)
+       || !data.read(entry.gpState.ms, version)
+       || !data.read(entry.gpState.ds, version)
+       || !data.read(entry.gpState.om, version)
+       || !data.read(entry.gpState.dsFront, version)
+       || !data.read(entry.gpState.dsBack, version))
+        return false;
+
+      if (entry.gpState.il.attributeCount() > MaxNumVertexAttributes
+       || entry.gpState.il.bindingCount() > MaxNumVertexBindings)
+        return false;
+
+      // Read render target swizzles
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        if (!data.read(entry.gpState.omSwizzle[i], version))
+          return false;
+      }
+
+      // Read render target blend info
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        if (!data.read(entry.gpState.omBlend[i], version))
+          return false;
+      }
+
+      // Read defined vertex attributes
+      for (uint32_t i = 0; i < entry.gpState.il.attributeCount(); i++) {
+        if (!data.read(entry.gpState.ilAttributes[i], version))
+          return false;
+      }
+
+      // Read defined vertex bindings
+      for (uint32_t i = 0; i < entry.gpState.il.bindingCount(); i++) {
+        if (!data.read(entry.gpState.ilBindings[i], version))
+          return false;
+      }
+    }
+
+    // Read non-zero spec constants
+    auto& sc = (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
+      ? entry.cpState.sc
+      : entry.gpState.sc;
+
+    uint32_t specConstantMask = 0;
+
+    if (!data.read(specConstantMask, version))
+      return false;
+
+    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
+      if (specConstantMask & (1 << i)) {
+        if (!data.read(sc.specConstants[i], version))
+          return false;
+      }
+    }
+
+    return true;
+  }
+
+
+  static void writeEntryState(
+          DxvkStateCacheEntryData&  data,
+          VkShaderStageFlags        stageMask,
+    const DxvkStateCacheEntry&      entry) {
+    if (stageMask & VK_SHADER_STAGE_COMPUTE_BIT) {
+      // Nothing else here to write out
+      data.write(entry.cpState.bsBindingMask);
+    } else {
+      // Pack render pass format
+      data.write(uint8_t(entry.format.sampleCount));
+      data.write(uint8_t(entry.format.depth.format));
+      data.write(packImageLayout(entry.format.depth.layout));
+
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++) {
+        data.write(uint8_t(entry.format.color[i].format));
+        data.write(packImageLayout(entry.format.color[i].layout));
+      }
+
+      // Write out common pipeline state
+      data.write(entry.gpState.bsBindingMask);
+      data.write(entry.gpState.ia);
+      data.write(entry.gpState.il);
+      data.write(entry.gpState.rs);
+      data.write(entry.gpState.ms);
+      data.write(entry.gpState.ds);
+      data.write(entry.gpState.om);
+      data.write(entry.gpState.dsFront);
+      data.write(entry.gpState.dsBack);
+
+      // Write out render target swizzles and blend info
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++)
+        data.write(entry.gpState.omSwizzle[i]);
+
+      for (uint32_t i = 0; i < MaxNumRenderTargets; i++)
+        data.write(entry.gpState.omBlend[i]);
+
+      // Write out input layout for defined attributes
+      for (uint32_t i = 0; i < entry.gpState.il.attributeCount(); i++)
+        data.write(entry.gpState.ilAttributes[i]);
+
+      for (uint32_t i = 0; i < entry.gpState.il.bindingCount(); i++)
+        data.write(entry.gpState.ilBindings[i]);
+    }
+
+    // Write out all non-zero spec constants
+    auto& sc = (stageMask & VK_SHADER_STAGE_COMPUTE_BIT)
+      ? entry.cpState.sc
+      : entry.gpState.sc;
+
+    uint32_t specConstantMask = 0;
+
+    for (uint32_t i = 0; i < MaxNumSpecConstants; i++)
+      specConstantMask |= sc.specConstants[i] ? (1 << i) : 0;
+
+    data.write(specConstantMask);
+
+    for (uint32_t i = 0; i < MaxNumSpecConstants; i++) {
+      if (specConstantMask & (1 << i))
+        data.write(sc.specConstants[i]);
+    }
+  }
+
+
+  bool DxvkStateCacheKey::eq(const DxvkStateCacheKey& key) const {
+    return this->vs.eq(key.vs)
+        && this->tcs.eq(key.tcs)
+        && this->tes.eq(key.tes)
+        && this->gs.eq(key.gs)
+        && this->fs.eq(key.fs)
+        && this->cs.eq(key.cs);
+  }
+
+
+  size_t DxvkStateCacheKey::hash() const {
+    DxvkHashState hash;
+    hash.add(this->vs.hash());
+    hash.add(this->tcs.hash());
+    hash.add(this->tes.hash());
+    hash.add(this->gs.hash());
+    hash.add(this->fs.hash());
+    hash.add(this->cs.hash());
+    return hash;
+  }
+
+
+  static VkShaderStageFlags getStageMask(
+    const DxvkStateCacheKey&        key) {
+    VkShaderStageFlags stageMask = 0;
+    auto keys = &key.vs;
+
+    for (uint32_t i = 0; i < 6; i++) {
+      if (!keys[i].eq(g_nullShaderKey))
+        stageMask |= VkShaderStageFlagBits(1 << i);
+    }
+
+    return stageMask;
+  }
+
+
+  bool DxvkStateCacheIo::readCacheHeader(
+          std::istream&             stream,
+          DxvkStateCacheHeader&     header) {
+    DxvkStateCacheHeader expected;
+
+    auto data = reinterpret_cast<char*>(&header);
+    auto size = sizeof(header);
+
+    if (!stream.read(data, size))
+      return false;
+    
+    for (uint32_t i = 0; i < 4; i++) {
+      if (expected.magic[i] != header.magic[i])
+        return false;
+    }
+    
+    return true;
+  }
+
+
+  bool DxvkStateCacheIo::isHeaderSupported(
+    const DxvkStateCacheHeader&     header) {
+    DxvkStateCacheHeader newHeader;
+
+    // Struct size hasn't changed between v2 and v4
+    size_t expectedSize = newHeader.entrySize;
+
+    if (header.version <= 4)
+      expectedSize = sizeof(DxvkStateCacheEntryV4);
+    else if (header.version <= 5)
+      expectedSize = sizeof(DxvkStateCacheEntryV5);
+    else if (header.version <= 6)
+      expectedSize = sizeof(DxvkStateCacheEntryV6);
+    else if (header.version <= 7)
+      expectedSize = sizeof(DxvkStateCacheEntry);
+
+    if (header.entrySize != expectedSize)
+      return false;
+
+    // Discard caches of unsupported versions
+    return header.version >= 2
+        && header.version <= newHeader.version;
+  }
+
+
+  bool DxvkStateCacheIo::readCacheEntryV7(
+          uint32_t                  version,
+          std::istream&             stream, 
+          DxvkStateCacheEntry&      entry) {
+    if (version <= 6) {
+      DxvkStateCacheEntryV6 v6;
+
+      if (version <= 4) {
+        DxvkStateCacheEntryV4 v4;
+
+        if (!readCacheEntryTyped(stream, v4))
+          return false;
+
+        if (version == 2)
+          convertEntryV2(v4);
+
+        if (!convertEntryV4(v4, v6))
+          return false;
+      } else if (version <= 5) {
+        DxvkStateCacheEntryV5 v5;
+
+        if (!readCacheEntryTyped(stream, v5))
+          return false;
+
+        if (!convertEntryV5(v5, v6))
+          return false;
+      } else {
+        if (!readCacheEntryTyped(stream, v6))
+          return false;
+      }
+
+      return convertEntryV6(v6, entry);
+    } else {
+      return readCacheEntryTyped(stream, entry);
+    }
+  }
+
+
+  bool DxvkStateCacheIo::readCacheEntry(
+          uint32_t                  version,
+          std::istream&             stream, 
+          DxvkStateCacheEntry&      entry) {
+    if (version < 8)
+      return readCacheEntryV7(version, stream, entry);
+
+    // Read entry metadata and actual data
+    DxvkStateCacheEntryHeader header;
+    DxvkStateCacheEntryData data;
+    Sha1Hash hash;
+  
+    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header))
+     || !stream.read(reinterpret_cast<char*>(&hash), sizeof(hash))
+     || !data.readFromStream(stream, header.entrySize))
+      return false;
+
+    // Validate hash, skip entry if invalid
+    if (hash != data.computeHash())
+      return false;
+
+    // Read shader hashes
+    VkShaderStageFlags stageMask = VkShaderStageFlags(header.stageMask);
+    auto keys = &entry.shaders.vs;
+
+    for (uint32_t i = 0; i < 6; i++) {
+      if (stageMask & VkShaderStageFlagBits(1 << i))
+        data.read(keys[i], version);
+      else
+        keys[i] = g_nullShaderKey;
+    }
+
+    return readEntryState(data, version, stageMask, entry);
+  }
+
+
+  void DxvkStateCacheIo::writeCacheEntry(
+          std::ostream&             stream, 
+    const DxvkStateCacheEntry&      entry) {
+    DxvkStateCacheEntryData data;
+    VkShaderStageFlags stageMask = 0;
+
+    // Write shader hashes
+    auto keys = &entry.shaders.vs;
+
+    for (uint32_t i = 0; i < 6; i++) {
+      if (!keys[i].eq(g_nullShaderKey)) {
+        stageMask |= VkShaderStageFlagBits(1 << i);
+        data.write(keys[i]);
+      }
+    }
+
+    writeEntryState(data, stageMask, entry);
+
+    // General layout: header -> hash -> data
+    DxvkStateCacheEntryHeader header;
+    header.stageMask = uint8_t(stageMask);
+    header.entrySize = data.size();
+
+    Sha1Hash hash = data.computeHash();
+
+    stream.write(reinterpret_cast<char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<char*>(&hash), sizeof(hash));
+    stream.write(data.data(), data.size());
+    stream.flush();
+  }
+
+
+  bool DxvkStateCacheIo::convertEntryV2(
+          DxvkStateCacheEntryV4&    entry) {
+    // Semantics changed:
+    // v2: rsDepthClampEnable
+    // v3: rsDepthClipEnable
+    entry.gpState.rsDepthClipEnable = !entry.gpState.rsDepthClipEnable;
+
+    // Frontend changed: Depth bias
+    // will typically be disabled
+    entry.gpState.rsDepthBiasEnable = VK_FALSE;
+    return true;
+  }
+
+
+  bool DxvkStateCacheIo::convertEntryV4(
+    const DxvkStateCacheEntryV4&    in,
+          DxvkStateCacheEntryV6&    out) {
+    out.shaders = in.shaders;
+    out.format  = in.format;
+    out.hash    = in.hash;
+
+    out.cpState.bsBindingMask           = in.cpState.bsBindingMask;
+    out.gpState.bsBindingMask           = in.gpState.bsBindingMask;
+    
+    out.gpState.iaPrimitiveTopology     = in.gpState.iaPrimitiveTopology;
+    out.gpState.iaPrimitiveRestart      = in.gpState.iaPrimitiveRestart;
+    out.gpState.iaPatchVertexCount      = in.gpState.iaPatchVertexCount;
+    
+    out.gpState.ilAttributeCount        = in.gpState.ilAttributeCount;
+    out.gpState.ilBindingCount          = in.gpState.ilBindingCount;
+
+    for (uint32_t i = 0; i < in.gpState.ilAttributeCount; i++)
+      out.gpState.ilAttributes[i]       = in.gpState.ilAttributes[i];
+
+    for (uint32_t i = 0; i < in.gpState.ilBindingCount; i++) {
+      out.gpState.ilBindings[i]         = in.gpState.ilBindings[i];
+      out.gpState.ilDivisors[i]         = in.gpState.ilDivisors[i];
+    }
+    
+    out.gpState.rsDepthClipEnable       = in.gpState.rsDepthClipEnable;
+    out.gpState.rsDepthBiasEnable       = in.gpState.rsDepthBiasEnable;
+    out.gpState.rsPolygonMode           = in.gpState.rsPolygonMode;
+    out.gpState.rsCullMode              = in.gpState.rsCullMode;
+    out.gpState.rsFrontFace             = in.gpState.rsFrontFace;
+    out.gpState.rsViewportCount         = in.gpState.rsViewportCount;
+    out.gpState.rsSampleCount           = in.gpState.rsSampleCount;
+    
+    out.gpState.msSampleCount           = in.gpState.msSampleCount;
+    out.gpState.msSampleMask            = in.gpState.msSampleMask;
+    out.gpState.msEnableAlphaToCoverage = in.gpState.msEnableAlphaToCoverage;
+    
+    out.gpState.dsEnableDepthTest       = in.gpState.dsEnableDepthTest;
+    out.gpState.dsEnableDepthWrite      = in.gpState.dsEnableDepthWrite;
+    out.gpState.dsEnableStencilTest     = in.gpState.dsEnableStencilTest;
+    out.gpState.dsDepthCompareOp        = in.gpState.dsDepthCompareOp;
+    out.gpState.dsStencilOpFront        = in.gpState.dsStencilOpFront;
+    out.gpState.dsStencilOpBack         = in.gpState.dsStencilOpBack;
+    
+    out.gpState.omEnableLogicOp         = in.gpState.omEnableLogicOp;
+    out.gpState.omLogicOp               = in.gpState.omLogicOp;
+
+    for (uint32_t i = 0; i < 8; i++) {
+      out.gpState.omBlendAttachments[i] = in.gpState.omBlendAttachments[i];
+      out.gpState.omComponentMapping[i] = in.gpState.omComponentMapping[i];
+    }
+
+    return true;
+  }
+
+
+  bool DxvkStateCacheIo::convertEntryV5(
+    const DxvkStateCacheEntryV5&    in,
+          DxvkStateCacheEntryV6&    out) {
+    out.shaders = in.shaders;
+    out.gpState = in.gpState;
+    out.format  = in.format;
+    out.hash    = in.hash;
+
+    out.cpState.bsBindingMask = in.cpState.bsBindingMask;
+    return true;
+  }
+
+
+  bool DxvkStateCacheIo::convertEntryV6(
+    const DxvkStateCacheEntryV6&    in,
+          DxvkStateCacheEntry&      out) {
+    out.shaders = in.shaders;
+    out.format  = in.format;
+    out.hash    = in.hash;
+
+    if (in.shaders.cs.eq(g_nullShaderKey)) {
+      // Binding mask
+      out.gpState.bsBindingMask = in.gpState.bsBindingMask.convert();
+
+      // Graphics state
+      out.gpState.ia = DxvkIaInfo(
+        in.gpState.iaPrimitiveTopology,
+        in.gpState.iaPrimitiveRestart,
+        in.gpState.iaPatchVertexCount);
+      
+      out.gpState.il = DxvkIlInfo(
+        in.gpState.ilAttributeCount,
+        in.gpState.ilBindingCount);
+      
+      for (uint32_t i = 0; i < in.gpState.ilAttributeCount; i++) {
+        out.gpState.ilAttributes[i] = DxvkIlAttribute(
+          in.gpState.ilAttributes[i].location,
+          in.gpState.ilAttributes[i].binding,
+          in.gpState.ilAttributes[i].format,
+          in.gpState.ilAttributes[i].offset);
+      }
+      
+      for (uint32_t i = 0; i < in.gpState.ilBindingCount; i++) {
+        out.gpState.ilBindings[i] = DxvkIlBinding(
+          in.gpState.ilBindings[i].binding,
+          in.gpState.ilBindings[i].stride,
+          in.gpState.ilBindings[i].inputRate,
+          in.gpState.ilDivisors[i]);
+      }
+      
+      out.gpState.rs = DxvkRsInfo(
+        in.gpState.rsDepthClipEnable,
+        in.gpState.rsDepthBiasEnable,
+        in.gpState.rsPolygonMode,
+        in.gpState.rsCullMode,
+        in.gpState.rsFrontFace,
+        in.gpState.rsViewportCount,
+        in.gpState.rsSampleCount,
+        VK_CONSERVATIVE_RASTERIZATION_MODE_DISABLED_EXT);
+
+      out.gpState.ms = DxvkMsInfo(
+        in.gpState.msSampleCount,
+        in.gpState.msSampleMask,
+        in.gpState.msEnableAlphaToCoverage);
+      
+      out.gpState.ds = DxvkDsInfo(
+        in.gpState.dsEnableDepthTest,
+        in.gpState.dsEnableDepthWrite,
+        in.gpState.dsEnableDepthBoundsTest,
+        in.gpState.dsEnableStencilTest,
+        in.gpState.dsDepthCompareOp);
+      
+      out.gpState.dsFront = DxvkDsStencilOp(in.gpState.dsStencilOpFront);
+      out.gpState.dsBack  = DxvkDsStencilOp(in.gpState.dsStencilOpBack);
+
+      out.gpState.om = DxvkOmInfo(
+        in.gpState.omEnableLogicOp,
+        in.gpState.omLogicOp);
+      
+      for (uint32_t i = 0; i < 8 && i < MaxNumRenderTargets; i++) {
+        out.gpState.omBlend[i] = DxvkOmAttachmentBlend(
+          in.gpState.omBlendAttachments[i].blendEnable,
+          in.gpState.omBlendAttachments[i].srcColorBlendFactor,
+          in.gpState.omBlendAttachments[i].dstColorBlendFactor,
+          in.gpState.omBlendAttachments[i].colorBlendOp,
+          in.gpState.omBlendAttachments[i].srcAlphaBlendFactor,
+          in.gpState.omBlendAttachments[i].dstAlphaBlendFactor,
+          in.gpState.omBlendAttachments[i].alphaBlendOp,
+          in.gpState.omBlendAttachments[i].colorWriteMask);
+        
+        out.gpState.omSwizzle[i] = DxvkOmAttachmentSwizzle(
+          in.gpState.omComponentMapping[i]);
+      }
+
+      // Specialization constants
+      for (uint32_t i = 0; i < 8 && i < MaxNumSpecConstants; i++)
+        out.cpState.sc.specConstants[i] = in.cpState.scSpecConstants[i];
+    } else {
+      // Binding mask
+      out.cpState.bsBindingMask = in.cpState.bsBindingMask.convert();
+
+      for (uint32_t i = 0; i < 8 && i < MaxNumSpecConstants; i++)
+        out.gpState.sc.specConstants[i] = in.gpState.scSpecConstants[i];
+    }
+
+    return true;
+  }
+
+
+  void DxvkStateCacheIo::encodeEntryState(
+    const DxvkStateCacheEntry&      entry,
+          std::vector<uint8_t>&     data) {
+    DxvkStateCacheEntryData entryData;
+    writeEntryState(entryData, getStageMask(entry.shaders), entry);
+
+    auto bytes = reinterpret_cast<const uint8_t*>(entryData.data());
+    data.assign(bytes, bytes + entryData.size());
+  }
+
+
+  bool DxvkStateCacheIo::decodeEntryState(
+    const uint8_t*                  data,
+          size_t                    size,
+          DxvkStateCacheEntry&      entry) {
+    DxvkStateCacheEntryData entryData;
+
+    if (!entryData.readFromMemory(data, size))
+      return false;
+
+    return readEntryState(entryData, DxvkStateCacheHeader().version,
+      getStageMask(entry.shaders), entry);
+  }
+
+
+  void DxvkStateCachePackWriter::addEntry(
+    const DxvkStateCacheEntry&      entry) {
+    auto group = m_groupMap.find(entry.shaders);
+    uint32_t groupIndex;
+
+    if (group == m_groupMap.end()) {
+      groupIndex = uint32_t(m_groups.size());
+      m_groupMap.insert({ entry.shaders, groupIndex });
+
+      auto& newGroup = m_groups.emplace_back();
+      newGroup.key = entry.shaders;
+    } else {
+      groupIndex = group->second;
+    }
+
+    auto& state = m_groups[groupIndex].states.emplace_back();
+    DxvkStateCacheIo::encodeEntryState(entry, state);
+  }
+
+
+  bool DxvkStateCachePackWriter::write(
+          std::ostream&             stream) {
+    std::vector<DxvkShaderKey>              shaderKeys;
+    std::vector<DxvkStateCachePackGroup>    groups;
+    std::vector<DxvkStateCachePackEntry>    entries;
+    std::vector<uint8_t>                    data;
+    std::vector<uint8_t>                    delta;
+
+    std::unordered_map<
+      DxvkShaderKey, uint32_t,
+      DxvkHash, DxvkEq> shaderKeyMap;
+
+    m_stats = DxvkStateCachePackStats();
+
+    for (const auto& group : m_groups) {
+      DxvkStateCachePackGroup& packGroup = groups.emplace_back();
+      packGroup.firstEntry = uint32_t(entries.size());
+      packGroup.entryCount = uint32_t(group.states.size());
+
+      // Deduplicate shader keys across all groups
+      auto keys = &group.key.vs;
+
+      for (uint32_t i = 0; i < 6; i++) {
+        packGroup.shaderKeys[i] = DxvkStateCachePackGroup::InvalidIndex;
+
+        if (keys[i].eq(g_nullShaderKey))
+          continue;
+
+        auto key = shaderKeyMap.insert({ keys[i], uint32_t(shaderKeys.size()) });
+
+        if (key.second)
+          shaderKeys.push_back(keys[i]);
+
+        packGroup.shaderKeys[i] = key.first->second;
+      }
+
+      // Delta-encode each state against the previous one in the
+      // group, since they typically differ in only a few bytes
+      for (size_t i = 0; i < group.states.size(); i++) {
+        const auto& state = group.states[i];
+
+        if (state.size() > DxvkStateCachePackEntry::MaxStateSize)
+          return false;
+
+        DxvkStateCachePackEntry& packEntry = entries.emplace_back();
+        packEntry.dataOffset = uint32_t(data.size());
+        packEntry.stateSize  = uint16_t(state.size());
+
+        if (i)
+          encodeDelta(group.states[i - 1], state, delta);
+
+        if (i && delta.size() < state.size()) {
+          packEntry.dataSize = uint16_t(delta.size()) | DxvkStateCachePackEntry::DeltaBit;
+          data.insert(data.end(), delta.begin(), delta.end());
+          m_stats.deltaEntryCount += 1;
+        } else {
+          packEntry.dataSize = uint16_t(state.size());
+          data.insert(data.end(), state.begin(), state.end());
+        }
+
+        m_stats.stateBytes += state.size();
+      }
+    }
+
+    // Lay out sections back to back. All records are
+    // multiples of 8 bytes, so no padding is needed.
+    DxvkStateCachePackHeader header;
+    header.shaderKeyCount   = uint32_t(shaderKeys.size());
+    header.groupCount       = uint32_t(groups.size());
+    header.entryCount       = uint32_t(entries.size());
+    header.shaderKeyOffset  = uint32_t(sizeof(header));
+    header.groupOffset      = header.shaderKeyOffset + uint32_t(shaderKeys.size() * sizeof(DxvkShaderKey));
+    header.entryOffset      = header.groupOffset + uint32_t(groups.size() * sizeof(DxvkStateCachePackGroup));
+    header.dataOffset       = header.entryOffset + uint32_t(entries.size() * sizeof(DxvkStateCachePackEntry));
+    header.dataSize         = uint32_t(data.size());
+    header.packSize         = align(header.dataOffset + header.dataSize, 8);
+
+    std::vector<uint8_t> body(header.packSize - sizeof(header));
+
+    auto copySection = [&body] (uint32_t offset, const void* src, size_t size) {
+      if (size)
+        std::memcpy(&body[offset - sizeof(DxvkStateCachePackHeader)], src, size);
+    };
+
+    copySection(header.shaderKeyOffset, shaderKeys.data(), shaderKeys.size() * sizeof(DxvkShaderKey));
+    copySection(header.groupOffset,     groups.data(),     groups.size() * sizeof(DxvkStateCachePackGroup));
+    copySection(header.entryOffset,     entries.data(),    entries.size() * sizeof(DxvkStateCachePackEntry));
+    copySection(header.dataOffset,      data.data(),       data.size());
+
+    header.checksum = XXH3_64bits(body.data(), body.size());
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(reinterpret_cast<const char*>(body.data()), body.size());
+    stream.flush();
+
+    m_stats.shaderKeyCount  = header.shaderKeyCount;
+    m_stats.groupCount      = header.groupCount;
+    m_stats.entryCount      = header.entryCount;
+    m_stats.dataBytes       = header.dataSize;
+    m_stats.packBytes       = header.packSize;
+    return bool(stream);
+  }
+
+
+  void DxvkStateCachePackWriter::encodeDelta(
+    const std::vector<uint8_t>&     ref,
+    const std::vector<uint8_t>&     src,
+          std::vector<uint8_t>&     dst) {
+    // Encoded as a sequence of (copy, literal) byte pairs, each
+    // followed by the literal bytes. Copied bytes are taken from
+    // the same position in the reference state.
+    auto matches = [&] (size_t pos) {
+      return pos < ref.size() && pos < src.size() && ref[pos] == src[pos];
+    };
+
+    // Short matches are cheaper to store as literals
+    auto matchStarts = [&] (size_t pos) {
+      return matches(pos) && matches(pos + 1) && matches(pos + 2);
+    };
+
+    dst.clear();
+
+    size_t pos = 0;
+
+    while (pos < src.size()) {
+      size_t copy = 0;
+
+      while (copy < 255 && matches(pos + copy))
+        copy += 1;
+
+      size_t literal = 0;
+
+      while (literal < 255 && pos + copy + literal < src.size()
+          && !matchStarts(pos + copy + literal))
+        literal += 1;
+
+      dst.push_back(uint8_t(copy));
+      dst.push_back(uint8_t(literal));
+      dst.insert(dst.end(),
+        src.begin() + pos + copy,
+        src.begin() + pos + copy + literal);
+
+      pos += copy + literal;
+    }
+  }
+
+
+  bool DxvkStateCachePackReader::open(
+    const std::wstring&             path,
+          size_t                    offset) {
+    close();
+
+    if (!m_file.open(path))
+      return false;
+
+    if (offset + sizeof(DxvkStateCachePackHeader) > m_file.size()) {
+      close();
+      return false;
+    }
+
+    auto base   = m_file.data() + offset;
+    auto header = reinterpret_cast<const DxvkStateCachePackHeader*>(base);
+
+    DxvkStateCachePackHeader expected;
+
+    bool valid = !std::memcmp(header->magic, expected.magic, sizeof(expected.magic))
+      && header->packSize >= sizeof(DxvkStateCachePackHeader)
+      && header->packSize <= m_file.size() - offset
+      && uint64_t(header->shaderKeyOffset) + uint64_t(header->shaderKeyCount) * sizeof(DxvkShaderKey) <= header->groupOffset
+      && uint64_t(header->groupOffset) + uint64_t(header->groupCount) * sizeof(DxvkStateCachePackGroup) <= header->entryOffset
+      && uint64_t(header->entryOffset) + uint64_t(header->entryCount) * sizeof(DxvkStateCachePackEntry) <= header->dataOffset
+      && uint64_t(header->dataOffset) + uint64_t(header->dataSize) <= header->packSize
+      && header->shaderKeyOffset >= sizeof(DxvkStateCachePackHeader);
+
+    // The checksum covers the entire pack, so that individual
+    // records do not need to be validated beyond bounds checks
+    valid = valid && header->checksum == XXH3_64bits(
+      base + sizeof(DxvkStateCachePackHeader),
+      header->packSize - sizeof(DxvkStateCachePackHeader));
+
+    if (!valid) {
+      close();
+      return false;
+    }
+
+    m_offset      = offset;
+    m_header      = header;
+    m_shaderKeys  = reinterpret_cast<const DxvkShaderKey*>(base + header->shaderKeyOffset);
+    m_groups      = reinterpret_cast<const DxvkStateCachePackGroup*>(base + header->groupOffset);
+    m_entries     = reinterpret_cast<const DxvkStateCachePackEntry*>(base + header->entryOffset);
+    m_data        = base + header->dataOffset;
+    return true;
+  }
+
+
+  void DxvkStateCachePackReader::close() {
+    m_file.close();
+
+    m_offset      = 0;
+    m_header      = nullptr;
+    m_shaderKeys  = nullptr;
+    m_groups      = nullptr;
+    m_entries     = nullptr;
+    m_data        = nullptr;
+  }
+
+
+  DxvkStateCacheKey DxvkStateCachePackReader::getGroupKey(
+          uint32_t                  group) const {
+    DxvkStateCacheKey result;
+
+    if (group >= getGroupCount())
+      return result;
+
+    auto keys = &result.vs;
+
+    for (uint32_t i = 0; i < 6; i++) {
+      uint32_t index = m_groups[group].shaderKeys[i];
+
+      if (index < m_header->shaderKeyCount)
+        keys[i] = m_shaderKeys[index];
+    }
+
+    return result;
+  }
+
+
+  uint32_t DxvkStateCachePackReader::readGroup(
+          uint32_t                  group,
+          std::vector<DxvkStateCacheEntry>& entries) const {
+    if (group >= getGroupCount())
+      return 0;
+
+    const DxvkStateCachePackGroup& packGroup = m_groups[group];
+
+    if (uint64_t(packGroup.firstEntry) + packGroup.entryCount > m_header->entryCount)
+      return packGroup.entryCount;
+
+    DxvkStateCacheKey key = getGroupKey(group);
+
+    std::array<uint8_t, DxvkStateCachePackEntry::MaxStateSize> prev;
+    std::array<uint8_t, DxvkStateCachePackEntry::MaxStateSize> curr;
+    size_t prevSize = 0;
+
+    uint32_t numInvalid = 0;
+
+    for (uint32_t i = 0; i < packGroup.entryCount; i++) {
+      const DxvkStateCachePackEntry& packEntry = m_entries[packGroup.firstEntry + i];
+
+      bool   isDelta  = packEntry.dataSize & DxvkStateCachePackEntry::DeltaBit;
+      size_t dataSize = packEntry.dataSize & ~DxvkStateCachePackEntry::DeltaBit;
+
+      bool valid = packEntry.stateSize <= curr.size()
+        && uint64_t(packEntry.dataOffset) + dataSize <= m_header->dataSize;
+
+      if (valid) {
+        const uint8_t* src = m_data + packEntry.dataOffset;
+
+        if (isDelta) {
+          valid = prevSize && decodeDelta(prev.data(), prevSize,
+            src, dataSize, curr.data(), packEntry.stateSize);
+        } else {
+          valid = dataSize == packEntry.stateSize;
+
+          if (valid)
+            std::memcpy(curr.data(), src, dataSize);
+        }
+      }
+
+      // If the raw data is broken, we cannot decode
+      // any further deltas against it either
+      if (!valid) {
+        prevSize = 0;
+        numInvalid += 1;
+        continue;
+      }
+
+      DxvkStateCacheEntry entry;
+      entry.shaders = key;
+
+      if (DxvkStateCacheIo::decodeEntryState(curr.data(), packEntry.stateSize, entry))
+        entries.push_back(entry);
+      else
+        numInvalid += 1;
+
+      std::swap(prev, curr);
+      prevSize = packEntry.stateSize;
+    }
+
+    return numInvalid;
+  }
+
+
+  DxvkStateCachePackStats DxvkStateCachePackReader::getStats() const {
+    DxvkStateCachePackStats stats;
+
+    if (!m_header)
+      return stats;
+
+    stats.shaderKeyCount  = m_header->shaderKeyCount;
+    stats.groupCount      = m_header->groupCount;
+    stats.entryCount      = m_header->entryCount;
+    stats.dataBytes       = m_header->dataSize;
+    stats.packBytes       = m_header->packSize;
+
+    for (uint32_t i = 0; i < m_header->entryCount; i++) {
+      if (m_entries[i].dataSize & DxvkStateCachePackEntry::DeltaBit)
+        stats.deltaEntryCount += 1;
+
+      stats.stateBytes += m_entries[i].stateSize;
+    }
+
+    return stats;
+  }
+
+
+  bool DxvkStateCachePackReader::decodeDelta(
+    const uint8_t*                  ref,
+          size_t                    refSize,
+    const uint8_t*                  src,
+          size_t                    srcSize,
+          uint8_t*                  dst,
+          size_t                    dstSize) {
+    size_t read  = 0;
+    size_t write = 0;
+
+    while (write < dstSize) {
+      if (read + 2 > srcSize)
+        return false;
+
+      size_t copy    = src[read + 0];
+      size_t literal = src[read + 1];
+      read += 2;
+
+      if (write + copy + literal > dstSize
+       || write + copy > refSize
+       || read + literal > srcSize)
+        return false;
+
+      std::memcpy(dst + write, ref + write, copy);
+      write += copy;
+
+      std::memcpy(dst + write, src + read, literal);
+      write += literal;
+      read  += literal;
+    }
+
+    return read == srcSize;
+  }
+
+}
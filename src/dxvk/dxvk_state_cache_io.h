@@ -0,0 +1,308 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <array>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "dxvk_state_cache_types.h"
+
+#include "../util/util_mapped_file.h"
+
+namespace dxvk {
+
+  /**
+   * \brief State cache entry serialization
+   *
+   * Reads and writes individual state cache entries and
+   * converts entries from older versions. This does not
+   * depend on a device, so that offline tools can use it.
+   */
+  class DxvkStateCacheIo {
+
+  public:
+
+    /**
+     * \brief Reads and validates file header
+     *
+     * \param [in] stream Input stream
+     * \param [out] header File header
+     * \returns \c true if the magic number matches
+     */
+    static bool readCacheHeader(
+            std::istream&             stream,
+            DxvkStateCacheHeader&     header);
+
+    /**
+     * \brief Checks whether a file header can be read
+     *
+     * \param [in] header File header
+     * \returns \c true if entries of this version and
+     *    entry size can be read or converted
+     */
+    static bool isHeaderSupported(
+      const DxvkStateCacheHeader&     header);
+
+    /**
+     * \brief Reads a single entry in the stream format
+     *
+     * \param [in] version File version
+     * \param [in] stream Input stream
+     * \param [out] entry Entry, converted to the current version
+     * \returns \c true if the entry is valid
+     */
+    static bool readCacheEntry(
+            uint32_t                  version,
+            std::istream&             stream, 
+            DxvkStateCacheEntry&      entry);
+
+    /**
+     * \brief Writes a single entry in the stream format
+     *
+     * \param [in] stream Output stream
+     * \param [in] entry The entry to write
+     */
+    static void writeCacheEntry(
+            std::ostream&             stream, 
+      const DxvkStateCacheEntry&      entry);
+
+    /**
+     * \brief Serializes pipeline state without shader keys
+     *
+     * \param [in] entry The entry to encode
+     * \param [out] data Serialized pipeline state
+     */
+    static void encodeEntryState(
+      const DxvkStateCacheEntry&      entry,
+            std::vector<uint8_t>&     data);
+
+    /**
+     * \brief Deserializes pipeline state
+     *
+     * Shader keys of \c entry must already be set,
+     * since they determine the pipeline type.
+     * \param [in] data Serialized pipeline state
+     * \param [in] size Size of the serialized state
+     * \param [in,out] entry Entry to fill in
+     * \returns \c true if the state is valid
+     */
+    static bool decodeEntryState(
+      const uint8_t*                  data,
+            size_t                    size,
+            DxvkStateCacheEntry&      entry);
+
+  private:
+
+    static bool readCacheEntryV7(
+            uint32_t                  version,
+            std::istream&             stream, 
+            DxvkStateCacheEntry&      entry);
+    
+    static bool convertEntryV2(
+            DxvkStateCacheEntryV4&    entry);
+    
+    static bool convertEntryV4(
+      const DxvkStateCacheEntryV4&    in,
+            DxvkStateCacheEntryV6&    out);
+    
+    static bool convertEntryV5(
+      const DxvkStateCacheEntryV5&    in,
+            DxvkStateCacheEntryV6&    out);
+    
+    static bool convertEntryV6(
+      const DxvkStateCacheEntryV6&    in,
+            DxvkStateCacheEntry&      out);
+
+  };
+
+
+  /**
+   * \brief Packed state cache statistics
+   */
+  struct DxvkStateCachePackStats {
+    uint32_t shaderKeyCount   = 0;
+    uint32_t groupCount       = 0;
+    uint32_t entryCount       = 0;
+    uint32_t deltaEntryCount  = 0;
+    size_t   stateBytes       = 0;  ///< Decoded pipeline state size
+    size_t   dataBytes        = 0;  ///< Encoded pipeline state size
+    size_t   packBytes        = 0;  ///< Size of the entire pack section
+  };
+
+
+  /**
+   * \brief Packed state cache writer
+   *
+   * Collects entries, deduplicates shader keys and shader
+   * sets, and writes them out as a packed section with
+   * delta-encoded pipeline state.
+   */
+  class DxvkStateCachePackWriter {
+
+  public:
+
+    /**
+     * \brief Adds an entry to the pack
+     *
+     * Duplicate entries are not filtered out.
+     * \param [in] entry The entry to add
+     */
+    void addEntry(
+      const DxvkStateCacheEntry&      entry);
+
+    /**
+     * \brief Writes the packed section
+     *
+     * \param [in] stream Output stream, positioned
+     *    directly after the file header
+     * \returns \c true on success
+     */
+    bool write(
+            std::ostream&             stream);
+
+    /**
+     * \brief Statistics of the last write
+     */
+    const DxvkStateCachePackStats& stats() const {
+      return m_stats;
+    }
+
+  private:
+
+    struct Group {
+      DxvkStateCacheKey                 key;
+      std::vector<std::vector<uint8_t>> states;
+    };
+
+    std::vector<Group> m_groups;
+
+    std::unordered_map<
+      DxvkStateCacheKey, uint32_t,
+      DxvkHash, DxvkEq> m_groupMap;
+
+    DxvkStateCachePackStats m_stats;
+
+    static void encodeDelta(
+      const std::vector<uint8_t>&     ref,
+      const std::vector<uint8_t>&     src,
+            std::vector<uint8_t>&     dst);
+
+  };
+
+
+  /**
+   * \brief Packed state cache reader
+   *
+   * Maps the cache file and indexes the packed section in
+   * place. Entries are only decoded when requested, one
+   * group at a time.
+   */
+  class DxvkStateCachePackReader {
+
+  public:
+
+    /**
+     * \brief Maps and validates a cache file
+     *
+     * \param [in] path Path to the cache file
+     * \param [in] offset Offset of the packed section
+     * \returns \c true if the pack is valid
+     */
+    bool open(
+      const std::wstring&             path,
+            size_t                    offset);
+
+    /**
+     * \brief Unmaps the file
+     */
+    void close();
+
+    bool isOpen() const {
+      return m_header != nullptr;
+    }
+
+    /**
+     * \brief File offset directly after the pack
+     *
+     * Appended entries in the stream format start here.
+     */
+    size_t getEndOffset() const {
+      return m_offset + (m_header ? m_header->packSize : 0);
+    }
+
+    uint32_t getGroupCount() const {
+      return m_header ? m_header->groupCount : 0;
+    }
+
+    uint32_t getEntryCount() const {
+      return m_header ? m_header->entryCount : 0;
+    }
+
+    /**
+     * \brief Retrieves the shader keys of a group
+     *
+     * \param [in] group Group index
+     * \returns Shader keys of all pipelines in the group
+     */
+    DxvkStateCacheKey getGroupKey(
+            uint32_t                  group) const;
+
+    /**
+     * \brief Decodes all entries of a group
+     *
+     * \param [in] group Group index
+     * \param [out] entries Decoded entries, appended
+     * \returns Number of entries that failed to decode
+     */
+    uint32_t readGroup(
+            uint32_t                  group,
+            std::vector<DxvkStateCacheEntry>& entries) const;
+
+    /**
+     * \brief Computes pack statistics
+     */
+    DxvkStateCachePackStats getStats() const;
+
+  private:
+
+    MappedFile                      m_file;
+    size_t                          m_offset = 0;
+
+    const DxvkStateCachePackHeader* m_header     = nullptr;
+    const DxvkShaderKey*            m_shaderKeys = nullptr;
+    const DxvkStateCachePackGroup*  m_groups     = nullptr;
+    const DxvkStateCachePackEntry*  m_entries    = nullptr;
+    const uint8_t*                  m_data       = nullptr;
+
+    static bool decodeDelta(
+      const uint8_t*                  ref,
+            size_t                    refSize,
+      const uint8_t*                  src,
+            size_t                    srcSize,
+            uint8_t*                  dst,
+            size_t                    dstSize);
+
+  };
+
+}
@@ -52,12 +52,82 @@ namespace dxvk {
    */
   struct DxvkStateCacheHeader {
     char     magic[4]   = { 'D', 'X', 'V', 'K' };
-    uint32_t version    = 10;
+    // NV-DXVK start: packed state cache format
+    uint32_t version    = 11;
+    // NV-DXVK end
     uint32_t entrySize  = 0; /* no longer meaningful */
   };
 
   static_assert(sizeof(DxvkStateCacheHeader) == 12);
 
+  // NV-DXVK start: packed state cache format
+  /**
+   * \brief Packed state cache section header
+   *
+   * Starting with v11, the file header is followed by a
+   * packed section that can be used in place from a file
+   * mapping, and then by regular v10-style entries that
+   * were appended since the pack was last written.
+   *
+   * All offsets are relative to the start of this header.
+   * Sections are laid out in the order shader keys, groups,
+   * entries, data, and are 8-byte aligned.
+   */
+  struct DxvkStateCachePackHeader {
+    char     magic[4]         = { 'P', 'A', 'C', 'K' };
+    uint32_t packSize         = 0;
+    uint32_t shaderKeyCount   = 0;
+    uint32_t groupCount       = 0;
+    uint32_t entryCount       = 0;
+    uint32_t shaderKeyOffset  = 0;
+    uint32_t groupOffset      = 0;
+    uint32_t entryOffset      = 0;
+    uint32_t dataOffset       = 0;
+    uint32_t dataSize         = 0;
+    uint64_t checksum         = 0; /* XXH3 of everything after the header */
+  };
+
+  static_assert(sizeof(DxvkStateCachePackHeader) == 48);
+
+
+  /**
+   * \brief Packed pipeline group
+   *
+   * All entries that share the same set of shaders. Shaders
+   * are stored as indices into the deduplicated shader key
+   * table, with \c InvalidIndex marking unused stages.
+   */
+  struct DxvkStateCachePackGroup {
+    constexpr static uint32_t InvalidIndex = ~0u;
+
+    uint32_t shaderKeys[6];
+    uint32_t firstEntry;
+    uint32_t entryCount;
+  };
+
+  static_assert(sizeof(DxvkStateCachePackGroup) == 32);
+
+
+  /**
+   * \brief Packed pipeline entry
+   *
+   * Pipeline state is stored in the same layout as a v10
+   * entry minus the shader keys. If \c DeltaBit is set in
+   * \c dataSize, the data is delta-encoded against the
+   * previous entry of the same group.
+   */
+  struct DxvkStateCachePackEntry {
+    constexpr static uint16_t DeltaBit     = 0x8000;
+    constexpr static uint16_t MaxStateSize = 1024;
+
+    uint32_t dataOffset;
+    uint16_t dataSize;
+    uint16_t stateSize;
+  };
+
+  static_assert(sizeof(DxvkStateCachePackEntry) == 8);
+  // NV-DXVK end
+
 
   class DxvkBindingMaskV8 : DxvkBindingSet<128> {
 
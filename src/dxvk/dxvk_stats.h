@@ -18,10 +18,16 @@ namespace dxvk {
     PipeCountGraphics,        ///< Number of graphics pipelines
     PipeCountCompute,         ///< Number of compute pipelines
     PipeCompilerBusy,         ///< Boolean indicating compiler activity
+    PipeCompilerPending,      ///< Number of pipelines queued for async compilation
     QueueSubmitCount,         ///< Number of command buffer submissions
     QueuePresentCount,        ///< Number of present calls / frames
     GpuIdleTicks,             ///< GPU idle time in microseconds
     RtxBlasCount,             ///< Number of unique BLAS's in the scene/geometry cache
+    RtxBlasCompactionSavedMb, ///< Device memory in MB saved by compacting static BLAS's
+    RtxAsyncAccelOperations,  ///< Number of BLAS builds and copies in the last completed async compute batch
+    RtxAsyncAccelGpuTimeUs,   ///< GPU time in microseconds of the last completed async compute batch
+    RtxDeferredBlasBuilds,    ///< Number of static BLAS builds deferred to a later frame by the build budget
+    RtxCulledInstances,       ///< Number of instances culled from the TLAS for being far outside of the camera frustum
     RtxBufferCount,           ///< Number of unique buffers being tracked for RT rendering
     RtxTextureCount,          ///< Number of unique textures being tracked for RT rendering
     RtxInstanceCount,         ///< Number of surfaces and TLAS instance nodes in the scene
@@ -31,6 +37,15 @@ namespace dxvk {
     RtxSamplers,              ///< Number of samplers currently present in the scene
     RtxTexturesInFlight,      ///< Number of texture currently being loaded
     RtxLastTextureBatchDuration, ///< Duration in ms of the last processed texture batch
+    // NV-DXVK start: draw call handoff to the CS thread
+    RtxDrawCallQueueDepth,    ///< Number of draw call states waiting for the CS thread
+    RtxDrawCallQueueStallUs,  ///< Total time in microseconds spent waiting for free draw call slots
+    // NV-DXVK end
+    // NV-DXVK start: Staging ring allocator
+    StagingLastFrameKb,       ///< Staging memory in KB allocated by the context in the previous frame
+    StagingRingBuffers,       ///< Number of buffers in the context's staging ring
+    StagingRingGrowths,       ///< Number of times the context's staging ring grew because its next buffer was still in flight
+    // NV-DXVK end
     NumCounters,              ///< Number of counters available
   };
   
@@ -0,0 +1,212 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <algorithm>
+#include <deque>
+#include <sstream>
+
+#include "dxvk_submit_policy.h"
+
+namespace dxvk {
+
+  // Time window over which the adaptive policy averages GPU idle time
+  constexpr double AdaptiveIdleWindowUs = 8000.0;
+
+  // Idle ratio above which the adaptive policy considers the GPU underutilized
+  constexpr float AdaptiveIdleThreshold = 0.5f;
+
+
+  std::unique_ptr<DxvkSubmitPolicy> DxvkSubmitPolicy::create(
+          DxvkSubmitPolicyType    type,
+    const DxvkSubmitPolicyParams& params) {
+    switch (type) {
+      case DxvkSubmitPolicyType::Batched:
+        return std::make_unique<DxvkSubmitPolicyBatched>(params);
+      case DxvkSubmitPolicyType::Adaptive:
+        return std::make_unique<DxvkSubmitPolicyAdaptive>(params);
+      default:
+        return std::make_unique<DxvkSubmitPolicyImmediate>(params);
+    }
+  }
+
+
+  DxvkSubmitPolicyType DxvkSubmitPolicy::parseType(const std::string& name) {
+    if (name == "batched")
+      return DxvkSubmitPolicyType::Batched;
+    if (name == "adaptive")
+      return DxvkSubmitPolicyType::Adaptive;
+    return DxvkSubmitPolicyType::Immediate;
+  }
+
+
+  bool DxvkSubmitPolicyImmediate::shouldSubmit(const DxvkSubmitPolicyInput& input) {
+    return true;
+  }
+
+
+  bool DxvkSubmitPolicyBatched::shouldSubmit(const DxvkSubmitPolicyInput& input) {
+    if (estimateCost(input) >= m_params.maxBatchCost)
+      return true;
+
+    return input.timeUs - input.lastSubmitUs >= m_params.maxBatchDelayUs;
+  }
+
+
+  bool DxvkSubmitPolicyAdaptive::shouldSubmit(const DxvkSubmitPolicyInput& input) {
+    updateIdleRatio(input);
+
+    // Nothing queued means that the GPU is either
+    // idle already or about to run out of work
+    if (input.pendingSubmissions == 0)
+      return true;
+
+    // Split large batches early if the GPU has spare
+    // capacity so that it does not have to wait for
+    // the entire batch to be recorded
+    uint64_t costLimit = m_params.maxBatchCost;
+
+    if (m_idleRatio > AdaptiveIdleThreshold)
+      costLimit /= 4;
+
+    if (estimateCost(input) >= costLimit)
+      return true;
+
+    // Hold back work for longer the busier the GPU is
+    uint64_t delayUs = uint64_t(double(m_params.maxBatchDelayUs) * (1.0 - double(m_idleRatio)));
+    return input.timeUs - input.lastSubmitUs >= delayUs;
+  }
+
+
+  void DxvkSubmitPolicyAdaptive::updateIdleRatio(const DxvkSubmitPolicyInput& input) {
+    if (input.timeUs > m_lastTimeUs && m_lastTimeUs != 0) {
+      double dt = double(input.timeUs - m_lastTimeUs);
+      double idle = double(input.gpuIdleUs - std::min(input.gpuIdleUs, m_lastIdleUs));
+
+      double sample = std::min(idle / dt, 1.0);
+      double alpha = dt / (dt + AdaptiveIdleWindowUs);
+
+      m_idleRatio = float(double(m_idleRatio) + alpha * (sample - double(m_idleRatio)));
+    }
+
+    m_lastTimeUs = input.timeUs;
+    m_lastIdleUs = input.gpuIdleUs;
+  }
+
+
+  DxvkSubmitSimulatorResult DxvkSubmitSimulator::run(
+          DxvkSubmitPolicy&                   policy,
+    const std::vector<DxvkSubmitTraceEvent>&  events) const {
+    DxvkSubmitSimulatorResult result;
+
+    if (events.empty())
+      return result;
+
+    double gpuFreeAt = double(events.front().timeUs);
+    double gpuIdleUs = 0.0;
+    double gpuBusyUs = 0.0;
+    double latencySum = 0.0;
+    double latencyMax = 0.0;
+
+    std::deque<double> inFlight;
+    std::vector<uint64_t> requests;
+
+    DxvkSubmitPolicyInput batch;
+    batch.lastSubmitUs = events.front().timeUs;
+
+    auto submit = [&] (uint64_t timeUs) {
+      double now = double(timeUs);
+
+      if (now > gpuFreeAt)
+        gpuIdleUs += now - gpuFreeAt;
+
+      double durationUs = m_params.submitOverheadUs
+        + m_params.usPerMiB * double(policy.estimateCost(batch)) / double(1u << 20);
+
+      gpuFreeAt = std::max(now, gpuFreeAt) + durationUs;
+      gpuBusyUs += durationUs;
+
+      for (uint64_t requestUs : requests) {
+        double latency = gpuFreeAt - double(requestUs);
+        latencySum += latency;
+        latencyMax = std::max(latencyMax, latency);
+      }
+
+      inFlight.push_back(gpuFreeAt);
+      requests.clear();
+
+      batch.copiedBytes = 0;
+      batch.commandCount = 0;
+      batch.lastSubmitUs = timeUs;
+
+      result.submitCount += 1;
+    };
+
+    for (const auto& e : events) {
+      double now = double(e.timeUs);
+
+      while (!inFlight.empty() && inFlight.front() <= now)
+        inFlight.pop_front();
+
+      // Events hold the work recorded since the previous request,
+      // so the simulated batch accumulates them until it is submitted
+      batch.timeUs = e.timeUs;
+      batch.copiedBytes += e.copiedBytes;
+      batch.commandCount += e.commandCount;
+      batch.pendingSubmissions = uint32_t(inFlight.size());
+      batch.gpuIdleUs = uint64_t(gpuIdleUs + std::max(now - gpuFreeAt, 0.0));
+
+      requests.push_back(e.timeUs);
+
+      if (policy.shouldSubmit(batch))
+        submit(e.timeUs);
+    }
+
+    if (!requests.empty())
+      submit(events.back().timeUs);
+
+    result.gpuIdleUs = uint64_t(gpuIdleUs);
+    result.gpuBusyUs = uint64_t(gpuBusyUs);
+    result.meanLatencyUs = latencySum / double(events.size());
+    result.maxLatencyUs = uint64_t(latencyMax);
+    return result;
+  }
+
+
+  std::vector<DxvkSubmitTraceEvent> DxvkSubmitSimulator::parseTrace(
+          std::istream&                       stream) {
+    std::vector<DxvkSubmitTraceEvent> events;
+    std::string line;
+
+    while (std::getline(stream, line)) {
+      if (line.empty() || line[0] == '#')
+        continue;
+
+      std::istringstream lineStream(line);
+      DxvkSubmitTraceEvent e;
+
+      if (lineStream >> e.timeUs >> e.copiedBytes >> e.commandCount)
+        events.push_back(e);
+    }
+
+    return events;
+  }
+
+}
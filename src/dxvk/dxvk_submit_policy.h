@@ -0,0 +1,292 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dxvk {
+
+  /**
+   * \brief Submission policy type
+   */
+  enum class DxvkSubmitPolicyType : uint32_t {
+    Immediate,  ///< Submit on every flush request
+    Batched,    ///< Merge flush requests up to a fixed delay or cost
+    Adaptive,   ///< Merge flush requests depending on GPU load
+  };
+
+
+  /**
+   * \brief Submission policy parameters
+   */
+  struct DxvkSubmitPolicyParams {
+    /// Maximum time work may be held back before it is submitted, in us
+    uint64_t maxBatchDelayUs  = 2000;
+    /// Estimated cost at which a batch is submitted regardless of delay
+    uint64_t maxBatchCost     = 16ull << 20;
+    /// Cost of a single draw, dispatch or trace rays command, in bytes
+    uint64_t commandCost      = 4096;
+  };
+
+
+  /**
+   * \brief Submission policy input
+   *
+   * Describes the state of a context and the
+   * GPU at the time a flush was requested.
+   */
+  struct DxvkSubmitPolicyInput {
+    uint64_t timeUs             = 0;  ///< Current time
+    uint64_t lastSubmitUs       = 0;  ///< Time of the last submission from this context
+    uint64_t copiedBytes        = 0;  ///< Bytes copied by the pending command list
+    uint64_t commandCount       = 0;  ///< Draws, dispatches and ray traces in the pending command list
+    uint32_t pendingSubmissions = 0;  ///< Command lists queued or executing on the GPU
+    uint64_t gpuIdleUs          = 0;  ///< Accumulated GPU idle time, monotonically increasing
+  };
+
+
+  /**
+   * \brief Submission policy
+   *
+   * Decides whether a soft flush request should submit
+   * the pending command list, or whether the recorded
+   * work should be merged with subsequent requests.
+   * Policies may keep state across calls, so each
+   * context owns its own policy instance.
+   */
+  class DxvkSubmitPolicy {
+
+  public:
+
+    DxvkSubmitPolicy(const DxvkSubmitPolicyParams& params)
+    : m_params(params) { }
+
+    virtual ~DxvkSubmitPolicy() { }
+
+    /**
+     * \brief Decides whether to submit pending work
+     *
+     * \param [in] input Context and GPU state
+     * \returns \c true if the command list should be submitted
+     */
+    virtual bool shouldSubmit(const DxvkSubmitPolicyInput& input) = 0;
+
+    /**
+     * \brief Estimates the cost of pending work
+     *
+     * \param [in] input Context and GPU state
+     * \returns Estimated cost, in bytes
+     */
+    uint64_t estimateCost(const DxvkSubmitPolicyInput& input) const {
+      return input.copiedBytes + input.commandCount * m_params.commandCost;
+    }
+
+    /**
+     * \brief Creates a submission policy
+     *
+     * \param [in] type Policy type
+     * \param [in] params Policy parameters
+     * \returns Submission policy
+     */
+    static std::unique_ptr<DxvkSubmitPolicy> create(
+            DxvkSubmitPolicyType    type,
+      const DxvkSubmitPolicyParams& params);
+
+    /**
+     * \brief Parses a policy type name
+     *
+     * Accepts \c immediate, \c batched and \c adaptive.
+     * \param [in] name Policy name
+     * \returns Policy type, or \c Immediate if unknown
+     */
+    static DxvkSubmitPolicyType parseType(const std::string& name);
+
+  protected:
+
+    DxvkSubmitPolicyParams m_params;
+
+  };
+
+
+  /**
+   * \brief Immediate submission policy
+   *
+   * Submits on every request. This
+   * matches a regular hard flush.
+   */
+  class DxvkSubmitPolicyImmediate : public DxvkSubmitPolicy {
+
+  public:
+
+    using DxvkSubmitPolicy::DxvkSubmitPolicy;
+
+    bool shouldSubmit(const DxvkSubmitPolicyInput& input) override;
+
+  };
+
+
+  /**
+   * \brief Batched submission policy
+   *
+   * Merges requests until either the oldest pending
+   * request is older than the maximum batch delay,
+   * or the pending work exceeds the maximum cost.
+   */
+  class DxvkSubmitPolicyBatched : public DxvkSubmitPolicy {
+
+  public:
+
+    using DxvkSubmitPolicy::DxvkSubmitPolicy;
+
+    bool shouldSubmit(const DxvkSubmitPolicyInput& input) override;
+
+  };
+
+
+  /**
+   * \brief Adaptive submission policy
+   *
+   * Tracks how much of the time the GPU has been idle
+   * since the last request. Work is submitted right away
+   * while the GPU is starving, and merged for up to the
+   * maximum batch delay while the GPU is saturated. Large
+   * batches are split earlier while the GPU is idle in
+   * order to keep it fed.
+   */
+  class DxvkSubmitPolicyAdaptive : public DxvkSubmitPolicy {
+
+  public:
+
+    using DxvkSubmitPolicy::DxvkSubmitPolicy;
+
+    bool shouldSubmit(const DxvkSubmitPolicyInput& input) override;
+
+    /**
+     * \brief Smoothed GPU idle ratio
+     * \returns Ratio of GPU idle time, between 0 and 1
+     */
+    float idleRatio() const {
+      return m_idleRatio;
+    }
+
+  private:
+
+    uint64_t  m_lastTimeUs    = 0;
+    uint64_t  m_lastIdleUs    = 0;
+    float     m_idleRatio     = 1.0f;
+
+    void updateIdleRatio(const DxvkSubmitPolicyInput& input);
+
+  };
+
+
+  /**
+   * \brief Recorded flush request
+   *
+   * One line of a submission trace, as written
+   * when \c dxvk.submitTraceFile is set. The work
+   * is the one recorded since the previous request,
+   * not the total of the pending command list.
+   */
+  struct DxvkSubmitTraceEvent {
+    uint64_t timeUs       = 0;  ///< Time of the request
+    uint64_t copiedBytes  = 0;  ///< Bytes copied since the previous request
+    uint64_t commandCount = 0;  ///< Commands recorded since the previous request
+  };
+
+
+  /**
+   * \brief Simulated GPU parameters
+   */
+  struct DxvkSubmitSimulatorParams {
+    /// Fixed GPU cost of each submission, in us
+    double submitOverheadUs = 20.0;
+    /// GPU time per unit of estimated cost, in us per MiB
+    double usPerMiB         = 50.0;
+  };
+
+
+  /**
+   * \brief Simulation results
+   */
+  struct DxvkSubmitSimulatorResult {
+    uint32_t submitCount    = 0;    ///< Number of submissions
+    uint64_t gpuIdleUs      = 0;    ///< GPU idle time between the first and last event
+    uint64_t gpuBusyUs      = 0;    ///< GPU busy time
+    double   meanLatencyUs  = 0.0;  ///< Average time from request until its work finished
+    uint64_t maxLatencyUs   = 0;    ///< Maximum time from request until its work finished
+  };
+
+
+  /**
+   * \brief Submission policy simulator
+   *
+   * Replays a recorded trace of flush requests against
+   * a policy and a simple GPU model that executes batches
+   * back to back, so that policies can be compared without
+   * running the application or even having a GPU.
+   */
+  class DxvkSubmitSimulator {
+
+  public:
+
+    DxvkSubmitSimulator(const DxvkSubmitSimulatorParams& params)
+    : m_params(params) { }
+
+    /**
+     * \brief Replays a trace
+     *
+     * Any work still pending after the last
+     * event is submitted with a hard flush.
+     * \param [in] policy Policy to evaluate
+     * \param [in] events Recorded flush requests, sorted by time
+     * \returns Simulation results
+     */
+    DxvkSubmitSimulatorResult run(
+            DxvkSubmitPolicy&                   policy,
+      const std::vector<DxvkSubmitTraceEvent>&  events) const;
+
+    /**
+     * \brief Parses a trace file
+     *
+     * Each line contains a time stamp in microseconds, the
+     * number of bytes copied and the number of commands
+     * recorded since the previous request, separated by
+     * whitespace. Lines starting with \c #
+     * are ignored.
+     * \param [in] stream Trace stream
+     * \returns Recorded events
+     */
+    static std::vector<DxvkSubmitTraceEvent> parseTrace(
+            std::istream&                       stream);
+
+  private:
+
+    DxvkSubmitSimulatorParams m_params;
+
+  };
+
+}
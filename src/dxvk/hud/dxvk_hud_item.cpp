@@ -670,6 +670,10 @@ namespace dxvk::hud {
     DxvkStatCounters counters = m_device->getStatCounters();
     bool doShow = counters.getCtr(DxvkStatCounter::PipeCompilerBusy);
 
+    // NV-DXVK start: prioritized pipeline compilation
+    m_pending = counters.getCtr(DxvkStatCounter::PipeCompilerPending);
+    // NV-DXVK end
+
     if (!doShow) {
       auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(time - m_timeShown);
       doShow = elapsed.count() <= MinShowDuration;
@@ -686,10 +690,16 @@ namespace dxvk::hud {
           HudRenderer&      renderer,
           HudPos            position) {
     if (m_show) {
+      // NV-DXVK start: prioritized pipeline compilation
+      std::string text = m_pending
+        ? str::format("Compiling shaders... (", m_pending, " pending)")
+        : std::string("Compiling shaders...");
+
       renderer.drawText(16.0f,
         { position.x, renderer.surfaceSize().height / renderer.scale() - 20.0f },
         { 1.0f, 1.0f, 1.0f, 1.0f },
-        "Compiling shaders...");
+        text);
+      // NV-DXVK end
     }
 
     return position;
@@ -713,6 +723,14 @@ namespace dxvk::hud {
 
     const std::string labels[] = { "# Presents:" , 
                                    "# BLAS:" ,
+                                   "BLAS compaction saved (MB):" ,
+                                   "# Async AS builds/copies:" ,
+                                   "Async AS GPU time (us):" ,
+                                   "# Deferred static BLAS builds:" ,
+                                   "# TLAS culled instances:" ,
+                                   "Staging last frame (KB):" ,
+                                   "# Staging ring buffers:" ,
+                                   "# Staging ring growths:" ,
                                    "# Buffers:" , 
                                    "# Textures:" , 
                                    "# Instances/Surfaces:" , 
@@ -724,6 +742,14 @@ namespace dxvk::hud {
                                    "# Last tex. batch (ms):"}; 
     const uint64_t values[] = { counters.getCtr(DxvkStatCounter::QueuePresentCount),
                                 counters.getCtr(DxvkStatCounter::RtxBlasCount),
+                                counters.getCtr(DxvkStatCounter::RtxBlasCompactionSavedMb),
+                                counters.getCtr(DxvkStatCounter::RtxAsyncAccelOperations),
+                                counters.getCtr(DxvkStatCounter::RtxAsyncAccelGpuTimeUs),
+                                counters.getCtr(DxvkStatCounter::RtxDeferredBlasBuilds),
+                                counters.getCtr(DxvkStatCounter::RtxCulledInstances),
+                                counters.getCtr(DxvkStatCounter::StagingLastFrameKb),
+                                counters.getCtr(DxvkStatCounter::StagingRingBuffers),
+                                counters.getCtr(DxvkStatCounter::StagingRingGrowths),
                                 counters.getCtr(DxvkStatCounter::RtxBufferCount),
                                 counters.getCtr(DxvkStatCounter::RtxTextureCount),
                                 counters.getCtr(DxvkStatCounter::RtxInstanceCount),
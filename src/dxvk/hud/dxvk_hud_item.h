@@ -425,6 +425,9 @@ namespace dxvk::hud {
     Rc<DxvkDevice> m_device;
 
     bool m_show = false;
+    // NV-DXVK start: prioritized pipeline compilation
+    uint64_t m_pending = 0;
+    // NV-DXVK end
 
     dxvk::high_resolution_clock::time_point m_timeShown
       = dxvk::high_resolution_clock::now();
@@ -2797,6 +2797,14 @@ namespace dxvk {
       ImGui::Unindent();
     }
 
+    if (ImGui::CollapsingHeader("Replacement Mesh LOD", collapsingHeaderClosedFlags)) {
+      ImGui::Indent();
+      ImGui::Checkbox("Generate LODs On Mod Load", &RtxOptions::ReplacementMeshLod::enableObject());
+      ImGui::DragFloat("Max Screen Space Error", &RtxOptions::ReplacementMeshLod::maxScreenSpaceErrorObject(), 0.0001f, 0.f, 0.1f, "%.4f");
+      ImGui::DragFloat("Hysteresis", &RtxOptions::ReplacementMeshLod::hysteresisObject(), 0.01f, 0.f, 1.f);
+      ImGui::Unindent();
+    }
+
     if (ImGui::CollapsingHeader("View Distance", collapsingHeaderClosedFlags)) {
       ImGui::Indent();
 
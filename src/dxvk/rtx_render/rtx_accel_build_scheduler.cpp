@@ -0,0 +1,63 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include "rtx_accel_build_scheduler.h"
+
+#include <algorithm>
+
+namespace dxvk {
+
+  float LinearAccelBuildCostModel::estimateBuildTimeMs(AccelBuildKind kind, uint32_t primitiveCount) const {
+    return kCostPerBuildMs + getCostPerPrimitiveMs(kind) * float(primitiveCount);
+  }
+
+  void LinearAccelBuildCostModel::addMeasurement(AccelBuildKind kind, uint32_t numBuilds, uint64_t primitiveCount, float gpuTimeMs) {
+    if (numBuilds == 0 || primitiveCount < kMinMeasuredPrimitives || gpuTimeMs <= 0.f)
+      return;
+
+    const float variableTimeMs = std::max(gpuTimeMs - kCostPerBuildMs * float(numBuilds), 0.f);
+    const float measuredCostPerPrimitiveMs = variableTimeMs / float(primitiveCount);
+
+    float& costPerPrimitiveMs = m_costPerPrimitiveMs[static_cast<uint32_t>(kind)];
+    costPerPrimitiveMs += (measuredCostPerPrimitiveMs - costPerPrimitiveMs) * kMeasurementWeight;
+  }
+
+  void AccelBuildScheduler::beginFrame(float budgetMs) {
+    m_budgetMs = std::max(budgetMs, 0.f);
+    m_scheduledTimeMs = 0.f;
+    m_numScheduledBuilds = 0;
+    m_numDeferredBuilds = 0;
+  }
+
+  bool AccelBuildScheduler::tryScheduleBuild(AccelBuildKind kind, uint32_t primitiveCount) {
+    const float buildTimeMs = m_costModel.estimateBuildTimeMs(kind, primitiveCount);
+    const bool isWithinBudget = m_budgetMs == 0.f || m_scheduledTimeMs + buildTimeMs <= m_budgetMs;
+
+    if (!isWithinBudget && m_numScheduledBuilds > 0) {
+      ++m_numDeferredBuilds;
+      return false;
+    }
+
+    m_scheduledTimeMs += buildTimeMs;
+    ++m_numScheduledBuilds;
+    return true;
+  }
+}
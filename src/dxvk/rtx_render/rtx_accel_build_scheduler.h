@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+
+namespace dxvk {
+
+  // Kind of a BLAS build, builds preferring fast trace take considerably longer than the ones preferring fast build
+  enum class AccelBuildKind : uint32_t {
+    FastTrace = 0,
+    FastBuild,
+
+    Count
+  };
+
+  // Estimates the GPU time of BLAS builds
+  class AccelBuildCostModel {
+  public:
+    virtual ~AccelBuildCostModel() = default;
+
+    // Returns the estimated GPU time in milliseconds of building a BLAS with the given number of primitives
+    virtual float estimateBuildTimeMs(AccelBuildKind kind, uint32_t primitiveCount) const = 0;
+  };
+
+  // Models the GPU time of a build as a fixed cost plus a cost per primitive.
+  // The cost per primitive starts from a conservative estimate and is calibrated online from GPU timestamps taken around sets of builds.
+  class LinearAccelBuildCostModel : public AccelBuildCostModel {
+  public:
+    float estimateBuildTimeMs(AccelBuildKind kind, uint32_t primitiveCount) const override;
+
+    // Feeds back the measured GPU time of a set of builds of the same kind
+    void addMeasurement(AccelBuildKind kind, uint32_t numBuilds, uint64_t primitiveCount, float gpuTimeMs);
+
+    float getCostPerPrimitiveMs(AccelBuildKind kind) const {
+      return m_costPerPrimitiveMs[static_cast<uint32_t>(kind)];
+    }
+
+    // Fixed cost of a build, independent of its size
+    static constexpr float kCostPerBuildMs = 0.01f;
+    // Measurements over fewer primitives are dominated by the fixed cost and timer noise, and are ignored
+    static constexpr uint64_t kMinMeasuredPrimitives = 10000;
+    // Weight of a new measurement in the running average of the cost per primitive
+    static constexpr float kMeasurementWeight = 0.25f;
+
+  private:
+    // Initial costs of roughly 5 ms and 2 ms per million triangles
+    float m_costPerPrimitiveMs[static_cast<uint32_t>(AccelBuildKind::Count)] = { 5.0e-6f, 2.0e-6f };
+  };
+
+  // Spreads BLAS builds across frames, keeping their estimated GPU time within a per-frame budget.
+  // Builds which don't fit are expected to be requested again on a later frame.
+  class AccelBuildScheduler {
+  public:
+    explicit AccelBuildScheduler(const AccelBuildCostModel& costModel)
+      : m_costModel(costModel) { }
+
+    // Starts a new frame with the given GPU time budget, a budget of 0 schedules every build
+    void beginFrame(float budgetMs);
+
+    // Returns true if the build should be made this frame, in which case its estimated time is taken from the budget.
+    // Note: the first build of a frame is always scheduled, so that builds larger than the whole budget still make progress.
+    bool tryScheduleBuild(AccelBuildKind kind, uint32_t primitiveCount);
+
+    float getScheduledTimeMs() const { return m_scheduledTimeMs; }
+    uint32_t getScheduledBuildCount() const { return m_numScheduledBuilds; }
+    uint32_t getDeferredBuildCount() const { return m_numDeferredBuilds; }
+
+  private:
+    const AccelBuildCostModel& m_costModel;
+
+    float m_budgetMs = 0.f;
+    float m_scheduledTimeMs = 0.f;
+    uint32_t m_numScheduledBuilds = 0;
+    uint32_t m_numDeferredBuilds = 0;
+  };
+}
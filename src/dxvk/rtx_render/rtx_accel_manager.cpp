@@ -19,6 +19,8 @@
 * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
 * DEALINGS IN THE SOFTWARE.
 */
+#include <array>
+#include <atomic>
 #include <mutex>
 #include <vector>
 #include <assert.h>
@@ -44,6 +46,7 @@ namespace dxvk {
 
   // Make this static and not a member of AccelManager to make it safe updating the count from ~PooledBlas()
   static int g_blasCount = 0;
+  static std::atomic<VkDeviceSize> g_blasCompactionSavings = 0;
 
   AccelManager::AccelManager(DxvkDevice* device)
     : CommonDeviceObject(device)
@@ -61,10 +64,44 @@ namespace dxvk {
         // only allocated with a 64 byte alignment.
         // Note: This could use the value of m_scratchAlignment, but this is duplicated to avoid potential future initialization order issues.
         device->properties().khrDeviceAccelerationStructureProperties.minAccelerationStructureScratchOffsetAlignment);
+
+    VkQueryPoolCreateInfo queryPoolInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+    queryPoolInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+    queryPoolInfo.queryCount = kMaxPendingBlasCompactions;
+
+    if (m_device->vkd()->vkCreateQueryPool(m_device->handle(), &queryPoolInfo, nullptr, &m_compactionQueryPool) != VK_SUCCESS) {
+      Logger::warn("DxvkRaytrace: failed to create the BLAS compaction query pool, static BLASes will not be compacted");
+      m_compactionQueryPool = VK_NULL_HANDLE;
+    } else {
+      m_freeCompactionQueries.reserve(kMaxPendingBlasCompactions);
+      for (uint32_t i = kMaxPendingBlasCompactions; i > 0; --i)
+        m_freeCompactionQueries.push_back(i - 1);
+    }
+
+    m_asyncBuilder = std::make_unique<RtxAsyncAccelBuilder>(device);
+  }
+
+  void AccelManager::onDestroy() {
+    m_scratchAllocator = nullptr;
+
+    m_pendingCompactions.clear();
+    m_compactionCandidates.clear();
+    m_asyncCompactions.clear();
+
+    // Note: waits for the async compute work still in flight
+    m_asyncBuilder = nullptr;
+
+    if (m_compactionQueryPool != VK_NULL_HANDLE) {
+      m_device->vkd()->vkDestroyQueryPool(m_device->handle(), m_compactionQueryPool, nullptr);
+      m_compactionQueryPool = VK_NULL_HANDLE;
+    }
   }
 
   void AccelManager::clear() {
     m_blasPool.clear();
+    m_activeBlasBuckets.clear();
+    m_blasBucketLookup.clear();
+    m_blasBucketPool.clear();
   }
 
   void AccelManager::garbageCollection() {
@@ -97,6 +134,7 @@ namespace dxvk {
   PooledBlas::~PooledBlas() {
     accelerationStructureReference = 0;
     accelStructure = nullptr;
+    g_blasCompactionSavings -= compactionSavings;
     --g_blasCount;
   }
 
@@ -105,42 +143,53 @@ namespace dxvk {
     return uint32_t(std::max(g_blasCount, 0));
   }
 
-  bool AccelManager::BlasBucket::tryAddInstance(RtInstance* instance) {
-    const uint8_t geometryInstanceMask = instance->getVkInstance().mask;
-    const uint32_t geometryCustomIndexFlags = instance->getVkInstance().instanceCustomIndex & ~uint32_t(CUSTOM_INDEX_SURFACE_MASK);
-    const bool geometryUsesUnorderedApproximations = instance->usesUnorderedApproximations();
-    const VkGeometryInstanceFlagsKHR geometryInstanceFlags = instance->getVkInstance().flags;
-    const uint32_t geometryInstanceShaderBindingTableRecordOffset = instance->getVkInstance().instanceShaderBindingTableRecordOffset;
-
-    if (!geometries.empty()) {
-      if (instanceMask != geometryInstanceMask)
-        return false;
-      if (instanceShaderBindingTableRecordOffset != geometryInstanceShaderBindingTableRecordOffset)
-        return false;
-      if (customIndexFlags != geometryCustomIndexFlags)
-        return false;
-      if (instanceFlags != geometryInstanceFlags)
-        return false;
-      if (usesUnorderedApproximations != geometryUsesUnorderedApproximations)
-        return false;
+  VkDeviceSize AccelManager::getBlasCompactionSavings() {
+    return g_blasCompactionSavings;
+  }
+
+  uint64_t AccelManager::BlasBucket::getMergeKey(const RtInstance& instance) {
+    const VkAccelerationStructureInstanceKHR& vkInstance = instance.getVkInstance();
+    const uint32_t customIndexFlags = vkInstance.instanceCustomIndex & ~uint32_t(CUSTOM_INDEX_SURFACE_MASK);
+
+    // Note: the instance mask and flags are 8 bits wide, the SBT record offset and custom index are 24 bits wide.
+    //       The unordered approximations flag goes into the lowest custom index bit, which belongs to the surface index and is always 0 here.
+    static_assert((CUSTOM_INDEX_SURFACE_MASK & 1) != 0);
+
+    return uint64_t(vkInstance.mask) |
+           uint64_t(vkInstance.flags) << 8 |
+           uint64_t(vkInstance.instanceShaderBindingTableRecordOffset) << 16 |
+           uint64_t(customIndexFlags) << 40 |
+           uint64_t(instance.usesUnorderedApproximations() ? 1 : 0) << 40;
+  }
+
+  void AccelManager::BlasBucket::addInstance(RtInstance* instance) {
+    if (geometries.empty()) {
+      instanceMask = instance->getVkInstance().mask;
+      instanceShaderBindingTableRecordOffset = instance->getVkInstance().instanceShaderBindingTableRecordOffset;
+      customIndexFlags = instance->getVkInstance().instanceCustomIndex & ~uint32_t(CUSTOM_INDEX_SURFACE_MASK);
+      instanceFlags = instance->getVkInstance().flags;
+      usesUnorderedApproximations = instance->usesUnorderedApproximations();
     }
 
     geometries.insert(geometries.end(), instance->buildGeometries.begin(), instance->buildGeometries.end());
     ranges.insert(ranges.end(), instance->buildRanges.begin(), instance->buildRanges.end());
 
-    for (auto& range : instance->buildRanges) {
-      originalInstances.push_back(instance);
+    originalInstances.insert(originalInstances.end(), instance->buildRanges.size(), instance);
+    for (const auto& range : instance->buildRanges)
       primitiveCounts.push_back(range.primitiveCount);
-    }
+
     instanceBillboardIndices.insert(instanceBillboardIndices.end(), instance->billboardIndices.begin(), instance->billboardIndices.end());
     indexOffsets.insert(indexOffsets.end(), instance->indexOffsets.begin(), instance->indexOffsets.end());
+  }
 
-    instanceShaderBindingTableRecordOffset = geometryInstanceShaderBindingTableRecordOffset;
-    instanceMask = geometryInstanceMask;
-    customIndexFlags = geometryCustomIndexFlags;
-    instanceFlags = geometryInstanceFlags;
-    usesUnorderedApproximations = geometryUsesUnorderedApproximations;
-    return true;
+  void AccelManager::BlasBucket::clear() {
+    geometries.clear();
+    ranges.clear();
+    originalInstances.clear();
+    primitiveCounts.clear();
+    instanceBillboardIndices.clear();
+    indexOffsets.clear();
+    reorderedSurfacesOffset = UINT32_MAX;
   }
 
   static void fillGeometryInfoFromBlasEntry(const BlasEntry& blasEntry, RtInstance& instance, const OpacityMicromapManager* opacityMicromapManager) {
@@ -290,21 +339,298 @@ namespace dxvk {
     ctx->getCommandList()->trackResource<DxvkAccess::Write>(scratchSlice.buffer());
   }
 
-  Rc<PooledBlas> AccelManager::createPooledBlas(size_t bufferSize) const {
-    auto newBlas = new PooledBlas();
+  bool AccelManager::useAsyncAccelStructureBuilds() const {
+    return RtxOptions::Get()->enableAsyncAccelStructureBuilds() && m_asyncBuilder->isSupported();
+  }
+
+  void AccelManager::adoptAsyncStaticBlas(BlasEntry& blasEntry) {
+    // The vertex data was updated after the build was issued, so the BLAS is stale
+    if (blasEntry.asyncStaticBlasFrameLastUpdated != blasEntry.frameLastUpdated) {
+      releaseAsyncStaticBlas(blasEntry);
+      return;
+    }
+
+    // Keep using the fast build BLAS until the build has completed, never wait for it
+    if (!m_asyncBuilder->isComplete(blasEntry.asyncStaticBlas->asyncTimelineValue))
+      return;
+
+    m_asyncWaitValue = std::max(m_asyncWaitValue, blasEntry.asyncStaticBlas->asyncTimelineValue);
+
+    blasEntry.staticBlas = std::move(blasEntry.asyncStaticBlas);
+    blasEntry.asyncStaticBlas = nullptr;
 
+    if (blasEntry.asyncStaticBlasAllowsCompaction)
+      m_compactionCandidates.push_back(blasEntry.staticBlas);
+  }
+
+  void AccelManager::recycleBlas(const Rc<PooledBlas>& blas) {
+    // Pooled BLASes are rebuilt from scratch on reuse, so they no longer hold any compaction savings
+    blas->compactionPending = false;
+    g_blasCompactionSavings -= blas->compactionSavings;
+    blas->compactionSavings = 0;
+    m_blasPool.push_back(blas);
+  }
+
+  void AccelManager::releaseAsyncStaticBlas(BlasEntry& blasEntry) {
+    // Move the BLAS to the common pool, which doesn't reuse it until its async build has completed
+    if (blasEntry.asyncStaticBlas.ptr()) {
+      recycleBlas(blasEntry.asyncStaticBlas);
+      blasEntry.asyncStaticBlas = nullptr;
+    }
+  }
+
+  void AccelManager::releaseDeferredStaticBlas(BlasEntry& blasEntry) {
+    // Move the BLAS to the common pool, which doesn't reuse it while the previous TLAS may still reference it
+    if (blasEntry.deferredStaticBlas.ptr()) {
+      recycleBlas(blasEntry.deferredStaticBlas);
+      blasEntry.deferredStaticBlas = nullptr;
+    }
+  }
+
+  PooledBlas* AccelManager::buildOrReuseDeferredStaticBlas(Rc<DxvkContext> ctx,
+                                                           DxvkBarrierSet& execBarriers,
+                                                           RtInstance& instance,
+                                                           BlasEntry& blasEntry,
+                                                           XXH64_hash_t boundOpacityMicromapHash,
+                                                           std::vector<VkAccelerationStructureBuildGeometryInfoKHR>& blasToBuild,
+                                                           std::vector<VkAccelerationStructureBuildRangeInfoKHR*>& blasRangesToBuild) {
+    Rc<PooledBlas>& deferredBlas = blasEntry.deferredStaticBlas;
+
+    // Built once and reused until the static BLAS takes over, unless the geometry or its opacity micromap changed since
+    if (deferredBlas.ptr() &&
+        blasEntry.deferredStaticBlasFrameLastUpdated == blasEntry.frameLastUpdated &&
+        deferredBlas->opacityMicromapSourceHash == boundOpacityMicromapHash)
+      return deferredBlas.ptr();
+
+    releaseDeferredStaticBlas(blasEntry);
+
+    VkAccelerationStructureBuildGeometryInfoKHR buildInfo {};
+    buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+    buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
+    buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    buildInfo.geometryCount = 1;
+    buildInfo.pGeometries = instance.buildGeometries.data();
+
+    VkAccelerationStructureBuildSizesInfoKHR sizeInfo {};
+    sizeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+    m_device->vkd()->vkGetAccelerationStructureBuildSizesKHR(m_device->handle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+                                                             &buildInfo, &instance.buildRanges[0].primitiveCount, &sizeInfo);
+
+    deferredBlas = createPooledBlas(sizeInfo.accelerationStructureSize);
+    deferredBlas->opacityMicromapSourceHash = boundOpacityMicromapHash;
+    blasEntry.deferredStaticBlasFrameLastUpdated = blasEntry.frameLastUpdated;
+
+    buildInfo.dstAccelerationStructure = deferredBlas->accelStructure->getAccelStructure();
+
+    // Allocate a scratch buffer slice
+    const DxvkBufferSlice scratchSlice = m_scratchAllocator->alloc(m_scratchAlignment, sizeInfo.buildScratchSize + m_scratchAlignment);
+    buildInfo.scratchData.deviceAddress = scratchSlice.getDeviceAddress();
+
+    assert(buildInfo.scratchData.deviceAddress % m_scratchAlignment == 0); // Note: Required by the Vulkan specification.
+
+    // Put the BLAS into the build queue
+    blasToBuild.push_back(buildInfo);
+    blasRangesToBuild.push_back(&instance.buildRanges[0]);
+
+    // Track the lifetime of the scratch and BLAS buffers
+    ctx->getCommandList()->trackResource<DxvkAccess::Write>(scratchSlice.buffer());
+    ctx->getCommandList()->trackResource<DxvkAccess::Read>(scratchSlice.buffer());
+    ctx->getCommandList()->trackResource<DxvkAccess::Write>(deferredBlas->accelStructure);
+
+    // Track the lifetime and states of the source geometry buffers
+    trackBlasBuildResources(ctx, execBarriers, &blasEntry);
+
+    return deferredBlas.ptr();
+  }
+
+  Rc<DxvkAccelStructure> AccelManager::createBlasAccelStructure(size_t bufferSize, DxvkMemoryStats::Category category) const {
     DxvkBufferCreateInfo bufferCreateInfo {};
     bufferCreateInfo.size = bufferSize;
     bufferCreateInfo.access = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
     bufferCreateInfo.stages = VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
     bufferCreateInfo.usage = VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
-    newBlas->accelStructure = m_device->createAccelStructure(bufferCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR);
 
+    return m_device->createAccelStructure(bufferCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR, category);
+  }
+
+  Rc<PooledBlas> AccelManager::createPooledBlas(size_t bufferSize) const {
+    auto newBlas = new PooledBlas();
+
+    newBlas->accelStructure = createBlasAccelStructure(bufferSize, DxvkMemoryStats::Category::RTXAccelerationStructure);
     newBlas->accelerationStructureReference = newBlas->accelStructure->getAccelDeviceAddress();
 
     return newBlas;
   }
 
+  void AccelManager::queryCompactedBlasSizes(Rc<DxvkContext> ctx) {
+    if (m_compactionCandidates.empty())
+      return;
+
+    ScopedGpuProfileZone(ctx, "queryCompactedBLASSizes");
+
+    // The compacted size is only available once the build has completed
+    ctx->emitMemoryBarrier(0,
+      VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+      VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR,
+      VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+      VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR);
+
+    const uint32_t currentFrame = m_device->getCurrentFrameId();
+
+    for (const Rc<PooledBlas>& blas : m_compactionCandidates) {
+      // Out of queries, the remaining BLASes simply stay uncompacted
+      if (m_freeCompactionQueries.empty())
+        break;
+
+      const uint32_t queryIndex = m_freeCompactionQueries.back();
+      m_freeCompactionQueries.pop_back();
+
+      // Note: a free query is either unused or its previous result has been read back already, so it is safe to reset it from the host
+      m_device->vkd()->vkResetQueryPool(m_device->handle(), m_compactionQueryPool, queryIndex, 1);
+
+      const VkAccelerationStructureKHR accelStructure = blas->accelStructure->getAccelStructure();
+      ctx->getCommandList()->vkCmdWriteAccelerationStructuresPropertiesKHR(1, &accelStructure, VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR,
+                                                                           m_compactionQueryPool, queryIndex);
+
+      blas->compactionPending = true;
+      m_pendingCompactions.push_back({ blas, blas->accelStructure, queryIndex, currentFrame });
+    }
+
+    m_compactionCandidates.clear();
+  }
+
+  void AccelManager::compactStaticBlases(Rc<DxvkContext> ctx) {
+    // Swap in the BLASes whose compaction copies on the async compute queue have completed
+    for (uint32_t i = 0; i < m_asyncCompactions.size();) {
+      AsyncBlasCompaction& compaction = m_asyncCompactions[i];
+      PooledBlas& blas = *compaction.blas;
+
+      if (!m_asyncBuilder->isComplete(blas.asyncTimelineValue)) {
+        ++i;
+        continue;
+      }
+
+      // The BLAS may have been released to the pool since the copy was recorded, the compacted copy is dropped then
+      if (blas.compactionPending && blas.accelStructure == compaction.sourceAccelStructure) {
+        blas.compactionPending = false;
+        m_asyncWaitValue = std::max(m_asyncWaitValue, blas.asyncTimelineValue);
+
+        swapInCompactedBlas(blas, std::move(compaction.compactedAccelStructure));
+      }
+
+      std::swap(compaction, m_asyncCompactions.back());
+      m_asyncCompactions.pop_back();
+    }
+
+    if (m_pendingCompactions.empty())
+      return;
+
+    ScopedGpuProfileZone(ctx, "compactBLAS");
+
+    const uint32_t currentFrame = m_device->getCurrentFrameId();
+    const uint32_t numFramesToDelay = std::max(1u, RtxOptions::Get()->numFramesToDelayBLASCompaction());
+    const bool useAsync = useAsyncAccelStructureBuilds();
+
+    for (uint32_t i = 0; i < m_pendingCompactions.size();) {
+      BlasCompactionRequest& request = m_pendingCompactions[i];
+
+      if (request.frameQueried + numFramesToDelay > currentFrame) {
+        ++i;
+        continue;
+      }
+
+      // The async compute queue may only read the BLAS once the graphics queue work which built it has completed
+      if (useAsync && request.sourceAccelStructure->isInUse(DxvkAccess::Write)) {
+        ++i;
+        continue;
+      }
+
+      // Never wait on the query, just try again next frame if the result isn't there yet
+      uint64_t compactedSize = 0;
+      const VkResult result = m_device->vkd()->vkGetQueryPoolResults(m_device->handle(), m_compactionQueryPool, request.queryIndex, 1,
+                                                                     sizeof(compactedSize), &compactedSize, sizeof(compactedSize), VK_QUERY_RESULT_64_BIT);
+
+      if (result == VK_NOT_READY) {
+        ++i;
+        continue;
+      }
+
+      m_freeCompactionQueries.push_back(request.queryIndex);
+
+      // The BLAS may have been released to the pool (and rebuilt with other geometry) since the query was issued
+      PooledBlas& blas = *request.blas;
+      const bool isRequestValid = blas.compactionPending && blas.accelStructure == request.sourceAccelStructure;
+
+      if (isRequestValid) {
+        blas.compactionPending = false;
+
+        if (result == VK_SUCCESS && compactedSize > 0 && compactedSize < blas.accelStructure->info().size)
+          compactBlas(ctx, request.blas, compactedSize);
+      }
+
+      std::swap(request, m_pendingCompactions.back());
+      m_pendingCompactions.pop_back();
+    }
+  }
+
+  void AccelManager::compactBlas(Rc<DxvkContext> ctx, const Rc<PooledBlas>& blas, VkDeviceSize compactedSize) {
+    Rc<DxvkAccelStructure> compactedAccelStructure = createBlasAccelStructure(compactedSize, DxvkMemoryStats::Category::RTXCompactedAccelerationStructure);
+
+    VkCopyAccelerationStructureInfoKHR copyInfo = { VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR };
+    copyInfo.src = blas->accelStructure->getAccelStructure();
+    copyInfo.dst = compactedAccelStructure->getAccelStructure();
+    copyInfo.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+
+    if (useAsyncAccelStructureBuilds()) {
+      const VkCommandBuffer cmdBuf = m_asyncBuilder->getCmdBuffer();
+
+      {
+        ScopedGpuProfileZoneQ(m_device, cmdBuf, asyncCompute, "compactBLAS");
+        m_device->vkd()->vkCmdCopyAccelerationStructureKHR(cmdBuf, &copyInfo);
+      }
+
+      m_asyncBuilder->trackResource<DxvkAccess::Read>(blas->accelStructure);
+      m_asyncBuilder->trackResource<DxvkAccess::Write>(compactedAccelStructure);
+      m_asyncBuilder->countOperation();
+
+      // The original keeps being used until the copy has completed, and must not be rebuilt while it is being read
+      blas->compactionPending = true;
+      blas->asyncTimelineValue = m_asyncBuilder->getRecordingValue();
+
+      m_asyncCompactions.push_back({ blas, blas->accelStructure, std::move(compactedAccelStructure) });
+      return;
+    }
+
+    ctx->getCommandList()->vkCmdCopyAccelerationStructureKHR(&copyInfo);
+
+    ctx->getCommandList()->trackResource<DxvkAccess::Read>(blas->accelStructure);
+    ctx->getCommandList()->trackResource<DxvkAccess::Write>(compactedAccelStructure);
+
+    swapInCompactedBlas(*blas, std::move(compactedAccelStructure));
+  }
+
+  void AccelManager::swapInCompactedBlas(PooledBlas& blas, Rc<DxvkAccelStructure>&& compactedAccelStructure) {
+    const VkDeviceSize compactedSize = compactedAccelStructure->info().size;
+
+    // Recycle the original allocation through the common pool.
+    // Note: it is touched in the current frame as the source of the compaction copy recorded now, the pool then doesn't
+    // reuse it until both that copy and the previous frame's TLAS referencing it have retired
+    Rc<PooledBlas> originalBlas = new PooledBlas();
+    originalBlas->accelStructure = blas.accelStructure;
+    originalBlas->accelerationStructureReference = blas.accelerationStructureReference;
+    originalBlas->frameLastTouched = m_device->getCurrentFrameId();
+    m_blasPool.push_back(std::move(originalBlas));
+
+    const VkDeviceSize savings = blas.accelStructure->info().size - compactedSize;
+    blas.compactionSavings += savings;
+    g_blasCompactionSavings += savings;
+
+    // Swap the compacted BLAS in, every instance referencing this BLAS picks up the new address when the TLAS is built
+    blas.accelStructure = std::move(compactedAccelStructure);
+    blas.accelerationStructureReference = blas.accelStructure->getAccelDeviceAddress();
+  }
+
   static void trackBlasBuildResources(Rc<DxvkContext> ctx, DxvkBarrierSet& execBarriers, const BlasEntry* blasEntry) {
     ScopedCpuProfileZone();
     ctx->getCommandList()->trackResource<DxvkAccess::Read>(blasEntry->modifiedGeometryData.positionBuffer.buffer());
@@ -325,6 +651,168 @@ namespace dxvk {
       VK_ACCESS_SHADER_READ_BIT);
   }
 
+  static bool canRefitBlas(const PooledBlas& blas,
+                           const VkAccelerationStructureGeometryKHR& geometry,
+                           const VkAccelerationStructureBuildRangeInfoKHR& buildRange) {
+    // Note: an update must use the same geometry layout and primitive counts as the build it updates,
+    // only the vertex data (and the addresses it is read from) may change.
+    const PooledBlas::RefitState& state = blas.refitState;
+    const VkAccelerationStructureGeometryTrianglesDataKHR& triangles = geometry.geometry.triangles;
+
+    return state.primitiveCount == buildRange.primitiveCount &&
+           state.geometryFlags == geometry.flags &&
+           state.triangles.vertexFormat == triangles.vertexFormat &&
+           state.triangles.vertexStride == triangles.vertexStride &&
+           state.triangles.maxVertex == triangles.maxVertex &&
+           state.triangles.indexType == triangles.indexType;
+  }
+
+  void AccelManager::releaseDynamicBlas(BlasEntry& blasEntry) {
+    // Move the BLASes used by this geometry to the common pool.
+    // This also ensures the resources still being used by the previous TLAS are properly tracked for the next frame
+    if (blasEntry.dynamicBlas.ptr()) {
+      recycleBlas(blasEntry.dynamicBlas);
+      blasEntry.dynamicBlas = nullptr;
+    }
+
+    if (blasEntry.previousDynamicBlas.ptr()) {
+      recycleBlas(blasEntry.previousDynamicBlas);
+      blasEntry.previousDynamicBlas = nullptr;
+    }
+  }
+
+  PooledBlas* AccelManager::buildOrRefitDynamicBlas(Rc<DxvkContext> ctx,
+                                                    DxvkBarrierSet& execBarriers,
+                                                    RtInstance& instance,
+                                                    BlasEntry& blasEntry,
+                                                    std::vector<VkAccelerationStructureBuildGeometryInfoKHR>& blasToBuild,
+                                                    std::vector<VkAccelerationStructureBuildRangeInfoKHR*>& blasRangesToBuild) {
+    const uint32_t currentFrame = m_device->getCurrentFrameId();
+
+    Rc<PooledBlas>& currentBlas = blasEntry.dynamicBlas;
+
+    // Nothing to do if another instance of this geometry already built the BLAS this frame, or if the vertices haven't changed since
+    if (currentBlas.ptr() && (currentBlas->frameLastTouched == currentFrame || blasEntry.frameLastUpdated != currentFrame))
+      return currentBlas.ptr();
+
+    const VkAccelerationStructureGeometryKHR& geometry = instance.buildGeometries[0];
+    VkAccelerationStructureBuildRangeInfoKHR& buildRange = instance.buildRanges[0];
+
+    const AxisAlignedBoundingBox& boundingBox = blasEntry.input.getGeometryData().boundingBox;
+    const float boundingBoxArea = boundingBox.isValid() ? boundingBox.getSurfaceArea() : 0.f;
+
+    // Refit while the topology is unchanged, but rebuild periodically as refits degrade the BLAS quality the more the geometry deforms
+    bool refit = currentBlas.ptr() &&
+                 canRefitBlas(*currentBlas, geometry, buildRange) &&
+                 currentBlas->refitState.refitCount < RtxOptions::Get()->maxBlasRefitsBeforeRebuild();
+
+    if (refit && currentBlas->refitState.boundingBoxArea > 0.f &&
+        boundingBoxArea > currentBlas->refitState.boundingBoxArea * RtxOptions::Get()->maxBlasRefitBoundingBoxGrowth()) {
+      refit = false;
+    }
+
+    VkAccelerationStructureBuildGeometryInfoKHR buildInfo {};
+    buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+    buildInfo.flags = VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR | VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    buildInfo.mode = refit ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    buildInfo.geometryCount = 1;
+    buildInfo.pGeometries = &geometry;
+
+    PooledBlas::RefitState refitState;
+    VkDeviceSize accelerationStructureSize;
+    VkDeviceSize scratchSize;
+
+    if (refit) {
+      refitState = currentBlas->refitState;
+      ++refitState.refitCount;
+
+      accelerationStructureSize = currentBlas->accelStructure->info().size;
+      scratchSize = refitState.updateScratchSize;
+    } else {
+      VkAccelerationStructureBuildSizesInfoKHR sizeInfo {};
+      sizeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+      m_device->vkd()->vkGetAccelerationStructureBuildSizesKHR(m_device->handle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+                                                               &buildInfo, &buildRange.primitiveCount, &sizeInfo);
+
+      refitState.triangles = geometry.geometry.triangles;
+      refitState.geometryFlags = geometry.flags;
+      refitState.primitiveCount = buildRange.primitiveCount;
+      refitState.updateScratchSize = sizeInfo.updateScratchSize;
+      refitState.boundingBoxArea = boundingBoxArea;
+      refitState.refitCount = 0;
+
+      accelerationStructureSize = sizeInfo.accelerationStructureSize;
+      scratchSize = sizeInfo.buildScratchSize;
+    }
+
+    // Write into the other BLAS of the pair so that the one referenced by the previous frame's TLAS stays intact.
+    // Note: +2 because frameLastTouched is unsigned and init'd with UINT32_MAX, see createBlasBuffersAndInstances()
+    Rc<PooledBlas>& targetBlas = blasEntry.previousDynamicBlas;
+
+    if (!targetBlas.ptr() ||
+        targetBlas->accelStructure->info().size < accelerationStructureSize ||
+        targetBlas->frameLastTouched + 2 > currentFrame) {
+      if (targetBlas.ptr())
+        recycleBlas(targetBlas);
+
+      targetBlas = createPooledBlas(accelerationStructureSize);
+    }
+
+    targetBlas->refitState = refitState;
+
+    buildInfo.srcAccelerationStructure = refit ? currentBlas->accelStructure->getAccelStructure() : VK_NULL_HANDLE;
+    buildInfo.dstAccelerationStructure = targetBlas->accelStructure->getAccelStructure();
+
+    // Allocate a scratch buffer slice
+    const DxvkBufferSlice scratchSlice = m_scratchAllocator->alloc(m_scratchAlignment, scratchSize + m_scratchAlignment);
+    buildInfo.scratchData.deviceAddress = scratchSlice.getDeviceAddress();
+
+    assert(buildInfo.scratchData.deviceAddress % m_scratchAlignment == 0); // Note: Required by the Vulkan specification.
+
+    // Put the BLAS into the build queue
+    blasToBuild.push_back(buildInfo);
+    blasRangesToBuild.push_back(&buildRange);
+
+    // Track the lifetime of the scratch and BLAS buffers
+    ctx->getCommandList()->trackResource<DxvkAccess::Write>(scratchSlice.buffer());
+    ctx->getCommandList()->trackResource<DxvkAccess::Read>(scratchSlice.buffer());
+    ctx->getCommandList()->trackResource<DxvkAccess::Write>(targetBlas->accelStructure);
+
+    if (refit)
+      ctx->getCommandList()->trackResource<DxvkAccess::Read>(currentBlas->accelStructure);
+
+    // Track the lifetime and states of the source geometry buffers
+    trackBlasBuildResources(ctx, execBarriers, &blasEntry);
+
+    std::swap(currentBlas, targetBlas);
+
+    return currentBlas.ptr();
+  }
+
+  bool AccelManager::isInstanceOutsideCullingVolume(const RtInstance& instance, const RtCamera& camera, float cullingDistance) {
+    // Only instances of the main camera's world can be culled against it
+    if (!instance.isCameraRegistered(CameraType::Main) ||
+        instance.isCameraRegistered(CameraType::Sky) ||
+        instance.isViewModel())
+      return false;
+
+    // Culling must be conservative, so instances of unknown size are kept
+    const AxisAlignedBoundingBox& boundingBox = instance.getBlas()->input.getGeometryData().boundingBox;
+    if (!boundingBox.isValid())
+      return false;
+
+    const Matrix4 objectToView = camera.getWorldToView(false) * instance.getTransform();
+
+    // Bounding sphere of the bounding box in view space.
+    // Note: the Frobenius norm of the linear part bounds its largest scale for any rotation or shear
+    const Vector4 centerView = objectToView * Vector4((boundingBox.minPos + boundingBox.maxPos) * 0.5f, 1.f);
+    const float maxScale = std::sqrt(lengthSqr(objectToView[0].xyz()) + lengthSqr(objectToView[1].xyz()) + lengthSqr(objectToView[2].xyz()));
+    const float radius = 0.5f * length(boundingBox.maxPos - boundingBox.minPos) * maxScale;
+
+    return !camera.getViewFrustum().CheckSphere(float3(centerView.x, centerView.y, centerView.z), radius + cullingDistance);
+  }
+
   void AccelManager::mergeInstancesIntoBlas(Rc<DxvkContext> ctx, 
                                             DxvkBarrierSet& execBarriers, 
                                             const std::vector<TextureRef>& textures,
@@ -374,8 +862,33 @@ namespace dxvk {
     if (opacityMicromapManager)
       opacityMicromapManager->onFrameStart(ctx);
 
-    std::vector<std::unique_ptr<BlasBucket>> blasBuckets;
-    blasBuckets.reserve(instances.size());
+    // Pick up the async compute work which completed since the last frame
+    m_asyncBuilder->onFrameBegin();
+    m_asyncWaitValue = 0;
+
+    // Calibrate the static BLAS build cost from the builds which completed since the last frame, and start this frame's budget
+    calibrateStaticBlasBuildCost();
+    m_staticBlasBuildScheduler.beginFrame(RtxOptions::Get()->staticBlasBuildBudgetMs());
+    m_staticBlasToBuild.clear();
+    m_staticBlasRangesToBuild.clear();
+    m_staticBlasPrimitivesToBuild = 0;
+
+    // Compact the static BLASes built a few frames ago before their addresses get written into the TLAS instances below
+    compactStaticBlases(ctx);
+
+    for (BlasBucket* bucket : m_activeBlasBuckets)
+      bucket->clear();
+
+    m_activeBlasBuckets.clear();
+    m_blasBucketLookup.clear();
+
+    // Ray portals teleport rays away from the camera, so nothing can be culled while they are active
+    const bool cullInstances = RtxOptions::Get()->enableTlasInstanceCulling() &&
+      cameraManager.isCameraValid(CameraType::Main) &&
+      !m_device->getCommon()->getSceneManager().getRayPortalManager().areAnyRayPortalPairsActive();
+    const float cullingDistance = RtxOptions::Get()->tlasInstanceCullingDistanceMeters() * RtxOptions::Get()->getMeterToWorldUnitScale();
+
+    m_culledInstanceCount = 0;
 
     for (RtInstance* instance : instances) {
       // If the instance has zero mask, do not build BLAS for it: no ray can intersect this instance.
@@ -401,6 +914,18 @@ namespace dxvk {
         continue;
       }
 
+      // Leave the instances no traced ray can reach out of the TLASes.
+      // The surface is kept so that anything referencing it, such as OMM baking or billboards, stays valid.
+      if (cullInstances && isInstanceOutsideCullingVolume(*instance, cameraManager.getMainCamera(), cullingDistance)) {
+        instance->setSurfaceIndex(m_reorderedSurfaces.size());
+
+        m_reorderedSurfaces.push_back(instance);
+        m_reorderedSurfacesFirstIndexOffset.push_back(0);
+
+        ++m_culledInstanceCount;
+        continue;
+      }
+
       // Find the blas entry for this instance.
       // Cannot store BlasEntry* directly in the RtInstance because the entries are owned and potentially moved by the hash table.
       BlasEntry* blasEntry = instance->getBlas();
@@ -431,7 +956,7 @@ namespace dxvk {
         if (forceRebuildStaticBlas) {
           // Move the BLAS used by this geometry to the common pool.
           // This also ensures the static blas resource that's still being used by previous TLAS is properly tracked for the next frame
-          m_blasPool.push_back(blasEntry->staticBlas);
+          recycleBlas(blasEntry->staticBlas);
           blasEntry->staticBlas = nullptr;
         }
       }
@@ -448,9 +973,21 @@ namespace dxvk {
         blasEntry->input.getSkinningState().numBones == 0 &&
         blasEntry->frameCreated == blasEntry->frameLastUpdated;
 
+      PooledBlas* dynamicBlas = nullptr;
+      PooledBlas* deferredStaticBlas = nullptr;
+
       if ((promoteToStaticBlas || forceStaticBlas) &&
            instance->buildGeometries.size() == 1) {
-        if (!blasEntry->staticBlas.ptr()) {
+        // Geometry which stopped animating doesn't need its refit BLAS anymore
+        releaseDynamicBlas(*blasEntry);
+
+        if (blasEntry->asyncStaticBlas.ptr())
+          adoptAsyncStaticBlas(*blasEntry);
+
+        // Note: a static BLAS build which doesn't fit this frame's budget is retried on the next frame,
+        //       meanwhile the instance uses a BLAS built once with the fast build preference, see buildOrReuseDeferredStaticBlas()
+        if (!blasEntry->staticBlas.ptr() && !blasEntry->asyncStaticBlas.ptr() &&
+            m_staticBlasBuildScheduler.tryScheduleBuild(AccelBuildKind::FastTrace, instance->buildRanges[0].primitiveCount)) {
           // Bind opacity micromap
           // Opacity micromaps must be bound before acceleration sizes are calculated
           // Note: since opacity micromaps for this frame are scheduled later 
@@ -468,55 +1005,132 @@ namespace dxvk {
           buildInfo.geometryCount = 1;
           buildInfo.pGeometries = instance->buildGeometries.data();
 
+          const bool compactBlas = RtxOptions::Get()->enableBlasCompaction() && m_compactionQueryPool != VK_NULL_HANDLE;
+
+          if (compactBlas)
+            buildInfo.flags |= VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
+
           // Calculate the build sizes for this static BLAS
           VkAccelerationStructureBuildSizesInfoKHR sizeInfo {};
           sizeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
           m_device->vkd()->vkGetAccelerationStructureBuildSizesKHR(m_device->handle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
                                                                    &buildInfo, &instance->buildRanges[0].primitiveCount, &sizeInfo);
 
-          blasEntry->staticBlas = createPooledBlas(sizeInfo.accelerationStructureSize);
-          blasEntry->staticBlas->opacityMicromapSourceHash = boundOpacityMicromapHash;
+          // Build on the async compute queue when the vertex data isn't written by graphics queue work which is still pending.
+          // Note: opacity micromaps are built on the graphics queue, so BLASes using them are built there too
+          const bool buildAsync = useAsyncAccelStructureBuilds() &&
+            boundOpacityMicromapHash == kEmptyHash &&
+            !blasEntry->modifiedGeometryData.positionBuffer.buffer()->isInUse(DxvkAccess::Write) &&
+            !blasEntry->modifiedGeometryData.indexBuffer.buffer()->isInUse(DxvkAccess::Write);
+
+          if (buildAsync) {
+            Rc<PooledBlas> asyncBlas = createPooledBlas(sizeInfo.accelerationStructureSize);
+            buildInfo.dstAccelerationStructure = asyncBlas->accelStructure->getAccelStructure();
+
+            const VkCommandBuffer cmdBuf = m_asyncBuilder->getCmdBuffer();
+            const DxvkBufferSlice scratchSlice = m_asyncBuilder->allocScratch(sizeInfo.buildScratchSize, m_scratchAlignment);
+            buildInfo.scratchData.deviceAddress = scratchSlice.getDeviceAddress();
+
+            assert(buildInfo.scratchData.deviceAddress % m_scratchAlignment == 0); // Note: Required by the Vulkan specification.
+
+            m_asyncBuilder->beginBuild(instance->buildRanges[0].primitiveCount);
+
+            {
+              ScopedGpuProfileZoneQ(m_device, cmdBuf, asyncCompute, "buildStaticBLAS");
+              const VkAccelerationStructureBuildRangeInfoKHR* pBuildRange = &instance->buildRanges[0];
+              m_device->vkd()->vkCmdBuildAccelerationStructuresKHR(cmdBuf, 1, &buildInfo, &pBuildRange);
+            }
+
+            m_asyncBuilder->trackResource<DxvkAccess::Write>(asyncBlas->accelStructure);
+            m_asyncBuilder->trackResource<DxvkAccess::Read>(blasEntry->modifiedGeometryData.positionBuffer.buffer());
+            m_asyncBuilder->trackResource<DxvkAccess::Read>(blasEntry->modifiedGeometryData.indexBuffer.buffer());
+
+            // The instance keeps using the fast build BLAS until the build has completed, see adoptAsyncStaticBlas()
+            asyncBlas->asyncTimelineValue = m_asyncBuilder->getRecordingValue();
+
+            blasEntry->asyncStaticBlas = std::move(asyncBlas);
+            blasEntry->asyncStaticBlasFrameLastUpdated = blasEntry->frameLastUpdated;
+            blasEntry->asyncStaticBlasAllowsCompaction = compactBlas;
+          } else {
+            blasEntry->staticBlas = createPooledBlas(sizeInfo.accelerationStructureSize);
+            blasEntry->staticBlas->opacityMicromapSourceHash = boundOpacityMicromapHash;
+
+            buildInfo.dstAccelerationStructure = blasEntry->staticBlas->accelStructure->getAccelStructure();
 
-          buildInfo.dstAccelerationStructure = blasEntry->staticBlas->accelStructure->getAccelStructure();
+            // Allocate a scratch buffer slice
+            const DxvkBufferSlice scratchSlice = m_scratchAllocator->alloc(m_scratchAlignment, sizeInfo.buildScratchSize + m_scratchAlignment);
+            buildInfo.scratchData.deviceAddress = scratchSlice.getDeviceAddress();
 
-          // Allocate a scratch buffer slice
-          const DxvkBufferSlice scratchSlice = m_scratchAllocator->alloc(m_scratchAlignment, sizeInfo.buildScratchSize + m_scratchAlignment);
-          buildInfo.scratchData.deviceAddress = scratchSlice.getDeviceAddress();
+            assert(buildInfo.scratchData.deviceAddress % m_scratchAlignment == 0); // Note: Required by the Vulkan specification.
 
-          assert(buildInfo.scratchData.deviceAddress % m_scratchAlignment == 0); // Note: Required by the Vulkan specification.
+            // Put the new BLAS into the static build queue, it's built separately from the per-frame BLASes to be timed
+            m_staticBlasToBuild.push_back(buildInfo);
+            m_staticBlasRangesToBuild.push_back(&instance->buildRanges[0]);
+            m_staticBlasPrimitivesToBuild += instance->buildRanges[0].primitiveCount;
 
-          // Put the new BLAS into the build queue
-          blasToBuild.push_back(buildInfo);
-          blasRangesToBuild.push_back(&instance->buildRanges[0]);
+            // Track the lifetime of the scratch and BLAS buffers
+            ctx->getCommandList()->trackResource<DxvkAccess::Write>(scratchSlice.buffer());
+            ctx->getCommandList()->trackResource<DxvkAccess::Read>(scratchSlice.buffer());
+            ctx->getCommandList()->trackResource<DxvkAccess::Write>(blasEntry->staticBlas->accelStructure);
 
-          // Track the lifetime of the scratch and BLAS buffers
-          ctx->getCommandList()->trackResource<DxvkAccess::Write>(scratchSlice.buffer());
-          ctx->getCommandList()->trackResource<DxvkAccess::Read>(scratchSlice.buffer());
-          ctx->getCommandList()->trackResource<DxvkAccess::Write>(blasEntry->staticBlas->accelStructure);
+            // Track the lifetime and states of the source geometry buffers
+            trackBlasBuildResources(ctx, execBarriers, blasEntry);
 
-          // Track the lifetime and states of the source geometry buffers
-          trackBlasBuildResources(ctx, execBarriers, blasEntry);
+            if (compactBlas)
+              m_compactionCandidates.push_back(blasEntry->staticBlas);
+          }
+        }
+
+        // The geometry isn't merged while its static BLAS is deferred or in flight, since the merged BLASes are rebuilt every frame
+        if (blasEntry->staticBlas.ptr()) {
+          releaseDeferredStaticBlas(*blasEntry);
+        } else {
+          if (!hasTriedToBindOpacityMicromap && opacityMicromapManager) {
+            boundOpacityMicromapHash = opacityMicromapManager->tryBindOpacityMicromap(ctx, *instance, 0, instance->buildGeometries[0], instanceManager);
+            hasTriedToBindOpacityMicromap = true;
+          }
+
+          deferredStaticBlas = buildOrReuseDeferredStaticBlas(ctx, execBarriers, *instance, *blasEntry, boundOpacityMicromapHash,
+                                                              blasToBuild, blasRangesToBuild);
         }
       } else { // Non-static blas instance
         // Previously static BLAS is no longer considered static (i.e. because it started getting animated)
         if (blasEntry->staticBlas.ptr()) {
           // Move the BLAS used by this geometry to the common pool.
           // This also ensures the static blas resource that's still being used by previous TLAS is properly tracked for the next frame
-          m_blasPool.push_back(blasEntry->staticBlas);
+          recycleBlas(blasEntry->staticBlas);
           blasEntry->staticBlas = nullptr;
         }
+
+        releaseAsyncStaticBlas(*blasEntry);
+        releaseDeferredStaticBlas(*blasEntry);
+
+        // Large animated geometry gets its own BLAS which is refit rather than merged and rebuilt every frame.
+        // Note: instances using opacity micromaps are excluded since micromap bindings may change between frames, which requires a rebuild.
+        const bool useDynamicBlas = RtxOptions::Get()->enableBlasRefit() &&
+          blasPrims >= RtxOptions::Get()->minPrimsInRefitBLAS() &&
+          instance->buildGeometries.size() == 1 &&
+          !(opacityMicromapManager && opacityMicromapManager->doesInstanceUseOpacityMicromap(*instance));
+
+        if (useDynamicBlas)
+          dynamicBlas = buildOrRefitDynamicBlas(ctx, execBarriers, *instance, *blasEntry, blasToBuild, blasRangesToBuild);
+        else
+          releaseDynamicBlas(*blasEntry);
       }
 
-      if (blasEntry->staticBlas.ptr()) {
-        // Create an instance for this static BLAS
+      PooledBlas* instanceBlas = blasEntry->staticBlas.ptr() ? blasEntry->staticBlas.ptr() :
+                                 dynamicBlas ? dynamicBlas : deferredStaticBlas;
+
+      if (instanceBlas) {
+        // Create an instance for this static, dynamic or deferred static BLAS
         VkAccelerationStructureInstanceKHR blasInstance = instance->getVkInstance();
-        blasInstance.accelerationStructureReference = blasEntry->staticBlas->accelerationStructureReference;
+        blasInstance.accelerationStructureReference = instanceBlas->accelerationStructureReference;
         blasInstance.instanceCustomIndex =
           (blasInstance.instanceCustomIndex & ~uint32_t(CUSTOM_INDEX_SURFACE_MASK)) |
           uint32_t(m_reorderedSurfaces.size()) & uint32_t(CUSTOM_INDEX_SURFACE_MASK);
 
         // Get the instance's flags and apply the objectToWorldMirrored flag.
-        // This flag should only be applied to static BLAS.
+        // This flag should only be applied to BLASes built in object space, i.e. not merged ones.
         if (instance->isObjectToWorldMirrored())
           blasInstance.flags ^= VK_GEOMETRY_INSTANCE_TRIANGLE_FLIP_FACING_BIT_KHR;
 
@@ -530,9 +1144,9 @@ namespace dxvk {
         m_reorderedSurfaces.push_back(instance);
         m_reorderedSurfacesFirstIndexOffset.push_back(0);
 
-        blasEntry->staticBlas->frameLastTouched = currentFrame;
+        instanceBlas->frameLastTouched = currentFrame;
 
-        ctx->getCommandList()->trackResource<DxvkAccess::Read>(blasEntry->staticBlas->accelStructure);
+        ctx->getCommandList()->trackResource<DxvkAccess::Read>(instanceBlas->accelStructure);
       }
       else {
         // Calculate the device address for the current instance's transform and write the transform data
@@ -544,23 +1158,20 @@ namespace dxvk {
         for (auto& geometry : instance->buildGeometries)  
           geometry.geometry.triangles.transformData.deviceAddress = transformDeviceAddress;
 
-        // Try to merge the instance into one of the blasBuckets
-        bool merged = false;
-        for (auto& bucket : blasBuckets) {
-          if (bucket->tryAddInstance(instance)) {
-            merged = true;
-            break;
-          }
-        }
-        // The instance couldn't be merged into any bucket - make a new one
-        if (!merged) {
-          auto newBucket = std::make_unique<BlasBucket>();
-          merged = newBucket->tryAddInstance(instance);
-          assert(merged);
+        // Merge the instance into the bucket of instances with the same mask etc.
+        BlasBucket*& bucket = m_blasBucketLookup[BlasBucket::getMergeKey(*instance)];
+
+        // There is no such bucket yet - take the next one from the pool
+        if (!bucket) {
+          if (m_activeBlasBuckets.size() == m_blasBucketPool.size())
+            m_blasBucketPool.push_back(std::make_unique<BlasBucket>());
 
-          blasBuckets.push_back(std::move(newBucket));
+          bucket = m_blasBucketPool[m_activeBlasBuckets.size()].get();
+          m_activeBlasBuckets.push_back(bucket);
         }
 
+        bucket->addInstance(instance);
+
         // Track the lifetime and states of the source geometry buffers
         trackBlasBuildResources(ctx, execBarriers, blasEntry);
       }
@@ -584,7 +1195,7 @@ namespace dxvk {
       VK_ACCESS_SHADER_READ_BIT);
 
     // Collect all the surfaces
-    for (const auto& blasBucket : blasBuckets) {
+    for (BlasBucket* blasBucket : m_activeBlasBuckets) {
       // Store the offset to use it later during blas instance creation
       blasBucket->reorderedSurfacesOffset = static_cast<uint32_t>(m_reorderedSurfaces.size());
 
@@ -613,19 +1224,26 @@ namespace dxvk {
       totalPrimitiveIDOffset += primitiveCount;
     }
 
+    // Kick off the async compute work recorded above, it overlaps with the rest of the frame's graphics queue work
+    m_asyncBuilder->submit();
+
+    // The graphics queue uses the results of async work which has completed already, this wait is only there to make its writes visible
+    if (m_asyncWaitValue > 0)
+      ctx->getCommandList()->addWaitSemaphore(m_asyncBuilder->getSemaphore(), m_asyncWaitValue);
+
     buildBlases(ctx, execBarriers, cameraManager, opacityMicromapManager, instanceManager, 
-                textures, instances, blasBuckets, blasToBuild, blasRangesToBuild, frameTimeSecs);
+                textures, instances, m_activeBlasBuckets, blasToBuild, blasRangesToBuild, frameTimeSecs);
   }
 
   void AccelManager::createBlasBuffersAndInstances(Rc<DxvkContext> ctx, 
-                                                   const std::vector<std::unique_ptr<BlasBucket>>& blasBuckets,
+                                                   const std::vector<BlasBucket*>& blasBuckets,
                                                    std::vector<VkAccelerationStructureBuildGeometryInfoKHR>& blasToBuild,
                                                    std::vector<VkAccelerationStructureBuildRangeInfoKHR*>& blasRangesToBuild) {
 
     const uint32_t currentFrame = m_device->getCurrentFrameId();
 
     // Create or find a matching BLAS for each bucket, then build it
-    for (const auto& bucket : blasBuckets) {
+    for (const BlasBucket* bucket : blasBuckets) {
       // Fill out the build info
       VkAccelerationStructureBuildGeometryInfoKHR buildInfo {};
       buildInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
@@ -647,6 +1265,7 @@ namespace dxvk {
         size_t bufferSize = blas->accelStructure->info().size;
         if (bufferSize >= sizeInfo.accelerationStructureSize &&
             (!selectedBlas || bufferSize < selectedBlas->accelStructure->info().size) &&
+            m_asyncBuilder->isComplete(blas->asyncTimelineValue) &&
             blas->frameLastTouched + 2 <= currentFrame) /* note: +2 because frameLastTouched is unsigned and init'd with UINT32_MAX, and keep the BLAS'es for one extra frame for previous TLAS access */
         {
           selectedBlas = blas.ptr();
@@ -706,6 +1325,62 @@ namespace dxvk {
     }
   }
 
+  // Uploads the records of data which differ from the previously uploaded data, then swaps data into uploadedData.
+  // Nearby dirty records are coalesced into one upload, and everything between the first and last dirty records is uploaded at once
+  // when the changes are too scattered.
+  static void updateBufferSparse(Rc<DxvkContext> ctx,
+                                 const Rc<DxvkBuffer>& buffer,
+                                 const bool bufferReallocated,
+                                 const size_t recordSize,
+                                 std::vector<uint8_t>& data,
+                                 std::vector<uint8_t>& uploadedData) {
+    constexpr size_t kMaxGapRecords = 4;
+    constexpr size_t kMaxUploads = 32;
+
+    struct Range {
+      size_t begin;
+      size_t end;
+    };
+
+    assert(data.size() % recordSize == 0);
+
+    const size_t numRecords = data.size() / recordSize;
+    const size_t numUploadedRecords = bufferReallocated ? 0 : std::min(data.size(), uploadedData.size()) / recordSize;
+
+    std::array<Range, kMaxUploads> ranges;
+    size_t numRanges = 0;
+    bool tooScattered = false;
+
+    for (size_t i = 0; i < numRecords; ++i) {
+      const bool isDirty = i >= numUploadedRecords ||
+                           memcmp(data.data() + i * recordSize, uploadedData.data() + i * recordSize, recordSize) != 0;
+      if (!isDirty)
+        continue;
+
+      if (numRanges > 0 && i - ranges[numRanges - 1].end <= kMaxGapRecords) {
+        ranges[numRanges - 1].end = i + 1;
+      } else if (numRanges < kMaxUploads) {
+        ranges[numRanges++] = { i, i + 1 };
+      } else {
+        ranges[numRanges - 1].end = i + 1;
+        tooScattered = true;
+      }
+    }
+
+    if (tooScattered) {
+      ranges[0].end = ranges[numRanges - 1].end;
+      numRanges = 1;
+    }
+
+    for (size_t i = 0; i < numRanges; ++i) {
+      const VkDeviceSize offset = ranges[i].begin * recordSize;
+      const VkDeviceSize size = (ranges[i].end - ranges[i].begin) * recordSize;
+      ctx->updateBuffer(buffer, offset, size, data.data() + offset);
+    }
+
+    std::swap(data, uploadedData);
+  }
+
   void AccelManager::prepareSceneData(Rc<DxvkContext> ctx, DxvkBarrierSet& execBarriers, InstanceManager& instanceManager) {
     ScopedCpuProfileZone();
     bool haveInstances = false;
@@ -800,20 +1475,27 @@ namespace dxvk {
     }
     info.size = align(info.size * sizeof(VkAccelerationStructureInstanceKHR), kBufferAlignment);
 
-    if (m_vkInstanceBuffer == nullptr || info.size > m_vkInstanceBuffer->info().size) {
+    const bool instanceBufferReallocated = m_vkInstanceBuffer == nullptr || info.size > m_vkInstanceBuffer->info().size;
+
+    if (instanceBufferReallocated) {
       m_vkInstanceBuffer = m_device->createBuffer(info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DxvkMemoryStats::Category::RTXAccelerationStructure);
       Logger::debug("DxvkRaytrace: Vulkan AS Instance Realloc");
     }
 
     // Write instance data
+    // Note: only the instances which changed since the last frame are uploaded, which in a mostly static scene are few
     size_t offset = 0;
+    m_instanceGPUData.resize(info.size);
     for (const auto& instances : m_mergedInstances) {
       if (!instances.empty()) {
         const size_t size = instances.size() * sizeof(VkAccelerationStructureInstanceKHR);
-        ctx->updateBuffer(m_vkInstanceBuffer, offset, size, instances.data());
+        memcpy(m_instanceGPUData.data() + offset, instances.data(), size);
         offset += size;
       }
     }
+    m_instanceGPUData.resize(offset);
+
+    updateBufferSparse(ctx, m_vkInstanceBuffer, instanceBufferReallocated, sizeof(VkAccelerationStructureInstanceKHR), m_instanceGPUData, m_uploadedInstanceGPUData);
 
     // Vk billboard buffer
     if (numActiveBillboards) {
@@ -842,27 +1524,31 @@ namespace dxvk {
     info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
     info.access = VK_ACCESS_TRANSFER_WRITE_BIT;
     info.size = align(surfacesGPUSize, kBufferAlignment);
-    if (m_surfaceBuffer == nullptr || info.size > m_surfaceBuffer->info().size) {
+
+    const bool surfaceBufferReallocated = m_surfaceBuffer == nullptr || info.size > m_surfaceBuffer->info().size;
+
+    if (surfaceBufferReallocated) {
       m_surfaceBuffer = m_device->createBuffer(info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DxvkMemoryStats::Category::RTXAccelerationStructure);
     }
 
     // Write surface data
     std::size_t dataOffset = 0;
-    std::vector<unsigned char> surfacesGPUData(surfacesGPUSize);
+    m_surfaceGPUData.resize(surfacesGPUSize);
 
     for (uint32_t i = 0; i < m_reorderedSurfaces.size(); ++i) {
       const auto& currentInstance = *m_reorderedSurfaces[i];
 
       // Split instance geometry need to have their first index offset set in their corresponding surface instances
       m_reorderedSurfaces[i]->surface.firstIndex += m_reorderedSurfacesFirstIndexOffset[i];
-      currentInstance.surface.writeGPUData(surfacesGPUData.data(), dataOffset);
+      currentInstance.surface.writeGPUData(m_surfaceGPUData.data(), dataOffset);
       m_reorderedSurfaces[i]->surface.firstIndex -= m_reorderedSurfacesFirstIndexOffset[i];
     }
 
     assert(dataOffset == surfacesGPUSize);
-    assert(surfacesGPUData.size() == surfacesGPUSize);
+    assert(m_surfaceGPUData.size() == surfacesGPUSize);
 
-    ctx->updateBuffer(m_surfaceBuffer, 0, surfacesGPUData.size(), surfacesGPUData.data());
+    // Only upload the surfaces which changed since the last frame
+    updateBufferSparse(ctx, m_surfaceBuffer, surfaceBufferReallocated, kSurfaceGPUSize, m_surfaceGPUData, m_uploadedSurfaceGPUData);
 
     // Find the size of the surface mapping buffer
     uint32_t maxPreviousSurfaceIndex = 0;
@@ -918,7 +1604,7 @@ namespace dxvk {
                                  const InstanceManager& instanceManager,
                                  const std::vector<TextureRef>& textures,
                                  const std::vector<RtInstance*>& instances,
-                                 const std::vector<std::unique_ptr<BlasBucket>>& blasBuckets,
+                                 const std::vector<BlasBucket*>& blasBuckets,
                                  std::vector<VkAccelerationStructureBuildGeometryInfoKHR>& blasToBuild,
                                  std::vector<VkAccelerationStructureBuildRangeInfoKHR*>& blasRangesToBuild,
                                  float frameTimeSecs) {
@@ -931,7 +1617,7 @@ namespace dxvk {
       opacityMicromapManager->buildOpacityMicromaps(ctx, textures, cameraManager.getLastCameraCutFrameId(), frameTimeSecs);
 
       // Bind opacity micromaps
-      for (auto& blasBucket : blasBuckets) {
+      for (BlasBucket* blasBucket : blasBuckets) {
         for (uint32_t i = 0; i < blasBucket->geometries.size(); i++) {
           opacityMicromapManager->tryBindOpacityMicromap(ctx, *blasBucket->originalInstances[i], blasBucket->instanceBillboardIndices[i],
                                                          blasBucket->geometries[i], instanceManager);
@@ -949,11 +1635,78 @@ namespace dxvk {
     //  o Opacity micromap generation above
     execBarriers.recordCommands(ctx->getCommandList());
 
+    buildStaticBlases(ctx);
+
     // Build the BLASes
     if (!blasToBuild.empty()) {
       assert(blasToBuild.size() == blasRangesToBuild.size());
       ctx->vkCmdBuildAccelerationStructuresKHR(blasToBuild.size(), blasToBuild.data(), blasRangesToBuild.data());
     }
+
+    queryCompactedBlasSizes(ctx);
+  }
+
+  void AccelManager::calibrateStaticBlasBuildCost() {
+    std::vector<RtxAsyncAccelBuilder::BuildTiming> completedBuildTimings;
+    m_asyncBuilder->popCompletedBuildTimings(completedBuildTimings);
+
+    for (const RtxAsyncAccelBuilder::BuildTiming& timing : completedBuildTimings)
+      m_staticBlasBuildCostModel.addMeasurement(AccelBuildKind::FastTrace, timing.numBuilds, timing.primitiveCount, timing.gpuTimeMs);
+
+    const double timestampPeriodMs = double(m_device->adapter()->deviceProperties().limits.timestampPeriod) / 1000000.0;
+
+    auto timing = m_pendingStaticBlasBuildTimings.begin();
+
+    while (timing != m_pendingStaticBlasBuildTimings.end()) {
+      DxvkQueryData beginData = {};
+      DxvkQueryData endData = {};
+
+      const DxvkGpuQueryStatus beginStatus = timing->begin->getData(beginData);
+      const DxvkGpuQueryStatus endStatus = timing->end->getData(endData);
+
+      if (beginStatus == DxvkGpuQueryStatus::Pending || endStatus == DxvkGpuQueryStatus::Pending) {
+        ++timing;
+        continue;
+      }
+
+      if (beginStatus == DxvkGpuQueryStatus::Available && endStatus == DxvkGpuQueryStatus::Available &&
+          endData.timestamp.time > beginData.timestamp.time) {
+        const float gpuTimeMs = float(double(endData.timestamp.time - beginData.timestamp.time) * timestampPeriodMs);
+        m_staticBlasBuildCostModel.addMeasurement(AccelBuildKind::FastTrace, timing->numBuilds, timing->primitiveCount, gpuTimeMs);
+      }
+
+      timing = m_pendingStaticBlasBuildTimings.erase(timing);
+    }
+  }
+
+  void AccelManager::buildStaticBlases(Rc<DxvkContext> ctx) {
+    if (m_staticBlasToBuild.empty())
+      return;
+
+    assert(m_staticBlasToBuild.size() == m_staticBlasRangesToBuild.size());
+
+    ScopedGpuProfileZone(ctx, "buildStaticBLAS");
+
+    // Only time the builds when there's room to read the result back, a few frames worth of measurements is plenty
+    const bool timeBuilds = m_pendingStaticBlasBuildTimings.size() < kMaxPendingStaticBlasBuildTimings;
+
+    StaticBlasBuildTiming timing;
+
+    if (timeBuilds) {
+      timing.begin = m_device->createGpuQuery(VK_QUERY_TYPE_TIMESTAMP, 0, 0);
+      timing.end = m_device->createGpuQuery(VK_QUERY_TYPE_TIMESTAMP, 0, 0);
+      timing.numBuilds = m_staticBlasToBuild.size();
+      timing.primitiveCount = m_staticBlasPrimitivesToBuild;
+
+      ctx->writeTimestamp(timing.begin);
+    }
+
+    ctx->vkCmdBuildAccelerationStructuresKHR(m_staticBlasToBuild.size(), m_staticBlasToBuild.data(), m_staticBlasRangesToBuild.data());
+
+    if (timeBuilds) {
+      ctx->writeTimestamp(timing.end);
+      m_pendingStaticBlasBuildTimings.push_back(std::move(timing));
+    }
   }
 
   void AccelManager::buildTlas(Rc<DxvkContext> ctx) {
@@ -989,7 +1742,9 @@ namespace dxvk {
   void AccelManager::internalBuildTlas(Rc<DxvkContext> ctx) {
     static constexpr char* names[] = { "buildTLAS_Opaque", "buildTLAS_NonOpaque" };
     ScopedGpuProfileZone(ctx, names[type]);
-    const VkBuildAccelerationStructureFlagsKHR flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR;
+    const bool enableRefit = RtxOptions::Get()->enableTlasRefit();
+    const VkBuildAccelerationStructureFlagsKHR flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_BUILD_BIT_KHR |
+      (enableRefit ? VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR : 0);
 
     const auto& vkd = m_device->vkd();
 
@@ -1028,6 +1783,25 @@ namespace dxvk {
     if (type == Tlas::Opaque)
       std::swap(tlas.accelStructure, tlas.previousAccelStructure);
 
+    // The last build is the previous TLAS when ping-ponging, otherwise it gets updated in place
+    const Rc<DxvkAccelStructure> lastBuiltAccelStructure = type == Tlas::Opaque ? tlas.previousAccelStructure : tlas.accelStructure;
+
+    // Refit the TLAS when the instance count and the instances' masks and flags are unchanged. Transforms and BLAS references may change,
+    // which includes refit BLASes alternating between their two allocations. Rebuild periodically as refits degrade the TLAS quality
+    // the more the instances move.
+    XXH64_hash_t instanceLayoutHash = kEmptyHash;
+    for (const VkAccelerationStructureInstanceKHR& instance : m_mergedInstances[type]) {
+      const uint32_t layout = uint32_t(instance.mask) | uint32_t(instance.flags) << 8;
+      instanceLayoutHash = XXH3_64bits_withSeed(&layout, sizeof(layout), instanceLayoutHash);
+    }
+
+    const bool refit = enableRefit &&
+                       lastBuiltAccelStructure != nullptr &&
+                       tlas.flags == flags &&
+                       tlas.instanceCount == numInstances &&
+                       tlas.instanceLayoutHash == instanceLayoutHash &&
+                       tlas.refitCount < RtxOptions::Get()->maxTlasRefitsBeforeRebuild();
+
     if (tlas.accelStructure == nullptr || sizeInfo.accelerationStructureSize > tlas.accelStructure->info().size) {
       ScopedGpuProfileZone(ctx, "buildTLAS_createAccelStructure");
       DxvkBufferCreateInfo info = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
@@ -1042,10 +1816,11 @@ namespace dxvk {
     }
 
     // Allocate the scratch memory
-    const auto scratchSlice = m_scratchAllocator->alloc(m_scratchAlignment, sizeInfo.buildScratchSize);
+    const auto scratchSlice = m_scratchAllocator->alloc(m_scratchAlignment, refit ? tlas.updateScratchSize : sizeInfo.buildScratchSize);
 
     // Update build information
-    buildInfo.srcAccelerationStructure = nullptr;
+    buildInfo.mode = refit ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    buildInfo.srcAccelerationStructure = refit ? lastBuiltAccelStructure->getAccelStructure() : nullptr;
     buildInfo.dstAccelerationStructure = tlas.accelStructure->getAccelStructure();
     buildInfo.scratchData.deviceAddress = scratchSlice.getDeviceAddress();
 
@@ -1060,5 +1835,16 @@ namespace dxvk {
 
     ctx->getCommandList()->trackResource<DxvkAccess::Write>(tlas.accelStructure);
     ctx->getCommandList()->trackResource<DxvkAccess::Write>(scratchSlice.buffer());
+
+    if (refit) {
+      ctx->getCommandList()->trackResource<DxvkAccess::Read>(lastBuiltAccelStructure);
+      ++tlas.refitCount;
+    } else {
+      tlas.flags = flags;
+      tlas.instanceCount = numInstances;
+      tlas.instanceLayoutHash = instanceLayoutHash;
+      tlas.updateScratchSize = sizeInfo.updateScratchSize;
+      tlas.refitCount = 0;
+    }
   }
 }  // namespace dxvk
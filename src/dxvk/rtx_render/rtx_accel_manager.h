@@ -28,6 +28,9 @@
 #include "../util/rc/util_rc_ptr.h"
 #include "rtx_types.h"
 #include "rtx_common_object.h"
+#include "rtx_async_accel_builder.h"
+#include "rtx_accel_build_scheduler.h"
+#include "../dxvk_gpu_query.h"
 #include "../util/util_vector.h"
 #include "../util/util_matrix.h"
 
@@ -37,6 +40,7 @@ class DxvkContext;
 class DxvkDevice;
 class ResourceCache;
 class CameraManager;
+class RtCamera;
 class OpacityMicromapManager;
 
 // AccelManager is responsible for maintaining the acceleration structures (BLAS and TLAS)
@@ -55,11 +59,15 @@ class AccelManager : public CommonDeviceObject {
     VkGeometryInstanceFlagsKHR instanceFlags = 0;
     bool usesUnorderedApproximations = false;
     uint32_t reorderedSurfacesOffset = UINT32_MAX;
-    
-    // Tries to add a geometry instance to the bucket. The addition is successful if either:
-    //   a) the bucket is empty,
-    //   b) the instance has the same mask etc. as all other instances in the bucket.
-    bool tryAddInstance(RtInstance* instance);
+
+    // Returns the key of the bucket an instance can be merged into, i.e. instances with the same mask etc. share a key
+    static uint64_t getMergeKey(const RtInstance& instance);
+
+    // Adds a geometry instance to the bucket, the instance must have the bucket's merge key
+    void addInstance(RtInstance* instance);
+
+    // Empties the bucket for reuse, keeping the allocated storage
+    void clear();
   };
 
 public:
@@ -69,9 +77,7 @@ public:
   explicit AccelManager(DxvkDevice* device);
 
   // Release internal objects
-  void onDestroy() {
-    m_scratchAllocator = nullptr;
-  }
+  void onDestroy();
 
   // Returns a GPU buffer containing the surface data for active instances
   const Rc<DxvkBuffer> getSurfaceBuffer() const { return m_surfaceBuffer; }
@@ -105,17 +111,33 @@ public:
   // Returns the number of live BLAS objects
   static uint32_t getBlasCount();
 
+  // Returns the amount of device memory saved by compacting the live static BLAS objects
+  static VkDeviceSize getBlasCompactionSavings();
+
   uint32_t getSurfaceCount() const { return m_reorderedSurfaces.size(); }
+
+  // Number of operations and GPU time of the last completed batch of async compute acceleration structure work
+  uint32_t getAsyncAccelOperationCount() const { return m_asyncBuilder->getLastBatchOperationCount(); }
+  uint64_t getAsyncAccelGpuTimeUs() const { return m_asyncBuilder->getLastBatchGpuTimeUs(); }
+
+  // Number of static BLAS builds pushed to a later frame by the static BLAS build budget this frame
+  uint32_t getDeferredStaticBlasBuildCount() const { return m_staticBlasBuildScheduler.getDeferredBuildCount(); }
+
+  // Number of instances left out of the TLASes this frame, see rtx.enableTlasInstanceCulling
+  uint32_t getCulledInstanceCount() const { return m_culledInstanceCount; }
 private:
+  // Returns true if no ray reaching further than cullingDistance from the camera frustum can hit the instance
+  static bool isInstanceOutsideCullingVolume(const RtInstance& instance, const RtCamera& camera, float cullingDistance);
+
   void buildBlases(Rc<DxvkContext> ctx, DxvkBarrierSet& execBarriers,
                    const CameraManager& cameraManager, OpacityMicromapManager* opacityMicromapManager, const InstanceManager& instanceManager,
                    const std::vector<TextureRef>& textures, const std::vector<RtInstance*>& instances,
-                   const std::vector<std::unique_ptr<BlasBucket>>& blasBuckets, 
+                   const std::vector<BlasBucket*>& blasBuckets, 
                    std::vector<VkAccelerationStructureBuildGeometryInfoKHR>& blasToBuild,
                    std::vector<VkAccelerationStructureBuildRangeInfoKHR*>& blasRangesToBuild,
                    float elapsedTime);
   void createBlasBuffersAndInstances(Rc<DxvkContext> ctx, 
-                                     const std::vector<std::unique_ptr<BlasBucket>>& blasBuckets,
+                                     const std::vector<BlasBucket*>& blasBuckets,
                                      std::vector<VkAccelerationStructureBuildGeometryInfoKHR>& blasToBuild,
                                      std::vector<VkAccelerationStructureBuildRangeInfoKHR*>& blasRangesToBuild);
   template<Tlas::Type type>
@@ -124,8 +146,20 @@ private:
   std::vector<uint32_t> m_reorderedSurfacesFirstIndexOffset;
   std::vector<uint32_t> m_reorderedSurfacesPrimitiveIDPrefixSum;
   std::vector<VkAccelerationStructureInstanceKHR> m_mergedInstances[Tlas::Count];
+  uint32_t m_culledInstanceCount = 0;
   std::vector<Rc<PooledBlas>> m_blasPool;
 
+  // BLAS buckets persist across frames so their geometry arrays only grow once, and are looked up by their merge key
+  std::vector<std::unique_ptr<BlasBucket>> m_blasBucketPool;
+  std::vector<BlasBucket*> m_activeBlasBuckets;
+  std::unordered_map<uint64_t, BlasBucket*> m_blasBucketLookup;
+
+  // CPU copies of the instance and surface data, and of the data last uploaded to the GPU used to find the records which changed
+  std::vector<uint8_t> m_instanceGPUData;
+  std::vector<uint8_t> m_uploadedInstanceGPUData;
+  std::vector<uint8_t> m_surfaceGPUData;
+  std::vector<uint8_t> m_uploadedSurfaceGPUData;
+
   Rc<DxvkBuffer> m_vkInstanceBuffer; // Note: Holds Vulkan AS Instances, not RtInstances
   Rc<DxvkBuffer> m_surfaceBuffer;
   Rc<DxvkBuffer> m_surfaceMappingBuffer;
@@ -137,8 +171,88 @@ private:
   Rc<DxvkBuffer> m_billboardsBuffer;
   void createAndBuildIntersectionBlas(Rc<DxvkContext> ctx, class DxvkBarrierSet& execBarriers);
 
+  Rc<DxvkAccelStructure> createBlasAccelStructure(size_t bufferSize, DxvkMemoryStats::Category category) const;
   Rc<PooledBlas> createPooledBlas(size_t bufferSize) const;
 
+  // Static BLAS compaction: the compacted size of a newly built static BLAS is queried right after its build,
+  // and a few frames later the BLAS is copied into a right-sized allocation. The original allocation is recycled through the pool.
+  struct BlasCompactionRequest {
+    Rc<PooledBlas> blas;
+    Rc<DxvkAccelStructure> sourceAccelStructure;
+    uint32_t queryIndex;
+    uint32_t frameQueried;
+  };
+
+  // A BLAS compacted on the async compute queue, it is swapped in once the copy has completed
+  struct AsyncBlasCompaction {
+    Rc<PooledBlas> blas;
+    Rc<DxvkAccelStructure> sourceAccelStructure;
+    Rc<DxvkAccelStructure> compactedAccelStructure;
+  };
+
+  void queryCompactedBlasSizes(Rc<DxvkContext> ctx);
+  void compactStaticBlases(Rc<DxvkContext> ctx);
+  void compactBlas(Rc<DxvkContext> ctx, const Rc<PooledBlas>& blas, VkDeviceSize compactedSize);
+  void swapInCompactedBlas(PooledBlas& blas, Rc<DxvkAccelStructure>&& compactedAccelStructure);
+
+  static constexpr uint32_t kMaxPendingBlasCompactions = 1024;
+  VkQueryPool m_compactionQueryPool = VK_NULL_HANDLE;
+  std::vector<uint32_t> m_freeCompactionQueries;
+  std::vector<BlasCompactionRequest> m_pendingCompactions;
+  std::vector<Rc<PooledBlas>> m_compactionCandidates;
+  std::vector<AsyncBlasCompaction> m_asyncCompactions;
+
+  // Static BLAS builds and compaction copies are recorded on the async compute queue when it's available
+  bool useAsyncAccelStructureBuilds() const;
+  void adoptAsyncStaticBlas(BlasEntry& blasEntry);
+  void releaseAsyncStaticBlas(BlasEntry& blasEntry);
+
+  // Builds the fast build BLAS instanced in place of a static BLAS which isn't available yet, or reuses the one built previously
+  PooledBlas* buildOrReuseDeferredStaticBlas(Rc<DxvkContext> ctx,
+                                             DxvkBarrierSet& execBarriers,
+                                             RtInstance& instance,
+                                             BlasEntry& blasEntry,
+                                             XXH64_hash_t boundOpacityMicromapHash,
+                                             std::vector<VkAccelerationStructureBuildGeometryInfoKHR>& blasToBuild,
+                                             std::vector<VkAccelerationStructureBuildRangeInfoKHR*>& blasRangesToBuild);
+  void releaseDeferredStaticBlas(BlasEntry& blasEntry);
+
+  std::unique_ptr<RtxAsyncAccelBuilder> m_asyncBuilder;
+  // Highest async compute timeline value whose results are used by this frame's graphics queue work
+  uint64_t m_asyncWaitValue = 0;
+
+  // Static BLAS builds are limited to a per-frame GPU time budget, instances whose build doesn't fit the budget stay
+  // in the merged BLASes for another frame. The cost model is calibrated from the GPU time of the static builds.
+  struct StaticBlasBuildTiming {
+    Rc<DxvkGpuQuery> begin;
+    Rc<DxvkGpuQuery> end;
+    uint32_t numBuilds;
+    uint64_t primitiveCount;
+  };
+
+  void calibrateStaticBlasBuildCost();
+  void buildStaticBlases(Rc<DxvkContext> ctx);
+
+  static constexpr uint32_t kMaxPendingStaticBlasBuildTimings = 8;
+  LinearAccelBuildCostModel m_staticBlasBuildCostModel;
+  AccelBuildScheduler m_staticBlasBuildScheduler { m_staticBlasBuildCostModel };
+  std::vector<VkAccelerationStructureBuildGeometryInfoKHR> m_staticBlasToBuild;
+  std::vector<VkAccelerationStructureBuildRangeInfoKHR*> m_staticBlasRangesToBuild;
+  uint64_t m_staticBlasPrimitivesToBuild = 0;
+  std::vector<StaticBlasBuildTiming> m_pendingStaticBlasBuildTimings;
+
+  // Builds or refits the persistent dynamic BLAS of an animated geometry, returns the BLAS to instance this frame
+  PooledBlas* buildOrRefitDynamicBlas(Rc<DxvkContext> ctx,
+                                      DxvkBarrierSet& execBarriers,
+                                      RtInstance& instance,
+                                      BlasEntry& blasEntry,
+                                      std::vector<VkAccelerationStructureBuildGeometryInfoKHR>& blasToBuild,
+                                      std::vector<VkAccelerationStructureBuildRangeInfoKHR*>& blasRangesToBuild);
+  void releaseDynamicBlas(BlasEntry& blasEntry);
+
+  // Moves a BLAS no longer owned by a geometry to the common pool
+  void recycleBlas(const Rc<PooledBlas>& blas);
+
   VkDeviceSize m_scratchAlignment;
   std::unique_ptr<DxvkStagingDataAlloc> m_scratchAllocator;
 };
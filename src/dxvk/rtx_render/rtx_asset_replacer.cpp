@@ -124,6 +124,14 @@ const std::string& AssetReplacer::getReplacementStatus() const {
   return noReplacements;
 }
 
+std::vector<std::string> AssetReplacer::getModDirectories() const {
+  std::vector<std::string> directories;
+  for (auto& mod : m_modManager.mods()) {
+    directories.push_back(mod->path().parent_path().string());
+  }
+  return directories;
+}
+
 void AssetReplacer::updateSecretReplacements() {
   bool updated = false;
 
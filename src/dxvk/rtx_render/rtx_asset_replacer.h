@@ -42,6 +42,14 @@ namespace dxvk {
 
   struct MeshReplacement {
     RasterGeometry data;
+
+    // Simplified versions of the mesh sharing its vertex buffer, finest first, see rtx.replacementMeshLod
+    struct Lod {
+      RasterGeometry data;
+      // Simplification error in replacement space units
+      float error;
+    };
+    std::vector<Lod> lods;
   };
 
   struct AssetReplacement {
@@ -199,6 +207,9 @@ namespace dxvk {
     bool areReplacementsLoading() const;
     const std::string& getReplacementStatus() const;
 
+    // returns the directories containing the mods, in mod priority order.
+    std::vector<std::string> getModDirectories() const;
+
     const bool hasNewSecretReplacementInfo() const {
       return m_bSecretReplacementsUpdated;
     }
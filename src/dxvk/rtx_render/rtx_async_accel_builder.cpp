@@ -0,0 +1,280 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include "rtx_async_accel_builder.h"
+
+#include "dxvk_device.h"
+#include "dxvk_scoped_annotation.h"
+#include "rtx_io.h"
+
+namespace dxvk {
+
+  RtxAsyncAccelBuilder::RtxAsyncAccelBuilder(DxvkDevice* device)
+    : m_device(device) {
+    // Note: without a dedicated async compute queue all acceleration structure work stays on the graphics queue.
+    // RTX IO submits to the async compute queue from its own threads without taking any lock, so it can't be shared with it.
+    if (m_device->queues().asyncCompute.queueHandle == VK_NULL_HANDLE || RtxIo::enabled())
+      return;
+
+    m_semaphore = RtxSemaphore::createTimeline(m_device, "async accel build");
+
+    const VkPhysicalDeviceLimits& limits = m_device->adapter()->deviceProperties().limits;
+
+    if (limits.timestampComputeAndGraphics) {
+      VkQueryPoolCreateInfo info = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+      info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+      info.queryCount = kMaxBatches * kQueriesPerBatch;
+
+      if (m_device->vkd()->vkCreateQueryPool(m_device->handle(), &info, nullptr, &m_timestampQueryPool) != VK_SUCCESS) {
+        Logger::warn("RtxAsyncAccelBuilder: failed to create the timestamp query pool, async acceleration structure work will not be timed");
+        m_timestampQueryPool = VK_NULL_HANDLE;
+      }
+
+      m_timestampPeriodUs = double(limits.timestampPeriod) / 1000.0;
+    }
+  }
+
+  RtxAsyncAccelBuilder::~RtxAsyncAccelBuilder() {
+    if (!isSupported())
+      return;
+
+    // The batches may still be executing, wait for all of them before destroying their command pools
+    m_semaphore->wait(m_lastSubmittedValue);
+
+    if (m_recordingBatch)
+      destroyBatch(*m_recordingBatch);
+
+    for (auto& batch : m_submittedBatches)
+      destroyBatch(*batch);
+
+    for (auto& batch : m_freeBatches)
+      destroyBatch(*batch);
+
+    if (m_timestampQueryPool != VK_NULL_HANDLE)
+      m_device->vkd()->vkDestroyQueryPool(m_device->handle(), m_timestampQueryPool, nullptr);
+  }
+
+  std::unique_ptr<RtxAsyncAccelBuilder::Batch> RtxAsyncAccelBuilder::acquireBatch() {
+    if (!m_freeBatches.empty()) {
+      std::unique_ptr<Batch> batch = std::move(m_freeBatches.back());
+      m_freeBatches.pop_back();
+      return batch;
+    }
+
+    // All batches are in flight, the async queue is more than a few frames behind so wait for the oldest batch
+    if (m_numBatches == kMaxBatches) {
+      ScopedCpuProfileZoneN("Wait for async accel batch");
+
+      std::unique_ptr<Batch> batch = std::move(m_submittedBatches.front());
+      m_submittedBatches.pop_front();
+
+      m_semaphore->wait(batch->value);
+      readBatchTimings(*batch);
+      batch->resources.reset();
+      return batch;
+    }
+
+    auto batch = std::make_unique<Batch>();
+    batch->queryIndex = m_numBatches * kQueriesPerBatch;
+    ++m_numBatches;
+
+    VkCommandPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = m_device->queues().asyncCompute.queueFamily;
+
+    if (m_device->vkd()->vkCreateCommandPool(m_device->handle(), &poolInfo, nullptr, &batch->cmdPool) != VK_SUCCESS)
+      throw DxvkError("RtxAsyncAccelBuilder: failed to create command pool");
+
+    VkCommandBufferAllocateInfo cmdInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    cmdInfo.commandPool = batch->cmdPool;
+    cmdInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdInfo.commandBufferCount = 1;
+
+    if (m_device->vkd()->vkAllocateCommandBuffers(m_device->handle(), &cmdInfo, &batch->cmdBuf) != VK_SUCCESS)
+      throw DxvkError("RtxAsyncAccelBuilder: failed to allocate command buffer");
+
+    return batch;
+  }
+
+  void RtxAsyncAccelBuilder::destroyBatch(Batch& batch) {
+    batch.resources.reset();
+    m_device->vkd()->vkDestroyCommandPool(m_device->handle(), batch.cmdPool, nullptr);
+    batch.cmdPool = VK_NULL_HANDLE;
+    batch.cmdBuf = VK_NULL_HANDLE;
+  }
+
+  VkCommandBuffer RtxAsyncAccelBuilder::getCmdBuffer() {
+    assert(isSupported());
+
+    if (m_recordingBatch)
+      return m_recordingBatch->cmdBuf;
+
+    m_recordingBatch = acquireBatch();
+    m_recordingBatch->value = getRecordingValue();
+    m_recordingBatch->numOperations = 0;
+    m_recordingBatch->numBuilds = 0;
+    m_recordingBatch->buildPrimitiveCount = 0;
+    m_recordingBatch->scratchOffset = 0;
+
+    m_device->vkd()->vkResetCommandPool(m_device->handle(), m_recordingBatch->cmdPool, 0);
+
+    VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (m_device->vkd()->vkBeginCommandBuffer(m_recordingBatch->cmdBuf, &beginInfo) != VK_SUCCESS)
+      Logger::err("RtxAsyncAccelBuilder: vkBeginCommandBuffer failed");
+
+    if (m_timestampQueryPool != VK_NULL_HANDLE) {
+      m_device->vkd()->vkResetQueryPool(m_device->handle(), m_timestampQueryPool, m_recordingBatch->queryIndex, kQueriesPerBatch);
+      m_device->vkd()->vkCmdWriteTimestamp(m_recordingBatch->cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampQueryPool, m_recordingBatch->queryIndex);
+    }
+
+    return m_recordingBatch->cmdBuf;
+  }
+
+  DxvkBufferSlice RtxAsyncAccelBuilder::allocScratch(VkDeviceSize size, VkDeviceSize alignment) {
+    assert(m_recordingBatch);
+
+    Batch& batch = *m_recordingBatch;
+    VkDeviceSize offset = align(batch.scratchOffset, alignment);
+
+    if (batch.scratchBuffer == nullptr || offset + size > batch.scratchBuffer->info().size) {
+      // Note: a replaced buffer stays alive through the resources tracked by the batch
+      DxvkBufferCreateInfo info;
+      info.size = std::max(size, kMinScratchBufferSize);
+      info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+      info.stages = VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+      info.access = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+      // Note: the scratch device address must be aligned, not just the offset, see the AccelManager's scratch allocator
+      info.requiredAlignmentOverride = alignment;
+
+      if (batch.scratchBuffer != nullptr)
+        info.size = std::max(info.size, 2 * batch.scratchBuffer->info().size);
+
+      batch.scratchBuffer = m_device->createBuffer(info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DxvkMemoryStats::Category::RTXBuffer);
+      offset = 0;
+    }
+
+    batch.scratchOffset = offset + size;
+    trackResource<DxvkAccess::Write>(batch.scratchBuffer);
+
+    return DxvkBufferSlice(batch.scratchBuffer, offset, size);
+  }
+
+  void RtxAsyncAccelBuilder::beginBuild(uint32_t primitiveCount) {
+    assert(m_recordingBatch);
+
+    Batch& batch = *m_recordingBatch;
+
+    // Note: bottom of pipe, so that the builds' time doesn't include the copies recorded before them
+    if (batch.numBuilds == 0 && m_timestampQueryPool != VK_NULL_HANDLE)
+      m_device->vkd()->vkCmdWriteTimestamp(batch.cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampQueryPool, batch.queryIndex + 1);
+
+    ++batch.numOperations;
+    ++batch.numBuilds;
+    batch.buildPrimitiveCount += primitiveCount;
+  }
+
+  void RtxAsyncAccelBuilder::submit() {
+    if (!m_recordingBatch)
+      return;
+
+    ScopedCpuProfileZone();
+
+    const VkCommandBuffer cmdBuf = m_recordingBatch->cmdBuf;
+
+    if (m_timestampQueryPool != VK_NULL_HANDLE) {
+      // Note: the builds' timestamp must be written for the whole batch's query results to become available
+      if (m_recordingBatch->numBuilds == 0)
+        m_device->vkd()->vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampQueryPool, m_recordingBatch->queryIndex + 1);
+
+      m_device->vkd()->vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampQueryPool, m_recordingBatch->queryIndex + 2);
+    }
+
+    TracyVkCollect(m_device->queues().asyncCompute.tracyCtx, cmdBuf);
+
+    if (m_device->vkd()->vkEndCommandBuffer(cmdBuf) != VK_SUCCESS)
+      Logger::err("RtxAsyncAccelBuilder: vkEndCommandBuffer failed");
+
+    const VkSemaphore signalSemaphore = m_semaphore->handle();
+    const uint64_t signalValue = m_recordingBatch->value;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &cmdBuf;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+
+    // Note: this is the only user of the async compute queue when RTX IO is disabled, so no queue lock is needed
+    const VkResult result = m_device->vkd()->vkQueueSubmit(m_device->queues().asyncCompute.queueHandle, 1, &submitInfo, VK_NULL_HANDLE);
+
+    if (result != VK_SUCCESS)
+      throw DxvkError(str::format("RtxAsyncAccelBuilder: vkQueueSubmit failed with ", result));
+
+    m_lastSubmittedValue = signalValue;
+    m_submittedBatches.push_back(std::move(m_recordingBatch));
+  }
+
+  void RtxAsyncAccelBuilder::onFrameBegin() {
+    if (!isSupported())
+      return;
+
+    m_completedValue = m_semaphore->value();
+
+    while (!m_submittedBatches.empty() && m_submittedBatches.front()->value <= m_completedValue) {
+      std::unique_ptr<Batch> batch = std::move(m_submittedBatches.front());
+      m_submittedBatches.pop_front();
+
+      readBatchTimings(*batch);
+
+      // Release the resources used by the batch, e.g. the scratch memory can be reused from now on
+      batch->resources.reset();
+      m_freeBatches.push_back(std::move(batch));
+    }
+  }
+
+  void RtxAsyncAccelBuilder::readBatchTimings(const Batch& batch) {
+    m_lastBatchOperationCount = batch.numOperations;
+
+    if (m_timestampQueryPool == VK_NULL_HANDLE)
+      return;
+
+    uint64_t timestamps[kQueriesPerBatch] = {};
+    const VkResult result = m_device->vkd()->vkGetQueryPoolResults(m_device->handle(), m_timestampQueryPool, batch.queryIndex, kQueriesPerBatch,
+                                                                   sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (result != VK_SUCCESS)
+      return;
+
+    if (timestamps[2] > timestamps[0])
+      m_lastBatchGpuTimeUs = uint64_t(double(timestamps[2] - timestamps[0]) * m_timestampPeriodUs);
+
+    if (batch.numBuilds > 0 && timestamps[2] > timestamps[1]) {
+      const float buildTimeMs = float(double(timestamps[2] - timestamps[1]) * m_timestampPeriodUs / 1000.0);
+      m_completedBuildTimings.push_back({ batch.numBuilds, batch.buildPrimitiveCount, buildTimeMs });
+    }
+  }
+}
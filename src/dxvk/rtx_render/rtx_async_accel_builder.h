@@ -0,0 +1,151 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "../dxvk_include.h"
+#include "../dxvk_buffer.h"
+#include "../dxvk_lifetime.h"
+#include "rtx_semaphore.h"
+
+namespace dxvk {
+  class DxvkDevice;
+
+  // Records acceleration structure work (builds, compaction copies) on the async compute queue so that it overlaps
+  // with the graphics queue work of the frame. The work recorded during a frame is submitted as one batch which signals
+  // a timeline semaphore, consumers poll the semaphore and only pick up the results of batches which have completed.
+  // Note: all acceleration structures and buffers are created with VK_SHARING_MODE_EXCLUSIVE and are used across queues without
+  //       ownership transfers, in the same way as the DLFG presenter does with its images. Async work must therefore only read
+  //       resources whose graphics queue writes have completed, and its results must only be consumed once isComplete() says so.
+  class RtxAsyncAccelBuilder {
+  public:
+    explicit RtxAsyncAccelBuilder(DxvkDevice* device);
+    ~RtxAsyncAccelBuilder();
+
+    RtxAsyncAccelBuilder(RtxAsyncAccelBuilder const&) = delete;
+    RtxAsyncAccelBuilder& operator=(RtxAsyncAccelBuilder const&) = delete;
+
+    // Returns true when the device has a dedicated async compute queue to submit to
+    bool isSupported() const { return m_semaphore.ptr() != nullptr; }
+
+    // Returns the command buffer of the batch being recorded, starting a new batch if needed
+    VkCommandBuffer getCmdBuffer();
+
+    // Keeps a resource alive (and marked as in use) until the batch being recorded has completed
+    template<DxvkAccess Access>
+    void trackResource(Rc<DxvkResource> rc) {
+      assert(m_recordingBatch);
+      m_recordingBatch->resources.trackResource<Access>(std::move(rc));
+    }
+
+    // Allocates scratch memory for an acceleration structure build recorded into the current batch.
+    // Note: async builds don't use the accel manager's scratch allocator, which recycles its memory based on graphics frame completion.
+    DxvkBufferSlice allocScratch(VkDeviceSize size, VkDeviceSize alignment);
+
+    // Counts an acceleration structure copy recorded into the current batch
+    void countOperation() { ++m_recordingBatch->numOperations; }
+
+    // Counts a BLAS build about to be recorded into the current batch. Builds are timed separately from the copies
+    // recorded before them, so they must be recorded after all the copies of the batch.
+    void beginBuild(uint32_t primitiveCount);
+
+    // Returns the timeline value which the batch being recorded signals on completion
+    uint64_t getRecordingValue() const { return m_lastSubmittedValue + 1; }
+
+    // Submits the batch being recorded, if any
+    void submit();
+
+    // Returns true when the batch signaling the given timeline value has completed
+    bool isComplete(uint64_t value) const { return value <= m_completedValue; }
+
+    // Returns the last timeline value signaled by a completed batch
+    uint64_t getCompletedValue() const { return m_completedValue; }
+
+    VkSemaphore getSemaphore() const { return m_semaphore->handle(); }
+
+    // Polls the timeline semaphore and recycles the batches which have completed. Called once per frame before recording.
+    void onFrameBegin();
+
+    // Number of operations and GPU time of the last completed batch
+    uint32_t getLastBatchOperationCount() const { return m_lastBatchOperationCount; }
+    uint64_t getLastBatchGpuTimeUs() const { return m_lastBatchGpuTimeUs; }
+
+    // GPU time of the builds of a completed batch
+    struct BuildTiming {
+      uint32_t numBuilds;
+      uint64_t primitiveCount;
+      float gpuTimeMs;
+    };
+
+    // Moves out the timings of the builds in the batches which completed since the last call, including the batches
+    // waited on when all of them were in flight
+    void popCompletedBuildTimings(std::vector<BuildTiming>& timings) {
+      timings.clear();
+      std::swap(timings, m_completedBuildTimings);
+    }
+
+  private:
+    struct Batch {
+      VkCommandPool cmdPool = VK_NULL_HANDLE;
+      VkCommandBuffer cmdBuf = VK_NULL_HANDLE;
+      DxvkLifetimeTracker resources;
+      uint64_t value = 0;
+      uint32_t numOperations = 0;
+      uint32_t numBuilds = 0;
+      uint64_t buildPrimitiveCount = 0;
+      uint32_t queryIndex = 0;
+      Rc<DxvkBuffer> scratchBuffer;
+      VkDeviceSize scratchOffset = 0;
+    };
+
+    std::unique_ptr<Batch> acquireBatch();
+    void destroyBatch(Batch& batch);
+    void readBatchTimings(const Batch& batch);
+
+    DxvkDevice* m_device;
+    Rc<RtxSemaphore> m_semaphore;
+
+    std::unique_ptr<Batch> m_recordingBatch;
+    std::deque<std::unique_ptr<Batch>> m_submittedBatches;
+    std::vector<std::unique_ptr<Batch>> m_freeBatches;
+
+    uint32_t m_numBatches = 0;
+
+    uint64_t m_lastSubmittedValue = 0;
+    uint64_t m_completedValue = 0;
+
+    // Timestamps at the beginning of every batch, at the beginning of its builds and at its end.
+    // Each batch owns kQueriesPerBatch consecutive queries.
+    static constexpr uint32_t kMaxBatches = 8;
+    static constexpr uint32_t kQueriesPerBatch = 3;
+    static constexpr VkDeviceSize kMinScratchBufferSize = 4 * 1024 * 1024;
+    VkQueryPool m_timestampQueryPool = VK_NULL_HANDLE;
+    double m_timestampPeriodUs = 0.0;
+
+    uint32_t m_lastBatchOperationCount = 0;
+    uint64_t m_lastBatchGpuTimeUs = 0;
+    std::vector<BuildTiming> m_completedBuildTimings;
+  };
+}
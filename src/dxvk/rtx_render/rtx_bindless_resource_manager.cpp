@@ -66,7 +66,10 @@ namespace dxvk {
 
     // Textures
     {
-      std::vector<VkDescriptorImageInfo> imageInfo(rtTextures.size());
+      std::vector<VkDescriptorImageInfo>& imageInfo = m_imageInfoScratch;
+      std::vector<uint64_t>& keys = m_keyScratch;
+      imageInfo.resize(rtTextures.size());
+      keys.resize(rtTextures.size());
 
       uint32_t idx = 0;
       for (auto&& texRef : rtTextures) {
@@ -76,9 +79,11 @@ namespace dxvk {
           imageInfo[idx].sampler = nullptr;
           imageInfo[idx].imageView = imageView->handle();
           imageInfo[idx].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+          keys[idx] = imageView->cookie();
           ctx->getCommandList()->trackResource<DxvkAccess::Read>(imageView);
         } else {
           imageInfo[idx] = m_device->getCommon()->dummyResources().imageViewDescriptor(VK_IMAGE_VIEW_TYPE_2D, true);
+          keys[idx] = 0;
         }
 
         ++idx;
@@ -86,30 +91,25 @@ namespace dxvk {
 
       assert(idx <= kMaxBindlessResources);
 
-      VkWriteDescriptorSet descWrites;
-      descWrites.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      descWrites.pNext = nullptr;
-      descWrites.dstSet = 0;//  This will be filled in by the BindlessTable 
-      descWrites.dstBinding = 0;
-      descWrites.dstArrayElement = 0;
-      descWrites.descriptorCount = idx;
-      descWrites.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-      descWrites.pImageInfo = &imageInfo[0];
-      descWrites.pBufferInfo = nullptr;
-      descWrites.pTexelBufferView = nullptr;
-      m_tables[Table::Textures][currentIdx()]->updateDescriptors(descWrites);
+      m_tables[Table::Textures][currentIdx()]->updateDescriptors(VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, imageInfo, keys);
     }
 
     // Buffers
     {
+      std::vector<VkDescriptorBufferInfo>& bufferInfo = m_bufferInfoScratch;
+      std::vector<uint64_t>& keys = m_keyScratch;
+      bufferInfo.resize(rtBuffers.size());
+      keys.resize(rtBuffers.size());
+
       uint32_t idx = 0;
-      std::vector<VkDescriptorBufferInfo> bufferInfo(rtBuffers.size());
       for (auto&& bufRef : rtBuffers) {
         if (bufRef.defined()) {
           bufferInfo[idx] = bufRef.getDescriptor().buffer;
+          keys[idx] = bufRef.buffer()->cookie();
           ctx->getCommandList()->trackResource<DxvkAccess::Read>(bufRef.buffer());
         } else {
           bufferInfo[idx] = m_device->getCommon()->dummyResources().bufferDescriptor();
+          keys[idx] = 0;
         }
 
         ++idx;
@@ -117,32 +117,27 @@ namespace dxvk {
 
       assert(idx <= kMaxBindlessResources);
 
-      VkWriteDescriptorSet descWrites;
-      descWrites.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      descWrites.pNext = nullptr;
-      descWrites.dstSet = 0;//  This will be filled in by the BindlessTable 
-      descWrites.dstBinding = 0;
-      descWrites.dstArrayElement = 0;
-      descWrites.descriptorCount = idx;
-      descWrites.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-      descWrites.pImageInfo = nullptr;
-      descWrites.pBufferInfo = &bufferInfo[0];
-      descWrites.pTexelBufferView = nullptr;
-      m_tables[Table::Buffers][currentIdx()]->updateDescriptors(descWrites);
+      m_tables[Table::Buffers][currentIdx()]->updateDescriptors(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, bufferInfo, keys);
     }
 
     // Samplers
     {
-      std::vector<VkDescriptorImageInfo> imageInfo(samplers.size());
+      std::vector<VkDescriptorImageInfo>& imageInfo = m_imageInfoScratch;
+      std::vector<uint64_t>& keys = m_keyScratch;
+      imageInfo.resize(samplers.size());
+      keys.resize(samplers.size());
 
       uint32_t idx = 0;
       for (auto&& sampler : samplers) {
         if (sampler != nullptr) {
           imageInfo[idx].sampler = sampler->handle();
           imageInfo[idx].imageView = nullptr;
+          imageInfo[idx].imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+          keys[idx] = sampler->cookie();
           ctx->getCommandList()->trackResource<DxvkAccess::Read>(sampler);
         } else {
           imageInfo[idx] = m_device->getCommon()->dummyResources().samplerDescriptor();
+          keys[idx] = 0;
         }
 
         ++idx;
@@ -150,18 +145,7 @@ namespace dxvk {
 
       assert(idx <= kMaxBindlessSamplers);
 
-      VkWriteDescriptorSet descWrites;
-      descWrites.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      descWrites.pNext = nullptr;
-      descWrites.dstSet = 0;//  This will be filled in by the BindlessTable 
-      descWrites.dstBinding = 0;
-      descWrites.dstArrayElement = 0;
-      descWrites.descriptorCount = idx;
-      descWrites.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
-      descWrites.pImageInfo = &imageInfo[0];
-      descWrites.pBufferInfo = nullptr;
-      descWrites.pTexelBufferView = nullptr;
-      m_tables[Table::Samplers][currentIdx()]->updateDescriptors(descWrites);
+      m_tables[Table::Samplers][currentIdx()]->updateDescriptors(VK_DESCRIPTOR_TYPE_SAMPLER, imageInfo, keys);
     }
 
     m_frameLastUpdated = m_device->getCurrentFrameId();
@@ -206,22 +190,105 @@ namespace dxvk {
       throw DxvkError("BindlessTable: Failed to create descriptor set layout");
   }
 
-  void BindlessResourceManager::BindlessTable::updateDescriptors(VkWriteDescriptorSet& set) {
+  static bool isSameDescriptor(const VkDescriptorImageInfo& a, const VkDescriptorImageInfo& b) {
+    return a.sampler == b.sampler
+        && a.imageView == b.imageView
+        && a.imageLayout == b.imageLayout;
+  }
+
+  static bool isSameDescriptor(const VkDescriptorBufferInfo& a, const VkDescriptorBufferInfo& b) {
+    return a.buffer == b.buffer
+        && a.offset == b.offset
+        && a.range == b.range;
+  }
+
+  static void setDescriptorInfo(VkWriteDescriptorSet& write, const VkDescriptorImageInfo* pInfo) {
+    write.pImageInfo = pInfo;
+  }
+
+  static void setDescriptorInfo(VkWriteDescriptorSet& write, const VkDescriptorBufferInfo* pInfo) {
+    write.pBufferInfo = pInfo;
+  }
+
+  bool BindlessResourceManager::BindlessTable::allocateSet(const VkDescriptorType type, const uint32_t count) {
     if (bindlessDescSet == nullptr) {
       // Allocate the descriptor set
       bindlessDescSet = m_pManager->m_globalBindlessPool[m_pManager->currentIdx()]->alloc(layout, "bindless descriptor set");
       if (bindlessDescSet == nullptr) {
-        Logger::err(str::format("BindlessTable: failed to allocate a descriptor set for ", set.descriptorCount, " ",
-                                (set.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) ? "buffers" : "textures"));
-        return;
+        Logger::err(str::format("BindlessTable: failed to allocate a descriptor set for ", count, " ",
+                                (type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) ? "buffers" : "textures"));
+        return false;
       }
     }
 
-    // Update the write descriptor with our set
-    set.dstSet = bindlessDescSet;
+    return true;
+  }
+
+  template<typename T>
+  void BindlessResourceManager::BindlessTable::writeDescriptors(const VkDescriptorType type, const std::vector<T>& infos, const std::vector<uint64_t>& keys, std::vector<T>& written) {
+    if (!allocateSet(type, infos.size()))
+      return;
+
+    // This set was last written kMaxFramesInFlight frames ago, so only descriptors which changed
+    // since then need to be rewritten. Resource cookies catch handles that were reused by a new
+    // object. Dirty descriptors are coalesced into contiguous runs, and short runs of unchanged
+    // descriptors in between are rewritten as well to keep the write count low.
+    const uint32_t count = infos.size();
+    const uint32_t writtenCount = written.size();
+
+    auto isDirty = [&] (uint32_t i) {
+      return i >= writtenCount || keys[i] != m_writtenKeys[i] || !isSameDescriptor(infos[i], written[i]);
+    };
+
+    m_writes.clear();
+
+    uint32_t i = 0;
+    while (i < count) {
+      if (!isDirty(i)) {
+        ++i;
+        continue;
+      }
+
+      const uint32_t first = i;
+      uint32_t last = i;
+
+      for (++i; i < count; ++i) {
+        if (isDirty(i))
+          last = i;
+        else if (i - last > kMaxCleanDescriptorGap)
+          break;
+      }
+
+      VkWriteDescriptorSet write;
+      write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      write.pNext = nullptr;
+      write.dstSet = bindlessDescSet;
+      write.dstBinding = 0;
+      write.dstArrayElement = first;
+      write.descriptorCount = last - first + 1;
+      write.descriptorType = type;
+      write.pImageInfo = nullptr;
+      write.pBufferInfo = nullptr;
+      write.pTexelBufferView = nullptr;
+      setDescriptorInfo(write, &infos[first]);
+
+      m_writes.push_back(write);
+    }
+
+    // Do the writes, all runs in a single call
+    if (!m_writes.empty())
+      vkd()->vkUpdateDescriptorSets(vkd()->device(), m_writes.size(), m_writes.data(), 0, nullptr);
+
+    written.assign(infos.begin(), infos.end());
+    m_writtenKeys.assign(keys.begin(), keys.end());
+  }
+
+  void BindlessResourceManager::BindlessTable::updateDescriptors(const VkDescriptorType type, const std::vector<VkDescriptorImageInfo>& infos, const std::vector<uint64_t>& keys) {
+    writeDescriptors(type, infos, keys, m_writtenImageInfos);
+  }
 
-    // Do the write
-    vkd()->vkUpdateDescriptorSets(vkd()->device(), 1, &set, 0, nullptr);
+  void BindlessResourceManager::BindlessTable::updateDescriptors(const VkDescriptorType type, const std::vector<VkDescriptorBufferInfo>& infos, const std::vector<uint64_t>& keys) {
+    writeDescriptors(type, infos, keys, m_writtenBufferInfos);
   }
 
   void BindlessResourceManager::createGlobalBindlessDescPool() {
@@ -40,6 +40,7 @@ namespace dxvk {
 
     static const uint32_t kMaxBindlessResources = 64 * 1024; // our indices are uint16_t...
     static const uint32_t kMaxBindlessSamplers = 2048; // this is the lowest max number of samplers our device base supports for remix (VkPhysicalDeviceLimits::maxDescriptorSetSamplers)
+    static const uint32_t kMaxCleanDescriptorGap = 16; // unchanged descriptors rewritten to merge two dirty runs
 
     BindlessResourceManager() = delete;
 
@@ -66,12 +67,24 @@ namespace dxvk {
       VkDescriptorSet bindlessDescSet = VK_NULL_HANDLE;
 
       void createLayout(const VkDescriptorType type);
-      void updateDescriptors(VkWriteDescriptorSet& set);
+      void updateDescriptors(const VkDescriptorType type, const std::vector<VkDescriptorImageInfo>& infos, const std::vector<uint64_t>& keys);
+      void updateDescriptors(const VkDescriptorType type, const std::vector<VkDescriptorBufferInfo>& infos, const std::vector<uint64_t>& keys);
 
     private:
       const Rc<vk::DeviceFn> vkd() const;
 
+      bool allocateSet(const VkDescriptorType type, const uint32_t count);
+
+      template<typename T>
+      void writeDescriptors(const VkDescriptorType type, const std::vector<T>& infos, const std::vector<uint64_t>& keys, std::vector<T>& written);
+
       BindlessResourceManager* m_pManager = nullptr;
+
+      // Descriptors as last written to this set, used to only write what changed
+      std::vector<VkDescriptorImageInfo> m_writtenImageInfos;
+      std::vector<VkDescriptorBufferInfo> m_writtenBufferInfos;
+      std::vector<uint64_t> m_writtenKeys;
+      std::vector<VkWriteDescriptorSet> m_writes;
     };
 
     // Persistent desc pool, our sets can be updated after bind (should be no need to reset this pool)
@@ -82,6 +95,10 @@ namespace dxvk {
     uint32_t m_globalBindlessDescSetIdx = 0;
     uint32_t m_frameLastUpdated = UINT_MAX;
 
+    std::vector<VkDescriptorImageInfo> m_imageInfoScratch;
+    std::vector<VkDescriptorBufferInfo> m_bufferInfoScratch;
+    std::vector<uint64_t> m_keyScratch;
+
 
     uint32_t currentIdx() const {
       return m_globalBindlessDescSetIdx;
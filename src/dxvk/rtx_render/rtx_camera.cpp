@@ -455,6 +455,16 @@ namespace dxvk
     return freeCamViewToWorld;
   }
 
+  void RtCamera::updateViewFrustum(float fov, float aspectRatio, float nearPlane, float farPlane, bool isLHS) {
+    float4x4 frustumMatrix;
+    if (std::isfinite(farPlane)) {
+      frustumMatrix.SetupByHalfFovy((float) (fov * 0.5), aspectRatio, nearPlane, farPlane, (isLHS ? PROJ_LEFT_HANDED : 0));
+    } else {
+      frustumMatrix.SetupByHalfFovyInf((float) (fov * 0.5), aspectRatio, nearPlane, (isLHS ? PROJ_LEFT_HANDED : 0));
+    }
+    m_viewFrustum.Setup(NDC_OGL, frustumMatrix);
+  }
+
   void RtCamera::updateAntiCulling(float fov, float aspectRatio, float nearPlane, float farPlane, bool isLHS) {
     // Create Anti-Culling frustum
     if (RtxOptions::AntiCulling::Object::enable()) {
@@ -569,6 +579,7 @@ namespace dxvk
 
     auto modifiedViewToProj = Matrix4d{ newViewToProjection };
 
+    updateViewFrustum(fov, aspectRatio, nearPlane, farPlane, isLHS);
     updateAntiCulling(fov, aspectRatio, nearPlane, farPlane, isLHS);
 
     // Sometimes we want to modify the near plane for RT.  See DevSettings->Camera->Advanced
@@ -207,6 +207,7 @@ namespace dxvk
 
     RtFrustum m_frustum;
     cFrustum m_lightAntiCullingFrustum;
+    cFrustum m_viewFrustum;
 
     // Captures any artificial offsets applied on top of the input transfrom 
     // from the game engine.
@@ -270,6 +271,9 @@ namespace dxvk
     inline const cFrustum& getLightAntiCullingFrustum() const { return m_lightAntiCullingFrustum; }
     inline cFrustum& getLightAntiCullingFrustum() { return m_lightAntiCullingFrustum; }
 
+    // View frustum of the game's projection, unaffected by the anti-culling settings
+    inline const cFrustum& getViewFrustum() const { return m_viewFrustum; }
+
     void setPreviousWorldToView(const Matrix4d& worldToView, bool freecam = true);
     void setPreviousViewToWorld(const Matrix4d& viewToWorld, bool freecam = true);
 
@@ -323,6 +327,7 @@ namespace dxvk
     Matrix4d getShakenViewToWorldMatrix(Matrix4d& viewToWorld, uint32_t flags);
     Matrix4d updateFreeCamera(uint32_t flags);
     void updateAntiCulling(float fov, float aspectRatio, float nearPlane, float farPlane, bool isLHS);
+    void updateViewFrustum(float fov, float aspectRatio, float nearPlane, float farPlane, bool isLHS);
     Matrix4d overrideNearPlane(const Matrix4d& modifiedViewToProj);
 
     RtCameraSetting m_context;
@@ -143,8 +143,9 @@ namespace dxvk {
       return;
     }
 
-    // Wait for all shader prewarming to complete
-    while (m_device->getCommon()->pipelineManager().isCompilingShaders()) {
+    // Wait for the RTX pipelines to finish compiling. Raster pipelines from the
+    // state cache are queued at a lower priority and keep compiling in the background.
+    while (m_device->getCommon()->pipelineManager().isCompilingShaders(DxvkPipelinePriority::Raytracing)) {
       Sleep(1);
     }
 
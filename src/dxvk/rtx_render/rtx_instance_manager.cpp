@@ -34,6 +34,7 @@
 #include "../d3d9/d3d9_state.h"
 #include "rtx_matrix_helpers.h"
 #include "dxvk_scoped_annotation.h"
+#include "../../util/log/draw_profiler.h"
 
 #include "rtx/pass/common_binding_indices.h"
 #include "rtx/concept/surface_material/surface_material_hitgroup.h"
@@ -348,6 +349,8 @@ namespace dxvk {
   RtInstance* InstanceManager::processSceneObject(
     const CameraManager& cameraManager, const RayPortalManager& rayPortalManager,
     BlasEntry& blas, const DrawCallState& drawCall, const MaterialData& materialData, const RtSurfaceMaterial& material) {
+    DrawStageScope stageScope(DrawStage::InstanceMatching);
+
     Matrix4 objectToWorld = drawCall.getTransformData().objectToWorld;
     Matrix4 worldToProjection = drawCall.getTransformData().viewToProjection * drawCall.getTransformData().worldToView;
 
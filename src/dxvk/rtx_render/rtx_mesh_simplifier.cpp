@@ -0,0 +1,339 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include "rtx_mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace dxvk {
+
+  namespace {
+    uint64_t makeEdgeKey(uint32_t a, uint32_t b) {
+      return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+
+    struct PositionHash {
+      size_t operator()(const Vector3& p) const {
+        uint32_t bits[3];
+        std::memcpy(bits, &p, sizeof(bits));
+        return std::hash<uint64_t>()((uint64_t(bits[0]) << 32) ^ (uint64_t(bits[1]) << 16) ^ bits[2]);
+      }
+    };
+
+    struct PositionEqual {
+      bool operator()(const Vector3& a, const Vector3& b) const {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+      }
+    };
+  }
+
+  void MeshSimplifier::Quadric::addPlane(const Vector3& normal, float distance, double planeWeight) {
+    const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    const double w = planeWeight;
+
+    a00 += w * a * a; a01 += w * a * b; a02 += w * a * c; a03 += w * a * d;
+    a11 += w * b * b; a12 += w * b * c; a13 += w * b * d;
+    a22 += w * c * c; a23 += w * c * d;
+    a33 += w * d * d;
+    weight += w;
+  }
+
+  void MeshSimplifier::Quadric::add(const Quadric& other) {
+    a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+    a11 += other.a11; a12 += other.a12; a13 += other.a13;
+    a22 += other.a22; a23 += other.a23;
+    a33 += other.a33;
+    weight += other.weight;
+  }
+
+  double MeshSimplifier::Quadric::evaluate(const Vector3& p) const {
+    if (weight <= 0.)
+      return 0.;
+
+    const double x = p.x, y = p.y, z = p.z;
+
+    const double sum = a00 * x * x + 2. * a01 * x * y + 2. * a02 * x * z + 2. * a03 * x
+         + a11 * y * y + 2. * a12 * y * z + 2. * a13 * y
+         + a22 * z * z + 2. * a23 * z
+         + a33;
+
+    return std::max(sum, 0.) / weight;
+  }
+
+  MeshSimplifier::MeshSimplifier(const void* positions, size_t positionStride, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+    : m_positions(vertexCount)
+    , m_indices(indices, indices + indexCount - indexCount % 3)
+    , m_isTriangleRemoved(indexCount / 3, false)
+    , m_vertexTriangles(vertexCount)
+    , m_quadrics(vertexCount)
+    , m_isVertexLocked(vertexCount, false)
+    , m_isVertexRemoved(vertexCount, false)
+    , m_vertexVersions(vertexCount, 0) {
+    for (size_t i = 0; i < vertexCount; i++)
+      std::memcpy(&m_positions[i], static_cast<const uint8_t*>(positions) + i * positionStride, sizeof(Vector3));
+
+    // Vertices sharing their position with another vertex lie on an attribute seam
+    {
+      std::unordered_map<Vector3, uint32_t, PositionHash, PositionEqual> firstVertexAtPosition;
+      firstVertexAtPosition.reserve(vertexCount);
+
+      for (uint32_t i = 0; i < vertexCount; i++) {
+        auto result = firstVertexAtPosition.emplace(m_positions[i], i);
+
+        if (!result.second) {
+          m_isVertexLocked[i] = true;
+          m_isVertexLocked[result.first->second] = true;
+        }
+      }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edgeTriangleCounts;
+    edgeTriangleCounts.reserve(m_indices.size());
+
+    for (uint32_t t = 0; t < m_isTriangleRemoved.size(); t++) {
+      const uint32_t* triangle = &m_indices[t * 3];
+
+      // Drop degenerate and invalid triangles
+      if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0] ||
+          triangle[0] >= vertexCount || triangle[1] >= vertexCount || triangle[2] >= vertexCount) {
+        m_isTriangleRemoved[t] = true;
+        continue;
+      }
+
+      m_triangleCount++;
+
+      const Vector3& p0 = m_positions[triangle[0]];
+      const Vector3 normal = cross(m_positions[triangle[1]] - p0, m_positions[triangle[2]] - p0);
+      const float normalLength = length(normal);
+
+      // Planes are weighted by triangle area so that densely tessellated regions don't dominate the error
+      Quadric quadric;
+      if (normalLength > 0.f) {
+        const Vector3 unitNormal = normal / normalLength;
+        quadric.addPlane(unitNormal, -dot(unitNormal, p0), 0.5 * normalLength);
+      }
+
+      for (uint32_t i = 0; i < 3; i++) {
+        m_vertexTriangles[triangle[i]].push_back(t);
+        m_quadrics[triangle[i]].add(quadric);
+        edgeTriangleCounts[makeEdgeKey(triangle[i], triangle[(i + 1) % 3])]++;
+      }
+    }
+
+    // Vertices on open borders or on non-manifold edges
+    for (uint32_t t = 0; t < m_isTriangleRemoved.size(); t++) {
+      if (m_isTriangleRemoved[t])
+        continue;
+
+      const uint32_t* triangle = &m_indices[t * 3];
+
+      for (uint32_t i = 0; i < 3; i++) {
+        if (edgeTriangleCounts[makeEdgeKey(triangle[i], triangle[(i + 1) % 3])] != 2) {
+          m_isVertexLocked[triangle[i]] = true;
+          m_isVertexLocked[triangle[(i + 1) % 3]] = true;
+        }
+      }
+    }
+
+    for (uint32_t i = 0; i < vertexCount; i++)
+      evaluateCollapse(i);
+  }
+
+  void MeshSimplifier::simplify(size_t targetIndexCount, float maxError) {
+    const double maxCost = double(maxError) * double(maxError);
+
+    while (getIndexCount() > targetIndexCount && !m_collapses.empty()) {
+      const Collapse collapseToApply = m_collapses.top();
+
+      if (collapseToApply.version != m_vertexVersions[collapseToApply.from] || m_isVertexRemoved[collapseToApply.from]) {
+        m_collapses.pop();
+        continue;
+      }
+
+      // Collapses are ordered by cost, so all the remaining ones exceed the error as well
+      if (collapseToApply.cost > maxCost)
+        break;
+
+      m_collapses.pop();
+
+      // Collapses are validated when evaluated, but the neighbourhood may have changed since
+      if (m_isVertexRemoved[collapseToApply.to] || !isCollapseValid(collapseToApply.from, collapseToApply.to)) {
+        evaluateCollapse(collapseToApply.from);
+        continue;
+      }
+
+      collapse(collapseToApply.from, collapseToApply.to);
+
+      m_error = std::max(m_error, float(std::sqrt(collapseToApply.cost)));
+    }
+  }
+
+  std::vector<uint32_t> MeshSimplifier::getIndices() const {
+    std::vector<uint32_t> indices;
+    indices.reserve(getIndexCount());
+
+    for (uint32_t t = 0; t < m_isTriangleRemoved.size(); t++) {
+      if (!m_isTriangleRemoved[t])
+        indices.insert(indices.end(), &m_indices[t * 3], &m_indices[t * 3] + 3);
+    }
+
+    return indices;
+  }
+
+  void MeshSimplifier::gatherNeighbours(uint32_t vertex, std::vector<uint32_t>& neighbours) const {
+    neighbours.clear();
+
+    for (uint32_t t : m_vertexTriangles[vertex]) {
+      if (m_isTriangleRemoved[t])
+        continue;
+
+      for (uint32_t i = 0; i < 3; i++) {
+        const uint32_t neighbour = m_indices[t * 3 + i];
+
+        if (neighbour != vertex && std::find(neighbours.begin(), neighbours.end(), neighbour) == neighbours.end())
+          neighbours.push_back(neighbour);
+      }
+    }
+  }
+
+  void MeshSimplifier::evaluateCollapse(uint32_t vertex) {
+    // Any collapse of the vertex queued earlier is stale now
+    m_vertexVersions[vertex]++;
+
+    if (m_isVertexLocked[vertex] || m_isVertexRemoved[vertex])
+      return;
+
+    std::vector<uint32_t> neighbours;
+    gatherNeighbours(vertex, neighbours);
+
+    Collapse cheapestCollapse { 0., vertex, UINT32_MAX, m_vertexVersions[vertex] };
+
+    for (uint32_t neighbour : neighbours) {
+      Quadric quadric = m_quadrics[vertex];
+      quadric.add(m_quadrics[neighbour]);
+
+      const double cost = quadric.evaluate(m_positions[neighbour]);
+
+      if ((cheapestCollapse.to == UINT32_MAX || cost < cheapestCollapse.cost) && isCollapseValid(vertex, neighbour)) {
+        cheapestCollapse.cost = cost;
+        cheapestCollapse.to = neighbour;
+      }
+    }
+
+    if (cheapestCollapse.to != UINT32_MAX)
+      m_collapses.push(cheapestCollapse);
+  }
+
+  bool MeshSimplifier::isCollapseValid(uint32_t from, uint32_t to) const {
+    if (m_isVertexLocked[from])
+      return false;
+
+    // The edge must be shared by exactly two triangles whose opposite vertices are the only common neighbours,
+    // otherwise the collapse would create non-manifold geometry
+    std::vector<uint32_t> fromNeighbours;
+    std::vector<uint32_t> toNeighbours;
+    gatherNeighbours(from, fromNeighbours);
+    gatherNeighbours(to, toNeighbours);
+
+    uint32_t numCommonNeighbours = 0;
+    for (uint32_t neighbour : fromNeighbours) {
+      if (std::find(toNeighbours.begin(), toNeighbours.end(), neighbour) != toNeighbours.end())
+        numCommonNeighbours++;
+    }
+
+    if (numCommonNeighbours != 2)
+      return false;
+
+    // Triangles must not flip when the vertex moves
+    const Vector3& toPosition = m_positions[to];
+
+    for (uint32_t t : m_vertexTriangles[from]) {
+      if (m_isTriangleRemoved[t])
+        continue;
+
+      const uint32_t* triangle = &m_indices[t * 3];
+
+      // Triangles on the collapsed edge are removed
+      if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+        continue;
+
+      Vector3 corners[3];
+      for (uint32_t i = 0; i < 3; i++)
+        corners[i] = m_positions[triangle[i]];
+
+      const Vector3 normalBefore = cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+      for (uint32_t i = 0; i < 3; i++) {
+        if (triangle[i] == from)
+          corners[i] = toPosition;
+      }
+
+      const Vector3 normalAfter = cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+      if (dot(normalBefore, normalAfter) <= 0.f)
+        return false;
+    }
+
+    return true;
+  }
+
+  void MeshSimplifier::collapse(uint32_t from, uint32_t to) {
+    for (uint32_t t : m_vertexTriangles[from]) {
+      if (m_isTriangleRemoved[t])
+        continue;
+
+      uint32_t* triangle = &m_indices[t * 3];
+
+      if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+        m_isTriangleRemoved[t] = true;
+        m_triangleCount--;
+        continue;
+      }
+
+      for (uint32_t i = 0; i < 3; i++) {
+        if (triangle[i] == from)
+          triangle[i] = to;
+      }
+
+      m_vertexTriangles[to].push_back(t);
+    }
+
+    m_vertexTriangles[from].clear();
+    m_quadrics[to].add(m_quadrics[from]);
+    m_isVertexRemoved[from] = true;
+
+    // Drop the removed triangles from the target's list, it keeps growing otherwise
+    auto& toTriangles = m_vertexTriangles[to];
+    toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(), [this](uint32_t t) { return m_isTriangleRemoved[t]; }), toTriangles.end());
+
+    // Costs changed for the target and every vertex around it
+    std::vector<uint32_t> neighbours;
+    gatherNeighbours(to, neighbours);
+
+    evaluateCollapse(to);
+    for (uint32_t neighbour : neighbours)
+      evaluateCollapse(neighbour);
+  }
+
+} // namespace dxvk
@@ -0,0 +1,96 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "../../util/util_vector.h"
+
+namespace dxvk {
+
+  // Simplifies triangle lists with edge collapses ordered by their quadric error, used to generate the LODs of replacement meshes.
+  // Vertices are only collapsed onto their neighbours, so the simplified index lists keep referencing the original vertex buffer.
+  // Vertices on open borders and on attribute seams (i.e. sharing their position with another vertex) are never removed,
+  // which preserves the outline of open meshes and keeps texture coordinates and normals from being stretched across seams.
+  class MeshSimplifier {
+  public:
+    // positions point to 3 floats every positionStride bytes
+    MeshSimplifier(const void* positions, size_t positionStride, size_t vertexCount, const uint32_t* indices, size_t indexCount);
+
+    // Collapses edges until at most targetIndexCount indices are left, or until the next collapse would make the error exceed maxError.
+    // Consecutive calls continue from the previous result, so a LOD chain is generated by lowering the target on every call.
+    void simplify(size_t targetIndexCount, float maxError);
+
+    // Returns the index list of the current result
+    std::vector<uint32_t> getIndices() const;
+
+    size_t getIndexCount() const { return m_triangleCount * 3; }
+
+    // Returns the largest collapse error so far, i.e. the root mean square distance of a moved vertex to the planes of the original triangles around it, in position units
+    float getError() const { return m_error; }
+
+  private:
+    // Symmetric 4x4 matrix measuring the weighted sum of squared distances of a point to a set of planes
+    struct Quadric {
+      double a00 = 0., a01 = 0., a02 = 0., a03 = 0., a11 = 0., a12 = 0., a13 = 0., a22 = 0., a23 = 0., a33 = 0.;
+      double weight = 0.;
+
+      void addPlane(const Vector3& normal, float distance, double planeWeight);
+      void add(const Quadric& other);
+      // Returns the weighted mean of the squared distances of p to the planes
+      double evaluate(const Vector3& p) const;
+    };
+
+    struct Collapse {
+      double cost;
+      uint32_t from;
+      uint32_t to;
+      // Version of the from vertex the collapse was evaluated for, the collapse is stale once the vertex is re-evaluated
+      uint32_t version;
+
+      bool operator>(const Collapse& other) const { return cost > other.cost; }
+    };
+
+    void gatherNeighbours(uint32_t vertex, std::vector<uint32_t>& neighbours) const;
+    void evaluateCollapse(uint32_t vertex);
+    bool isCollapseValid(uint32_t from, uint32_t to) const;
+    void collapse(uint32_t from, uint32_t to);
+
+    std::vector<Vector3> m_positions;
+    std::vector<uint32_t> m_indices;
+    std::vector<bool> m_isTriangleRemoved;
+    // Triangles referencing each vertex, may contain removed triangles
+    std::vector<std::vector<uint32_t>> m_vertexTriangles;
+    std::vector<Quadric> m_quadrics;
+    std::vector<bool> m_isVertexLocked;
+    std::vector<bool> m_isVertexRemoved;
+    std::vector<uint32_t> m_vertexVersions;
+    // Cheapest collapse of every unlocked vertex, cheapest first
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> m_collapses;
+    size_t m_triangleCount = 0;
+    float m_error = 0.f;
+  };
+
+} // namespace dxvk
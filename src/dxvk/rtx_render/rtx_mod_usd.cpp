@@ -31,6 +31,7 @@
 #include "rtx_game_capturer_paths.h"
 #include "rtx_utils.h"
 #include "rtx_asset_data_manager.h"
+#include "rtx_mesh_simplifier.h"
 
 #include "../../lssusd/usd_include_begin.h"
 #include <pxr/base/gf/matrix4f.h>
@@ -95,6 +96,7 @@ private:
   MaterialData* processMaterial(Args& args, const pxr::UsdPrim& matPrim);
   MaterialData* processMaterialUser(Args& args, const pxr::UsdPrim& prim);
   bool processMesh(const pxr::UsdPrim& prim, Args& args);
+  void processMeshLods(Args& args, const lss::UsdMeshImporter& mesh, const lss::UsdMeshImporter::SubMesh& submesh, DxvkBufferCreateInfo indexBufferInfo, MeshReplacement& replacement);
   void processPrim(Args& args, pxr::UsdPrim& prim);
 
   void processLight(Args& args, const pxr::UsdPrim& lightPrim);
@@ -1290,12 +1292,76 @@ bool UsdMod::Impl::processMesh(const pxr::UsdPrim& prim, Args& args) {
       // Set these as hashed so that the geometryData acts like it's static.
       newGeomData.hashes[HashComponents::Indices] = newGeomData.hashes[HashComponents::VertexPosition] = getNextGeomHash();
       newGeomData.hashes.precombine();
+
+      if (newGeomData.positionBuffer.defined()) {
+        // Replacement geometry skips the draw call processing which computes bounding boxes, so do it here once
+        const uint8_t* positions = reinterpret_cast<const uint8_t*>(processedMesh->GetVertexData().data()) + newGeomData.positionBuffer.offsetFromSlice();
+        for (uint32_t index : submesh.indexBuffer) {
+          const Vector3& position = *reinterpret_cast<const Vector3*>(positions + index * processedMesh->GetVertexStride());
+          newGeomData.boundingBox.unionWith(AxisAlignedBoundingBox { position, position });
+        }
+
+        // Skinned replacements are deformed every frame, errors measured in the bind pose don't hold for them
+        if (RtxOptions::ReplacementMeshLod::enable() && newGeomData.numBonesPerVertex == 0) {
+          processMeshLods(args, *processedMesh, submesh, info, newReplacement);
+        }
+      }
     }
   }
 
   return true;
 }
 
+void UsdMod::Impl::processMeshLods(Args& args, const lss::UsdMeshImporter& mesh, const lss::UsdMeshImporter::SubMesh& submesh, DxvkBufferCreateInfo indexBufferInfo, MeshReplacement& replacement) {
+  ScopedCpuProfileZone();
+
+  const uint32_t minTriangles = RtxOptions::ReplacementMeshLod::minTriangles();
+  const uint32_t maxLevels = RtxOptions::ReplacementMeshLod::maxLevels();
+  const float reductionPerLevel = std::clamp(RtxOptions::ReplacementMeshLod::reductionPerLevel(), 0.f, 1.f);
+
+  if (submesh.GetNumIndices() / 3 < minTriangles || maxLevels == 0) {
+    return;
+  }
+
+  const RasterGeometry& geometryData = replacement.data;
+  const uint8_t* positions = reinterpret_cast<const uint8_t*>(mesh.GetVertexData().data()) + geometryData.positionBuffer.offsetFromSlice();
+
+  MeshSimplifier simplifier(positions, mesh.GetVertexStride(), mesh.GetNumVertices(), submesh.indexBuffer.data(), submesh.GetNumIndices());
+
+  size_t previousIndexCount = submesh.GetNumIndices();
+
+  for (uint32_t level = 0; level < maxLevels; level++) {
+    const size_t targetIndexCount = static_cast<size_t>(previousIndexCount / 3 * reductionPerLevel) * 3;
+    simplifier.simplify(targetIndexCount, FLT_MAX);
+
+    // Stop once the simplifier gets stuck on locked vertices, another level would cost a BLAS without saving much
+    const size_t indexCount = simplifier.getIndexCount();
+    if (indexCount == 0 || indexCount > previousIndexCount * 9 / 10) {
+      break;
+    }
+
+    const std::vector<uint32_t> indices = simplifier.getIndices();
+    const size_t indexDataSize = indices.size() * sizeof(uint32_t);
+    indexBufferInfo.size = dxvk::align(indexDataSize, CACHE_LINE_SIZE);
+
+    Rc<DxvkBuffer> indexBuffer = args.context->getDevice()->createBuffer(indexBufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, DxvkMemoryStats::Category::RTXBuffer);
+    const DxvkBufferSlice& indexSlice = DxvkBufferSlice(indexBuffer);
+    memcpy(indexSlice.mapPtr(0), indices.data(), indexDataSize);
+
+    // Every level shares the vertex buffer but needs its own hashes, so that it gets its own BLAS
+    MeshReplacement::Lod& lod = replacement.lods.emplace_back(MeshReplacement::Lod { geometryData, simplifier.getError() });
+    lod.data.indexBuffer = RasterBuffer(indexSlice, 0, sizeof(uint32_t), VK_INDEX_TYPE_UINT32);
+    lod.data.indexCount = indices.size();
+    lod.data.hashes[HashComponents::Indices] = lod.data.hashes[HashComponents::VertexPosition] = getNextGeomHash();
+    lod.data.hashes.precombine();
+
+    previousIndexCount = indexCount;
+  }
+
+  Logger::info(str::format("Generated ", replacement.lods.size(), " levels of detail for ", submesh.prim.GetPath().GetString(),
+                           ", ", submesh.GetNumIndices() / 3, " triangles reduced to ", previousIndexCount / 3));
+}
+
 UsdMod::UsdMod(const Mod::Path& usdFilePath)
 : Mod(usdFilePath) {
   m_impl = std::make_unique<Impl>(*this);
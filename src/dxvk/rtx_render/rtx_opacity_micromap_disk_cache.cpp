@@ -0,0 +1,479 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include "rtx_opacity_micromap_disk_cache.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+
+#include "../../util/log/log.h"
+#include "../../util/util_env.h"
+#include "../../util/util_once.h"
+#include "../../util/util_string.h"
+
+namespace fs = std::filesystem;
+
+namespace dxvk {
+
+  namespace {
+    constexpr uint32_t kMagic = 0x434D4D4F; // "OMMC"
+    // Bump whenever the file layout or the baking results change
+    constexpr uint32_t kVersion = 1;
+
+    struct FileHeader {
+      uint32_t magic = kMagic;
+      uint32_t version = kVersion;
+      XXH64_hash_t key = 0;
+      OpacityMicromapDiskCacheDesc desc;
+      uint64_t dataSize = 0;
+      XXH64_hash_t dataHash = 0;
+    };
+
+    bool parseKey(const fs::path& path, XXH64_hash_t& key) {
+      const std::string stem = path.stem().string();
+
+      if (stem.size() != 16 || stem.find_first_not_of("0123456789abcdef") != std::string::npos)
+        return false;
+
+      key = std::stoull(stem, nullptr, 16);
+      return true;
+    }
+  }
+
+  fs::path OpacityMicromapDiskCache::getFilePath(const fs::path& directory, XXH64_hash_t key) {
+    char fileName[32];
+    std::snprintf(fileName, sizeof(fileName), "%016" PRIx64 "%s", static_cast<uint64_t>(key), kFileExtension);
+    return directory / fileName;
+  }
+
+  std::vector<std::pair<XXH64_hash_t, OpacityMicromapDiskCache::Entry>> OpacityMicromapDiskCache::indexDirectory(const fs::path& directory, bool isReadOnly) {
+    std::vector<std::pair<XXH64_hash_t, Entry>> entries;
+    std::vector<fs::file_time_type> lastWriteTimes;
+    std::error_code ec;
+
+    for (const fs::directory_entry& dirEntry : fs::directory_iterator(directory, ec)) {
+      XXH64_hash_t key;
+
+      if (!dirEntry.is_regular_file(ec) || dirEntry.path().extension() != kFileExtension || !parseKey(dirEntry.path(), key))
+        continue;
+
+      Entry entry;
+      entry.path = dirEntry.path();
+      entry.size = dirEntry.file_size(ec);
+      entry.isReadOnly = isReadOnly;
+
+      entries.emplace_back(key, std::move(entry));
+      lastWriteTimes.push_back(dirEntry.last_write_time(ec));
+    }
+
+    // Order the entries from the least to the most recently used
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); i++)
+      order[i] = i;
+
+    std::sort(order.begin(), order.end(), [&lastWriteTimes](size_t a, size_t b) {
+      return lastWriteTimes[a] < lastWriteTimes[b];
+    });
+
+    std::vector<std::pair<XXH64_hash_t, Entry>> orderedEntries;
+    orderedEntries.reserve(entries.size());
+
+    for (size_t i : order)
+      orderedEntries.push_back(std::move(entries[i]));
+
+    return orderedEntries;
+  }
+
+  bool OpacityMicromapDiskCache::open(const std::string& directory, uint64_t maxSizeBytes) {
+    close();
+
+    std::error_code ec;
+    const fs::path directoryPath = fs::absolute(fs::path(directory), ec).lexically_normal();
+
+    if (ec || (!fs::create_directories(directoryPath, ec) && !fs::is_directory(directoryPath, ec))) {
+      Logger::warn(str::format("[RTX Opacity Micromap] Failed to open the disk cache directory ", directory, ". Baked Opacity Micromaps will not be cached on disk."));
+      return false;
+    }
+
+    m_directory = directoryPath;
+    m_maxSize = maxSizeBytes;
+    m_stopWorker = false;
+
+    m_worker = dxvk::thread([this] {
+      env::setThreadName("rtx-omm-disk-cache");
+      workerFunc();
+    });
+
+    for (auto& [key, entry] : indexDirectory(m_directory, false))
+      addEntry(key, std::move(entry));
+
+    Logger::info(str::format("[RTX Opacity Micromap] Opened the disk cache in ", m_directory.string(), " with ", m_entries.size(), " entries, ", m_size / (1024 * 1024), " MB."));
+
+    evictLeastRecentlyUsedEntries();
+
+    return true;
+  }
+
+  void OpacityMicromapDiskCache::addReadOnlyDirectory(const std::string& directory) {
+    std::error_code ec;
+
+    if (!fs::is_directory(directory, ec))
+      return;
+
+    uint32_t numEntries = 0;
+
+    for (auto& [key, entry] : indexDirectory(directory, true)) {
+      if (contains(key))
+        continue;
+
+      addEntry(key, std::move(entry));
+      ++numEntries;
+    }
+
+    Logger::info(str::format("[RTX Opacity Micromap] Added ", numEntries, " entries from the read-only disk cache in ", directory, "."));
+  }
+
+  OpacityMicromapDiskCache::~OpacityMicromapDiskCache() {
+    close();
+  }
+
+  void OpacityMicromapDiskCache::close() {
+    if (m_worker.joinable()) {
+      {
+        std::unique_lock<dxvk::mutex> lock(m_mutex);
+        m_stopWorker = true;
+        m_condOnRequest.notify_one();
+      }
+
+      // Note: the worker completes the queued requests before it exits, so no stored entry is lost
+      m_worker.join();
+    }
+
+    m_requests.clear();
+    m_completedRequests.clear();
+    m_numIncompleteRequests = 0;
+
+    m_entries.clear();
+    m_leastRecentlyUsedList.clear();
+    m_directory.clear();
+    m_size = 0;
+  }
+
+  void OpacityMicromapDiskCache::addEntry(XXH64_hash_t key, Entry&& entry) {
+    if (!entry.isReadOnly) {
+      m_leastRecentlyUsedList.push_back(key);
+      entry.leastRecentlyUsedListIter = std::prev(m_leastRecentlyUsedList.end());
+      m_size += entry.size;
+    }
+
+    m_entries[key] = std::move(entry);
+  }
+
+  void OpacityMicromapDiskCache::removeEntry(std::unordered_map<XXH64_hash_t, Entry>::iterator entryIter, bool deleteFile) {
+    Entry& entry = entryIter->second;
+
+    if (!entry.isReadOnly) {
+      m_leastRecentlyUsedList.erase(entry.leastRecentlyUsedListIter);
+      m_size -= std::min(m_size, entry.size);
+
+      if (deleteFile) {
+        IORequest request;
+        request.type = IORequestType::Remove;
+        request.path = entry.path;
+        queueRequest(std::move(request));
+      }
+    }
+
+    m_entries.erase(entryIter);
+  }
+
+  void OpacityMicromapDiskCache::evictLeastRecentlyUsedEntries() {
+    while (m_size > m_maxSize && !m_leastRecentlyUsedList.empty())
+      removeEntry(m_entries.find(m_leastRecentlyUsedList.front()), true);
+  }
+
+  void OpacityMicromapDiskCache::setMaxSize(uint64_t maxSizeBytes) {
+    m_maxSize = maxSizeBytes;
+    evictLeastRecentlyUsedEntries();
+  }
+
+  uint64_t OpacityMicromapDiskCache::requestLoad(XXH64_hash_t key, const OpacityMicromapDiskCacheDesc& desc) {
+    auto entryIter = m_entries.find(key);
+
+    if (entryIter == m_entries.end())
+      return 0;
+
+    Entry& entry = entryIter->second;
+
+    // Mark the entry as the most recently used one, the worker persists that for the following sessions
+    if (!entry.isReadOnly)
+      m_leastRecentlyUsedList.splice(m_leastRecentlyUsedList.end(), m_leastRecentlyUsedList, entry.leastRecentlyUsedListIter);
+
+    IORequest request;
+    request.type = IORequestType::Load;
+    request.key = key;
+    request.desc = desc;
+    request.path = entry.path;
+    request.isReadOnly = entry.isReadOnly;
+    queueRequest(std::move(request));
+
+    return entry.size;
+  }
+
+  bool OpacityMicromapDiskCache::requestStore(XXH64_hash_t key, const OpacityMicromapDiskCacheDesc& desc, std::vector<uint8_t>&& data) {
+    if (!isOpen() || sizeof(FileHeader) + data.size() > m_maxSize)
+      return false;
+
+    auto entryIter = m_entries.find(key);
+
+    if (entryIter != m_entries.end()) {
+      // Entries in the writable cache are immutable since they're content addressed
+      if (!entryIter->second.isReadOnly)
+        return true;
+
+      // The writable cache takes over the key from the read-only cache
+      removeEntry(entryIter, false);
+    }
+
+    // The entry is indexed right away, the worker completes the store before any later request reads or removes the file
+    Entry entry;
+    entry.path = getFilePath(m_directory, key);
+    entry.size = sizeof(FileHeader) + data.size();
+
+    IORequest request;
+    request.type = IORequestType::Store;
+    request.key = key;
+    request.desc = desc;
+    request.path = entry.path;
+    request.data = std::move(data);
+
+    addEntry(key, std::move(entry));
+    queueRequest(std::move(request));
+
+    evictLeastRecentlyUsedEntries();
+
+    return true;
+  }
+
+  void OpacityMicromapDiskCache::popLoadedEntries(std::vector<LoadedEntry>& loadedEntries) {
+    std::vector<IORequest> completedRequests;
+
+    {
+      std::unique_lock<dxvk::mutex> lock(m_mutex);
+      completedRequests.swap(m_completedRequests);
+    }
+
+    for (IORequest& request : completedRequests) {
+      // Drop the entries which can't be used, unless their key was taken over by another entry since
+      if (request.status == IOStatus::Failure) {
+        auto entryIter = m_entries.find(request.key);
+
+        if (entryIter != m_entries.end() && entryIter->second.path == request.path) {
+          if (request.type == IORequestType::Load)
+            Logger::warn(str::format("[RTX Opacity Micromap] Discarding invalid disk cache entry ", request.path.string(), "."));
+
+          // Note: failed stores have already cleaned up after themselves
+          removeEntry(entryIter, request.type == IORequestType::Load);
+        }
+      }
+
+      if (request.type != IORequestType::Load)
+        continue;
+
+      LoadedEntry& loadedEntry = loadedEntries.emplace_back();
+      loadedEntry.key = request.key;
+      loadedEntry.isValid = request.status == IOStatus::Success;
+      loadedEntry.data = std::move(request.data);
+    }
+  }
+
+  void OpacityMicromapDiskCache::sync() const {
+    std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+    m_condOnIdle.wait(lock, [this] {
+      return m_numIncompleteRequests == 0;
+    });
+  }
+
+  void OpacityMicromapDiskCache::queueRequest(IORequest&& request) {
+    std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+    m_requests.push_back(std::move(request));
+    ++m_numIncompleteRequests;
+
+    m_condOnRequest.notify_one();
+  }
+
+  void OpacityMicromapDiskCache::workerFunc() {
+    std::unique_lock<dxvk::mutex> lock(m_mutex);
+
+    while (true) {
+      m_condOnRequest.wait(lock, [this] {
+        return !m_requests.empty() || m_stopWorker;
+      });
+
+      // Requests queued before the stop are still completed
+      if (m_requests.empty())
+        break;
+
+      IORequest request = std::move(m_requests.front());
+      m_requests.pop_front();
+
+      lock.unlock();
+
+      switch (request.type) {
+      case IORequestType::Load:
+        readEntry(request);
+        break;
+      case IORequestType::Store:
+        writeEntry(request);
+        break;
+      case IORequestType::Remove: {
+        std::error_code ec;
+        fs::remove(request.path, ec);
+        break;
+      }
+      }
+
+      // The stored data isn't needed anymore
+      if (request.type == IORequestType::Store)
+        request.data = std::vector<uint8_t>();
+
+      lock.lock();
+
+      // Loads and failed stores are handled on the calling thread, see popLoadedEntries()
+      if (request.type == IORequestType::Load || request.status == IOStatus::Failure)
+        m_completedRequests.push_back(std::move(request));
+
+      --m_numIncompleteRequests;
+
+      if (m_numIncompleteRequests == 0)
+        m_condOnIdle.notify_all();
+    }
+  }
+
+  void OpacityMicromapDiskCache::readEntry(IORequest& request) {
+    std::error_code ec;
+    const uint64_t fileSize = fs::file_size(request.path, ec);
+
+    std::ifstream file(request.path, std::ios::binary);
+    FileHeader header;
+
+    const bool isValid =
+      !ec &&
+      file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+      header.magic == kMagic &&
+      header.version == kVersion &&
+      header.key == request.key &&
+      header.dataSize == fileSize - sizeof(header);
+
+    request.status = IOStatus::Failure;
+
+    if (!isValid)
+      return;
+
+    // A valid entry with another layout isn't loaded, but is kept for the requests it was baked for
+    if (!(header.desc == request.desc)) {
+      request.status = IOStatus::LayoutMismatch;
+      return;
+    }
+
+    request.data.resize(header.dataSize);
+
+    if (!file.read(reinterpret_cast<char*>(request.data.data()), request.data.size()) ||
+        XXH3_64bits(request.data.data(), request.data.size()) != header.dataHash) {
+      request.data.clear();
+      return;
+    }
+
+    if (!request.isReadOnly)
+      fs::last_write_time(request.path, fs::file_time_type::clock::now(), ec);
+
+    request.status = IOStatus::Success;
+  }
+
+  void OpacityMicromapDiskCache::writeEntry(IORequest& request) {
+    FileHeader header;
+    header.key = request.key;
+    header.desc = request.desc;
+    header.dataSize = request.data.size();
+    header.dataHash = XXH3_64bits(request.data.data(), request.data.size());
+
+    // Write to a temporary file first, so that an interrupted write never leaves a partial entry behind
+    fs::path tempPath = request.path;
+    tempPath += ".tmp";
+
+    request.status = IOStatus::Failure;
+
+    {
+      std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+      if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+          !file.write(reinterpret_cast<const char*>(request.data.data()), request.data.size())) {
+        file.close();
+
+        std::error_code ec;
+        fs::remove(tempPath, ec);
+
+        ONCE(Logger::warn(str::format("[RTX Opacity Micromap] Failed to write the disk cache entry ", request.path.string(), ".")));
+        return;
+      }
+    }
+
+    std::error_code ec;
+    fs::rename(tempPath, request.path, ec);
+
+    if (ec) {
+      fs::remove(tempPath, ec);
+      return;
+    }
+
+    request.status = IOStatus::Success;
+  }
+
+  uint32_t OpacityMicromapDiskCache::exportTo(const std::string& directory) const {
+    // Complete the pending stores first
+    sync();
+
+    std::error_code ec;
+    const fs::path directoryPath = fs::absolute(fs::path(directory), ec).lexically_normal();
+
+    if (ec || (!fs::create_directories(directoryPath, ec) && !fs::is_directory(directoryPath, ec))) {
+      Logger::err(str::format("[RTX Opacity Micromap] Failed to create the disk cache export directory ", directory, "."));
+      return 0;
+    }
+
+    uint32_t numExported = 0;
+
+    for (const XXH64_hash_t key : m_leastRecentlyUsedList) {
+      const Entry& entry = m_entries.at(key);
+
+      if (fs::copy_file(entry.path, getFilePath(directoryPath, key), fs::copy_options::overwrite_existing, ec))
+        ++numExported;
+    }
+
+    Logger::info(str::format("[RTX Opacity Micromap] Exported ", numExported, " disk cache entries to ", directoryPath.string(), "."));
+
+    return numExported;
+  }
+}
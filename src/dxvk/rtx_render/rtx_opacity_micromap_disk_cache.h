@@ -0,0 +1,165 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../util/thread.h"
+#include "../../util/xxHash/xxhash.h"
+
+namespace dxvk {
+
+  // Describes the layout of a baked Opacity Micromap array, an entry is only loaded when its layout matches the requested one
+  struct OpacityMicromapDiskCacheDesc {
+    uint32_t numTriangles = 0;
+    uint32_t subdivisionLevel = 0;
+    uint32_t ommFormat = 0;      // VkOpacityMicromapFormatEXT
+    uint32_t pad32 = 0;
+
+    bool operator==(const OpacityMicromapDiskCacheDesc& other) const {
+      return numTriangles == other.numTriangles &&
+             subdivisionLevel == other.subdivisionLevel &&
+             ommFormat == other.ommFormat;
+    }
+  };
+
+  // Content addressed on-disk cache of baked Opacity Micromap arrays.
+  // Every entry is a file named after its key, which hashes all the inputs of the bake. The writable cache directory is
+  // kept within a size cap by evicting the least recently used entries, the usage order persists across sessions through
+  // the files' modification times. Read-only directories, i.e. caches exported alongside mods, are looked up as well.
+  // The index of the entries is owned by the calling thread, while the files are read and written by a worker thread.
+  // The worker processes the requests in order, so an entry can be loaded and evicted as soon as its store was requested.
+  class OpacityMicromapDiskCache {
+  public:
+    // Result of a load request
+    struct LoadedEntry {
+      XXH64_hash_t key = 0;
+      bool isValid = false;   // Whether the entry was read successfully and its layout matches the requested one
+      std::vector<uint8_t> data;
+    };
+
+    ~OpacityMicromapDiskCache();
+
+    // Opens the writable cache in the directory, creating the directory if needed, and indexes the entries already in it
+    bool open(const std::string& directory, uint64_t maxSizeBytes);
+    // Adds a read-only cache directory, entries in the writable cache take priority over the ones found here
+    void addReadOnlyDirectory(const std::string& directory);
+    // Completes the requests queued so far and closes the cache
+    void close();
+
+    bool isOpen() const { return !m_directory.empty(); }
+
+    bool contains(XXH64_hash_t key) const {
+      return m_entries.find(key) != m_entries.end();
+    }
+
+    // Queues reading an entry, its data is returned by popLoadedEntries() once read. Returns the size of the entry, or 0 if it's missing.
+    // Note: a load request marks the entry as the most recently used one
+    uint64_t requestLoad(XXH64_hash_t key, const OpacityMicromapDiskCacheDesc& desc);
+
+    // Queues writing an entry into the writable cache, evicting the least recently used entries to stay within the size cap
+    bool requestStore(XXH64_hash_t key, const OpacityMicromapDiskCacheDesc& desc, std::vector<uint8_t>&& data);
+
+    // Returns the entries read since the previous call. Corrupted entries are dropped, entries with another layout are kept.
+    void popLoadedEntries(std::vector<LoadedEntry>& loadedEntries);
+
+    // Waits for the worker thread to complete all the queued requests
+    void sync() const;
+
+    void setMaxSize(uint64_t maxSizeBytes);
+
+    // Copies the entries of the writable cache into a directory, i.e. one shipped with a mod. Returns the number of entries copied.
+    uint32_t exportTo(const std::string& directory) const;
+
+    uint64_t getSize() const { return m_size; }
+    uint32_t getEntryCount() const { return static_cast<uint32_t>(m_entries.size()); }
+
+    static constexpr const char* kFileExtension = ".omm";
+
+  private:
+    struct Entry {
+      std::filesystem::path path;
+      uint64_t size = 0;
+      bool isReadOnly = false;
+      std::list<XXH64_hash_t>::iterator leastRecentlyUsedListIter;
+    };
+
+    enum class IORequestType {
+      Load,
+      Store,
+      Remove
+    };
+
+    enum class IOStatus {
+      Success,
+      LayoutMismatch,
+      Failure
+    };
+
+    struct IORequest {
+      IORequestType type = IORequestType::Load;
+      XXH64_hash_t key = 0;
+      OpacityMicromapDiskCacheDesc desc;
+      std::filesystem::path path;
+      bool isReadOnly = false;
+      std::vector<uint8_t> data;
+      IOStatus status = IOStatus::Success;
+    };
+
+    // Indexes the entry files in a directory, returns them ordered from the least to the most recently used
+    static std::vector<std::pair<XXH64_hash_t, Entry>> indexDirectory(const std::filesystem::path& directory, bool isReadOnly);
+    static std::filesystem::path getFilePath(const std::filesystem::path& directory, XXH64_hash_t key);
+
+    // File IO, run on the worker thread
+    static void readEntry(IORequest& request);
+    static void writeEntry(IORequest& request);
+
+    void addEntry(XXH64_hash_t key, Entry&& entry);
+    void removeEntry(std::unordered_map<XXH64_hash_t, Entry>::iterator entryIter, bool deleteFile);
+    void evictLeastRecentlyUsedEntries();
+
+    void queueRequest(IORequest&& request);
+    void workerFunc();
+
+    std::filesystem::path m_directory;
+    uint64_t m_maxSize = 0;
+    uint64_t m_size = 0;   // Size of the writable cache
+
+    std::unordered_map<XXH64_hash_t, Entry> m_entries;
+    std::list<XXH64_hash_t> m_leastRecentlyUsedList;  // Writable cache entries, starting with the least recently used one
+
+    dxvk::thread m_worker;
+    mutable dxvk::mutex m_mutex;
+    dxvk::condition_variable m_condOnRequest;
+    mutable dxvk::condition_variable m_condOnIdle;
+    std::deque<IORequest> m_requests;
+    std::vector<IORequest> m_completedRequests;   // Loads and failed stores to be handled on the calling thread
+    uint32_t m_numIncompleteRequests = 0;
+    bool m_stopWorker = false;
+  };
+}
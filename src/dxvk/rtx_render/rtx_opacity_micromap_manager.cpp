@@ -207,6 +207,9 @@ namespace dxvk {
 
   void OpacityMicromapManager::onDestroy() {
     m_scratchAllocator = nullptr;
+    m_pendingReadBacks.clear();
+    m_pendingDiskCacheLoads.clear();
+    m_diskCache.close();
   }
 
   OmmRequest::OmmRequest(const RtInstance& _instance, const InstanceManager& instanceManager, uint32_t _quadSliceIndex)
@@ -436,6 +439,7 @@ namespace dxvk {
     m_ommBuildRequestStatistics.clear();
 
     m_instanceOmmRequests.clear();
+    m_pendingDiskCacheLoads.clear();
 
     m_memoryManager.releaseAll();
     m_amountOfMemoryMissing = 0;
@@ -494,11 +498,27 @@ namespace dxvk {
     }
 
 
+    if (ImGui::CollapsingHeader("Disk Cache", collapsingHeaderClosedFlags)) {
+      ImGui::Indent();
+      ImGui::Checkbox("Enable", &OpacityMicromapOptions::DiskCache::enableObject());
+      ImGui::DragInt("Max Size [MB]", &OpacityMicromapOptions::DiskCache::maxSizeMBObject(), 16.f, 0, 256 * 1024, "%d", sliderFlags);
+      ADVANCED(ImGui::DragInt("Max IO Size Per Frame [MB]", &OpacityMicromapOptions::DiskCache::maxIOSizeMBPerFrameObject(), 1.f, 1, 1024, "%d", sliderFlags));
+      ImGui::Text("# Entries: %u", m_diskCache.getEntryCount());
+      ImGui::Text("Size [MB]: %u", static_cast<uint32_t>(m_diskCache.getSize() / (1024 * 1024)));
+      ImGui::Text("# Loaded/Stored Items: %u/%u", m_numLoadedFromDiskCache, m_numStoredToDiskCache);
+
+      if (ImGui::Button("Export to Mods"))
+        exportDiskCacheToMods();
+
+      ImGui::Unindent();
+    }
+
     if (ImGui::CollapsingHeader("Requests Filter", collapsingHeaderClosedFlags)) {
       ImGui::Indent();
       ImGui::Checkbox("Enable Filtering", &OpacityMicromapOptions::BuildRequests::filteringObject());
       ImGui::Checkbox("Animated Instances", &OpacityMicromapOptions::BuildRequests::enableAnimatedInstancesObject());
       ImGui::Checkbox("Particles", &OpacityMicromapOptions::BuildRequests::enableParticlesObject());
+      ImGui::Checkbox("Prioritize by Visibility", &OpacityMicromapOptions::BuildRequests::prioritizeByVisibilityObject());
       ADVANCED(ImGui::Checkbox("Custom Filters for Billboards", &OpacityMicromapOptions::BuildRequests::customFiltersForBillboardsObject()));
       
       ADVANCED(ImGui::DragInt("Max Staged Requests", &OpacityMicromapOptions::BuildRequests::maxRequestsObject(), 1.f, 1, 1000 * 1000, "%d", sliderFlags));
@@ -795,8 +815,9 @@ namespace dxvk {
     CachedSourceData& sourceData = sourceDataIter->second;
 
     // Billboard requests go to the end since they are expected to be changed at high frequency and trigger a lot of builds.
-    // Therefore, we want to prioritize building ommRequests that passed standard OMM registration filter tests first
-    if (!ommRequest.isBillboardOmmRequest()) {
+    // Therefore, we want to prioritize building ommRequests that passed standard OMM registration filter tests first.
+    // Note: with prioritization by visibility the list is reordered every frame instead, see prioritizeOpacityMicromaps()
+    if (!ommRequest.isBillboardOmmRequest() && !OpacityMicromapOptions::BuildRequests::prioritizeByVisibility()) {
       // Add the OMM request to the unprocessed list according to the numTriangle count in an ascending order 
       // so that requests with least triangles are processed first and thus with lower overall latency
       for (auto itemIter = m_unprocessedList.begin(); itemIter != m_unprocessedList.end(); itemIter++) {
@@ -1178,6 +1199,30 @@ namespace dxvk {
       sizeInfo.micromapSize + 2 * kBufferInBlasUsageAlignment;
   }
 
+  OpacityMicromapManager::OmmResult OpacityMicromapManager::preallocateDeviceMemory(OpacityMicromapCacheItem& ommCacheItem, uint32_t numTriangles) {
+    if (ommCacheItem.getDeviceSize() != 0)
+      return OmmResult::Success;
+
+    VkDeviceSize arrayBufferDeviceSize;
+    VkDeviceSize blasOmmBuffersDeviceSize;
+
+    const VkIndexType triangleIndexType = numTriangles <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    calculateRequiredVRamSize(numTriangles, ommCacheItem.subdivisionLevel, ommCacheItem.ommFormat, triangleIndexType,
+                              arrayBufferDeviceSize, blasOmmBuffersDeviceSize);
+
+    VkDeviceSize requiredDeviceSize = arrayBufferDeviceSize + blasOmmBuffersDeviceSize;
+
+    if (!m_memoryManager.allocate(requiredDeviceSize)) {
+      m_amountOfMemoryMissing += requiredDeviceSize;
+      return OmmResult::OutOfMemory;
+    }
+
+    ommCacheItem.arrayBufferDeviceSize = arrayBufferDeviceSize;
+    ommCacheItem.blasOmmBuffersDeviceSize = blasOmmBuffersDeviceSize;
+
+    return OmmResult::Success;
+  }
+
   OpacityMicromapManager::OmmResult OpacityMicromapManager::bakeOpacityMicromapArray(
     Rc<DxvkContext> ctx,
     XXH64_hash_t ommSrcHash,
@@ -1208,32 +1253,21 @@ namespace dxvk {
     const uint32_t opacityMicromapBufferSize = numTriangles * opacityMicromapPerTriangleBufferSize;
 
     // Preallocate all the device memory needed to build the OMM item
-    if (ommCacheItem.getDeviceSize() == 0)
     {
-      VkDeviceSize arrayBufferDeviceSize;
-      VkDeviceSize blasOmmBuffersDeviceSize;
-
-      const VkIndexType triangleIndexType = numTriangles <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
-      calculateRequiredVRamSize(numTriangles, ommCacheItem.subdivisionLevel, ommCacheItem.ommFormat, triangleIndexType,
-                                arrayBufferDeviceSize, blasOmmBuffersDeviceSize);
+      const OmmResult result = preallocateDeviceMemory(ommCacheItem, numTriangles);
 
-      VkDeviceSize requiredDeviceSize = arrayBufferDeviceSize + blasOmmBuffersDeviceSize;
-
-      if (!m_memoryManager.allocate(requiredDeviceSize)) {
-        m_amountOfMemoryMissing += requiredDeviceSize;
-        return OmmResult::OutOfMemory;
-      }
-
-      ommCacheItem.arrayBufferDeviceSize = arrayBufferDeviceSize;
-      ommCacheItem.blasOmmBuffersDeviceSize = blasOmmBuffersDeviceSize;
+      if (result != OmmResult::Success)
+        return result;
     }
 
     // Create micromap buffer
     if (!ommCacheItem.ommArrayBuffer.ptr())
     {
+      // Note: the baked array is copied out to be stored in the disk cache, see readBackOpacityMicromapArray()
       DxvkBufferCreateInfo ommBufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-      ommBufferInfo.usage = VK_BUFFER_USAGE_MICROMAP_BUILD_INPUT_READ_ONLY_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
-      ommBufferInfo.access = VK_ACCESS_SHADER_WRITE_BIT;
+      ommBufferInfo.usage = VK_BUFFER_USAGE_MICROMAP_BUILD_INPUT_READ_ONLY_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+      ommBufferInfo.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+      ommBufferInfo.access = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
       ommBufferInfo.size = opacityMicromapBufferSize;
       ommCacheItem.ommArrayBuffer = m_device->createBuffer(ommBufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DxvkMemoryStats::Category::RTXOpacityMicromap);
 
@@ -1394,6 +1428,9 @@ namespace dxvk {
       ctx->getCommandList()->trackResource<DxvkAccess::Read>(triangleArrayBuffer);
       ctx->getCommandList()->trackResource<DxvkAccess::Write>(scratchSlice.buffer());
 
+      // Persist the baked array before it's released
+      readBackOpacityMicromapArray(ctx, ommCacheItem, numTriangles, opacityMicromapBufferSize);
+
       // Release OMM array memory as it's no longer needed after the build
       {
         m_memoryManager.release(ommCacheItem.arrayBufferDeviceSize);
@@ -1432,6 +1469,90 @@ namespace dxvk {
     return OmmResult::Success;
   }
 
+  float OpacityMicromapManager::calculateBuildPriority(const RtInstance& instance, uint32_t numTriangles, const RtCamera& camera) const {
+    // Any-hit work saved by an OMM scales with the number of rays hitting the instance,
+    // which is approximated by the solid angle of the instance's bounding sphere as seen from the camera
+    const float distanceSqr = lengthSqr(instance.getWorldPosition() - camera.getPosition(false));
+    float radiusSqr = 1.f;
+
+    // Note: mesh bounding boxes are only calculated when a feature needs them, a unit radius is used otherwise
+    const AxisAlignedBoundingBox& boundingBox = instance.getBlas()->input.getGeometryData().boundingBox;
+    if (boundingBox.isValid()) {
+      const Vector4 worldExtent = instance.getTransform() * Vector4(boundingBox.maxPos - boundingBox.minPos, 0.f);
+      radiusSqr = std::max(0.25f * lengthSqr(worldExtent.xyz()), FLT_MIN);
+    }
+
+    const float screenCoverage = radiusSqr / (radiusSqr + distanceSqr);
+
+    // Instances which haven't been drawn recently are not hit by rays
+    const uint32_t numFramesSinceDrawn = m_device->getCurrentFrameId() - std::min(instance.getFrameLastUpdated(), m_device->getCurrentFrameId());
+    const float recency = 1.f / (1.f + numFramesSinceDrawn);
+
+    // Bake and build costs scale with the number of triangles
+    return screenCoverage * recency / std::max(numTriangles, 1u);
+  }
+
+  void OpacityMicromapManager::prioritizeOpacityMicromaps(const RtCamera& camera) {
+    ScopedCpuProfileZone();
+
+    for (XXH64_hash_t ommSrcHash : m_unprocessedList) {
+      auto sourceDataIter = m_cachedSourceData.find(ommSrcHash);
+      auto cacheItemIter = m_ommCache.find(ommSrcHash);
+
+      if (sourceDataIter == m_cachedSourceData.end() || cacheItemIter == m_ommCache.end())
+        continue;
+
+      const RtInstance* instance = sourceDataIter->second.getInstance();
+
+      // Items with an unlinked instance keep their last priority
+      if (instance == nullptr || instance->getBlas() == nullptr)
+        continue;
+
+      OpacityMicromapCacheItem& ommCacheItem = cacheItemIter->second;
+      ommCacheItem.buildPriority = calculateBuildPriority(*instance, sourceDataIter->second.numTriangles, camera);
+      ommCacheItem.hasBillboards = instance->getBillboardCount() > 0;
+    }
+
+    sortByBuildPriority(m_unprocessedList);
+    sortByBuildPriority(m_bakedList);
+  }
+
+  void OpacityMicromapManager::sortByBuildPriority(std::list<XXH64_hash_t>& list) {
+    struct SortItem {
+      std::list<XXH64_hash_t>::iterator listIter;
+      bool isBaking;
+      bool hasBillboards;
+      float buildPriority;
+    };
+
+    std::vector<SortItem> sortItems;
+    sortItems.reserve(list.size());
+
+    for (auto listIter = list.begin(); listIter != list.end(); listIter++) {
+      auto cacheItemIter = m_ommCache.find(*listIter);
+
+      if (cacheItemIter == m_ommCache.end())
+        sortItems.push_back({ listIter, false, true, 0.f });
+      else
+        sortItems.push_back({ listIter, cacheItemIter->second.cacheState == OpacityMicromapCacheState::eStep1_Baking,
+                              cacheItemIter->second.hasBillboards, cacheItemIter->second.buildPriority });
+    }
+
+    // Partially baked items are finished first so that they don't hold onto their memory,
+    // and billboard requests go last since they are expected to change at high frequency
+    std::stable_sort(sortItems.begin(), sortItems.end(), [](const SortItem& a, const SortItem& b) {
+      if (a.isBaking != b.isBaking)
+        return a.isBaking;
+      if (a.hasBillboards != b.hasBillboards)
+        return b.hasBillboards;
+      return a.buildPriority > b.buildPriority;
+    });
+
+    // Reorder the list in place, splicing keeps the cache items' list iterators valid
+    for (const SortItem& sortItem : sortItems)
+      list.splice(list.end(), list, sortItem.listIter);
+  }
+
   void OpacityMicromapManager::bakeOpacityMicromapArrays(Rc<DxvkContext> ctx,
                                                          const std::vector<TextureRef>& textures,
                                                          uint32_t& maxMicroTrianglesToBake) {
@@ -1480,11 +1601,20 @@ namespace dxvk {
 
       CachedSourceData& sourceData = sourceDataIter->second;
       OpacityMicromapCacheItem& ommCacheItem = cacheItemIter->second;
-      ommCacheItem.cacheState = OpacityMicromapCacheState::eStep1_Baking;
+
+      // Items found in the disk cache are loaded rather than baked, see loadOpacityMicromapArraysFromDiskCache()
+      if (ommCacheItem.cacheState == OpacityMicromapCacheState::eStep0_Unprocessed && m_diskCache.isOpen() &&
+          sourceData.getInstance() != nullptr && m_diskCache.contains(ommCacheItem.diskCacheKey)) {
+        ommSrcHashIter++;
+        continue;
+      }
 
       OmmResult result = bakeOpacityMicromapArray(ctx, ommSrcHash, ommCacheItem, sourceData, textures, maxMicroTrianglesToBake);
 
       if (result == OmmResult::Success) {
+        // Items only leave the unprocessed state once baking has started, so deferred items can still be loaded from the disk cache
+        ommCacheItem.cacheState = OpacityMicromapCacheState::eStep1_Baking;
+
         // Use >= as the number of baked micro triangles is aligned up
         if (ommCacheItem.bakingState.numMicroTrianglesBaked >= ommCacheItem.bakingState.numMicroTrianglesToBake) {
           // Unlink the referenced RtInstance
@@ -1628,6 +1758,290 @@ namespace dxvk {
     }
   }
 
+  void OpacityMicromapManager::openDiskCache(Rc<DxvkContext> ctx) {
+    const uint64_t maxSize = static_cast<uint64_t>(std::max(OpacityMicromapOptions::DiskCache::maxSizeMB(), 0)) * 1024 * 1024;
+
+    if (!m_diskCache.open(OpacityMicromapOptions::DiskCache::directory(), maxSize)) {
+      m_hasDiskCacheOpenFailed = true;
+      return;
+    }
+
+    // Pick up the caches shipped with mods
+    for (const std::string& modDirectory : ctx->getCommonObjects()->getSceneManager().getAssetReplacer()->getModDirectories())
+      m_diskCache.addReadOnlyDirectory(str::format(modDirectory, "/", kModDiskCacheDirectory));
+  }
+
+  uint32_t OpacityMicromapManager::exportDiskCacheToMods() const {
+    uint32_t numExported = 0;
+
+    for (const std::string& modDirectory : m_device->getCommon()->getSceneManager().getAssetReplacer()->getModDirectories())
+      numExported += m_diskCache.exportTo(str::format(modDirectory, "/", kModDiskCacheDirectory));
+
+    return numExported;
+  }
+
+  XXH64_hash_t OpacityMicromapManager::calculateDiskCacheKey(XXH64_hash_t ommSrcHash,
+                                                             const OpacityMicromapCacheItem& ommCacheItem,
+                                                             const RtInstance& instance,
+                                                             const std::vector<TextureRef>& textures) const {
+    // Instance indices aren't stable across sessions
+    if (OpacityMicromapOptions::Cache::hashInstanceIndexOnly())
+      return kEmptyHash;
+
+    // The source hash refers to the game's textures, while baking reads the textures bound at bake time, which may be replacements.
+    // So the textures are identified by the hashes of their contents.
+    auto getTextureContentHash = [&textures](uint32_t textureIndex) -> XXH64_hash_t {
+      if (textureIndex == BINDING_INDEX_INVALID || textureIndex >= textures.size())
+        return kEmptyHash;
+
+      const TextureRef& texture = textures[textureIndex];
+
+      if (texture.getManagedTexture().ptr() && texture.getManagedTexture()->assetData.ptr())
+        return texture.getManagedTexture()->assetData->hash();
+
+      return texture.getImageHash();
+    };
+
+    // All parameters contributing to a baked OMM array
+    struct DiskCacheKeySourceData {
+      XXH64_hash_t ommSrcHash;
+      XXH64_hash_t opacityTextureHash;
+      XXH64_hash_t secondaryOpacityTextureHash;
+      uint32_t subdivisionLevel;
+      uint32_t ommFormat;   // VkOpacityMicromapFormatEXT
+      uint32_t enableVertexAndTextureOperations;
+      uint32_t enableConservativeEstimation;
+      uint32_t conservativeEstimationMaxTexelTapsPerMicroTriangle;
+      float resolveTransparencyThreshold;
+      float resolveOpaquenessThreshold;
+      uint32_t pad32;
+    };
+
+    static_assert(sizeof(DiskCacheKeySourceData) == 56, "DiskCacheKeySourceData must not contain padding");
+
+    DiskCacheKeySourceData keySourceData;
+    keySourceData.ommSrcHash = ommSrcHash;
+    keySourceData.opacityTextureHash = getTextureContentHash(instance.getAlbedoOpacityTextureIndex());
+    keySourceData.secondaryOpacityTextureHash = instance.getMaterialType() == RtSurfaceMaterialType::RayPortal
+      ? getTextureContentHash(instance.getSecondaryOpacityTextureIndex())
+      : kEmptyHash;
+    keySourceData.subdivisionLevel = ommCacheItem.subdivisionLevel;
+    keySourceData.ommFormat = ommCacheItem.ommFormat;
+    keySourceData.enableVertexAndTextureOperations = OpacityMicromapOptions::Building::enableVertexAndTextureOperations();
+    keySourceData.enableConservativeEstimation = OpacityMicromapOptions::Building::ConservativeEstimation::enable();
+    keySourceData.conservativeEstimationMaxTexelTapsPerMicroTriangle = OpacityMicromapOptions::Building::ConservativeEstimation::maxTexelTapsPerMicroTriangle();
+    keySourceData.resolveTransparencyThreshold = RtxOptions::Get()->getResolveTransparencyThreshold();
+    keySourceData.resolveOpaquenessThreshold = RtxOptions::Get()->getResolveOpaquenessThreshold();
+    keySourceData.pad32 = 0;
+
+    if (instance.surface.alphaState.isDecal)
+      keySourceData.resolveTransparencyThreshold = std::max(keySourceData.resolveTransparencyThreshold, OpacityMicromapOptions::Building::decalsMinResolveTransparencyThreshold());
+
+    // Textures whose contents can't be identified can't be cached
+    if (keySourceData.opacityTextureHash == kEmptyHash)
+      return kEmptyHash;
+
+    return XXH3_64bits(&keySourceData, sizeof(keySourceData));
+  }
+
+  OpacityMicromapDiskCacheDesc OpacityMicromapManager::getDiskCacheDesc(const OpacityMicromapCacheItem& ommCacheItem, uint32_t numTriangles) {
+    OpacityMicromapDiskCacheDesc desc;
+    desc.numTriangles = numTriangles;
+    desc.subdivisionLevel = ommCacheItem.subdivisionLevel;
+    desc.ommFormat = ommCacheItem.ommFormat;
+    return desc;
+  }
+
+  OpacityMicromapManager::OmmResult OpacityMicromapManager::uploadOpacityMicromapArray(Rc<DxvkContext> ctx,
+                                                                                       OpacityMicromapCacheItem& ommCacheItem,
+                                                                                       const CachedSourceData& sourceData,
+                                                                                       const std::vector<uint8_t>& data) {
+    const uint32_t numTriangles = sourceData.numTriangles;
+    const uint32_t numMicroTrianglesPerTriangle = calculateNumMicroTriangles(ommCacheItem.subdivisionLevel);
+    const uint8_t numOpacityMicromapBitsPerMicroTriangle = ommCacheItem.ommFormat == VK_OPACITY_MICROMAP_FORMAT_2_STATE_EXT ? 1 : 2;
+    const uint32_t opacityMicromapPerTriangleBufferSize = dxvk::util::ceilDivide(numMicroTrianglesPerTriangle * numOpacityMicromapBitsPerMicroTriangle, 8);
+    const uint32_t opacityMicromapBufferSize = numTriangles * opacityMicromapPerTriangleBufferSize;
+
+    if (data.size() != opacityMicromapBufferSize)
+      return OmmResult::Failure;
+
+    {
+      const OmmResult result = preallocateDeviceMemory(ommCacheItem, numTriangles);
+
+      if (result != OmmResult::Success)
+        return result;
+    }
+
+    DxvkBufferCreateInfo ommBufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    ommBufferInfo.usage = VK_BUFFER_USAGE_MICROMAP_BUILD_INPUT_READ_ONLY_BIT_EXT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    ommBufferInfo.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+    ommBufferInfo.size = opacityMicromapBufferSize;
+    ommCacheItem.ommArrayBuffer = m_device->createBuffer(ommBufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DxvkMemoryStats::Category::RTXOpacityMicromap);
+
+    if (ommCacheItem.ommArrayBuffer == nullptr) {
+      ONCE(Logger::warn(str::format("[RTX - Opacity Micromap] Failed to allocate OMM array buffer due to m_device->createBuffer() failing to allocate a buffer for size: ", ommBufferInfo.size)));
+      return OmmResult::OutOfMemory;
+    }
+
+    // Note: the transfer writes are synchronized with the micromap builds by the barrier in buildOpacityMicromapsInternal()
+    ctx->updateBuffer(ommCacheItem.ommArrayBuffer, 0, opacityMicromapBufferSize, data.data(), true);
+
+    ommCacheItem.isLoadedFromDiskCache = true;
+
+    return OmmResult::Success;
+  }
+
+  void OpacityMicromapManager::loadOpacityMicromapArraysFromDiskCache(Rc<DxvkContext> ctx, const std::vector<TextureRef>& textures) {
+    if (!m_diskCache.isOpen() || !OpacityMicromapOptions::enableBakingArrays())
+      return;
+
+    ScopedCpuProfileZone();
+
+    // Upload the arrays read by the disk cache's worker thread
+    m_loadedDiskCacheEntries.clear();
+    m_diskCache.popLoadedEntries(m_loadedDiskCacheEntries);
+
+    for (const OpacityMicromapDiskCache::LoadedEntry& loadedEntry : m_loadedDiskCacheEntries) {
+      auto pendingLoadIter = m_pendingDiskCacheLoads.find(loadedEntry.key);
+
+      if (pendingLoadIter == m_pendingDiskCacheLoads.end())
+        continue;
+
+      const XXH64_hash_t ommSrcHash = pendingLoadIter->second;
+      m_pendingDiskCacheLoads.erase(pendingLoadIter);
+
+      auto sourceDataIter = m_cachedSourceData.find(ommSrcHash);
+      auto cacheItemIter = m_ommCache.find(ommSrcHash);
+
+      // The item may have been destroyed or started baking since the load was requested
+      if (sourceDataIter == m_cachedSourceData.end() || cacheItemIter == m_ommCache.end())
+        continue;
+
+      CachedSourceData& sourceData = sourceDataIter->second;
+      OpacityMicromapCacheItem& ommCacheItem = cacheItemIter->second;
+
+      if (ommCacheItem.cacheState != OpacityMicromapCacheState::eStep0_Unprocessed || sourceData.getInstance() == nullptr ||
+          !ommCacheItem.isUnprocessedCacheStateListIterValid || ommCacheItem.diskCacheKey != loadedEntry.key)
+        continue;
+
+      const OmmResult result = loadedEntry.isValid
+        ? uploadOpacityMicromapArray(ctx, ommCacheItem, sourceData, loadedEntry.data)
+        : OmmResult::Failure;
+
+      if (result == OmmResult::Success) {
+        // Unlink the referenced RtInstance
+        sourceData.setInstance(nullptr, m_instanceOmmRequests);
+
+        // Move the item from the unprocessed list to the end of the baked list
+        ommCacheItem.cacheState = OpacityMicromapCacheState::eStep2_Baked;
+        m_bakedList.splice(m_bakedList.end(), m_unprocessedList, ommCacheItem.cacheStateListIter);
+        ommCacheItem.isUnprocessedCacheStateListIterValid = false;
+
+        ++m_numLoadedFromDiskCache;
+      } else if (result == OmmResult::Failure) {
+        // Items whose entry can't be used are baked instead
+        ommCacheItem.diskCacheKey = kEmptyHash;
+      }
+      // Otherwise the load is requested again on a later frame
+    }
+
+    // Request loading the unprocessed items found in the disk cache.
+    // Note: the key is calculated for every item regardless of the IO budget, items baked without one are never stored to the disk cache
+    for (auto ommSrcHashIter = m_unprocessedList.begin(); ommSrcHashIter != m_unprocessedList.end(); ommSrcHashIter++) {
+      XXH64_hash_t ommSrcHash = *ommSrcHashIter;
+
+      auto sourceDataIter = m_cachedSourceData.find(ommSrcHash);
+      auto cacheItemIter = m_ommCache.find(ommSrcHash);
+
+      // Note: inconsistent items are handled by bakeOpacityMicromapArrays()
+      if (sourceDataIter == m_cachedSourceData.end() || cacheItemIter == m_ommCache.end())
+        continue;
+
+      CachedSourceData& sourceData = sourceDataIter->second;
+      OpacityMicromapCacheItem& ommCacheItem = cacheItemIter->second;
+
+      if (ommCacheItem.cacheState != OpacityMicromapCacheState::eStep0_Unprocessed || sourceData.getInstance() == nullptr)
+        continue;
+
+      if (!ommCacheItem.isDiskCacheLookupDone) {
+        ommCacheItem.diskCacheKey = calculateDiskCacheKey(ommSrcHash, ommCacheItem, *sourceData.getInstance(), textures);
+        ommCacheItem.isDiskCacheLookupDone = true;
+      }
+
+      // Items which aren't in the disk cache are baked, the ones which don't fit this frame's IO budget are requested on a later frame
+      if (m_diskCacheIOSizeAvailable == 0 || !m_diskCache.contains(ommCacheItem.diskCacheKey) ||
+          m_pendingDiskCacheLoads.find(ommCacheItem.diskCacheKey) != m_pendingDiskCacheLoads.end())
+        continue;
+
+      const uint64_t size = m_diskCache.requestLoad(ommCacheItem.diskCacheKey, getDiskCacheDesc(ommCacheItem, sourceData.numTriangles));
+
+      m_pendingDiskCacheLoads[ommCacheItem.diskCacheKey] = ommSrcHash;
+      m_diskCacheIOSizeAvailable -= std::min<VkDeviceSize>(size, m_diskCacheIOSizeAvailable);
+    }
+  }
+
+  void OpacityMicromapManager::readBackOpacityMicromapArray(Rc<DxvkContext> ctx,
+                                                            const OpacityMicromapCacheItem& ommCacheItem,
+                                                            uint32_t numTriangles,
+                                                            VkDeviceSize size) {
+    if (!m_diskCache.isOpen() || ommCacheItem.isLoadedFromDiskCache ||
+        ommCacheItem.diskCacheKey == kEmptyHash || m_diskCache.contains(ommCacheItem.diskCacheKey))
+      return;
+
+    // Drop read backs rather than letting them pile up in host memory when the disk cache can't keep up
+    if (m_pendingReadBackSize + size > kMaxPendingReadBackSize)
+      return;
+
+    DxvkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    bufferInfo.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferInfo.size = size;
+
+    Rc<DxvkBuffer> buffer = m_device->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, DxvkMemoryStats::Category::RTXOpacityMicromap);
+
+    if (buffer == nullptr)
+      return;
+
+    ctx->copyBuffer(buffer, 0, ommCacheItem.ommArrayBuffer, 0, size);
+    ctx->emitMemoryBarrier(0,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_ACCESS_TRANSFER_WRITE_BIT,
+      VK_PIPELINE_STAGE_HOST_BIT,
+      VK_ACCESS_HOST_READ_BIT);
+
+    PendingReadBack readBack;
+    readBack.diskCacheKey = ommCacheItem.diskCacheKey;
+    readBack.desc = getDiskCacheDesc(ommCacheItem, numTriangles);
+    readBack.buffer = std::move(buffer);
+
+    m_pendingReadBacks.push_back(std::move(readBack));
+    m_pendingReadBackSize += size;
+  }
+
+  void OpacityMicromapManager::storePendingReadBacksToDiskCache() {
+    while (!m_pendingReadBacks.empty() && m_diskCacheIOSizeAvailable > 0) {
+      PendingReadBack& readBack = m_pendingReadBacks.front();
+
+      // Read backs complete in submission order
+      if (readBack.buffer->isInUse())
+        break;
+
+      const VkDeviceSize size = readBack.buffer->info().size;
+
+      // Hand a copy of the array over to the disk cache's worker thread, so the read back buffer can be released right away
+      const uint8_t* readBackData = static_cast<const uint8_t*>(readBack.buffer->mapPtr(0));
+      std::vector<uint8_t> data(readBackData, readBackData + size);
+
+      if (m_diskCache.requestStore(readBack.diskCacheKey, readBack.desc, std::move(data)))
+        ++m_numStoredToDiskCache;
+
+      m_diskCacheIOSizeAvailable -= std::min(size, m_diskCacheIOSizeAvailable);
+      m_pendingReadBackSize -= size;
+      m_pendingReadBacks.pop_front();
+    }
+  }
+
   void OpacityMicromapManager::onFrameStart(Rc<DxvkContext> ctx) {
     ScopedCpuProfileZone();
     const uint32_t currentFrameIndex = m_device->getCurrentFrameId();
@@ -1669,6 +2083,22 @@ namespace dxvk {
         m_ommBuildRequestStatistics.erase(currentStatIter);
     }
     
+    // Disk cache
+    if (OpacityMicromapOptions::DiskCache::enable() && !OpacityMicromapOptions::Cache::hashInstanceIndexOnly()) {
+      if (!m_diskCache.isOpen() && !m_hasDiskCacheOpenFailed)
+        openDiskCache(ctx);
+
+      m_diskCache.setMaxSize(static_cast<uint64_t>(std::max(OpacityMicromapOptions::DiskCache::maxSizeMB(), 0)) * 1024 * 1024);
+      m_diskCacheIOSizeAvailable = static_cast<VkDeviceSize>(std::max(OpacityMicromapOptions::DiskCache::maxIOSizeMBPerFrame(), 1)) * 1024 * 1024;
+
+      storePendingReadBacksToDiskCache();
+    } else if (m_diskCache.isOpen()) {
+      m_pendingReadBacks.clear();
+      m_pendingReadBackSize = 0;
+      m_pendingDiskCacheLoads.clear();
+      m_diskCache.close();
+    }
+
     // Account for OMM usage in BLASes in a previous TLAS
     // Tag the previously bound OMMs as used in this frame as well
     for (auto& previousFrameBoundOMM : m_boundOMMs)
@@ -1800,6 +2230,10 @@ namespace dxvk {
     if (!m_unprocessedList.empty() || !m_bakedList.empty()) {
       ScopedGpuProfileZone(ctx, "Process Opacity Micromaps");
 
+      if (OpacityMicromapOptions::BuildRequests::prioritizeByVisibility())
+        prioritizeOpacityMicromaps(ctx->getCommonObjects()->getSceneManager().getCamera());
+
+      loadOpacityMicromapArraysFromDiskCache(ctx, textures);
       bakeOpacityMicromapArrays(ctx, textures, numMicroTrianglesToBakeAvailable);
       buildOpacityMicromapsInternal(ctx, numMicroTrianglesToBuildAvailable);
     }
@@ -26,6 +26,7 @@
 #include "rtx_geometry_utils.h"
 #include "rtx_option.h"
 #include "rtx_common_object.h"
+#include "rtx_opacity_micromap_disk_cache.h"
 #include <vector>
 #include <list>
 #include <unordered_map>
@@ -36,6 +37,7 @@ namespace dxvk {
   class DxvkBarrierSet;
   class RtInstance;
   class InstanceManager;
+  class RtCamera;
   struct InstanceEventHandler;
 
   struct OpacityMicromapOptions {
@@ -66,6 +68,20 @@ namespace dxvk {
     };
 
 
+    struct DiskCache {
+      friend class OpacityMicromapManager;
+
+      RTX_OPTION("rtx.opacityMicromap.diskCache", bool, enable, true,
+                 "Persists baked Opacity Micromap arrays to a cache on disk, so that they're loaded rather than baked again in later sessions.\n"
+                 "Not used when Opacity Micromaps are hashed by instance index only.");
+      RTX_OPTION("rtx.opacityMicromap.diskCache", std::string, directory, "./rtx-remix/omm-cache/",
+                 "Directory of the Opacity Micromap disk cache.\n"
+                 "Caches exported to an 'omm-cache' directory next to a mod's mod file are loaded from as well.");
+      RTX_OPTION("rtx.opacityMicromap.diskCache", int, maxSizeMB, 4096, "Max size of the Opacity Micromap disk cache [MB]. The least recently used entries are evicted beyond it.");
+      RTX_OPTION("rtx.opacityMicromap.diskCache", int, maxIOSizeMBPerFrame, 32, "Max amount of Opacity Micromap data queued per frame to be read from and written to the disk cache on its worker thread [MB].");
+    };
+
+
     struct BuildRequests {
       friend class OpacityMicromapManager;
 
@@ -85,6 +101,10 @@ namespace dxvk {
                      "Min number of Opacity Micromap usage requests for a staged Opacity Micromap request before it is allowed to be built.");
 
       RTX_OPTION("rtx.opacityMicromap.buildRequests", bool, customFiltersForBillboards, true, "Applies custom filters for staged Billboard requests.");
+
+      RTX_OPTION("rtx.opacityMicromap.buildRequests", bool, prioritizeByVisibility, true,
+                 "Bakes and builds the accepted Opacity Micromap requests in the order of their estimated benefit per micro triangle rather than in the order of their triangle count.\n"
+                 "The benefit is estimated from the instance's approximate screen coverage and from how recently the instance was drawn.");
     };
 
 
@@ -238,6 +258,16 @@ namespace dxvk {
     // but the source data has been unlinked and cacheStateList item was removed
     bool isUnprocessedCacheStateListIterValid = false;  
 
+    // Key of the baked OMM array in the disk cache, kEmptyHash when the array can't be cached on disk
+    XXH64_hash_t diskCacheKey = kEmptyHash;
+    bool isDiskCacheLookupDone = false;
+    bool isLoadedFromDiskCache = false;
+
+    // Estimated benefit of the OMM per baked micro triangle, higher values are baked and built first.
+    // Updated while the item is unprocessed, since the instance is unlinked once the item is baked
+    float buildPriority = 0.f;
+    bool hasBillboards = false;
+
     // Needed during baking
     Rc<DxvkBuffer> ommArrayBuffer;   // Per micro triangle
     RtxGeometryUtils::BakeOpacityMicromapState bakingState;
@@ -259,7 +289,12 @@ namespace dxvk {
     , ommFormat(src.ommFormat)
     , leastRecentlyUsedListIter(src.leastRecentlyUsedListIter)
     , cacheStateListIter(src.cacheStateListIter)
-    , isUnprocessedCacheStateListIterValid(src.isUnprocessedCacheStateListIterValid) { }
+    , isUnprocessedCacheStateListIterValid(src.isUnprocessedCacheStateListIterValid)
+    , diskCacheKey(src.diskCacheKey)
+    , isDiskCacheLookupDone(src.isDiskCacheLookupDone)
+    , isLoadedFromDiskCache(src.isLoadedFromDiskCache)
+    , buildPriority(src.buildPriority)
+    , hasBillboards(src.hasBillboards) { }
 
     VkDeviceSize getDeviceSize() const;
 
@@ -354,6 +389,10 @@ namespace dxvk {
     // It is OK for batched BLASes to contain a mix of BLASes with and without bound opacity micromaps
     void onBlasBuild(Rc<DxvkContext> ctx);
 
+    // Copies the disk cache into the 'omm-cache' directory of every mod, so that players of a mod start with baked Opacity Micromaps.
+    // Returns the number of entries exported.
+    uint32_t exportDiskCacheToMods() const;
+
   private:
     typedef fast_unordered_cache<OpacityMicromapCacheItem> OpacityMicromapCache;
 
@@ -421,6 +460,27 @@ namespace dxvk {
                                   const std::vector<TextureRef>& textures, uint32_t& maxMicroTrianglesToBake);
     OmmResult buildOpacityMicromap(Rc<DxvkContext> ctx, XXH64_hash_t ommSrcHash, OpacityMicromapCacheItem& ommCacheItem, VkMicromapUsageEXT& ommUsageGroup, VkMicromapBuildInfoEXT& ommBuildInfo, uint32_t& maxMicroTrianglesToBuild, bool forceBuild);
     void bakeOpacityMicromapArrays(Rc<DxvkContext> ctx, const std::vector<TextureRef>& textures, uint32_t& maxMicroTrianglesToBake);
+
+    // Updates the build priorities of unprocessed items and reorders the unprocessed and baked lists by them
+    float calculateBuildPriority(const RtInstance& instance, uint32_t numTriangles, const RtCamera& camera) const;
+    void prioritizeOpacityMicromaps(const RtCamera& camera);
+    void sortByBuildPriority(std::list<XXH64_hash_t>& list);
+
+    // Preallocates all the device memory needed to build the OMM item
+    OmmResult preallocateDeviceMemory(OpacityMicromapCacheItem& ommCacheItem, uint32_t numTriangles);
+
+    // Disk cache of baked OMM arrays. Unprocessed items found in the disk cache are loaded straight into the baked state,
+    // and the arrays baked at runtime are read back and written to the disk cache before they're released.
+    // The files are read and written on the disk cache's worker thread, the render thread only uploads the loaded arrays.
+    void openDiskCache(Rc<DxvkContext> ctx);
+    XXH64_hash_t calculateDiskCacheKey(XXH64_hash_t ommSrcHash, const OpacityMicromapCacheItem& ommCacheItem, const RtInstance& instance,
+                                       const std::vector<TextureRef>& textures) const;
+    static OpacityMicromapDiskCacheDesc getDiskCacheDesc(const OpacityMicromapCacheItem& ommCacheItem, uint32_t numTriangles);
+    OmmResult uploadOpacityMicromapArray(Rc<DxvkContext> ctx, OpacityMicromapCacheItem& ommCacheItem, const CachedSourceData& sourceData,
+                                         const std::vector<uint8_t>& data);
+    void loadOpacityMicromapArraysFromDiskCache(Rc<DxvkContext> ctx, const std::vector<TextureRef>& textures);
+    void readBackOpacityMicromapArray(Rc<DxvkContext> ctx, const OpacityMicromapCacheItem& ommCacheItem, uint32_t numTriangles, VkDeviceSize size);
+    void storePendingReadBacksToDiskCache();
     void buildOpacityMicromapsInternal(Rc<DxvkContext> ctx, uint32_t& maxMicroTrianglesToBuild);
 
     // Bound built OMMs need to be synchronized once before being used. 
@@ -458,6 +518,25 @@ namespace dxvk {
 
     fast_unordered_cache<OMMBuildRequestStatistics> m_ommBuildRequestStatistics;
 
+    static constexpr const char* kModDiskCacheDirectory = "omm-cache";
+    static constexpr VkDeviceSize kMaxPendingReadBackSize = 256 * 1024 * 1024;
+
+    struct PendingReadBack {
+      XXH64_hash_t diskCacheKey;
+      OpacityMicromapDiskCacheDesc desc;
+      Rc<DxvkBuffer> buffer;
+    };
+
+    OpacityMicromapDiskCache m_diskCache;
+    fast_unordered_cache<XXH64_hash_t> m_pendingDiskCacheLoads;  // Source hashes of the items being read from the disk cache, by disk cache key
+    std::vector<OpacityMicromapDiskCache::LoadedEntry> m_loadedDiskCacheEntries;
+    std::list<PendingReadBack> m_pendingReadBacks;
+    VkDeviceSize m_pendingReadBackSize = 0;
+    VkDeviceSize m_diskCacheIOSizeAvailable = 0;  // Per frame
+    uint32_t m_numLoadedFromDiskCache = 0;
+    uint32_t m_numStoredToDiskCache = 0;
+    bool m_hasDiskCacheOpenFailed = false;
+
     VkDeviceSize m_amountOfMemoryMissing = 0;    // Records how much memory was missing in a frame
     OpacityMicromapMemoryManager m_memoryManager;
     std::unique_ptr<DxvkStagingDataAlloc> m_scratchAllocator;
@@ -295,6 +295,7 @@ namespace dxvk {
 
   bool RtxOptions::needsMeshBoundingBox() {
     return AntiCulling::Object::enable() ||
-           TerrainBaker::needsTerrainBaking();
+           TerrainBaker::needsTerrainBaking() ||
+           enableTlasInstanceCulling();
   }
 }
@@ -300,10 +300,44 @@ namespace dxvk {
       RTX_OPTION("rtx.displacement", float, displacementFactor, 1.0f, "Scaling factor for all displacement maps");
     } displacement;
 
+    struct ReplacementMeshLod {
+      friend class ImGUI;
+      RTX_OPTION("rtx.replacementMeshLod", bool, enable, false, "When enabled, simplified levels of detail are generated for large replacement meshes when mods are loaded, and a coarser level is drawn when its simplification error is too small to be seen at the mesh's distance from the camera.\n"
+                 "Every level gets its own static BLAS, so distant replacements cost less to build and to trace. Only takes effect for mods loaded after it is enabled.");
+      RTX_OPTION("rtx.replacementMeshLod", uint32_t, minTriangles, 10000, "The minimum number of triangles a replacement mesh needs to get levels of detail generated.");
+      RTX_OPTION("rtx.replacementMeshLod", uint32_t, maxLevels, 4, "The maximum number of simplified levels of detail generated for every replacement mesh.");
+      RTX_OPTION("rtx.replacementMeshLod", float, reductionPerLevel, 0.5f, "The fraction of the previous level's triangles every simplified level of detail targets.");
+      RTX_OPTION("rtx.replacementMeshLod", float, maxScreenSpaceError, 0.001f, "The largest simplification error a level of detail may have to be drawn, as a fraction of the screen height at the mesh's distance from the camera.");
+      RTX_OPTION("rtx.replacementMeshLod", float, hysteresis, 0.25f, "The fraction by which the projected error of a coarser level of detail must be below rtx.replacementMeshLod.maxScreenSpaceError before a mesh switches to it.\n"
+                 "Keeps meshes near a switching distance from alternating between levels every frame, which would also rebuild their BLAS instances.");
+    } replacementMeshLod;
+
     RTX_OPTION("rtx", bool, resolvePreCombinedMatrices, true, "");
 
     RTX_OPTION("rtx", uint32_t, minPrimsInStaticBLAS, 1000, "");
     RTX_OPTION("rtx", uint32_t, maxPrimsInMergedBLAS, 50000, "");
+    RTX_OPTION("rtx", float, staticBlasBuildBudgetMs, 2.0f, "The estimated GPU time in milliseconds static BLAS builds may take per frame, 0 removes the limit.\n"
+               "Builds which don't fit the budget are made on later frames, until then their geometry uses a BLAS built once with the fast build preference.\n"
+               "The estimate is calibrated from GPU timestamps taken around the builds. At least one static BLAS is built per frame regardless of its size.");
+    RTX_OPTION("rtx", bool, enableTlasRefit, true, "When enabled, the TLASes are refit instead of rebuilt while the number of instances and their masks and flags are unchanged.");
+    RTX_OPTION("rtx", uint32_t, maxTlasRefitsBeforeRebuild, 16, "The number of consecutive refits after which a TLAS is fully rebuilt to restore its trace quality.");
+    RTX_OPTION("rtx", bool, enableAsyncAccelStructureBuilds, true, "When enabled, static BLAS builds and BLAS compaction copies are recorded on the async compute queue so they overlap with the graphics queue work.\n"
+               "Results are only used once the async work has completed, until then static geometry keeps being merged into the per-frame BLASes.\n"
+               "Has no effect when the GPU has no dedicated async compute queue, or when RTX IO is enabled since it uses that queue.");
+    RTX_OPTION("rtx", bool, enableBlasCompaction, true, "When enabled, static BLASes are compacted into right-sized allocations a few frames after they are built to reduce their memory usage.");
+    RTX_OPTION("rtx", uint32_t, numFramesToDelayBLASCompaction, 2, "The number of frames to wait after building a static BLAS before reading back its compacted size and compacting it.\n"
+               "The readback never stalls, if the size isn't available yet the compaction is retried on the next frame.");
+    RTX_OPTION("rtx", bool, enableBlasRefit, true, "When enabled, animated geometry gets a persistent BLAS which is refit when its vertices change instead of being rebuilt from scratch every frame.\n"
+               "The BLAS is fully rebuilt when its topology changes or when one of the rebuild heuristics below triggers.");
+    RTX_OPTION("rtx", uint32_t, minPrimsInRefitBLAS, 1000, "The minimum number of triangles animated geometry needs to get a refit BLAS. Smaller animated geometry is merged into shared BLASes which are rebuilt every frame.");
+    RTX_OPTION("rtx", uint32_t, maxBlasRefitsBeforeRebuild, 32, "The number of consecutive refits after which a refit BLAS is fully rebuilt to restore its trace quality.");
+    RTX_OPTION("rtx", float, maxBlasRefitBoundingBoxGrowth, 1.5f, "The ratio of the geometry's bounding box surface area to its surface area at the last full build above which a refit BLAS is fully rebuilt.\n"
+               "Only applies when mesh bounding boxes are computed, otherwise rebuilds are driven by the refit count alone.");
+    RTX_OPTION("rtx", bool, enableTlasInstanceCulling, false, "When enabled, instances whose bounds lie far enough outside of the main camera's frustum are left out of the TLASes, reducing TLAS build and trace costs in large scenes.\n"
+               "An instance is kept as long as its bounds are within rtx.tlasInstanceCullingDistanceMeters of the frustum, so that it can still be reached by secondary rays for indirect lighting, reflections and shadows.\n"
+               "Instances without mesh bounding boxes, instances drawn by other cameras (e.g. sky or view model) and all instances while ray portals are active are never culled.");
+    RTX_OPTION("rtx", float, tlasInstanceCullingDistanceMeters, 100.f, "The distance in meters outside of the main camera's frustum beyond which instances are culled from the TLASes, see rtx.enableTlasInstanceCulling.\n"
+               "Should cover the longest secondary ray that is expected to contribute visibly to the image.");
 
     // Camera
     RW_RTX_OPTION_ENV("rtx", bool, shakeCamera, false, "RTX_FREE_CAMERA_ENABLE_ANIMATION", "Enables animation of the free camera.");
@@ -906,6 +940,16 @@ namespace dxvk {
     RTX_OPTION("rtx", bool, useObsoleteHashOnTextureUpload, false,
                "Whether or not to use slower XXH64 hash on texture upload.\n"
                "New projects should not enable this option as this solely exists for compatibility with older hashing schemes.");
+    RTX_OPTION("rtx", bool, asyncTextureHashing, true,
+               "When enabled, texture contents are hashed on worker threads after the first upload instead of on the application thread.\n"
+               "Anything reading a texture hash before it is ready waits for it, so hash values are not affected.");
+    RTX_OPTION("rtx", uint32_t, textureHashVersion, 0,
+               "The rule used to hash texture contents.\n"
+               "0: The whole texture is hashed at once.\n"
+               "1: Textures of at least rtx.textureTreeHashMinSize bytes are split into 1 MiB chunks that are hashed in parallel, followed by a hash over the chunk hashes. Smaller textures hash the same as with version 0.\n"
+               "Changing the version changes the hashes of large textures, so replacements must be authored with the same version.");
+    RTX_OPTION("rtx", uint32_t, textureTreeHashMinSize, 4 * 1024 * 1024,
+               "The minimum texture size in bytes hashed in parallel chunks when rtx.textureHashVersion is 1.");
 
     RTX_OPTION("rtx", bool, serializeChangedOptionOnly, true, "");
 
@@ -42,6 +42,7 @@
 #include "rtx_intersection_test.h"
 
 #include "dxvk_scoped_annotation.h"
+#include "../../util/log/draw_profiler.h"
 
 namespace dxvk {
 
@@ -301,6 +302,16 @@ namespace dxvk {
       }
     }
 
+    if (m_device->getCurrentFrameId() > RtxOptions::Get()->numFramesToKeepGeometryData()) {
+      for (auto iter = m_replacementMeshLodStates.begin(); iter != m_replacementMeshLodStates.end(); ) {
+        if (iter->second.frameLastUsed < oldestFrame) {
+          iter = m_replacementMeshLodStates.erase(iter);
+        } else {
+          ++iter;
+        }
+      }
+    }
+
     // Perform GC on the other managers
     auto& textureManager = m_device->getCommon()->getTextureManager();
     textureManager.garbageCollection();
@@ -482,6 +493,7 @@ namespace dxvk {
 
   void SceneManager::submitDrawState(Rc<DxvkContext> ctx, const DrawCallState& input, const MaterialData* overrideMaterialData) {
     ScopedCpuProfileZone();
+    DrawStageScope stageScope(DrawStage::SubmitDrawState);
     const uint32_t kBufferCacheLimit = kSurfaceInvalidBufferIndex - 10; // Limit for unique buffers minus some padding
     if (m_bufferCache.getTotalCount() >= kBufferCacheLimit && m_bufferCache.getActiveCount() >= kBufferCacheLimit) {
       ONCE(Logger::info("[RTX-Compatibility-Info] This application is pushing more unique buffers than is currently supported - some objects may not raytrace."));
@@ -652,7 +664,7 @@ namespace dxvk {
         transforms.texgenMode = TexGenMode::None;
 
         DrawCallState newDrawCallState(*input);
-        newDrawCallState.geometryData = replacement.geometry->data; // Note: Geometry Data replaced
+        newDrawCallState.geometryData = selectReplacementMeshLod(*input, replacement, transforms.objectToView); // Note: Geometry Data replaced
         newDrawCallState.transformData = transforms;
         newDrawCallState.categories = replacement.categories.applyCategoryFlags(newDrawCallState.categories);
 
@@ -694,6 +706,53 @@ namespace dxvk {
     return rootInstanceId;
   }
 
+  const RasterGeometry& SceneManager::selectReplacementMeshLod(const DrawCallState& input, const AssetReplacement& replacement, const Matrix4& replacementToView) {
+    const MeshReplacement& mesh = *replacement.geometry;
+
+    // Only the main camera's field of view is known, other cameras always draw the full mesh
+    const AxisAlignedBoundingBox& boundingBox = mesh.data.boundingBox;
+    const float tanHalfFov = std::tan(getCamera().getFov() * 0.5f);
+    if (mesh.lods.empty() || input.cameraType != CameraType::Main || !boundingBox.isValid() || tanHalfFov <= 0.f) {
+      return mesh.data;
+    }
+
+    // Distance to the closest point of the bounding sphere, so that no part of the mesh is closer than assumed.
+    // Note: the Frobenius norm of the linear part bounds its largest scale for any rotation or shear
+    const Vector4 centerView = replacementToView * Vector4((boundingBox.minPos + boundingBox.maxPos) * 0.5f, 1.f);
+    const float maxScale = std::sqrt(lengthSqr(replacementToView[0].xyz()) + lengthSqr(replacementToView[1].xyz()) + lengthSqr(replacementToView[2].xyz()));
+    const float radius = 0.5f * length(boundingBox.maxPos - boundingBox.minPos) * maxScale;
+    const float distance = length(centerView.xyz()) - radius;
+
+    // Instances are told apart by their replacement and their position, movement across the grid only resets the hysteresis
+    const Vector3 worldPosition = input.getTransformData().objectToWorld[3].xyz();
+    const int32_t cell[3] = { int32_t(std::floor(worldPosition.x)), int32_t(std::floor(worldPosition.y)), int32_t(std::floor(worldPosition.z)) };
+    const XXH64_hash_t instanceHash = XXH64(cell, sizeof(cell), input.getHash(RtxOptions::Get()->GeometryHashGenerationRule) ^ reinterpret_cast<uintptr_t>(&mesh));
+
+    ReplacementMeshLodState& state = m_replacementMeshLodStates.try_emplace(instanceHash, ReplacementMeshLodState { 0, 0 }).first->second;
+    state.frameLastUsed = m_device->getCurrentFrameId();
+
+    uint32_t lodIndex = 0;
+    if (distance > 0.f) {
+      const float screenHeight = 2.f * distance * tanHalfFov;
+      const float maxError = RtxOptions::ReplacementMeshLod::maxScreenSpaceError() * screenHeight / maxScale;
+      const float coarserMaxError = maxError * (1.f - std::clamp(RtxOptions::ReplacementMeshLod::hysteresis(), 0.f, 1.f));
+      const uint32_t previousLodIndex = std::min(state.lodIndex, static_cast<uint32_t>(mesh.lods.size()));
+
+      // Errors grow with every level, so the coarsest acceptable one is the last one below the limit
+      for (uint32_t i = 1; i <= mesh.lods.size(); i++) {
+        if (mesh.lods[i - 1].error > (i > previousLodIndex ? coarserMaxError : maxError)) {
+          break;
+        }
+
+        lodIndex = i;
+      }
+    }
+
+    state.lodIndex = lodIndex;
+
+    return lodIndex == 0 ? mesh.data : mesh.lods[lodIndex - 1].data;
+  }
+
   void SceneManager::clearFogState() {
     m_fog = FogState();
   }
@@ -1294,6 +1353,11 @@ namespace dxvk {
 
     // Update stats
     m_device->statCounters().setCtr(DxvkStatCounter::RtxBlasCount, AccelManager::getBlasCount());
+    m_device->statCounters().setCtr(DxvkStatCounter::RtxBlasCompactionSavedMb, AccelManager::getBlasCompactionSavings() >> 20);
+    m_device->statCounters().setCtr(DxvkStatCounter::RtxAsyncAccelOperations, m_accelManager.getAsyncAccelOperationCount());
+    m_device->statCounters().setCtr(DxvkStatCounter::RtxAsyncAccelGpuTimeUs, m_accelManager.getAsyncAccelGpuTimeUs());
+    m_device->statCounters().setCtr(DxvkStatCounter::RtxDeferredBlasBuilds, m_accelManager.getDeferredStaticBlasBuildCount());
+    m_device->statCounters().setCtr(DxvkStatCounter::RtxCulledInstances, m_accelManager.getCulledInstanceCount());
     m_device->statCounters().setCtr(DxvkStatCounter::RtxBufferCount, m_bufferCache.getActiveCount());
     m_device->statCounters().setCtr(DxvkStatCounter::RtxTextureCount, textureManager.getTextureTable().size());
     m_device->statCounters().setCtr(DxvkStatCounter::RtxInstanceCount, m_instanceManager.getActiveCount());
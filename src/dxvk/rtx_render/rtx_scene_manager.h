@@ -232,6 +232,7 @@ private:
   void onInstanceDestroyed(const RtInstance& instance);
 
   uint64_t drawReplacements(Rc<DxvkContext> ctx, const DrawCallState* input, const std::vector<AssetReplacement>* pReplacements, const MaterialData* overrideMaterialData);
+  const RasterGeometry& selectReplacementMeshLod(const DrawCallState& input, const AssetReplacement& replacement, const Matrix4& replacementToView);
 
   void createEffectLight(Rc<DxvkContext> ctx, const DrawCallState& input, const RtInstance* instance);
 
@@ -250,6 +251,13 @@ private:
 
   DrawCallCache m_drawCallCache;
 
+  // Level of detail last drawn for every replacement mesh instance, see rtx.replacementMeshLod
+  struct ReplacementMeshLodState {
+    uint32_t lodIndex;
+    uint32_t frameLastUsed;
+  };
+  fast_unordered_cache<ReplacementMeshLodState> m_replacementMeshLodStates;
+
   CameraManager m_cameraManager;
 
   std::unique_ptr<AssetReplacer> m_pReplacer;
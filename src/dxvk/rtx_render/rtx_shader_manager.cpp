@@ -191,6 +191,13 @@ namespace dxvk {
         SpirvCodeBuffer code(file);
         if (code.size()) {
           info.m_staticCode = code; // Update the code
+
+          // Cancel pending pipeline compiles of the shader being replaced before the new one is registered,
+          // as both may share a shader key. Older versions were unregistered when they were replaced.
+          if (!info.m_shader.empty()) {
+            m_device->unregisterShader(info.m_shader.back());
+          }
+
           Rc<DxvkShader> shader = createShader(info);
           info.m_shader.emplace_back(shader);
           success = true;
@@ -192,7 +192,8 @@ namespace dxvk {
         const Rc<ManagedTexture>&  texture,
         const Rc<DxvkContext>&     ctx,
         const DxvkImageCreateInfo& desc,
-        const bool                 isPreloading) {
+        const bool                 isPreloading,
+        const bool                 deferVidMemState) {
     const Rc<DxvkDevice>& device = ctx->getDevice();
 
     auto& assetData = *texture->assetData;
@@ -234,7 +235,11 @@ namespace dxvk {
     viewInfo.format = desc.format;
 
     Rc<DxvkImageView> view = device->createImageView(image, viewInfo);
-    texture->state = ManagedTexture::State::kVidMem;
+
+    // The upload is only recorded at this point, a deferred texture gets published by the caller after submission
+    if (!deferVidMemState) {
+      texture->state = ManagedTexture::State::kVidMem;
+    }
 
     return view;
   }
@@ -286,7 +291,7 @@ namespace dxvk {
     return texture;
   }
 
-  void TextureUtils::loadTexture(Rc<ManagedTexture> texture, const Rc<DxvkContext>& ctx, const bool isPreloading, int minimumMipLevel) {
+  bool TextureUtils::loadTexture(Rc<ManagedTexture> texture, const Rc<DxvkContext>& ctx, const bool isPreloading, int minimumMipLevel, const bool deferVidMemState) {
     ScopedCpuProfileZone();
 
     if (!isPreloading) {
@@ -314,7 +319,7 @@ namespace dxvk {
       // There's no point in loading same texture again, we can just
       // set all mips view to the small mips view.
       texture->allMipsImageView = texture->smallMipsImageView;
-      return;
+      return false;
     }
 
     // Adjust image create info
@@ -327,7 +332,7 @@ namespace dxvk {
       validateMipTailRtxIo(texture, texture->futureImageDesc, baseLevel);
       viewTarget = loadTextureRtxIo(texture, ctx, texture->futureImageDesc, isPreloading);
     } else {
-      viewTarget = loadTextureToVidmem(texture, ctx, texture->futureImageDesc, isPreloading);
+      viewTarget = loadTextureToVidmem(texture, ctx, texture->futureImageDesc, isPreloading, deferVidMemState);
     }
 
     if (isPreloading) {
@@ -352,5 +357,7 @@ namespace dxvk {
 
     // Release asset source to keep the number of open file low
     texture->assetData->releaseSource();
+
+    return true;
   }
 } // namespace dxvk
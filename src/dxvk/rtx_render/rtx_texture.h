@@ -261,7 +261,9 @@ namespace dxvk {
 
     static Rc<ManagedTexture> createTexture(const Rc<AssetData>& assetData, ColorSpace colorSpace);
 
-    static void loadTexture(Rc<ManagedTexture> texture, const Rc<DxvkContext>& ctx, const bool isPreloading, int minimumMipLevel);
+    // Returns true if an upload of the texture was recorded into ctx. With deferVidMemState set, an uploaded
+    // texture is left in kQueuedForUpload so that the caller can publish it once the upload has been submitted.
+    static bool loadTexture(Rc<ManagedTexture> texture, const Rc<DxvkContext>& ctx, const bool isPreloading, int minimumMipLevel, const bool deferVidMemState = false);
   };
 
 } // namespace dxvk
@@ -58,10 +58,28 @@ namespace dxvk {
       texture->state = ManagedTexture::State::kFailed;
       texture->demote();
     } else {
-      loadTexture(texture, ctx);
+      loadTexture(texture, ctx, true);
     }
   }
 
+  void RtxTextureManager::idle(Rc<DxvkContext>& ctx) {
+    if (m_batchedUploads.empty())
+      return;
+
+    ctx->flushCommandList();
+    publishBatchedUploads();
+  }
+
+  void RtxTextureManager::publishBatchedUploads() {
+    for (const Rc<ManagedTexture>& texture : m_batchedUploads) {
+      // Leave textures alone which were demoted or failed in the meantime
+      ManagedTexture::State expected = ManagedTexture::State::kQueuedForUpload;
+      texture->state.compare_exchange_strong(expected, ManagedTexture::State::kVidMem);
+    }
+
+    m_batchedUploads.clear();
+  }
+
   RtxTextureManager::RtxTextureManager(DxvkDevice* device)
     : RenderProcessor(device, "rtx-texture-manager")
     , m_pDevice(device) {
@@ -283,7 +301,7 @@ namespace dxvk {
     return key;
   }
 
-  void RtxTextureManager::loadTexture(const Rc<ManagedTexture>& texture, Rc<DxvkContext>& ctx) {
+  void RtxTextureManager::loadTexture(const Rc<ManagedTexture>& texture, Rc<DxvkContext>& ctx, bool allowBatching) {
     ScopedCpuProfileZone();
 
     if (texture->state != ManagedTexture::State::kQueuedForUpload)
@@ -305,7 +323,10 @@ namespace dxvk {
         largestMipToLoad += spillMib / kReduceMipsEveryMib;
       }
 
-      TextureUtils::loadTexture(texture, ctx, false, largestMipToLoad);
+      // Batched textures must not be used before their upload gets submitted, so they stay in
+      // kQueuedForUpload until publishBatchedUploads() makes them available.
+      const bool deferVidMemState = allowBatching && !RtxIo::enabled();
+      const bool uploaded = TextureUtils::loadTexture(texture, ctx, false, largestMipToLoad, deferVidMemState);
 
 #ifdef _DEBUG
       Logger::debug(str::format("Loaded texture ", texture->assetData->hash(), " at ",
@@ -313,7 +334,18 @@ namespace dxvk {
 #endif
 
       if (!RtxIo::enabled()) {
-        ctx->flushCommandList();
+        if (deferVidMemState && uploaded) {
+          // Let the submission policy merge uploads from the worker thread
+          m_batchedUploads.push_back(texture);
+
+          if (ctx->flushCommandListHint())
+            publishBatchedUploads();
+        } else {
+          ctx->flushCommandList();
+
+          if (allowBatching)
+            publishBatchedUploads();
+        }
       }
     } catch (const DxvkError& e) {
       texture->state = ManagedTexture::State::kFailed;
@@ -134,6 +134,8 @@ namespace dxvk {
   protected:
     void work(Rc<ManagedTexture>& item, Rc<DxvkContext>& ctx) override;
 
+    void idle(Rc<DxvkContext>& ctx) override;
+
     bool wakeWorkerCondition() override;
 
   private:
@@ -164,12 +166,16 @@ namespace dxvk {
 
     fast_unordered_cache<Rc<ManagedTexture>> m_assetHashToTextures;
 
+    // Textures uploaded by the worker thread whose command list was not submitted yet
+    std::vector<Rc<ManagedTexture>> m_batchedUploads;
+
     RTX_OPTION("rtx.texturemanager", uint32_t, budgetPercentageOfAvailableVram, 50, "The percentage of available VRAM we should use for material textures.  If material textures are required beyond this budget, then those textures will be loaded at lower quality.  Important note, it's impossible to perfectly match the budget while maintaining reasonable quality levels, so use this as more of a guideline.  If the replacements assets are simply too large for the target GPUs available vid mem, we may end up going overbudget regularly.  Defaults to 50% of the available VRAM.");
     RTX_OPTION("rtx.texturemanager", bool, showProgress, false, "Show texture loading progress in the HUD.");
 
     bool isTextureSuboptimal(const Rc<ManagedTexture>& texture) const;
     void scheduleTextureLoad(TextureRef& texture, Rc<DxvkContext>& immediateContext, bool allowAsync);
-    void loadTexture(const Rc<ManagedTexture>& texture, Rc<DxvkContext>& ctx);
+    void loadTexture(const Rc<ManagedTexture>& texture, Rc<DxvkContext>& ctx, bool allowBatching = false);
+    void publishBatchedUploads();
 
     VkDeviceSize overBudgetMib(VkDeviceSize percentageOfBudget = 100) const;
   };
@@ -24,9 +24,12 @@
 #include "rtx_types.h"
 #include "rtx_options.h"
 #include "rtx_terrain_baker.h"
+#include "../../util/log/draw_profiler.h"
 
 namespace dxvk {
   bool DrawCallState::finalizePendingFutures(const RtCamera* pLastCamera) {
+    DrawStageScope stageScope(DrawStage::FutureWait);
+
     // Geometry hashes are vital, and cannot be disabled, so its important we get valid data (hence the return type)
     const bool valid = finalizeGeometryHashes();
     if (valid) {
@@ -123,6 +123,15 @@ struct AxisAlignedBoundingBox {
       maxPos[i] = std::max(maxPos[i], other.maxPos[i]);
     }
   }
+
+  bool isValid() const {
+    return minPos.x <= maxPos.x && minPos.y <= maxPos.y && minPos.z <= maxPos.z;
+  }
+
+  float getSurfaceArea() const {
+    const Vector3 extent = maxPos - minPos;
+    return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+  }
 };
 
 // Stores a snapshot of the geometry state for a draw call.
@@ -508,6 +517,30 @@ struct PooledBlas : public RcObject {
   // Note: only used for tracking of OMMs for static BLASes
   XXH64_hash_t opacityMicromapSourceHash = kEmptyHash;
 
+  // Set while the compacted size of this BLAS is being queried or while it is being copied on the async compute queue,
+  // cleared when the BLAS is released back to the pool
+  // Note: only used for static BLASes
+  bool compactionPending = false;
+  // Device memory saved by compacting this BLAS
+  VkDeviceSize compactionSavings = 0;
+
+  // Async compute timeline value signaled once the async work accessing this BLAS has completed, 0 when there is none.
+  // The BLAS must not be rebuilt before that.
+  uint64_t asyncTimelineValue = 0;
+
+  // Inputs of the last full build of a BLAS built with ALLOW_UPDATE, an update is only valid when the new geometry matches them
+  // Note: only used for dynamic BLASes
+  struct RefitState {
+    VkAccelerationStructureGeometryTrianglesDataKHR triangles = {};
+    VkGeometryFlagsKHR geometryFlags = 0;
+    uint32_t primitiveCount = 0;
+    VkDeviceSize updateScratchSize = 0;
+    // Surface area of the geometry's bounding box at the last full build, 0 when unknown
+    float boundingBoxArea = 0.f;
+    // Number of refits since the last full build
+    uint32_t refitCount = 0;
+  } refitState;
+
   explicit PooledBlas();
   ~PooledBlas();
 };
@@ -528,6 +561,23 @@ struct BlasEntry {
 
   Rc<PooledBlas> staticBlas;
 
+  // Static BLAS being built on the async compute queue, it becomes the static BLAS once its build has completed.
+  // Note: it is dropped if the vertex data is updated in the meantime, frameLastUpdated is recorded when the build is issued.
+  Rc<PooledBlas> asyncStaticBlas;
+  uint32_t asyncStaticBlasFrameLastUpdated = kInvalidFrameIndex;
+  bool asyncStaticBlasAllowsCompaction = false;
+
+  // BLAS built once with the fast build preference for static geometry whose optimized build was deferred by the build budget
+  // or is still in flight on the async compute queue, it is released once the static BLAS is available.
+  // Note: it is rebuilt if the vertex data or the bound opacity micromap changes, frameLastUpdated is recorded when it is built.
+  Rc<PooledBlas> deferredStaticBlas;
+  uint32_t deferredStaticBlasFrameLastUpdated = kInvalidFrameIndex;
+
+  // Persistent BLAS for animated geometry which is refit in place of a full rebuild while the topology is unchanged.
+  // Refits ping-pong between the two so that the BLAS referenced by the previous frame's TLAS is left intact.
+  Rc<PooledBlas> dynamicBlas;
+  Rc<PooledBlas> previousDynamicBlas;
+
   BlasEntry() = default;
 
   BlasEntry(const DrawCallState& input_)
@@ -589,6 +639,13 @@ struct Tlas {
   VkBuildAccelerationStructureFlagsKHR flags = 0;
   Rc<DxvkAccelStructure> accelStructure = nullptr;
   Rc<DxvkAccelStructure> previousAccelStructure = nullptr;
+
+  // State of the last build, a TLAS built with ALLOW_UPDATE can be refit when the next build has the same instance layout
+  uint32_t instanceCount = 0;
+  XXH64_hash_t instanceLayoutHash = kEmptyHash;
+  VkDeviceSize updateScratchSize = 0;
+  // Number of refits since the last full build
+  uint32_t refitCount = 0;
 };
 
 enum class RtxGeometryStatus {
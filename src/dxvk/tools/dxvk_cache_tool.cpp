@@ -0,0 +1,191 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../dxvk_state_cache_io.h"
+
+using namespace dxvk;
+
+namespace {
+
+  struct CacheFileStats {
+    DxvkStateCacheHeader    header;
+    DxvkStateCachePackStats pack;
+    uint32_t                numAppended       = 0;
+    uint32_t                numInvalid        = 0;
+    uint32_t                numGraphics       = 0;
+    uint32_t                numCompute        = 0;
+  };
+
+
+  bool readCacheFile(
+    const std::string&                  path,
+          std::vector<DxvkStateCacheEntry>& entries,
+          CacheFileStats&               stats) {
+    std::ifstream file(path, std::ios_base::binary);
+
+    if (!file) {
+      std::cerr << "Failed to open " << path << std::endl;
+      return false;
+    }
+
+    if (!DxvkStateCacheIo::readCacheHeader(file, stats.header)) {
+      std::cerr << "Invalid state cache header" << std::endl;
+      return false;
+    }
+
+    if (!DxvkStateCacheIo::isHeaderSupported(stats.header)) {
+      std::cerr << "Unsupported state cache version v" << stats.header.version << std::endl;
+      return false;
+    }
+
+    if (stats.header.version >= 11) {
+      DxvkStateCachePackReader pack;
+
+      if (!pack.open(str::tows(path.c_str()), sizeof(DxvkStateCacheHeader))) {
+        std::cerr << "Packed section is corrupt" << std::endl;
+        return false;
+      }
+
+      for (uint32_t i = 0; i < pack.getGroupCount(); i++)
+        stats.numInvalid += pack.readGroup(i, entries);
+
+      stats.pack = pack.getStats();
+      file.seekg(pack.getEndOffset());
+    }
+
+    while (file) {
+      DxvkStateCacheEntry entry;
+
+      if (DxvkStateCacheIo::readCacheEntry(stats.header.version, file, entry)) {
+        entries.push_back(entry);
+        stats.numAppended += 1;
+      } else if (file) {
+        stats.numInvalid += 1;
+      }
+    }
+
+    for (const auto& entry : entries) {
+      if (entry.shaders.cs.eq(DxvkShaderKey()))
+        stats.numGraphics += 1;
+      else
+        stats.numCompute += 1;
+    }
+
+    return true;
+  }
+
+
+  void printStats(const CacheFileStats& stats) {
+    std::cout << "Version:           v" << stats.header.version << std::endl;
+    std::cout << "Graphics entries:  " << stats.numGraphics << std::endl;
+    std::cout << "Compute entries:   " << stats.numCompute << std::endl;
+    std::cout << "Invalid entries:   " << stats.numInvalid << std::endl;
+
+    if (stats.header.version >= 11) {
+      std::cout << "Packed entries:    " << stats.pack.entryCount
+                << " (" << stats.pack.deltaEntryCount << " delta-encoded)" << std::endl;
+      std::cout << "Appended entries:  " << stats.numAppended << std::endl;
+      std::cout << "Shader keys:       " << stats.pack.shaderKeyCount << std::endl;
+      std::cout << "Shader sets:       " << stats.pack.groupCount << std::endl;
+      std::cout << "State data:        " << stats.pack.dataBytes << " bytes encoded, "
+                << stats.pack.stateBytes << " bytes decoded" << std::endl;
+      std::cout << "Pack size:         " << stats.pack.packBytes << " bytes" << std::endl;
+    }
+  }
+
+
+  int convertCacheFile(
+    const std::string&                  srcPath,
+    const std::string&                  dstPath) {
+    std::vector<DxvkStateCacheEntry> entries;
+    CacheFileStats stats;
+
+    if (!readCacheFile(srcPath, entries, stats))
+      return 1;
+
+    std::ofstream file(dstPath, std::ios_base::binary | std::ios_base::trunc);
+
+    if (!file) {
+      std::cerr << "Failed to create " << dstPath << std::endl;
+      return 1;
+    }
+
+    DxvkStateCacheHeader header;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    DxvkStateCachePackWriter writer;
+
+    for (const auto& entry : entries)
+      writer.addEntry(entry);
+
+    if (!writer.write(file)) {
+      std::cerr << "Failed to write " << dstPath << std::endl;
+      return 1;
+    }
+
+    const auto& pack = writer.stats();
+
+    std::cout << "Converted v" << stats.header.version << " to v" << header.version << ": "
+              << pack.entryCount << " entries, " << pack.packBytes << " bytes" << std::endl;
+
+    if (stats.numInvalid)
+      std::cout << "Dropped " << stats.numInvalid << " invalid entries" << std::endl;
+
+    return 0;
+  }
+
+
+  void printUsage() {
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  dxvk_cache_tool <file>                  Validate a state cache and print statistics" << std::endl;
+    std::cout << "  dxvk_cache_tool --convert <src> <dst>   Convert a state cache of any version to the current one" << std::endl;
+  }
+
+}
+
+
+int main(int argc, char** argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+
+  if (args.size() == 3 && args[0] == "--convert")
+    return convertCacheFile(args[1], args[2]);
+
+  if (args.size() != 1 || args[0].rfind("--", 0) == 0) {
+    printUsage();
+    return 1;
+  }
+
+  std::vector<DxvkStateCacheEntry> entries;
+  CacheFileStats stats;
+
+  if (!readCacheFile(args[0], entries, stats))
+    return 1;
+
+  printStats(stats);
+
+  // Non-zero exit code so that scripts can detect corrupt caches
+  return stats.numInvalid ? 2 : 0;
+}
@@ -41,6 +41,13 @@ namespace dxvk {
 
     SpirvCompressedBuffer(
       const SpirvCodeBuffer&  code);
+
+    // NV-DXVK start: persistent D3D9 shader cache
+    SpirvCompressedBuffer(
+            uint32_t              size,
+            std::vector<uint64_t> mask,
+            std::vector<uint64_t> code);
+    // NV-DXVK end
     
     ~SpirvCompressedBuffer();
     
@@ -50,6 +57,25 @@ namespace dxvk {
       return m_code;
     }
 
+    // NV-DXVK start: persistent D3D9 shader cache
+    /**
+     * \brief Size of the uncompressed code, in dwords
+     */
+    uint32_t dwords() const {
+      return m_size;
+    }
+
+    /**
+     * \brief Per-dword byte count masks
+     *
+     * Together with \ref getCode and \ref dwords, this
+     * is enough to serialize the compressed buffer.
+     */
+    const std::vector<uint64_t>& getMask() const {
+      return m_mask;
+    }
+    // NV-DXVK end
+
   private:
 
     uint32_t              m_size;
@@ -0,0 +1,254 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include "draw_profiler.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "../util_bit.h"
+#include "../util_env.h"
+#include "../util_likely.h"
+#include "../util_string.h"
+
+namespace dxvk {
+
+  std::atomic<bool> DrawProfiler::s_enabled     = { env::getEnvVar("DXVK_DRAW_PROFILER") == "1" };
+  std::atomic<bool> DrawProfiler::s_everEnabled = { false };
+
+  dxvk::mutex                                       DrawProfiler::s_mutex;
+  std::vector<std::unique_ptr<DrawProfiler::ThreadBuffer>> DrawProfiler::s_buffers;
+  DrawStageReport                                   DrawProfiler::s_lastFrame;
+  DrawStageReport                                   DrawProfiler::s_accumulated;
+
+
+  uint32_t DrawStageHistogram::bucketIndex(uint64_t ns) {
+    if (ns >> 31)
+      return BucketCount - 1;
+
+    return ns ? 31 - bit::lzcnt(uint32_t(ns)) : 0;
+  }
+
+
+  uint64_t DrawStageHistogram::percentileNs(double fraction) const {
+    if (!count)
+      return 0;
+
+    uint64_t target = uint64_t(fraction * double(count));
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < BucketCount; i++) {
+      seen += buckets[i];
+
+      if (seen > target)
+        return (uint64_t(2) << i) - 1;
+    }
+
+    return (uint64_t(2) << (BucketCount - 1)) - 1;
+  }
+
+
+  void DrawStageHistogram::add(const DrawStageHistogram& other) {
+    count   += other.count;
+    totalNs += other.totalNs;
+
+    for (uint32_t i = 0; i < BucketCount; i++)
+      buckets[i] += other.buckets[i];
+  }
+
+
+  void DrawProfiler::record(DrawStage stage, uint64_t ns) {
+    ThreadBuffer* buffer = getThreadBuffer();
+
+    // Only the owning thread writes to the buffer, so a
+    // relaxed load and store is enough and avoids a locked
+    // read-modify-write on every sample
+    auto& bucket = buffer->buckets[uint32_t(stage)][DrawStageHistogram::bucketIndex(ns)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    auto& total = buffer->totalNs[uint32_t(stage)];
+    total.store(total.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+  }
+
+
+  void DrawProfiler::endFrame() {
+    if (!enabled())
+      return;
+
+    s_everEnabled.store(true, std::memory_order_relaxed);
+
+    std::lock_guard<dxvk::mutex> lock(s_mutex);
+
+    DrawStageReport frame;
+    frame.frames = 1;
+
+    for (const auto& buffer : s_buffers) {
+      for (uint32_t s = 0; s < StageCount; s++) {
+        DrawStageHistogram& merged = buffer->merged[s];
+        DrawStageHistogram& delta = frame.stages[s];
+
+        for (uint32_t i = 0; i < DrawStageHistogram::BucketCount; i++) {
+          uint64_t value = buffer->buckets[s][i].load(std::memory_order_relaxed);
+          uint64_t diff = value - merged.buckets[i];
+
+          delta.buckets[i] += diff;
+          delta.count      += diff;
+          merged.buckets[i] = value;
+        }
+
+        uint64_t total = buffer->totalNs[s].load(std::memory_order_relaxed);
+        delta.totalNs += total - merged.totalNs;
+        merged.totalNs = total;
+      }
+    }
+
+    s_lastFrame = frame;
+
+    s_accumulated.frames += 1;
+
+    for (uint32_t s = 0; s < StageCount; s++)
+      s_accumulated.stages[s].add(frame.stages[s]);
+  }
+
+
+  DrawStageReport DrawProfiler::lastFrame() {
+    std::lock_guard<dxvk::mutex> lock(s_mutex);
+    return s_lastFrame;
+  }
+
+
+  DrawStageReport DrawProfiler::accumulated() {
+    std::lock_guard<dxvk::mutex> lock(s_mutex);
+    return s_accumulated;
+  }
+
+
+  void DrawProfiler::serialize() {
+    if (!s_everEnabled.load(std::memory_order_relaxed))
+      return;
+
+    std::string path = env::getEnvVar("DXVK_METRICS_PATH");
+
+    if (path == "none")
+      return;
+
+    if (!path.empty() && *path.rbegin() != '/')
+      path += '/';
+
+    DrawStageReport report = accumulated();
+
+    std::ofstream csv(str::tows((path + "draw_stages.csv").c_str()).c_str());
+    csv << toCsv(report);
+
+    std::ofstream json(str::tows((path + "draw_stages.json").c_str()).c_str());
+    json << toJson(report);
+  }
+
+
+  const char* DrawProfiler::stageName(DrawStage stage) {
+    switch (stage) {
+      case DrawStage::D3D9Validation:   return "d3d9_validation";
+      case DrawStage::RasterSetup:      return "raster_setup";
+      case DrawStage::PrepareGeometry:  return "prepare_geometry";
+      case DrawStage::GeometryHashing:  return "geometry_hashing";
+      case DrawStage::Skinning:         return "skinning";
+      case DrawStage::CsDispatch:       return "cs_dispatch";
+      case DrawStage::FutureWait:       return "future_wait";
+      case DrawStage::SubmitDrawState:  return "submit_draw_state";
+      case DrawStage::InstanceMatching: return "instance_matching";
+      default:                          return "unknown";
+    }
+  }
+
+
+  std::string DrawProfiler::toCsv(const DrawStageReport& report) {
+    std::stringstream stream;
+    stream << "stage,frames,count,total_ns,avg_ns,p50_ns,p99_ns";
+
+    for (uint32_t i = 0; i < DrawStageHistogram::BucketCount; i++)
+      stream << ",bucket" << i;
+
+    stream << "\n";
+
+    for (uint32_t s = 0; s < StageCount; s++) {
+      const DrawStageHistogram& h = report.stages[s];
+
+      stream << stageName(DrawStage(s)) << ","
+             << report.frames << ","
+             << h.count << ","
+             << h.totalNs << ","
+             << uint64_t(h.averageNs()) << ","
+             << h.percentileNs(0.5) << ","
+             << h.percentileNs(0.99);
+
+      for (uint32_t i = 0; i < DrawStageHistogram::BucketCount; i++)
+        stream << "," << h.buckets[i];
+
+      stream << "\n";
+    }
+
+    return stream.str();
+  }
+
+
+  std::string DrawProfiler::toJson(const DrawStageReport& report) {
+    std::stringstream stream;
+    stream << "{\n  \"frames\": " << report.frames << ",\n  \"stages\": {";
+
+    for (uint32_t s = 0; s < StageCount; s++) {
+      const DrawStageHistogram& h = report.stages[s];
+
+      stream << (s ? ",\n" : "\n")
+             << "    \"" << stageName(DrawStage(s)) << "\": { "
+             << "\"count\": " << h.count << ", "
+             << "\"total_ns\": " << h.totalNs << ", "
+             << "\"p50_ns\": " << h.percentileNs(0.5) << ", "
+             << "\"p99_ns\": " << h.percentileNs(0.99) << ", "
+             << "\"buckets\": [";
+
+      for (uint32_t i = 0; i < DrawStageHistogram::BucketCount; i++)
+        stream << (i ? ", " : "") << h.buckets[i];
+
+      stream << "] }";
+    }
+
+    stream << "\n  }\n}\n";
+    return stream.str();
+  }
+
+
+  DrawProfiler::ThreadBuffer* DrawProfiler::getThreadBuffer() {
+    static thread_local ThreadBuffer* t_buffer = nullptr;
+
+    if (unlikely(!t_buffer)) {
+      // Buffers stay alive after their thread exits so that
+      // the samples it recorded still take part in merges
+      auto buffer = std::make_unique<ThreadBuffer>();
+      t_buffer = buffer.get();
+
+      std::lock_guard<dxvk::mutex> lock(s_mutex);
+      s_buffers.push_back(std::move(buffer));
+    }
+
+    return t_buffer;
+  }
+
+}
@@ -0,0 +1,219 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../thread.h"
+#include "../util_time.h"
+
+namespace dxvk {
+
+  /**
+   * \brief Stages a draw call goes through on its way to the ray tracer
+   */
+  enum class DrawStage : uint32_t {
+    D3D9Validation = 0, // Draw entry point up to geometry preparation
+    RasterSetup,        // State validation and emitting the original draw
+    PrepareGeometry,    // PrepareDrawGeometryForRT on the application thread
+    GeometryHashing,    // Geometry hash jobs on worker threads
+    Skinning,           // Skinning jobs on worker threads
+    CsDispatch,         // Handing the draw call state to the CS thread
+    FutureWait,         // Waiting for hash, bounds and skinning results
+    SubmitDrawState,    // SceneManager::submitDrawState
+    InstanceMatching,   // Matching the draw against existing instances
+
+    Count
+  };
+
+  /**
+   * \brief Histogram of stage durations
+   *
+   * Bucket \c i counts samples of at least \c 2^i and
+   * less than \c 2^(i+1) nanoseconds, bucket 0 also
+   * counts zero length samples.
+   */
+  struct DrawStageHistogram {
+    constexpr static uint32_t BucketCount = 32;
+
+    uint64_t count   = 0;
+    uint64_t totalNs = 0;
+    std::array<uint64_t, BucketCount> buckets = { };
+
+    static uint32_t bucketIndex(uint64_t ns);
+
+    /**
+     * \brief Approximates a percentile
+     * \param [in] fraction Percentile in the range [0,1]
+     * \returns Upper bound of the bucket containing it, in ns
+     */
+    uint64_t percentileNs(double fraction) const;
+
+    double averageNs() const {
+      return count ? double(totalNs) / double(count) : 0.0;
+    }
+
+    void add(const DrawStageHistogram& other);
+  };
+
+  /**
+   * \brief Per-stage histograms for a number of frames
+   */
+  struct DrawStageReport {
+    uint64_t frames = 0;
+    std::array<DrawStageHistogram, uint32_t(DrawStage::Count)> stages;
+
+    const DrawStageHistogram& operator [] (DrawStage stage) const {
+      return stages[uint32_t(stage)];
+    }
+  };
+
+  /**
+   * \brief Aggregate per-draw CPU cost accounting
+   *
+   * Complements the profiler zones with numbers that can be read
+   * at runtime. Every thread records stage durations into its own
+   * buffer with plain relaxed stores, so recording takes no locks
+   * and causes no cache line sharing. Once per frame the buffers
+   * are merged by diffing them against the previous merge.
+   *
+   * Recording is disabled by default and costs a single relaxed
+   * load per stage while disabled. It is enabled by the HUD item
+   * or by setting \c DXVK_DRAW_PROFILER=1, in which case the
+   * accumulated histograms are also written next to the metrics.
+   */
+  class DrawProfiler {
+    constexpr static uint32_t StageCount = uint32_t(DrawStage::Count);
+  public:
+
+    static bool enabled() {
+      return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    static void setEnabled(bool enabled) {
+      s_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Records a stage duration for the calling thread
+     */
+    static void record(DrawStage stage, uint64_t ns);
+
+    /**
+     * \brief Merges all thread buffers into the frame report
+     *
+     * Called once per frame. Samples recorded concurrently
+     * are picked up by the next merge.
+     */
+    static void endFrame();
+
+    /**
+     * \brief Report for the last merged frame
+     */
+    static DrawStageReport lastFrame();
+
+    /**
+     * \brief Report accumulated since startup
+     */
+    static DrawStageReport accumulated();
+
+    /**
+     * \brief Writes the accumulated report as CSV and JSON
+     *
+     * Files are written to \c DXVK_METRICS_PATH next to the
+     * metrics file, and only if recording was ever enabled.
+     */
+    static void serialize();
+
+    static const char* stageName(DrawStage stage);
+
+    static std::string toCsv(const DrawStageReport& report);
+
+    static std::string toJson(const DrawStageReport& report);
+
+  private:
+
+    struct ThreadBuffer {
+      std::array<std::array<std::atomic<uint64_t>, DrawStageHistogram::BucketCount>, StageCount> buckets = { };
+      std::array<std::atomic<uint64_t>, StageCount> totalNs = { };
+      // Values seen by the last merge, owned by the merging thread
+      std::array<DrawStageHistogram, StageCount> merged;
+    };
+
+    static std::atomic<bool> s_enabled;
+    static std::atomic<bool> s_everEnabled;
+
+    static dxvk::mutex                                s_mutex;
+    static std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+    static DrawStageReport                            s_lastFrame;
+    static DrawStageReport                            s_accumulated;
+
+    static ThreadBuffer* getThreadBuffer();
+
+  };
+
+  /**
+   * \brief Records the duration of a draw stage
+   *
+   * Records when going out of scope, or earlier when \c end
+   * is called. Does nothing if the profiler is disabled when
+   * the scope starts.
+   */
+  class DrawStageScope {
+  public:
+
+    explicit DrawStageScope(DrawStage stage)
+    : m_stage   (stage),
+      m_active  (DrawProfiler::enabled()) {
+      if (m_active)
+        m_start = high_resolution_clock::now();
+    }
+
+    ~DrawStageScope() {
+      end();
+    }
+
+    DrawStageScope             (const DrawStageScope&) = delete;
+    DrawStageScope& operator = (const DrawStageScope&) = delete;
+
+    void end() {
+      if (m_active) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          high_resolution_clock::now() - m_start).count();
+        DrawProfiler::record(m_stage, uint64_t(ns));
+        m_active = false;
+      }
+    }
+
+  private:
+
+    DrawStage                           m_stage;
+    bool                                m_active;
+    high_resolution_clock::time_point   m_start;
+
+  };
+
+}
@@ -20,6 +20,7 @@
 * DEALINGS IN THE SOFTWARE.
 */
 #include "METRICS.h"
+#include "draw_profiler.h"
 
 #include "../util_env.h"
 #include "util_math.h"
@@ -46,6 +47,8 @@ namespace dxvk {
   void Metrics::serialize() {
     for(uint32_t i=0 ; i<Metric::kCount ; i++)
       s_instance.emitMsg((Metric)i, s_instance.m_data[i]);
+
+    DrawProfiler::serialize();
   }
 
   template<typename T>
@@ -0,0 +1,107 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <utility>
+
+#include "util_mapped_file.h"
+
+#include <Windows.h>
+
+namespace dxvk {
+
+  MappedFile::MappedFile(MappedFile&& other) noexcept
+  : m_file    (std::exchange(other.m_file,    nullptr)),
+    m_mapping (std::exchange(other.m_mapping, nullptr)),
+    m_data    (std::exchange(other.m_data,    nullptr)),
+    m_size    (std::exchange(other.m_size,    0)) { }
+
+
+  MappedFile& MappedFile::operator = (MappedFile&& other) noexcept {
+    if (this != &other) {
+      close();
+
+      m_file    = std::exchange(other.m_file,    nullptr);
+      m_mapping = std::exchange(other.m_mapping, nullptr);
+      m_data    = std::exchange(other.m_data,    nullptr);
+      m_size    = std::exchange(other.m_size,    0);
+    }
+
+    return *this;
+  }
+
+
+  bool MappedFile::open(const std::wstring& path) {
+    close();
+
+    HANDLE file = ::CreateFileW(path.c_str(), GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE)
+      return false;
+
+    LARGE_INTEGER size = { };
+
+    if (!::GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+      ::CloseHandle(file);
+      return false;
+    }
+
+    HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (!mapping) {
+      ::CloseHandle(file);
+      return false;
+    }
+
+    void* data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (!data) {
+      ::CloseHandle(mapping);
+      ::CloseHandle(file);
+      return false;
+    }
+
+    m_file    = file;
+    m_mapping = mapping;
+    m_data    = reinterpret_cast<const uint8_t*>(data);
+    m_size    = size_t(size.QuadPart);
+    return true;
+  }
+
+
+  void MappedFile::close() {
+    if (m_data)
+      ::UnmapViewOfFile(m_data);
+
+    if (m_mapping)
+      ::CloseHandle(m_mapping);
+
+    if (m_file)
+      ::CloseHandle(m_file);
+
+    m_file    = nullptr;
+    m_mapping = nullptr;
+    m_data    = nullptr;
+    m_size    = 0;
+  }
+
+}
@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace dxvk {
+
+  /**
+   * \brief Read-only memory mapped file
+   *
+   * Maps an entire file into the address space so that
+   * it can be parsed in place without stream I/O. The
+   * mapping stays valid until the object is destroyed
+   * or \c close is called.
+   */
+  class MappedFile {
+
+  public:
+
+    MappedFile() { }
+
+    ~MappedFile() {
+      close();
+    }
+
+    MappedFile             (const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator = (MappedFile&& other) noexcept;
+
+    /**
+     * \brief Maps a file
+     *
+     * \param [in] path Path to the file
+     * \returns \c true on success. Empty files
+     *    cannot be mapped and will fail.
+     */
+    bool open(const std::wstring& path);
+
+    /**
+     * \brief Unmaps the file
+     */
+    void close();
+
+    bool isOpen() const {
+      return m_data != nullptr;
+    }
+
+    const uint8_t* data() const {
+      return m_data;
+    }
+
+    size_t size() const {
+      return m_size;
+    }
+
+  private:
+
+    void*           m_file    = nullptr;
+    void*           m_mapping = nullptr;
+    const uint8_t*  m_data    = nullptr;
+    size_t          m_size    = 0;
+
+  };
+
+}
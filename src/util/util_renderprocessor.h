@@ -136,6 +136,13 @@ namespace dxvk {
       */
     virtual void work(T& item, Rc<DxvkContext>& ctx) = 0;
 
+    /**
+      * \brief Called after an item was processed and the queue ran empty,
+      *        before the item is retired. Can be used to submit work which
+      *        was batched up while processing items.
+      */
+    virtual void idle(Rc<DxvkContext>& ctx) { }
+
     /**
       * \brief Conditions under which to wake worker, can be augmented by implementation.
       */
@@ -195,6 +202,15 @@ namespace dxvk {
           T& item = optItem.value();
 
           work(item, m_ctx);
+
+          bool queueEmpty;
+          {
+            std::unique_lock<dxvk::mutex> lock(m_mutex);
+            queueEmpty = m_itemQueue.empty();
+          }
+
+          if (queueEmpty)
+            idle(m_ctx);
         }
       } catch (const DxvkError& e) {
         Logger::err(str::format("Exception on, ", m_threadName, ", thread!"));
@@ -0,0 +1,184 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <iostream>
+
+#include "../../test_utils.h"
+#include "../../../src/dxvk/rtx_render/rtx_accel_build_scheduler.h"
+
+using namespace dxvk;
+using namespace std;
+
+// Costs 1 ms per 1000 primitives for every kind of build, so that budgets are easy to reason about
+class MockAccelBuildCostModel : public AccelBuildCostModel {
+public:
+  float estimateBuildTimeMs(AccelBuildKind kind, uint32_t primitiveCount) const override {
+    return float(primitiveCount) / 1000.f;
+  }
+};
+
+class AccelBuildSchedulerTestApp {
+public:
+  static void run() {
+    cout << "Begin budget test" << endl;
+    test_budget();
+    cout << "Begin oversized build test" << endl;
+    test_oversized();
+    cout << "Begin unlimited budget test" << endl;
+    test_unlimited();
+    cout << "Begin spreading test" << endl;
+    test_spreading();
+    cout << "Begin calibration test" << endl;
+    test_calibration();
+    cout << "Acceleration structure build scheduling successfully tested" << endl;
+  }
+
+private:
+  static void test_budget() {
+    MockAccelBuildCostModel costModel;
+    AccelBuildScheduler scheduler(costModel);
+
+    scheduler.beginFrame(2.f);
+
+    if (!scheduler.tryScheduleBuild(AccelBuildKind::FastTrace, 1000) ||
+        !scheduler.tryScheduleBuild(AccelBuildKind::FastTrace, 1000))
+      throw DxvkError("Builds within the budget were deferred");
+
+    if (scheduler.tryScheduleBuild(AccelBuildKind::FastTrace, 500))
+      throw DxvkError("Build exceeding the budget was scheduled");
+
+    if (scheduler.getScheduledBuildCount() != 2 || scheduler.getDeferredBuildCount() != 1)
+      throw DxvkError("Unexpected build counts");
+
+    // A new frame starts with the whole budget again
+    scheduler.beginFrame(2.f);
+
+    if (!scheduler.tryScheduleBuild(AccelBuildKind::FastTrace, 500) || scheduler.getDeferredBuildCount() != 0)
+      throw DxvkError("Budget was not reset at the beginning of the frame");
+  }
+
+  static void test_oversized() {
+    MockAccelBuildCostModel costModel;
+    AccelBuildScheduler scheduler(costModel);
+
+    // A build larger than the whole budget must still be made, or it would never be
+    scheduler.beginFrame(1.f);
+
+    if (!scheduler.tryScheduleBuild(AccelBuildKind::FastTrace, 100000))
+      throw DxvkError("Oversized build was never scheduled");
+
+    if (scheduler.tryScheduleBuild(AccelBuildKind::FastTrace, 1))
+      throw DxvkError("Build was scheduled after the budget was exhausted");
+  }
+
+  static void test_unlimited() {
+    MockAccelBuildCostModel costModel;
+    AccelBuildScheduler scheduler(costModel);
+
+    scheduler.beginFrame(0.f);
+
+    for (uint32_t i = 0; i < 1000; i++) {
+      if (!scheduler.tryScheduleBuild(AccelBuildKind::FastTrace, 100000))
+        throw DxvkError("Build was deferred without a budget");
+    }
+  }
+
+  static void test_spreading() {
+    // A level load requesting 1000 builds of 1 ms each with a 4 ms budget takes 250 frames, never exceeding the budget
+    MockAccelBuildCostModel costModel;
+    AccelBuildScheduler scheduler(costModel);
+
+    uint32_t numPendingBuilds = 1000;
+    uint32_t numFrames = 0;
+
+    while (numPendingBuilds > 0) {
+      scheduler.beginFrame(4.f);
+
+      const uint32_t numRequestedBuilds = numPendingBuilds;
+
+      for (uint32_t i = 0; i < numRequestedBuilds; i++) {
+        if (scheduler.tryScheduleBuild(AccelBuildKind::FastTrace, 1000))
+          --numPendingBuilds;
+      }
+
+      if (scheduler.getScheduledTimeMs() > 4.f)
+        throw DxvkError("Scheduled builds exceeded the frame budget");
+
+      if (++numFrames > 1000)
+        throw DxvkError("Builds did not make progress");
+    }
+
+    cout << "  frames: " << numFrames << endl;
+
+    if (numFrames != 250)
+      throw DxvkError("Builds were not spread evenly across frames");
+  }
+
+  static void test_calibration() {
+    LinearAccelBuildCostModel costModel;
+
+    // Measurements of builds 4x slower than the initial estimate move the estimate towards the measured cost
+    const uint32_t numBuilds = 10;
+    const uint64_t numPrimitives = 1000000;
+    const float costPerPrimitiveMs = 4.f * costModel.getCostPerPrimitiveMs(AccelBuildKind::FastTrace);
+    const float gpuTimeMs = LinearAccelBuildCostModel::kCostPerBuildMs * numBuilds + costPerPrimitiveMs * numPrimitives;
+
+    for (uint32_t i = 0; i < 50; i++)
+      costModel.addMeasurement(AccelBuildKind::FastTrace, numBuilds, numPrimitives, gpuTimeMs);
+
+    const float calibratedCost = costModel.getCostPerPrimitiveMs(AccelBuildKind::FastTrace);
+
+    if (calibratedCost < costPerPrimitiveMs * 0.99f || calibratedCost > costPerPrimitiveMs * 1.01f)
+      throw DxvkError("Cost model did not converge to the measured cost");
+
+    // Each kind of build is calibrated separately
+    if (costModel.getCostPerPrimitiveMs(AccelBuildKind::FastBuild) == calibratedCost)
+      throw DxvkError("Measurement affected another kind of build");
+
+    // Measurements over too few primitives are noise
+    costModel.addMeasurement(AccelBuildKind::FastTrace, 1, 10, 100.f);
+
+    if (costModel.getCostPerPrimitiveMs(AccelBuildKind::FastTrace) != calibratedCost)
+      throw DxvkError("Small measurement was not ignored");
+
+    // The scheduler picks up the calibrated estimates
+    AccelBuildScheduler scheduler(costModel);
+    scheduler.beginFrame(1000.f);
+    scheduler.tryScheduleBuild(AccelBuildKind::FastTrace, 100000);
+
+    const float expectedTimeMs = costModel.estimateBuildTimeMs(AccelBuildKind::FastTrace, 100000);
+
+    if (scheduler.getScheduledTimeMs() != expectedTimeMs)
+      throw DxvkError("Scheduler did not use the cost model's estimate");
+  }
+};
+
+int main() {
+  try {
+    AccelBuildSchedulerTestApp::run();
+  }
+  catch (const dxvk::DxvkError& e) {
+    cerr << e.message() << endl;
+    return -1;
+  }
+
+  return 0;
+}
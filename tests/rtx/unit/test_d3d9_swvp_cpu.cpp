@@ -0,0 +1,239 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../../test_utils.h"
+#include "../../../src/d3d9/d3d9_swvp_cpu.h"
+#include "../../../src/util/util_error.h"
+#include "../../../src/util/util_string.h"
+
+using namespace dxvk;
+
+namespace swvp_cpu_test {
+
+// Expected values below are what the fixed function vertex shader
+// followed by the SWVP geometry shader write for the same state.
+class SWVPCpuTestApp {
+public:
+  static void run() {
+    std::cout << "Begin test (transform)" << std::endl;
+    test_transform();
+
+    std::cout << "Begin test (lighting)" << std::endl;
+    test_lighting();
+
+    std::cout << "Begin test (parallel)" << std::endl;
+    test_parallel();
+  }
+
+private:
+  struct InputVertex {
+    float    position[3];
+    float    normal[3];
+    uint32_t color;
+    float    texcoord[2];
+  };
+
+  struct OutputVertex {
+    float    position[4];
+    float    normal[3];
+    float    color0[4];
+    uint32_t color1;
+    float    texcoord[2];
+  };
+
+  static constexpr D3DVERTEXELEMENT9 s_inputDecl[] = {
+    { 0,  0, D3DDECLTYPE_FLOAT3,   0, D3DDECLUSAGE_POSITION, 0 },
+    { 0, 12, D3DDECLTYPE_FLOAT3,   0, D3DDECLUSAGE_NORMAL,   0 },
+    { 0, 24, D3DDECLTYPE_D3DCOLOR, 0, D3DDECLUSAGE_COLOR,    0 },
+    { 0, 28, D3DDECLTYPE_FLOAT2,   0, D3DDECLUSAGE_TEXCOORD, 0 },
+  };
+
+  static constexpr D3DVERTEXELEMENT9 s_outputDecl[] = {
+    { 0,  0, D3DDECLTYPE_FLOAT4,   0, D3DDECLUSAGE_POSITION, 0 },
+    { 0, 16, D3DDECLTYPE_FLOAT3,   0, D3DDECLUSAGE_NORMAL,   0 },
+    { 0, 28, D3DDECLTYPE_FLOAT4,   0, D3DDECLUSAGE_COLOR,    0 },
+    { 0, 44, D3DDECLTYPE_D3DCOLOR, 0, D3DDECLUSAGE_COLOR,    1 },
+    { 0, 48, D3DDECLTYPE_FLOAT2,   0, D3DDECLUSAGE_TEXCOORD, 1 },
+  };
+
+  static D3D9SWVPCpuKernel createKernel(const D3D9SWVPCpuState& state) {
+    if (!D3D9SWVPCpuKernel::SupportsDeclarations(
+          s_inputDecl, std::size(s_inputDecl), s_outputDecl, std::size(s_outputDecl)))
+      throw DxvkError("Declarations unexpectedly unsupported");
+
+    return D3D9SWVPCpuKernel(state,
+      s_inputDecl,  std::size(s_inputDecl),
+      s_outputDecl, std::size(s_outputDecl));
+  }
+
+  static void process(const D3D9SWVPCpuKernel& kernel, const std::vector<InputVertex>& src, std::vector<OutputVertex>& dst, bool parallel) {
+    std::array<D3D9SWVPCpuStream, caps::MaxStreams> streams = { };
+    streams[0].data   = reinterpret_cast<const uint8_t*>(src.data());
+    streams[0].stride = sizeof(InputVertex);
+
+    dst.resize(src.size());
+
+    if (parallel)
+      kernel.Process(streams.data(), 0, uint32_t(src.size()), reinterpret_cast<uint8_t*>(dst.data()), sizeof(OutputVertex));
+    else
+      kernel.ProcessBatch(streams.data(), 0, uint32_t(src.size()), reinterpret_cast<uint8_t*>(dst.data()), sizeof(OutputVertex));
+  }
+
+  static void expect(float actual, float expected, const char* what) {
+    if (std::abs(actual - expected) > 1.0e-5f)
+      throw DxvkError(str::format("Mismatch in ", what, ": got ", actual, ", expected ", expected));
+  }
+
+  static void expect(uint32_t actual, uint32_t expected, const char* what) {
+    if (actual != expected)
+      throw DxvkError(str::format("Mismatch in ", what, ": got ", actual, ", expected ", expected));
+  }
+
+  static D3D9SWVPCpuState createLitState() {
+    D3D9SWVPCpuState state;
+    state.UseLighting      = true;
+    state.GlobalAmbient    = Vector4(0.2f, 0.2f, 0.2f, 0.0f);
+    state.MaterialDiffuse  = Vector4(0.5f, 0.25f, 0.125f, 0.75f);
+    state.MaterialAmbient  = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
+    state.MaterialSpecular = Vector4(0.5f, 0.5f, 0.5f, 0.5f);
+    state.MaterialPower    = 1.0f;
+
+    D3D9SWVPCpuLight& light = state.Lights[0];
+    light.Type      = D3DLIGHT_DIRECTIONAL;
+    light.Diffuse   = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
+    light.Ambient   = Vector4(0.1f, 0.1f, 0.1f, 0.0f);
+    light.Specular  = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
+    light.Direction = Vector4(0.0f, -0.6f, -0.8f, 0.0f);
+    state.LightCount = 1;
+    return state;
+  }
+
+  static void test_transform() {
+    D3D9SWVPCpuState state;
+    state.WorldView[3]     = Vector4(1.0f, 2.0f, 3.0f, 1.0f);
+    state.Projection       = Matrix4(
+      Vector4(2.0f, 0.0f, 0.0f, 0.0f),
+      Vector4(0.0f, 2.0f, 0.0f, 0.0f),
+      Vector4(0.0f, 0.0f, 1.0f, 1.0f),
+      Vector4(0.0f, 0.0f, 0.0f, 0.0f));
+    state.NormalizeNormals = true;
+    state.TexcoordIndices[1] = 0;
+
+    std::vector<InputVertex> src = {
+      { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 2.0f }, 0x80FF4020u, { 0.25f, 0.75f } },
+    };
+    std::vector<OutputVertex> dst;
+
+    process(createKernel(state), src, dst, false);
+
+    // Translated to (2, 3, 4), then projected with w = z
+    expect(dst[0].position[0], 4.0f, "position.x");
+    expect(dst[0].position[1], 6.0f, "position.y");
+    expect(dst[0].position[2], 4.0f, "position.z");
+    expect(dst[0].position[3], 4.0f, "position.w");
+
+    expect(dst[0].normal[0], 0.0f, "normal.x");
+    expect(dst[0].normal[1], 0.0f, "normal.y");
+    expect(dst[0].normal[2], 1.0f, "normal.z");
+
+    // Unlit colors pass through, missing specular is black
+    expect(dst[0].color0[0], 1.0f,          "color0.r");
+    expect(dst[0].color0[1], 64.0f / 255.0f, "color0.g");
+    expect(dst[0].color0[2], 32.0f / 255.0f, "color0.b");
+    expect(dst[0].color0[3], 128.0f / 255.0f, "color0.a");
+    expect(dst[0].color1, 0u, "color1");
+
+    // Output set 1 reads input set 0
+    expect(dst[0].texcoord[0], 0.25f, "texcoord.x");
+    expect(dst[0].texcoord[1], 0.75f, "texcoord.y");
+  }
+
+  static void test_lighting() {
+    std::vector<InputVertex> src = {
+      { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, 0xFFFFFFFFu, { 0.0f, 0.0f } },
+    };
+    std::vector<OutputVertex> dst;
+
+    process(createKernel(createLitState()), src, dst, false);
+
+    // Ambient 0.2 + 0.1, diffuse N.L = 0.8 times the material, alpha
+    // from the diffuse material. The half vector faces away from the
+    // normal, so there is no specular contribution.
+    expect(dst[0].color0[0], 0.7f,  "color0.r");
+    expect(dst[0].color0[1], 0.5f,  "color0.g");
+    expect(dst[0].color0[2], 0.4f,  "color0.b");
+    expect(dst[0].color0[3], 0.75f, "color0.a");
+    expect(dst[0].color1, 0u, "color1");
+  }
+
+  static void test_parallel() {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> uni(-1.0f, 1.0f);
+
+    std::vector<InputVertex> src(1024 * 1024 + 17);
+
+    for (auto& v : src) {
+      v = { { uni(rng), uni(rng), uni(rng) }, { uni(rng), uni(rng), uni(rng) }, uint32_t(rng()), { uni(rng), uni(rng) } };
+    }
+
+    D3D9SWVPCpuState state = createLitState();
+    state.WorldView[3]     = Vector4(0.0f, 0.0f, 5.0f, 1.0f);
+    state.NormalizeNormals = true;
+
+    D3D9SWVPCpuKernel kernel = createKernel(state);
+
+    std::vector<OutputVertex> serial;
+    std::vector<OutputVertex> parallel;
+
+    {
+      std::cout << "Running: ProcessBatch (" << src.size() << " vertices) --> ";
+      Timer time;
+      process(kernel, src, serial, false);
+    }
+
+    {
+      std::cout << "Running: Process (" << src.size() << " vertices) --> ";
+      Timer time;
+      process(kernel, src, parallel, true);
+    }
+
+    if (std::memcmp(serial.data(), parallel.data(), serial.size() * sizeof(OutputVertex)) != 0)
+      throw DxvkError("Parallel output not matching serial output");
+  }
+};
+}
+
+int main() {
+  try {
+    swvp_cpu_test::SWVPCpuTestApp::run();
+  }
+  catch (const dxvk::DxvkError& e) {
+    std::cerr << e.message() << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,236 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../../test_utils.h"
+#include "../../../src/util/log/draw_profiler.h"
+
+using namespace dxvk;
+using namespace std;
+
+class DrawProfilerTestApp {
+public:
+  static void run() {
+    DrawProfiler::setEnabled(true);
+
+    cout << "Begin bucket test" << endl;
+    test_buckets();
+    cout << "Begin merge test" << endl;
+    test_merge();
+    cout << "Begin multithreaded merge test" << endl;
+    test_threads();
+    cout << "Begin serialization test" << endl;
+    test_serialize();
+    cout << "Begin overhead test" << endl;
+    test_overhead();
+    cout << "Draw profiler successfully tested" << endl;
+  }
+
+private:
+  static void expect(bool condition, const char* message) {
+    if (!condition)
+      throw DxvkError(message);
+  }
+
+  static void test_buckets() {
+    expect(DrawStageHistogram::bucketIndex(0) == 0, "0 ns in wrong bucket");
+    expect(DrawStageHistogram::bucketIndex(1) == 0, "1 ns in wrong bucket");
+    expect(DrawStageHistogram::bucketIndex(2) == 1, "2 ns in wrong bucket");
+    expect(DrawStageHistogram::bucketIndex(3) == 1, "3 ns in wrong bucket");
+    expect(DrawStageHistogram::bucketIndex(1024) == 10, "1024 ns in wrong bucket");
+    expect(DrawStageHistogram::bucketIndex(~0ull) == DrawStageHistogram::BucketCount - 1, "Overflow in wrong bucket");
+
+    DrawStageHistogram h;
+    h.count = 100;
+    h.buckets[4] = 90;
+    h.buckets[10] = 10;
+
+    expect(h.percentileNs(0.5) == 31, "Unexpected median");
+    expect(h.percentileNs(0.95) == 2047, "Unexpected 95th percentile");
+  }
+
+  static void test_merge() {
+    // Drop anything recorded so far
+    DrawProfiler::endFrame();
+
+    for (uint32_t i = 0; i < 10; i++)
+      DrawProfiler::record(DrawStage::PrepareGeometry, 1000);
+
+    DrawProfiler::record(DrawStage::SubmitDrawState, 5);
+    DrawProfiler::endFrame();
+
+    DrawStageReport frame = DrawProfiler::lastFrame();
+    expect(frame[DrawStage::PrepareGeometry].count == 10, "Samples lost in merge");
+    expect(frame[DrawStage::PrepareGeometry].totalNs == 10000, "Durations lost in merge");
+    expect(frame[DrawStage::PrepareGeometry].buckets[9] == 10, "Samples merged into wrong bucket");
+    expect(frame[DrawStage::SubmitDrawState].count == 1, "Samples lost in merge");
+    expect(frame[DrawStage::CsDispatch].count == 0, "Samples recorded for wrong stage");
+
+    // A merge only reports samples recorded since the previous one
+    DrawProfiler::endFrame();
+    frame = DrawProfiler::lastFrame();
+    expect(frame[DrawStage::PrepareGeometry].count == 0, "Samples merged twice");
+  }
+
+  static void test_threads() {
+    constexpr uint32_t ThreadCount = 4;
+    constexpr uint32_t SampleCount = 100000;
+
+    DrawProfiler::endFrame();
+    uint64_t framesBefore = DrawProfiler::accumulated().frames;
+
+    std::vector<std::thread> threads;
+
+    for (uint32_t t = 0; t < ThreadCount; t++) {
+      threads.emplace_back([] {
+        for (uint32_t i = 0; i < SampleCount; i++)
+          DrawProfiler::record(DrawStage::GeometryHashing, i & 0xff);
+      });
+    }
+
+    // Merging while threads record must not lose samples
+    uint64_t seen = 0;
+
+    for (uint32_t i = 0; i < 10; i++) {
+      DrawProfiler::endFrame();
+      seen += DrawProfiler::lastFrame()[DrawStage::GeometryHashing].count;
+    }
+
+    for (auto& thread : threads)
+      thread.join();
+
+    DrawProfiler::endFrame();
+    seen += DrawProfiler::lastFrame()[DrawStage::GeometryHashing].count;
+
+    expect(seen == ThreadCount * SampleCount, "Samples lost across threads");
+    expect(DrawProfiler::accumulated().frames == framesBefore + 11, "Unexpected frame count");
+  }
+
+  static void test_serialize() {
+    DrawStageReport report = DrawProfiler::accumulated();
+
+    std::string csv = DrawProfiler::toCsv(report);
+    uint32_t lines = 0;
+
+    for (char c : csv)
+      lines += c == '\n' ? 1 : 0;
+
+    expect(lines == uint32_t(DrawStage::Count) + 1, "Unexpected CSV line count");
+    expect(csv.find("instance_matching,") != std::string::npos, "Stage missing from CSV");
+
+    std::string json = DrawProfiler::toJson(report);
+    expect(json.find("\"prepare_geometry\"") != std::string::npos, "Stage missing from JSON");
+  }
+
+  // Stand-in for the CPU work of one draw stage, mixing the words of a mesh-sized buffer
+  static uint64_t simulateStage(const std::vector<uint64_t>& data, uint64_t hash) {
+    for (uint64_t word : data)
+      hash = (hash ^ word) * 0x100000001b3ull;
+
+    return hash;
+  }
+
+  static uint64_t timeDraw(const std::vector<uint64_t>& data, uint64_t& hash) {
+    auto start = high_resolution_clock::now();
+
+    for (uint32_t stage = 0; stage < uint32_t(DrawStage::Count); stage++) {
+      DrawStageScope scope { DrawStage(stage) };
+      hash = simulateStage(data, hash);
+    }
+
+    auto end = high_resolution_clock::now();
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+  }
+
+  static void test_overhead() {
+    constexpr uint32_t ScopeCount = 1000000;
+    constexpr uint32_t DrawCount = 2000;
+    // Profiling must stay under 1% of the draw time, plus some slack for timing noise
+    constexpr double MaxOverhead = 0.01;
+    constexpr double NoiseTolerance = 0.01;
+
+    auto start = high_resolution_clock::now();
+
+    for (uint32_t i = 0; i < ScopeCount; i++)
+      DrawStageScope scope(DrawStage::CsDispatch);
+
+    auto end = high_resolution_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    cout << "  " << double(ns) / ScopeCount << " ns per recorded scope" << endl;
+
+    // Compare the same draws with and without profiling. Profiled and baseline draws
+    // alternate so that both see the same clock and load changes, and medians discard
+    // the draws hit by preemption or other noise.
+    std::vector<uint64_t> data(16384);
+
+    for (uint32_t i = 0; i < data.size(); i++)
+      data[i] = i * 0x9e3779b97f4a7c15ull;
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    std::vector<int64_t> baselineNs(DrawCount);
+    std::vector<int64_t> differenceNs(DrawCount);
+
+    for (uint32_t i = 0; i < DrawCount; i++) {
+      DrawProfiler::setEnabled(false);
+      baselineNs[i] = int64_t(timeDraw(data, hash));
+
+      DrawProfiler::setEnabled(true);
+      differenceNs[i] = int64_t(timeDraw(data, hash)) - baselineNs[i];
+    }
+
+    DrawProfiler::endFrame();
+
+    std::nth_element(baselineNs.begin(), baselineNs.begin() + DrawCount / 2, baselineNs.end());
+    std::nth_element(differenceNs.begin(), differenceNs.begin() + DrawCount / 2, differenceNs.end());
+    const double overhead = double(differenceNs[DrawCount / 2]) / double(baselineNs[DrawCount / 2]);
+
+    cout << "  " << overhead * 100.0 << "% overhead on simulated draws (hash " << (hash & 0xff) << ")" << endl;
+    expect(overhead <= MaxOverhead + NoiseTolerance, "Profiling overhead exceeds 1% of the draw time");
+
+    DrawProfiler::setEnabled(false);
+    start = high_resolution_clock::now();
+
+    for (uint32_t i = 0; i < ScopeCount; i++)
+      DrawStageScope scope(DrawStage::CsDispatch);
+
+    end = high_resolution_clock::now();
+    ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    cout << "  " << double(ns) / ScopeCount << " ns per disabled scope" << endl;
+  }
+};
+
+int main() {
+  try {
+    DrawProfilerTestApp::run();
+  }
+  catch (const dxvk::DxvkError& e) {
+    cerr << e.message() << endl;
+    return -1;
+  }
+
+  return 0;
+}
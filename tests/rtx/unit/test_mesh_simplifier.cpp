@@ -0,0 +1,185 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <iostream>
+#include <cfloat>
+#include <cmath>
+
+#include "../../test_utils.h"
+#include "../../../src/dxvk/rtx_render/rtx_mesh_simplifier.h"
+
+using namespace dxvk;
+using namespace std;
+
+// Grid of gridSize x gridSize quads in the XY plane, with heights from the function passed in
+template<typename HeightFunction>
+static void createGrid(uint32_t gridSize, HeightFunction height, vector<Vector3>& positions, vector<uint32_t>& indices) {
+  positions.clear();
+  indices.clear();
+
+  for (uint32_t y = 0; y <= gridSize; y++) {
+    for (uint32_t x = 0; x <= gridSize; x++)
+      positions.push_back(Vector3(float(x), float(y), height(x, y)));
+  }
+
+  for (uint32_t y = 0; y < gridSize; y++) {
+    for (uint32_t x = 0; x < gridSize; x++) {
+      const uint32_t v = y * (gridSize + 1) + x;
+      indices.insert(indices.end(), { v, v + 1, v + gridSize + 2, v, v + gridSize + 2, v + gridSize + 1 });
+    }
+  }
+}
+
+static void validateIndices(const vector<uint32_t>& indices, size_t vertexCount) {
+  if (indices.size() % 3 != 0)
+    throw DxvkError("Index count is not a multiple of 3");
+
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+      throw DxvkError("Index is out of range");
+
+    if (indices[i] == indices[i + 1] || indices[i + 1] == indices[i + 2] || indices[i + 2] == indices[i])
+      throw DxvkError("Degenerate triangle in the simplified mesh");
+  }
+}
+
+class MeshSimplifierTestApp {
+public:
+  static void run() {
+    cout << "Begin planar test" << endl;
+    test_planar();
+    cout << "Begin error limit test" << endl;
+    test_errorLimit();
+    cout << "Begin seam test" << endl;
+    test_seam();
+    cout << "Mesh simplification successfully tested" << endl;
+  }
+
+private:
+  static void test_planar() {
+    const uint32_t gridSize = 16;
+    vector<Vector3> positions;
+    vector<uint32_t> indices;
+    createGrid(gridSize, [](uint32_t, uint32_t) { return 0.f; }, positions, indices);
+
+    MeshSimplifier simplifier(positions.data(), sizeof(Vector3), positions.size(), indices.data(), indices.size());
+    simplifier.simplify(indices.size() / 4, 0.001f);
+
+    const vector<uint32_t> simplifiedIndices = simplifier.getIndices();
+    validateIndices(simplifiedIndices, positions.size());
+
+    if (simplifiedIndices.size() != simplifier.getIndexCount())
+      throw DxvkError("Index count does not match the index list");
+
+    if (simplifiedIndices.size() > indices.size() / 4)
+      throw DxvkError("Planar mesh was not simplified down to the target");
+
+    if (simplifier.getError() > 1e-3f)
+      throw DxvkError("Simplifying a planar mesh introduced an error");
+
+    // The outline of the grid is preserved
+    vector<bool> isReferenced(positions.size(), false);
+    for (uint32_t index : simplifiedIndices)
+      isReferenced[index] = true;
+
+    for (uint32_t i = 0; i <= gridSize; i++) {
+      if (!isReferenced[i] || !isReferenced[gridSize * (gridSize + 1) + i] ||
+          !isReferenced[i * (gridSize + 1)] || !isReferenced[i * (gridSize + 1) + gridSize])
+        throw DxvkError("Border vertex was removed");
+    }
+  }
+
+  static void test_errorLimit() {
+    vector<Vector3> positions;
+    vector<uint32_t> indices;
+    createGrid(16, [](uint32_t x, uint32_t y) { return 4.f * sinf(float(x) * 0.7f) * cosf(float(y) * 0.9f); }, positions, indices);
+
+    // A tight error limit stops the simplification early
+    MeshSimplifier strict(positions.data(), sizeof(Vector3), positions.size(), indices.data(), indices.size());
+    strict.simplify(0, 0.01f);
+
+    if (strict.getError() > 0.01f)
+      throw DxvkError("Simplification exceeded the error limit");
+
+    if (strict.getIndexCount() < indices.size() / 2)
+      throw DxvkError("Curved mesh was simplified too far for the error limit");
+
+    // Simplifying further reports a larger error and keeps the mesh valid
+    MeshSimplifier relaxed(positions.data(), sizeof(Vector3), positions.size(), indices.data(), indices.size());
+    relaxed.simplify(indices.size() / 2, FLT_MAX);
+    const size_t firstIndexCount = relaxed.getIndexCount();
+    const float firstError = relaxed.getError();
+
+    relaxed.simplify(indices.size() / 8, FLT_MAX);
+
+    if (relaxed.getIndexCount() >= firstIndexCount || relaxed.getError() < firstError)
+      throw DxvkError("Consecutive simplification did not continue from the previous result");
+
+    if (relaxed.getError() <= strict.getError())
+      throw DxvkError("Error did not grow with the simplification");
+
+    validateIndices(relaxed.getIndices(), positions.size());
+  }
+
+  static void test_seam() {
+    // Two planar grids whose shared edge is made of separate vertices, as with a texture coordinate seam
+    vector<Vector3> positions;
+    vector<uint32_t> indices;
+    createGrid(8, [](uint32_t, uint32_t) { return 0.f; }, positions, indices);
+
+    vector<Vector3> otherPositions;
+    vector<uint32_t> otherIndices;
+    createGrid(8, [](uint32_t, uint32_t) { return 0.f; }, otherPositions, otherIndices);
+
+    const uint32_t baseVertex = uint32_t(positions.size());
+    for (const Vector3& p : otherPositions)
+      positions.push_back(Vector3(p.x + 8.f, p.y, p.z));
+    for (uint32_t index : otherIndices)
+      indices.push_back(baseVertex + index);
+
+    MeshSimplifier simplifier(positions.data(), sizeof(Vector3), positions.size(), indices.data(), indices.size());
+    simplifier.simplify(0, 0.001f);
+
+    const vector<uint32_t> simplifiedIndices = simplifier.getIndices();
+    validateIndices(simplifiedIndices, positions.size());
+
+    vector<bool> isReferenced(positions.size(), false);
+    for (uint32_t index : simplifiedIndices)
+      isReferenced[index] = true;
+
+    for (uint32_t y = 0; y <= 8; y++) {
+      if (!isReferenced[y * 9 + 8] || !isReferenced[baseVertex + y * 9])
+        throw DxvkError("Seam vertex was removed");
+    }
+  }
+};
+
+int main() {
+  try {
+    MeshSimplifierTestApp::run();
+  }
+  catch (const dxvk::DxvkError& e) {
+    cerr << e.message() << endl;
+    return -1;
+  }
+
+  return 0;
+}
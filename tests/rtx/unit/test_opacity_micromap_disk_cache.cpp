@@ -0,0 +1,253 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "../../test_utils.h"
+#include "../../../src/dxvk/rtx_render/rtx_opacity_micromap_disk_cache.h"
+
+using namespace dxvk;
+using namespace std;
+
+namespace fs = std::filesystem;
+
+class OpacityMicromapDiskCacheTestApp {
+public:
+  static void run() {
+    cout << "Begin round trip test" << endl;
+    test_roundTrip();
+    cout << "Begin invalid entry test" << endl;
+    test_invalidEntries();
+    cout << "Begin LRU eviction test" << endl;
+    test_eviction();
+    cout << "Begin export test" << endl;
+    test_export();
+    cout << "Opacity Micromap disk cache successfully tested" << endl;
+
+    fs::remove_all(getTestDirectory());
+  }
+
+private:
+  static fs::path getTestDirectory() {
+    return fs::temp_directory_path() / "rtx_omm_disk_cache_test";
+  }
+
+  static fs::path resetDirectory(const char* name) {
+    const fs::path path = getTestDirectory() / name;
+    fs::remove_all(path);
+    return path;
+  }
+
+  static OpacityMicromapDiskCacheDesc makeDesc(uint32_t numTriangles) {
+    OpacityMicromapDiskCacheDesc desc;
+    desc.numTriangles = numTriangles;
+    desc.subdivisionLevel = 4;
+    desc.ommFormat = 2;
+    return desc;
+  }
+
+  static bool store(OpacityMicromapDiskCache& cache, XXH64_hash_t key, const OpacityMicromapDiskCacheDesc& desc, const vector<uint8_t>& data) {
+    return cache.requestStore(key, desc, vector<uint8_t>(data));
+  }
+
+  // Loads an entry and waits for it to be read
+  static bool load(OpacityMicromapDiskCache& cache, XXH64_hash_t key, const OpacityMicromapDiskCacheDesc& desc, vector<uint8_t>& data) {
+    if (cache.requestLoad(key, desc) == 0)
+      return false;
+
+    cache.sync();
+
+    vector<OpacityMicromapDiskCache::LoadedEntry> loadedEntries;
+    cache.popLoadedEntries(loadedEntries);
+
+    if (loadedEntries.size() != 1 || loadedEntries[0].key != key)
+      throw DxvkError("Requested entry was not returned");
+
+    data = std::move(loadedEntries[0].data);
+    return loadedEntries[0].isValid;
+  }
+
+  static vector<uint8_t> makeData(size_t size, uint8_t seed) {
+    vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++)
+      data[i] = uint8_t(i * 31 + seed);
+    return data;
+  }
+
+  static void test_roundTrip() {
+    const fs::path directory = resetDirectory("roundtrip");
+    const vector<uint8_t> data = makeData(1000, 7);
+
+    {
+      OpacityMicromapDiskCache cache;
+
+      if (!cache.open(directory.string(), 1 << 20))
+        throw DxvkError("Failed to open the cache");
+
+      if (!store(cache, 0x1234, makeDesc(10), data))
+        throw DxvkError("Failed to store an entry");
+    }
+
+    // Entries persist across sessions
+    OpacityMicromapDiskCache cache;
+    cache.open(directory.string(), 1 << 20);
+
+    vector<uint8_t> loadedData;
+
+    if (!cache.contains(0x1234) || !load(cache, 0x1234, makeDesc(10), loadedData) || loadedData != data)
+      throw DxvkError("Stored entry was not loaded back");
+
+    if (cache.contains(0x5678) || load(cache, 0x5678, makeDesc(10), loadedData))
+      throw DxvkError("Missing entry was loaded");
+  }
+
+  static void test_invalidEntries() {
+    const fs::path directory = resetDirectory("invalid");
+    const vector<uint8_t> data = makeData(1000, 3);
+
+    OpacityMicromapDiskCache cache;
+    cache.open(directory.string(), 1 << 20);
+    store(cache, 0x1, makeDesc(10), data);
+    store(cache, 0x2, makeDesc(10), data);
+
+    const uint64_t entrySize = cache.getSize() / 2;
+
+    // An entry baked with a different layout is never used, but is kept
+    vector<uint8_t> loadedData;
+
+    if (load(cache, 0x1, makeDesc(11), loadedData))
+      throw DxvkError("Entry with a mismatching layout was loaded");
+
+    if (!cache.contains(0x1) || !load(cache, 0x1, makeDesc(10), loadedData))
+      throw DxvkError("Entry with a mismatching layout was dropped");
+
+    // A corrupted entry is dropped
+    cache.sync();
+
+    {
+      fstream file(directory / "0000000000000002.omm", ios::binary | ios::in | ios::out);
+      file.seekp(-1, ios::end);
+      file.put('x');
+    }
+
+    if (load(cache, 0x2, makeDesc(10), loadedData) || cache.contains(0x2))
+      throw DxvkError("Corrupted entry was loaded");
+
+    cache.sync();
+
+    if (fs::exists(directory / "0000000000000002.omm"))
+      throw DxvkError("Corrupted entry was not deleted");
+
+    if (cache.getSize() != entrySize)
+      throw DxvkError("Dropped entries are still accounted for");
+  }
+
+  static void test_eviction() {
+    const fs::path directory = resetDirectory("eviction");
+    const vector<uint8_t> data = makeData(1000, 5);
+
+    OpacityMicromapDiskCache cache;
+    cache.open(directory.string(), 1 << 20);
+
+    store(cache, 0x1, makeDesc(10), data);
+    store(cache, 0x2, makeDesc(10), data);
+    store(cache, 0x3, makeDesc(10), data);
+
+    const uint64_t entrySize = cache.getSize() / 3;
+
+    // Using the oldest entry makes the second one the least recently used
+    vector<uint8_t> loadedData;
+    load(cache, 0x1, makeDesc(10), loadedData);
+
+    cache.setMaxSize(entrySize * 3);
+    store(cache, 0x4, makeDesc(10), data);
+
+    if (cache.contains(0x2) || !cache.contains(0x1) || !cache.contains(0x3) || !cache.contains(0x4))
+      throw DxvkError("Least recently used entry was not evicted");
+
+    if (cache.getSize() > entrySize * 3 || cache.getEntryCount() != 3)
+      throw DxvkError("Cache exceeds its size cap");
+
+    cache.setMaxSize(entrySize);
+
+    if (cache.getEntryCount() != 1 || !cache.contains(0x4))
+      throw DxvkError("Lowering the size cap did not evict the least recently used entries");
+
+    cache.sync();
+
+    if (fs::exists(directory / "0000000000000003.omm") || !fs::exists(directory / "0000000000000004.omm"))
+      throw DxvkError("Evicted entries were not deleted");
+
+    // Entries which can never fit are not stored
+    if (store(cache, 0x5, makeDesc(20), makeData(2000, 1)) || cache.contains(0x5))
+      throw DxvkError("Entry larger than the size cap was stored");
+  }
+
+  static void test_export() {
+    const fs::path directory = resetDirectory("export_source");
+    const fs::path modDirectory = resetDirectory("export_mod");
+    const vector<uint8_t> data = makeData(1000, 9);
+
+    {
+      OpacityMicromapDiskCache cache;
+      cache.open(directory.string(), 1 << 20);
+      store(cache, 0x1, makeDesc(10), data);
+      store(cache, 0x2, makeDesc(10), data);
+
+      if (cache.exportTo(modDirectory.string()) != 2)
+        throw DxvkError("Entries were not exported");
+    }
+
+    // A player's empty cache picks up the entries shipped with the mod
+    OpacityMicromapDiskCache cache;
+    cache.open(resetDirectory("export_player").string(), 1 << 20);
+    cache.addReadOnlyDirectory(modDirectory.string());
+
+    vector<uint8_t> loadedData;
+
+    if (!load(cache, 0x2, makeDesc(10), loadedData) || loadedData != data)
+      throw DxvkError("Exported entry was not loaded");
+
+    // Read-only entries don't count towards the size cap and are never evicted
+    if (cache.getSize() != 0)
+      throw DxvkError("Read-only entries are accounted for in the writable cache");
+
+    cache.setMaxSize(0);
+
+    if (!cache.contains(0x1) || !fs::exists(modDirectory / "0000000000000001.omm"))
+      throw DxvkError("Read-only entry was evicted");
+  }
+};
+
+int main() {
+  try {
+    OpacityMicromapDiskCacheTestApp::run();
+  }
+  catch (const dxvk::DxvkError& e) {
+    cerr << e.message() << endl;
+    return -1;
+  }
+
+  return 0;
+}
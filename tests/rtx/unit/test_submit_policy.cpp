@@ -0,0 +1,184 @@
+/*
+* Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a
+* copy of this software and associated documentation files (the "Software"),
+* to deal in the Software without restriction, including without limitation
+* the rights to use, copy, modify, merge, publish, distribute, sublicense,
+* and/or sell copies of the Software, and to permit persons to whom the
+* Software is furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+* THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+* FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+* DEALINGS IN THE SOFTWARE.
+*/
+#include <iostream>
+#include <sstream>
+
+#include "../../test_utils.h"
+#include "../../../src/dxvk/dxvk_submit_policy.h"
+
+using namespace dxvk;
+using namespace std;
+
+class SubmitPolicyTestApp {
+public:
+  static void run() {
+    cout << "Begin trace parsing test" << endl;
+    test_parse();
+    cout << "Begin burst test" << endl;
+    test_burst();
+    cout << "Begin sparse test" << endl;
+    test_sparse();
+    cout << "Begin large batch test" << endl;
+    test_large();
+    cout << "Begin trace replay test" << endl;
+    test_replay();
+    cout << "Submission policies successfully tested" << endl;
+  }
+
+private:
+  static vector<DxvkSubmitTraceEvent> makeTrace(uint32_t count, uint64_t intervalUs, uint64_t bytes) {
+    vector<DxvkSubmitTraceEvent> events(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+      events[i].timeUs = 1000 + i * intervalUs;
+      events[i].copiedBytes = bytes;
+      events[i].commandCount = 1;
+    }
+
+    return events;
+  }
+
+  static DxvkSubmitSimulatorResult simulate(DxvkSubmitPolicyType type, const vector<DxvkSubmitTraceEvent>& events) {
+    DxvkSubmitPolicyParams params;
+    auto policy = DxvkSubmitPolicy::create(type, params);
+
+    DxvkSubmitSimulator simulator { DxvkSubmitSimulatorParams() };
+    DxvkSubmitSimulatorResult result = simulator.run(*policy, events);
+
+    cout << "  submits: " << result.submitCount
+         << ", gpu busy: " << result.gpuBusyUs << " us"
+         << ", gpu idle: " << result.gpuIdleUs << " us"
+         << ", mean latency: " << result.meanLatencyUs << " us" << endl;
+    return result;
+  }
+
+  static void test_parse() {
+    istringstream stream("# time bytes commands\n100 4096 1\n\n250 0 3\n");
+    auto events = DxvkSubmitSimulator::parseTrace(stream);
+
+    if (events.size() != 2)
+      throw DxvkError("Unexpected number of trace events");
+
+    if (events[1].timeUs != 250 || events[1].copiedBytes != 0 || events[1].commandCount != 3)
+      throw DxvkError("Trace event did not round trip");
+  }
+
+  static void test_burst() {
+    // Many small uploads arriving faster than the GPU can retire
+    // individual submissions, e.g. a burst of texture loads
+    auto events = makeTrace(500, 20, 256 << 10);
+
+    auto immediate = simulate(DxvkSubmitPolicyType::Immediate, events);
+    auto batched = simulate(DxvkSubmitPolicyType::Batched, events);
+    auto adaptive = simulate(DxvkSubmitPolicyType::Adaptive, events);
+
+    if (immediate.submitCount != events.size())
+      throw DxvkError("Immediate policy must submit every request");
+
+    if (batched.submitCount >= immediate.submitCount || adaptive.submitCount >= immediate.submitCount)
+      throw DxvkError("Batching policies did not merge submissions");
+
+    if (adaptive.gpuBusyUs >= immediate.gpuBusyUs)
+      throw DxvkError("Merging submissions did not reduce GPU time");
+  }
+
+  static void test_sparse() {
+    // Requests spaced further apart than their GPU time, the
+    // adaptive policy should not hold back work from an idle GPU
+    auto events = makeTrace(100, 500, 64 << 10);
+
+    auto batched = simulate(DxvkSubmitPolicyType::Batched, events);
+    auto adaptive = simulate(DxvkSubmitPolicyType::Adaptive, events);
+
+    if (adaptive.submitCount != events.size())
+      throw DxvkError("Adaptive policy delayed work while the GPU was idle");
+
+    if (adaptive.meanLatencyUs >= batched.meanLatencyUs)
+      throw DxvkError("Adaptive policy did not reduce latency on an idle GPU");
+  }
+
+  static void test_replay() {
+    // A trace as written by DxvkDevice, each request carries the work
+    // recorded since the previous one: 1 MiB and one draw every 10 us
+    DxvkSubmitPolicyParams params;
+    DxvkSubmitSimulatorParams simulatorParams;
+
+    const uint32_t numRequests = 32;
+    const uint64_t bytesPerRequest = 1 << 20;
+
+    ostringstream trace;
+    trace << "# time_us copied_bytes command_count (since the previous request)" << endl;
+
+    for (uint32_t i = 0; i < numRequests; i++)
+      trace << 1000 + i * 10 << " " << bytesPerRequest << " " << 1 << endl;
+
+    istringstream stream(trace.str());
+    auto events = DxvkSubmitSimulator::parseTrace(stream);
+
+    auto result = simulate(DxvkSubmitPolicyType::Batched, events);
+
+    // The batch must only reach the cost limit once 16 requests have been merged,
+    // well before the delay limit. Accumulating totals would split it earlier.
+    const uint64_t requestCost = bytesPerRequest + params.commandCost;
+    const uint64_t requestsPerBatch = (params.maxBatchCost + requestCost - 1) / requestCost;
+
+    if (result.submitCount != numRequests / requestsPerBatch)
+      throw DxvkError("Replayed trace was not batched by the work of its requests");
+
+    // All of the recorded work is executed exactly once
+    const double expectedBusyUs = double(result.submitCount) * simulatorParams.submitOverheadUs
+      + simulatorParams.usPerMiB * double(numRequests * requestCost) / double(1u << 20);
+
+    if (result.gpuBusyUs != uint64_t(expectedBusyUs))
+      throw DxvkError("Replayed trace did not execute the recorded work exactly once");
+  }
+
+  static void test_large() {
+    // A single batch exceeding the cost limit must go out right away
+    DxvkSubmitPolicyParams params;
+
+    DxvkSubmitPolicyInput input;
+    input.timeUs = 1000;
+    input.lastSubmitUs = 1000;
+    input.copiedBytes = params.maxBatchCost;
+    input.pendingSubmissions = 4;
+
+    for (auto type : { DxvkSubmitPolicyType::Batched, DxvkSubmitPolicyType::Adaptive }) {
+      auto policy = DxvkSubmitPolicy::create(type, params);
+
+      if (!policy->shouldSubmit(input))
+        throw DxvkError("Large batch was not submitted");
+    }
+  }
+};
+
+int main() {
+  try {
+    SubmitPolicyTestApp::run();
+  }
+  catch (const dxvk::DxvkError& e) {
+    cerr << e.message() << endl;
+    return -1;
+  }
+
+  return 0;
+}